@@ -0,0 +1,397 @@
+// vinflate throughput benchmark
+//
+// Generates a deterministic corpus, compresses each part with stored, fixed
+// and dynamic blocks, then times decompression, checksums and gzip header
+// parsing. With BENCH_ZLIB defined, system zlib is timed on the same data.
+//
+// Usage: vinflate [-j] [-s size] [-t ms] [filter]
+//   -j      Print one JSON object per result, instead of a table
+//   -s      Size of each corpus part in bytes (default 4M)
+//   -t      Length of each timed batch in milliseconds (default 100)
+//   filter  Only run benchmarks whose name contains this string
+#define _POSIX_C_SOURCE 200809L
+#include <stdarg.h>
+#include "../v.h"
+#define VENFLATE_IMPL
+#include "../vinflate.h"
+#define VDEFLATE_IMPL
+#include "../vdeflate.h"
+
+#ifdef BENCH_ZLIB
+#include <zlib.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_CYCLES
+static inline uint64_t cycles(void) {
+	return __rdtsc();
+}
+#else
+static inline uint64_t cycles(void) {
+	return 0;
+}
+#endif
+
+static _Bool json;
+static uint64_t batch_ns = 100000000;
+static const char *filter;
+
+// Corpus generation {{{
+static uint64_t rng = 0x9e3779b97f4a7c15;
+static uint32_t rnd(void) {
+	rng ^= rng << 13;
+	rng ^= rng >> 7;
+	rng ^= rng << 17;
+	return rng >> 32;
+}
+
+// Pick from n choices, favouring the first ones roughly like word frequencies do
+static uint32_t skewed(uint32_t n) {
+	uint32_t a = rnd() % n, b = rnd() % n;
+	return a < b ? a : b;
+}
+
+struct buf {
+	unsigned char *data;
+	size_t len, cap;
+};
+
+// Append formatted text, stopping once the buffer is full
+static void put(struct buf *b, const char *fmt, ...) {
+	if (b->len >= b->cap) return;
+	va_list ap;
+	va_start(ap, fmt);
+	int n = vsnprintf((char *)b->data + b->len, b->cap - b->len + 1, fmt, ap);
+	va_end(ap);
+	b->len += n < 0 ? 0 : (size_t)n;
+	if (b->len > b->cap) b->len = b->cap;
+}
+
+static const char *const words[] = {
+	"the", "of", "and", "to", "in", "a", "is", "that", "for", "it", "as", "was", "with", "be", "by", "on",
+	"not", "he", "this", "are", "or", "his", "from", "at", "which", "but", "have", "an", "had", "they",
+	"you", "were", "their", "one", "all", "we", "can", "her", "has", "there", "been", "if", "more", "when",
+	"will", "would", "who", "so", "no", "decompression", "window", "stream", "block", "symbol", "length",
+	"distance", "literal", "huffman", "checksum", "archive", "member", "header", "footer", "buffer",
+};
+static const size_t nwords = sizeof words / sizeof *words;
+
+static void gen_text(struct buf *b) {
+	while (b->len < b->cap) {
+		unsigned n = 5 + rnd() % 15;
+		for (unsigned i = 0; i < n; i++) {
+			const char *w = words[skewed(nwords)];
+			if (i) put(b, " %s", w);
+			else put(b, "%c%s", w[0] - 'a' + 'A', w + 1);
+		}
+		put(b, rnd() % 5 ? ". " : ".\n\n");
+	}
+}
+
+static void gen_logs(struct buf *b) {
+	static const char *const levels[] = {"INFO", "INFO", "INFO", "DEBUG", "WARN", "ERROR"};
+	static const char *const paths[] = {"/", "/index.html", "/api/v1/users", "/api/v1/orders", "/static/app.js", "/login"};
+	static const int status[] = {200, 200, 200, 304, 404, 500};
+	uint64_t t = 1700000000000;
+	while (b->len < b->cap) {
+		t += rnd() % 2000;
+		put(b, "%" PRIu64 ".%03u %-5s 10.%u.%u.%u \"GET %s\" %d %u %uus\n",
+			t / 1000, (unsigned)(t % 1000), levels[rnd() % 6], rnd() % 4, rnd() % 256, rnd() % 256,
+			paths[skewed(6)], status[skewed(6)], rnd() % 50000, rnd() % 100000);
+	}
+}
+
+static void gen_json(struct buf *b) {
+	static const char *const names[] = {"alice", "bob", "carol", "dave", "eve", "mallory", "trent", "peggy"};
+	put(b, "[");
+	for (unsigned id = 0; b->len < b->cap; id++) {
+		put(b, "%s{\"id\":%u,\"user\":{\"name\":\"%s\",\"age\":%u,\"active\":%s},\"score\":%u.%02u,\"tags\":[",
+			id ? ",\n" : "\n", id, names[rnd() % 8], 18 + rnd() % 60, rnd() % 2 ? "true" : "false",
+			rnd() % 1000, rnd() % 100);
+		unsigned ntags = rnd() % 4;
+		for (unsigned i = 0; i < ntags; i++) put(b, "%s\"%s\"", i ? "," : "", words[skewed(nwords)]);
+		put(b, "]}");
+	}
+}
+
+// Fixed-size records of slowly changing sensor readings
+static void gen_binary(struct buf *b) {
+	uint32_t t = 0;
+	int16_t v[4] = {0};
+	float f = 0;
+	while (b->len < b->cap) {
+		unsigned char rec[24];
+		t += 10 + rnd() % 3;
+		for (int i = 0; i < 4; i++) v[i] += (int16_t)(rnd() % 9) - 4;
+		f += (float)(rnd() % 1000) / 1000 - 0.5f;
+		memcpy(rec, &t, 4);
+		memcpy(rec + 4, v, 8);
+		memcpy(rec + 12, &f, 4);
+		uint64_t id = rnd() % 16;
+		memcpy(rec + 16, &id, 8);
+		size_t n = b->cap - b->len < sizeof rec ? b->cap - b->len : sizeof rec;
+		memcpy(b->data + b->len, rec, n);
+		b->len += n;
+	}
+}
+
+// Already-compressed data: text compressed at the default level
+static void gen_compressed(struct buf *b) {
+	struct buf text = {malloc(2 * b->cap + 1), 0, 2 * b->cap};
+	gen_text(&text);
+	size_t len = vdeflate_bound(text.len);
+	unsigned char *z = malloc(len);
+	vdeflate(text.data, text.len, z, &len, VINF_STREAM_RAW, VDEF_LEVEL_DEFAULT);
+	while (b->len < b->cap && len) {
+		size_t n = b->cap - b->len < len ? b->cap - b->len : len;
+		memcpy(b->data + b->len, z, n);
+		b->len += n;
+	}
+	free(z);
+	free(text.data);
+}
+
+static const struct {
+	const char *name;
+	void (*gen)(struct buf *b);
+} corpus[] = {
+	{"text", gen_text},
+	{"logs", gen_logs},
+	{"json", gen_json},
+	{"binary", gen_binary},
+	{"compressed", gen_compressed},
+};
+static const size_t ncorpus = sizeof corpus / sizeof *corpus;
+
+static const struct {
+	const char *name;
+	int level, strategy;
+} variants[] = {
+	{"stored", VDEF_LEVEL_STORE, VDEF_STRATEGY_DEFAULT},
+	{"fixed", VDEF_LEVEL_DEFAULT, VDEF_STRATEGY_FIXED},
+	{"dynamic", VDEF_LEVEL_DEFAULT, VDEF_STRATEGY_DEFAULT},
+};
+static const size_t nvariants = sizeof variants / sizeof *variants;
+
+// Compress data into a gzip member
+static unsigned char *gzip(const unsigned char *data, size_t len, int level, int strategy, size_t *z_len) {
+	static struct vdef_stream s;
+	vdef_stream_init(&s, VINF_STREAM_GZIP, level);
+	s.strategy = strategy;
+	size_t bound = vdeflate_bound(len);
+	unsigned char *z = malloc(bound);
+	s.inp = data;
+	s.inp_len = len;
+	s.out = z;
+	s.out_len = bound;
+	vdeflate_stream(&s, VDEF_FINISH);
+	if (!s.done) panic("Compressed data exceeds bound");
+	*z_len = s.total_out;
+	return z;
+}
+// }}}
+
+// Timing {{{
+struct ctx {
+	const unsigned char *inp;
+	size_t inp_len;
+	unsigned char *out;
+	size_t out_len;
+	uint32_t check;
+#ifdef BENCH_ZLIB
+	z_stream zs;
+#endif
+};
+
+// Run fn in batches of at least batch_ns, and report the fastest batch. bytes
+// is the amount of data each call processes
+static void bench(const char *name, const char *part, const char *variant, void (*fn)(struct ctx *), struct ctx *c, size_t bytes) {
+	char full[128];
+	snprintf(full, sizeof full, "%s/%s/%s", name, part, variant);
+	if (filter && !strstr(full, filter)) return;
+
+	fn(c);
+	double best_ns = 0, best_cyc = 0;
+	for (int i = 0; i < 5; i++) {
+		uint64_t n = 0, t0 = nanotime(), c0 = cycles(), t;
+		do {
+			fn(c);
+			n++;
+		} while ((t = nanotime()) - t0 < batch_ns);
+		double ns = (double)(t - t0) / n, cyc = (double)(cycles() - c0) / n;
+		if (!i || ns < best_ns) {
+			best_ns = ns;
+			best_cyc = cyc;
+		}
+	}
+
+	double mbs = bytes / best_ns * 1e3;
+	if (json) {
+		printf("{\"name\":\"%s\",\"corpus\":\"%s\",\"variant\":\"%s\",\"bytes\":%zu,\"ns\":%.1f,\"mb_s\":%.2f,",
+			name, part, variant, bytes, best_ns, mbs);
+#ifdef HAVE_CYCLES
+		printf("\"cycles_per_byte\":%.3f}\n", best_cyc / bytes);
+#else
+		printf("\"cycles_per_byte\":null}\n");
+#endif
+	} else {
+		printf("%-18s %-10s %-8s %10.1f MB/s %8.3f cyc/B\n", name, part, variant, mbs, best_cyc / bytes);
+	}
+	fflush(stdout);
+}
+// }}}
+
+// Benchmarks {{{
+static void run_vinflate(struct ctx *c) {
+	struct vinf_gzip hdr;
+	if (vinf_read_gzip(c->inp, c->inp_len, &hdr)) panic("Bad gzip header");
+	hdr.data.out = c->out;
+	if (vinflate(hdr.data)) panic("vinflate failed");
+}
+
+static void run_stream(struct ctx *c) {
+	static struct vinf_stream s;
+	vinf_stream_init(&s, VINF_STREAM_GZIP);
+	s.inp = c->inp;
+	s.inp_len = c->inp_len;
+	s.out = c->out;
+	s.out_len = c->out_len;
+	if (vinflate_stream(&s) || !s.done) panic("vinflate_stream failed");
+}
+
+static void run_crc32(struct ctx *c) {
+	c->check = vinf_crc32_buf(0, c->inp, c->inp_len);
+}
+
+static void run_adler32(struct ctx *c) {
+	c->check = vinf_adler32(1, c->inp, c->inp_len);
+}
+
+static void run_read_gzip(struct ctx *c) {
+	struct vinf_gzip hdr;
+	if (vinf_read_gzip(c->inp, c->inp_len, &hdr)) panic("Bad gzip header");
+	c->check = hdr.f_hcrc;
+}
+
+#ifdef BENCH_ZLIB
+static void run_zlib_inflate(struct ctx *c) {
+	inflateReset(&c->zs);
+	c->zs.next_in = (unsigned char *)c->inp;
+	c->zs.avail_in = c->inp_len;
+	c->zs.next_out = c->out;
+	c->zs.avail_out = c->out_len;
+	if (inflate(&c->zs, Z_FINISH) != Z_STREAM_END) panic("zlib inflate failed");
+}
+
+static void run_zlib_crc32(struct ctx *c) {
+	c->check = crc32(0, c->inp, c->inp_len);
+}
+
+static void run_zlib_adler32(struct ctx *c) {
+	c->check = adler32(1, c->inp, c->inp_len);
+}
+#endif
+
+// A member with every optional header field, and a tiny body
+static unsigned char *make_header(size_t *len) {
+	static const char extra[] = "AB\x10\0sixteen bytes here!!";
+	static const char name[] = "benchmark-corpus-file-name.txt";
+	static const char comment[] = "A comment long enough to make scanning for its end take some time";
+	size_t xlen = sizeof extra - 1;
+
+	unsigned char *p = malloc(12 + xlen + sizeof name + sizeof comment + 2 + 32);
+	size_t n = 0;
+	unsigned char fixed[10] = {0x1f, 0x8b, 8, VENF_GZ_EXTRA | VENF_GZ_NAME | VENF_GZ_COMMENT | VENF_GZ_HCRC, 0, 0, 0, 0, 0, 3};
+	memcpy(p, fixed, 10);
+	n = 10;
+	p[n++] = xlen;
+	p[n++] = xlen >> 8;
+	memcpy(p + n, extra, xlen);
+	n += xlen;
+	memcpy(p + n, name, sizeof name);
+	n += sizeof name;
+	memcpy(p + n, comment, sizeof comment);
+	n += sizeof comment;
+	uint32_t hcrc = vinf_crc32_buf(0, p, n);
+	p[n++] = hcrc;
+	p[n++] = hcrc >> 8;
+
+	// An empty fixed block, then the footer of an empty member
+	static const unsigned char body[] = {3, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+	memcpy(p + n, body, sizeof body);
+	*len = n + sizeof body;
+	return p;
+}
+// }}}
+
+int main(int argc, char **argv) {
+	size_t size = 4 << 20;
+	int opt;
+	while ((opt = getopt(argc, argv, "js:t:")) != -1) {
+		switch (opt) {
+		case 'j': json = 1; break;
+		case 's': size = strtoull(optarg, NULL, 0); break;
+		case 't': batch_ns = strtoull(optarg, NULL, 0) * 1000000; break;
+		default:
+			fprintf(stderr, "Usage: %s [-j] [-s size] [-t ms] [filter]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (optind < argc) filter = argv[optind];
+
+	struct ctx c = {0};
+#ifdef BENCH_ZLIB
+	if (inflateInit2(&c.zs, 16 + MAX_WBITS) != Z_OK) panic("inflateInit2 failed");
+#endif
+
+	size_t hdr_len;
+	unsigned char *hdr = make_header(&hdr_len);
+	c.inp = hdr;
+	c.inp_len = hdr_len;
+	bench("vinf_read_gzip", "header", "-", run_read_gzip, &c, hdr_len);
+	free(hdr);
+
+	for (size_t i = 0; i < ncorpus; i++) {
+		struct buf b = {malloc(size + 1), 0, size};
+		corpus[i].gen(&b);
+		c.out = malloc(b.len + 1);
+		c.out_len = b.len;
+
+		c.inp = b.data;
+		c.inp_len = b.len;
+		bench("vinf_crc32_buf", corpus[i].name, "-", run_crc32, &c, b.len);
+		bench("vinf_adler32", corpus[i].name, "-", run_adler32, &c, b.len);
+#ifdef BENCH_ZLIB
+		bench("zlib_crc32", corpus[i].name, "-", run_zlib_crc32, &c, b.len);
+		bench("zlib_adler32", corpus[i].name, "-", run_zlib_adler32, &c, b.len);
+#endif
+
+		for (size_t j = 0; j < nvariants; j++) {
+			size_t z_len;
+			unsigned char *z = gzip(b.data, b.len, variants[j].level, variants[j].strategy, &z_len);
+			c.inp = z;
+			c.inp_len = z_len;
+
+			// Check the output once, so the timings are of correct decoding
+			memset(c.out, 0, b.len);
+			run_vinflate(&c);
+			if (memcmp(c.out, b.data, b.len)) panic("vinflate output differs from the input");
+
+			bench("vinflate", corpus[i].name, variants[j].name, run_vinflate, &c, b.len);
+			bench("vinflate_stream", corpus[i].name, variants[j].name, run_stream, &c, b.len);
+#ifdef BENCH_ZLIB
+			bench("zlib_inflate", corpus[i].name, variants[j].name, run_zlib_inflate, &c, b.len);
+#endif
+			free(z);
+		}
+
+		free(c.out);
+		free(b.data);
+	}
+
+#ifdef BENCH_ZLIB
+	inflateEnd(&c.zs);
+#endif
+	return 0;
+}
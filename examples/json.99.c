@@ -1,6 +1,8 @@
 #include <ctype.h>
 #include <stdio.h>
 #include "../v.h"
+#define VARENA_IMPL
+#include "../varena.h"
 #define VJSON_IMPL
 #include "../vjson.h"
 
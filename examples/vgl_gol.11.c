@@ -2,6 +2,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "glad/glad.h"
+#define VENFLATE_IMPL
+#include "../vinflate.h"
 #define VGL_IMPL
 #include "../vgl.h"
 
@@ -1,5 +1,7 @@
 // GPU-accelerated image viewer
 #include "glad/glad.h"
+#define VENFLATE_IMPL
+#include "../vinflate.h"
 #define VGL_IMPL
 #include "../vgl.h"
 
@@ -48,14 +50,21 @@ int main(int argc, char **argv) {
 	// Load texture
 	GLuint tex;
 	glGenTextures(1, &tex);
-	struct vgl_image img = vgl_load_farbfeld(filename);
+	size_t fnlen = strlen(filename);
+	struct vgl_image img;
+	if (fnlen >= 4 && !strcmp(filename + fnlen - 4, ".png")) {
+		img = vgl_load_png(filename, GL_UNSIGNED_BYTE);
+	} else {
+		img = vgl_load_farbfeld(filename);
+	}
 	if (!img.data) {
 		fprintf(stderr, "Error opening image\n");
 		return 1;
 	}
 	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(GL_TEXTURE_RECTANGLE, tex);
-	glTexImage2D(GL_TEXTURE_RECTANGLE, 0, GL_RGBA16, img.width, img.height, 0, GL_RGBA, GL_UNSIGNED_SHORT, img.data);
+	GLint internal = img.type == GL_UNSIGNED_BYTE ? GL_RGBA8 : GL_RGBA16;
+	glTexImage2D(GL_TEXTURE_RECTANGLE, 0, internal, img.width, img.height, 0, GL_RGBA, img.type, img.data);
 	glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 
@@ -1,4 +1,6 @@
 #include "glad/glad.h"
+#define VENFLATE_IMPL
+#include "../vinflate.h"
 #define VGL_IMPL
 #include "../vgl.h"
 
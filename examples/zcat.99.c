@@ -1,33 +1,51 @@
 #include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
 #define VENFLATE_IMPL
 #include "../v.h"
 #include "../vinflate.h"
 
 int main(int argc, char **argv) {
-	if (argc < 2) {
-		fprintf(stderr, "Usage: %s FILE.gz\n", argv[0]);
+	if (argc > 2) {
+		fprintf(stderr, "Usage: %s [FILE.gz]\n", argv[0]);
 		return 1;
 	}
 
-	size_t len;
-	unsigned char *gz = mapfile(argv[1], &len);
-	if (!gz) panic("Opening file failed");
-
-	struct vinf_gzip hdr;
-	enum vinf_error err = vinf_read_gzip(gz, len, &hdr);
-	if (err) panic("GZIP header corrupt: %s", vinf_error_string[err]);
-
-	fprintf(stderr, "Name:\t%s\nLength:\t%d\nCRC:\t%08x\n\n", hdr.f_name, hdr.data.out_len, hdr.data.out_crc);
-
-	hdr.data.out = malloc(hdr.data.out_len);
-	err = vinflate(hdr.data);
-	if (err) panic("Compressed data corrupt: %s", vinf_error_string[err]);
-
-	fwrite(hdr.data.out, 1, hdr.data.out_len, stdout);
-	fflush(stdout);
-	fputs("\u00a7\n\n", stderr);
+	int fd = 0;
+	if (argc == 2) {
+		fd = open(argv[1], O_RDONLY);
+		if (fd < 0) panic("Opening file failed");
+	}
 
-	free(hdr.data.out);
+	// Output goes straight from the decoder's window to stdout
+	static struct vinf_stream s;
+	static unsigned char inp[1 << 16];
+	vinf_stream_init(&s, VINF_STREAM_GZIP);
+	s.sink = vinf_fd_sink(STDOUT_FILENO);
+
+	ssize_t n;
+	while ((n = read(fd, inp, sizeof inp)) > 0) {
+		s.inp = inp;
+		s.inp_len = n;
+
+		do {
+			// A gzip file may contain multiple members, which are concatenated
+			if (s.done) {
+				const unsigned char *p = s.inp;
+				size_t len = s.inp_len;
+				vinf_stream_init(&s, VINF_STREAM_GZIP);
+				s.sink = vinf_fd_sink(STDOUT_FILENO);
+				s.inp = p;
+				s.inp_len = len;
+			}
+
+			enum vinf_error err = vinflate_stream(&s);
+			if (err == VENF_ERR_WRITE) panic("Writing output failed");
+			if (err) panic("Compressed data corrupt: %s", vinf_error_string[err]);
+		} while (s.inp_len);
+	}
+	if (n < 0) panic("Reading file failed");
+	if (!s.done) panic("Compressed data corrupt: %s", vinf_error_string[VENF_ERR_EOF]);
 
 	return 0;
 }
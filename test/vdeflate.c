@@ -0,0 +1,234 @@
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "vtest.h"
+#define VENFLATE_IMPL
+#include "../vinflate.h"
+#define VDEFLATE_IMPL
+#include "../vdeflate.h"
+
+#define TEST_TEXT "data/vinflate/text.txt"
+
+static unsigned char *readf(const char *fn, size_t *len) {
+	int fd = open(fn, O_RDONLY);
+	if (fd < 0) return NULL;
+
+	struct stat st;
+	if (fstat(fd, &st)) {
+		close(fd);
+		return NULL;
+	}
+
+	unsigned char *buf = malloc(st.st_size+1);
+	ssize_t bufl = read(fd, buf, st.st_size);
+	close(fd);
+	if (bufl < 0) {
+		free(buf);
+		return NULL;
+	}
+
+	if (len) *len = bufl;
+	return buf;
+}
+
+// Several copies of the text with some bytes changed, long enough for the
+// window to slide several times, followed by incompressible data
+static unsigned char *make_big(const unsigned char *text, size_t text_len, size_t *len) {
+	size_t n = 8 * text_len + 40000;
+	unsigned char *buf = malloc(n);
+	uint32_t x = 12345;
+	for (size_t i = 0; i < n; i++) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		buf[i] = i < 8 * text_len && x % 100 ? text[i % text_len] : x >> 24;
+	}
+	*len = n;
+	return buf;
+}
+
+// Decompress data in the given format, and compare it to the expected data
+static void check_decompress(const unsigned char *z, size_t z_len, int format, const unsigned char *expect, size_t expect_len, int *_vtest_status) {
+	unsigned char *out = malloc(expect_len + 1);
+	size_t out_len = expect_len;
+
+	if (format == VINF_STREAM_GZIP) {
+		struct vinf_gzip hdr;
+		vassert_eq(vinf_read_gzip(z, z_len, &hdr), VENF_ERR_SUCCESS);
+		vassert_eq_u(hdr.data.out_len, expect_len);
+		hdr.data.out = out;
+		enum vinf_error err = vinflate(hdr.data);
+		vassert_msg(!err, "gzip: %s", vinf_error_string[err]);
+	} else if (format == VINF_STREAM_ZLIB) {
+		enum vinf_error err = vinflate_zlib(z, z_len, out, &out_len, NULL, 0);
+		vassert_msg(!err, "zlib: %s", vinf_error_string[err]);
+		vassert_eq_u(out_len, expect_len);
+	} else {
+		static struct vinf_stream s;
+		vinf_stream_init(&s, VINF_STREAM_RAW);
+		s.inp = z;
+		s.inp_len = z_len;
+		s.out = out;
+		s.out_len = expect_len + 1;
+		enum vinf_error err = vinflate_stream(&s);
+		vassert_msg(!err, "raw: %s", vinf_error_string[err]);
+		vassert(s.done);
+		vassert_eq_u(s.inp_len, 0);
+		vassert_eq_u(s.total_out, expect_len);
+	}
+
+	vassert(!memcmp(out, expect, expect_len));
+	free(out);
+}
+
+// Compress at the given level, and check the result decompresses
+static size_t check_roundtrip(const unsigned char *data, size_t len, int format, int level, int *_vtest_status) {
+	size_t bound = vdeflate_bound(len);
+	unsigned char *z = malloc(bound);
+	size_t z_len = bound;
+	enum vinf_error err = vdeflate(data, len, z, &z_len, format, level);
+	vassert_msg(!err, "level %d: %s", level, vinf_error_string[err]);
+	vassert(z_len <= bound);
+	check_decompress(z, z_len, format, data, len, _vtest_status);
+	free(z);
+	return z_len;
+}
+
+VTEST(test_levels) {
+	size_t text_len;
+	unsigned char *text = readf(TEST_TEXT, &text_len);
+	if (!vassert_not_null(text)) return;
+
+	size_t sizes[VDEF_LEVEL_BEST + 1];
+	for (int level = 0; level <= VDEF_LEVEL_BEST; level++) {
+		sizes[level] = check_roundtrip(text, text_len, VINF_STREAM_GZIP, level, _vtest_status);
+	}
+
+	// Stored data has a little overhead, and higher levels compress better
+	vassert(sizes[VDEF_LEVEL_STORE] > text_len);
+	vassert(sizes[VDEF_LEVEL_FASTEST] < text_len / 2);
+	vassert(sizes[VDEF_LEVEL_DEFAULT] < sizes[VDEF_LEVEL_FASTEST]);
+	vassert(sizes[VDEF_LEVEL_BEST] <= sizes[VDEF_LEVEL_DEFAULT]);
+
+	free(text);
+}
+
+VTEST(test_formats) {
+	size_t text_len, big_len;
+	unsigned char *text = readf(TEST_TEXT, &text_len);
+	if (!vassert_not_null(text)) return;
+	unsigned char *big = make_big(text, text_len, &big_len);
+
+	static const int formats[] = {VINF_STREAM_RAW, VINF_STREAM_GZIP, VINF_STREAM_ZLIB};
+	static const int levels[] = {0, 1, 3, 4, 6, 9};
+	for (size_t i = 0; i < sizeof formats / sizeof *formats; i++) {
+		for (size_t j = 0; j < sizeof levels / sizeof *levels; j++) {
+			check_roundtrip((const unsigned char *)"", 0, formats[i], levels[j], _vtest_status);
+			check_roundtrip((const unsigned char *)"a", 1, formats[i], levels[j], _vtest_status);
+			check_roundtrip(big, big_len, formats[i], levels[j], _vtest_status);
+		}
+	}
+
+	// A small output buffer is reported as overflow
+	unsigned char z[100];
+	size_t z_len = sizeof z;
+	vassert_eq(vdeflate(text, text_len, z, &z_len, VINF_STREAM_GZIP, 6), VENF_ERR_OVERFLOW);
+
+	free(big);
+	free(text);
+}
+
+VTEST(test_strategy) {
+	size_t text_len;
+	unsigned char *text = readf(TEST_TEXT, &text_len);
+	if (!vassert_not_null(text)) return;
+
+	static struct vdef_stream s;
+	vdef_stream_init(&s, VINF_STREAM_RAW, VDEF_LEVEL_DEFAULT);
+	s.strategy = VDEF_STRATEGY_FIXED;
+	size_t bound = vdeflate_bound(text_len);
+	unsigned char *z = malloc(bound);
+	s.inp = text;
+	s.inp_len = text_len;
+	s.out = z;
+	s.out_len = bound;
+	vdeflate_stream(&s, VDEF_FINISH);
+	vassert(s.done);
+
+	// The first block uses the fixed code, and the result is bigger than
+	// with dynamic blocks allowed
+	vassert_eq(z[0] >> 1 & 3, 1);
+	size_t dyn_len = bound;
+	unsigned char *dyn = malloc(bound);
+	vassert_eq(vdeflate(text, text_len, dyn, &dyn_len, VINF_STREAM_RAW, VDEF_LEVEL_DEFAULT), VENF_ERR_SUCCESS);
+	vassert(dyn_len < s.total_out && s.total_out < text_len);
+	check_decompress(z, s.total_out, VINF_STREAM_RAW, text, text_len, _vtest_status);
+
+	free(dyn);
+	free(z);
+	free(text);
+}
+
+VTEST(test_stream) {
+	size_t text_len, big_len;
+	unsigned char *text = readf(TEST_TEXT, &text_len);
+	if (!vassert_not_null(text)) return;
+	unsigned char *big = make_big(text, text_len, &big_len);
+
+	// Feed input and output space in small chunks, with a sync flush part way.
+	// Output space is given until some is left over, at which point all the
+	// input has been consumed
+	static struct vdef_stream s;
+	vdef_stream_init(&s, VINF_STREAM_GZIP, VDEF_LEVEL_DEFAULT);
+	unsigned char *z = malloc(vdeflate_bound(big_len) + 16);
+	size_t inp_off = 0, sync_out = 0;
+	while (!s.done) {
+		size_t n = big_len - inp_off < 1000 ? big_len - inp_off : 1000;
+		int flush = inp_off + n == big_len ? VDEF_FINISH : VDEF_NO_FLUSH;
+		if (inp_off < 100000 && inp_off + n >= 100000) flush = VDEF_SYNC_FLUSH;
+
+		s.inp = big + inp_off;
+		s.inp_len = n;
+		do {
+			s.out = z + s.total_out;
+			s.out_len = 300;
+			vdeflate_stream(&s, flush);
+		} while (!s.out_len);
+		vassert_eq_u(s.inp_len, 0);
+		inp_off += n;
+		if (flush == VDEF_SYNC_FLUSH) sync_out = s.total_out;
+	}
+	vassert_eq_u(s.total_in, big_len);
+
+	// Everything before the sync point decompresses, ending on an empty stored block
+	if (vassert(sync_out > 14)) {
+		vassert(!memcmp(z + sync_out - 4, "\0\0\xff\xff", 4));
+		static struct vinf_stream is;
+		static unsigned char out[100000 + 1000];
+		vinf_stream_init(&is, VINF_STREAM_GZIP);
+		is.inp = z;
+		is.inp_len = sync_out;
+		is.out = out;
+		is.out_len = sizeof out;
+		vassert_eq(vinflate_stream(&is), VENF_ERR_SUCCESS);
+		vassert(!is.done);
+		vassert(is.total_out >= 100000);
+		vassert(!memcmp(out, big, is.total_out));
+	}
+
+	check_decompress(z, s.total_out, VINF_STREAM_GZIP, big, big_len, _vtest_status);
+
+	free(z);
+	free(big);
+	free(text);
+}
+
+VTESTS_BEGIN
+	test_levels,
+	test_formats,
+	test_strategy,
+	test_stream,
+VTESTS_END
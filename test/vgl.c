@@ -3,6 +3,8 @@
 #include "../examples/glad/glad.c"
 
 #include "vtest.h"
+#define VENFLATE_IMPL
+#include "../vinflate.h"
 #define VGL_IMPL
 #include "../vgl.h"
 
@@ -165,6 +167,61 @@ VTEST(test_qeuler) {
 
 // TODO: test_load_farbfeld
 
+VTEST(test_load_png) {
+	// Each PNG decodes to the farbfeld image after it, in both 16 and 8 bits
+	static const char *files[][2] = {
+		{"png_rgba8.png", "png_color.ff"},
+		{"png_rgba8i.png", "png_color.ff"},
+		{"png_rgba16.png", "png_color.ff"},
+		{"png_pal8.png", "png_color.ff"},
+		{"png_pal4i.png", "png_color.ff"},
+		{"png_gray4.png", "png_gray.ff"},
+		{"png_gray16i.png", "png_gray.ff"},
+		{"png_rgb8.png", "png_gray.ff"},
+		{"png_graya8.png", "png_gray.ff"},
+	};
+
+	char fn[64];
+	for (size_t i = 0; i < sizeof files / sizeof *files; i++) {
+		snprintf(fn, sizeof fn, "data/vgl/%s", files[i][1]);
+		struct vgl_image ref = vgl_load_farbfeld(fn);
+		if (!vassert_not_null(ref.data)) continue;
+		size_t n = 4 * ref.width * ref.height;
+
+		snprintf(fn, sizeof fn, "data/vgl/%s", files[i][0]);
+		struct vgl_image img = vgl_load_png(fn, GL_UNSIGNED_SHORT);
+		if (vassert_msg(img.data, "%s: load failed", fn)) {
+			vassert_eq(img.type, GL_UNSIGNED_SHORT);
+			vassert_eq_u(img.width, ref.width);
+			vassert_eq_u(img.height, ref.height);
+			vassert_msg(!memcmp(img.data, ref.data, n * sizeof *img.data), "%s: 16-bit data differs", fn);
+			free(img.data);
+		}
+
+		img = vgl_load_png(fn, GL_UNSIGNED_BYTE);
+		if (vassert_msg(img.data8, "%s: load failed", fn)) {
+			vassert_eq(img.type, GL_UNSIGNED_BYTE);
+			size_t j = 0;
+			while (j < n && img.data8[j] == ref.data[j] >> 8) j++;
+			vassert_msg(j == n, "%s: 8-bit data differs at %zu", fn, j);
+			free(img.data8);
+		}
+
+		free(ref.data);
+	}
+
+	// Corrupt chunks are caught by their CRC
+	struct vgl_mbuf m = vgl_mapfile("data/vgl/png_rgba8.png");
+	if (!vassert_not_null(m.data)) return;
+	unsigned char *buf = malloc(m.len);
+	memcpy(buf, m.udata, m.len);
+	buf[m.len / 2] ^= 1;
+	vassert_null(vgl_load_png_data(buf, m.len, GL_UNSIGNED_BYTE).data);
+	vassert_null(vgl_load_png_data(m.udata, m.len - 20, GL_UNSIGNED_BYTE).data);
+	free(buf);
+	vgl_unmap(m);
+}
+
 VTEST(test_load_vmesh) {
 	struct vgl_mesh *mesh = vgl_load_vmesh("data/vgl/cube.vmsh");
 	if (!vassert_not_null(mesh)) return;
@@ -195,5 +252,6 @@ VTESTS_BEGIN
 	test_qeuler,
 
 	// TODO: test_load_farbfeld
+	test_load_png,
 	test_load_vmesh,
 VTESTS_END
@@ -0,0 +1,754 @@
+#define _DEFAULT_SOURCE
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "vtest.h"
+#define VENFLATE_IMPL
+#include "../vinflate.h"
+
+#define TEST_TEXT "data/vinflate/text.txt"
+#define TEST_DYNAMIC "data/vinflate/dynamic.gz"
+#define TEST_FIXED "data/vinflate/fixed.gz"
+#define TEST_STORED "data/vinflate/stored.gz"
+#define TEST_RUNS "data/vinflate/runs.gz"
+#define TEST_BGZF "data/vinflate/bgzf.gz"
+#define TEST_LOG "data/vinflate/log.gz" // Many blocks
+#define TEST_SEGMENT "data/vinflate/segment.raw" // Non-final DEFLATE blocks ending on a byte boundary
+#define TEST_MULTI "data/vinflate/multi.gz" // dynamic, stored, bgzf and fixed concatenated
+#define TEST_ZLIB "data/vinflate/text.zz"
+#define TEST_ZLIB_DICT "data/vinflate/dict.zz" // text after the first 8K, with the first 8K as dictionary
+
+static unsigned char *readf(const char *fn, size_t *len) {
+	int fd = open(fn, O_RDONLY);
+	if (fd < 0) return NULL;
+
+	struct stat st;
+	if (fstat(fd, &st)) {
+		close(fd);
+		return NULL;
+	}
+
+	unsigned char *buf = malloc(st.st_size+1);
+	ssize_t bufl = read(fd, buf, st.st_size);
+	close(fd);
+	if (bufl < 0) {
+		free(buf);
+		return NULL;
+	}
+
+	if (len) *len = bufl;
+	return buf;
+}
+
+// Generates the uncompressed contents of runs.gz
+static unsigned char *make_runs(size_t *len) {
+	unsigned char *buf = malloc(1 << 16), *p = buf;
+	for (int i = 0; i < 64; i++) {
+		for (int j = 0; j < i*37 % 300 + 1; j++) *p++ = 'a' + i%26;
+		for (int j = 0; j < 20; j++) {
+			for (int k = 0; k < i%7 + 1; k++) *p++ = k;
+		}
+	}
+	*len = p - buf;
+	return buf;
+}
+
+// Decompress a gzip file and compare it to the expected data
+static void check_gzip(const char *fn, const unsigned char *expect, size_t expect_len, int *_vtest_status) {
+	size_t len;
+	unsigned char *gz = readf(fn, &len);
+	if (!vassert_not_null(gz)) return;
+
+	struct vinf_gzip hdr;
+	vassert_eq(vinf_read_gzip(gz, len, &hdr), VENF_ERR_SUCCESS);
+	vassert_eq_u(hdr.data.out_len, expect_len);
+
+	hdr.data.out = malloc(hdr.data.out_len);
+	enum vinf_error err = vinflate(hdr.data);
+	vassert_msg(!err, "%s: %s", fn, vinf_error_string[err]);
+	vassert(!memcmp(hdr.data.out, expect, expect_len));
+
+	free(hdr.data.out);
+	free(gz);
+}
+
+// Decompress a gzip file through the streaming interface, feeding it input
+// and output space in chunks of the given sizes
+static void check_stream(const char *fn, size_t inp_chunk, size_t out_chunk, const unsigned char *expect, size_t expect_len, int *_vtest_status) {
+	size_t len;
+	unsigned char *gz = readf(fn, &len);
+	if (!vassert_not_null(gz)) return;
+
+	static struct vinf_stream s;
+	vinf_stream_init(&s, VINF_STREAM_GZIP);
+
+	unsigned char *out = malloc(expect_len + out_chunk);
+	size_t inp_off = 0, out_off = 0;
+	while (!s.done) {
+		size_t n = len - inp_off < inp_chunk ? len - inp_off : inp_chunk;
+		s.inp = gz + inp_off;
+		s.inp_len = n;
+		s.out = out + out_off;
+		s.out_len = out_chunk;
+
+		enum vinf_error err = vinflate_stream(&s);
+		if (!vassert_msg(!err, "%s: %s", fn, vinf_error_string[err])) break;
+		inp_off += n - s.inp_len;
+		out_off = s.out - out;
+
+		// Unless the output is full, all input must be consumed
+		if (!s.done && s.out_len) {
+			if (!vassert_eq_u(s.inp_len, 0)) break;
+			if (!vassert_msg(inp_off < len, "%s: stream ended early", fn)) break;
+		}
+	}
+
+	vassert_eq_u(inp_off, len);
+	vassert_eq_u(out_off, expect_len);
+	vassert_eq_u(s.total_out, expect_len);
+	vassert(!memcmp(out, expect, expect_len));
+
+	free(out);
+	free(gz);
+}
+
+VTEST(test_bitreader) {
+	static const unsigned char data[] = {0xa5, 0x0f, 0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0, 0xff};
+	struct vinf_bitreader br;
+	vinf_brinit(&br, data, sizeof data);
+
+	vassert_eq(vinf_readbit(&br), 1);
+	vassert_eq(vinf_readbit(&br), 0);
+	vassert_eq(vinf_readval(&br, 6), 0x29);
+	vassert_eq(vinf_readval(&br, 4), 0xf);
+	vassert_eq_x(vinf_brpeek(&br, 20), 0x34120);
+	vassert(vinf_brconsume(&br, 4));
+
+	// Byte reads discard the partial byte and return any buffered bytes
+	const unsigned char *p = vinf_readbyt(&br, 2);
+	vassert_eq_p(p, data + 2);
+	vassert_eq(vinf_readval(&br, 16), 0x7856);
+
+	p = vinf_readbyt(&br, 5);
+	vassert_eq_p(p, data + 6);
+	vassert_null(vinf_readbyt(&br, 1));
+	vassert_eq(vinf_readbit(&br), -1);
+}
+
+VTEST(test_crc32) {
+	vassert_eq_x(vinf_crc32_buf(0, (const unsigned char *)"123456789", 9), 0xcbf43926);
+
+	size_t len;
+	unsigned char *text = readf(TEST_TEXT, &len);
+	if (!vassert_not_null(text)) return;
+
+	// Compare the fast paths against the bytewise CRC, at every alignment and
+	// a range of lengths around the block sizes
+	uint32_t *crcs = malloc((len + 1) * sizeof *crcs);
+	crcs[0] = 0;
+	for (size_t i = 0; i < len; i++) crcs[i+1] = vinf_crc32(crcs[i], text[i]);
+	vassert_eq_x(vinf_crc32_buf(0, text, len), crcs[len]);
+
+	for (size_t off = 0; off < 16; off++) {
+		for (size_t n = 0; n < 300; n++) {
+			uint32_t crc = vinf_crc32_buf(crcs[off], text + off, n);
+			if (!vassert_eq_x(crc, crcs[off + n])) goto end;
+		}
+	}
+
+	// Combining the CRCs of two halves gives the CRC of the whole
+	for (size_t split = 0; split <= len; split += 997) {
+		uint32_t crc2 = vinf_crc32_buf(0, text + split, len - split);
+		vassert_eq_x(vinf_crc32_combine(crcs[split], crc2, len - split), crcs[len]);
+	}
+
+end:
+	free(crcs);
+	free(text);
+}
+
+VTEST(test_adler32) {
+	vassert_eq_x(vinf_adler32(1, (const unsigned char *)"Wikipedia", 9), 0x11e60398);
+
+	size_t len;
+	unsigned char *text = readf(TEST_TEXT, &len);
+	if (!vassert_not_null(text)) return;
+	vassert_eq_x(vinf_adler32(1, text, len), 0xde5d9475);
+
+	// Compare the vector paths against a bytewise sum, at a range of
+	// alignments and lengths around the vector and reduction block sizes
+	for (size_t off = 0; off < 32; off += 3) {
+		uint32_t s1 = 1, s2 = 0;
+		for (size_t n = 0; off + n <= len; n += n < 200 ? 1 : 997) {
+			uint32_t adler = vinf_adler32(1, text + off, n);
+			if (!vassert_eq_x(adler, s2 << 16 | s1)) goto end;
+
+			size_t step = n < 200 ? 1 : 997;
+			for (size_t i = n; i < n + step && off + i < len; i++) {
+				s1 = (s1 + text[off + i]) % 65521;
+				s2 = (s2 + s1) % 65521;
+			}
+		}
+	}
+
+	// Runs of 0xff give the largest sums
+	unsigned char *ones = malloc(1 << 16);
+	memset(ones, 0xff, 1 << 16);
+	uint32_t s1 = 1, s2 = 0;
+	for (size_t i = 0; i < 1 << 16; i++) {
+		s1 = (s1 + 0xff) % 65521;
+		s2 = (s2 + s1) % 65521;
+	}
+	vassert_eq_x(vinf_adler32(1, ones, 1 << 16), s2 << 16 | s1);
+	free(ones);
+
+end:
+	free(text);
+}
+
+// The precomputed fixed code tables match what _vinf_mkhuff builds
+VTEST(test_fixed_tables) {
+	uint8_t lit_desc[_vinf_FIXED_NLIT], dist_desc[_vinf_FIXED_NDIST];
+	for (int i = 0; i < _vinf_FIXED_NLIT; i++) lit_desc[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+	for (int i = 0; i < _vinf_FIXED_NDIST; i++) dist_desc[i] = 5;
+
+	static struct _vinf_hent lit[1 << _vinf_LIT_BITS], dist[1 << _vinf_DIST_BITS];
+	vassert_eq(_vinf_mkhuff(lit, 1 << _vinf_LIT_BITS, _vinf_LIT_BITS, lit_desc, _vinf_FIXED_NLIT, &_vinf_lit_alphabet), VENF_ERR_SUCCESS);
+	vassert_eq(_vinf_mkhuff(dist, 1 << _vinf_DIST_BITS, _vinf_DIST_BITS, dist_desc, _vinf_FIXED_NDIST, &_vinf_dist_alphabet), VENF_ERR_SUCCESS);
+
+#define check_hent(a, b) (vassert_eq_u((a).val, (b).val) && vassert_eq_u((a).len, (b).len) && \
+		vassert_eq_u((a).kind, (b).kind) && vassert_eq_u((a).extra, (b).extra))
+	for (int i = 0; i < 1 << _vinf_LIT_BITS; i++) {
+		if (!check_hent(lit[i], _vinf_fixed_lit[i])) return;
+	}
+	for (int i = 0; i < 1 << _vinf_DIST_BITS; i++) {
+		if (!check_hent(dist[i], _vinf_fixed_dist[i])) return;
+	}
+#undef check_hent
+}
+
+VTEST(test_dynamic) {
+	size_t len;
+	unsigned char *text = readf(TEST_TEXT, &len);
+	if (!vassert_not_null(text)) return;
+	check_gzip(TEST_DYNAMIC, text, len, _vtest_status);
+	free(text);
+}
+
+VTEST(test_fixed) {
+	size_t len;
+	unsigned char *text = readf(TEST_TEXT, &len);
+	if (!vassert_not_null(text)) return;
+	check_gzip(TEST_FIXED, text, len, _vtest_status);
+	free(text);
+}
+
+VTEST(test_stored) {
+	size_t len;
+	unsigned char *text = readf(TEST_TEXT, &len);
+	if (!vassert_not_null(text)) return;
+	check_gzip(TEST_STORED, text, len, _vtest_status);
+	free(text);
+}
+
+VTEST(test_runs) {
+	size_t len;
+	unsigned char *runs = make_runs(&len);
+	check_gzip(TEST_RUNS, runs, len, _vtest_status);
+	free(runs);
+}
+
+VTEST(test_overflow) {
+	size_t len;
+	unsigned char *gz = readf(TEST_DYNAMIC, &len);
+	if (!vassert_not_null(gz)) return;
+
+	struct vinf_gzip hdr;
+	vassert_eq(vinf_read_gzip(gz, len, &hdr), VENF_ERR_SUCCESS);
+	hdr.data.out_len -= 1;
+	hdr.data.out = malloc(hdr.data.out_len);
+	vassert_eq(vinflate(hdr.data), VENF_ERR_OVERFLOW);
+
+	free(hdr.data.out);
+	free(gz);
+}
+
+VTEST(test_truncated) {
+	size_t len;
+	unsigned char *gz = readf(TEST_DYNAMIC, &len);
+	if (!vassert_not_null(gz)) return;
+
+	struct vinf_gzip hdr;
+	vassert_eq(vinf_read_gzip(gz, len, &hdr), VENF_ERR_SUCCESS);
+	hdr.data.inp_len /= 2;
+	hdr.data.out = malloc(hdr.data.out_len);
+	vassert_eq(vinflate(hdr.data), VENF_ERR_EOF);
+
+	free(hdr.data.out);
+	free(gz);
+}
+
+VTEST(test_corrupt) {
+	size_t len;
+	unsigned char *gz = readf(TEST_DYNAMIC, &len);
+	if (!vassert_not_null(gz)) return;
+
+	struct vinf_gzip hdr;
+	vassert_eq(vinf_read_gzip(gz, len, &hdr), VENF_ERR_SUCCESS);
+	hdr.data.out = malloc(hdr.data.out_len);
+
+	// Flipping bits anywhere in the stream must never crash or succeed silently
+	unsigned char *inp = (unsigned char *)hdr.data.inp;
+	for (size_t i = 0; i < hdr.data.inp_len; i += 97) {
+		inp[i] ^= 0x5a;
+		vassert(vinflate(hdr.data) != VENF_ERR_SUCCESS);
+		inp[i] ^= 0x5a;
+	}
+	vassert_eq(vinflate(hdr.data), VENF_ERR_SUCCESS);
+
+	free(hdr.data.out);
+	free(gz);
+}
+
+VTEST(test_stream) {
+	size_t len;
+	unsigned char *text = readf(TEST_TEXT, &len);
+	if (!vassert_not_null(text)) return;
+
+	static const size_t chunks[][2] = {{1, 1 << 16}, {7, 300}, {4096, 1}, {1 << 16, 1 << 16}};
+	for (size_t i = 0; i < sizeof chunks / sizeof *chunks; i++) {
+		check_stream(TEST_DYNAMIC, chunks[i][0], chunks[i][1], text, len, _vtest_status);
+		check_stream(TEST_FIXED, chunks[i][0], chunks[i][1], text, len, _vtest_status);
+		check_stream(TEST_STORED, chunks[i][0], chunks[i][1], text, len, _vtest_status);
+	}
+	free(text);
+
+	unsigned char *runs = make_runs(&len);
+	check_stream(TEST_RUNS, 5, 37, runs, len, _vtest_status);
+	free(runs);
+}
+
+VTEST(test_stream_raw) {
+	size_t len, text_len;
+	unsigned char *gz = readf(TEST_DYNAMIC, &len);
+	unsigned char *text = readf(TEST_TEXT, &text_len);
+	if (!vassert_not_null(gz) || !vassert_not_null(text)) return;
+
+	struct vinf_gzip hdr;
+	vassert_eq(vinf_read_gzip(gz, len, &hdr), VENF_ERR_SUCCESS);
+
+	// Anything after the end of the DEFLATE stream is left unconsumed
+	static struct vinf_stream s;
+	vinf_stream_init(&s, VINF_STREAM_RAW);
+	s.inp = hdr.data.inp;
+	s.inp_len = hdr.data.inp_len + 8;
+	s.out = malloc(text_len);
+	s.out_len = text_len;
+	unsigned char *out = s.out;
+
+	vassert_eq(vinflate_stream(&s), VENF_ERR_SUCCESS);
+	vassert(s.done);
+	vassert_eq_u(s.out_len, 0);
+	vassert_eq_u(s.inp_len, 8);
+	vassert_eq_p(s.inp, hdr.data.inp + hdr.data.inp_len);
+	vassert_eq_x(s.crc, hdr.data.out_crc);
+	vassert(!memcmp(out, text, text_len));
+
+	free(out);
+	free(text);
+	free(gz);
+}
+
+VTEST(test_stream_corrupt) {
+	size_t len;
+	unsigned char *gz = readf(TEST_DYNAMIC, &len);
+	if (!vassert_not_null(gz)) return;
+
+	// Corrupt the stored CRC
+	gz[len - 8] ^= 1;
+
+	static struct vinf_stream s;
+	static unsigned char out[1 << 10];
+	vinf_stream_init(&s, VINF_STREAM_GZIP);
+	s.inp = gz;
+	s.inp_len = len;
+
+	enum vinf_error err;
+	do {
+		s.out = out;
+		s.out_len = sizeof out;
+	} while (!(err = vinflate_stream(&s)) && !s.done);
+	vassert_eq(err, VENF_ERR_CRC_MISMATCH);
+
+	free(gz);
+}
+
+// Decompress a zlib stream in small chunks, returning the number of bytes output
+static size_t stream_zlib(struct vinf_stream *s, const unsigned char *inp, size_t len, unsigned char *out, size_t out_len, enum vinf_error *err) {
+	size_t inp_off = 0;
+	s->out = out;
+	s->out_len = out_len;
+	do {
+		s->inp = inp + inp_off;
+		s->inp_len = len - inp_off < 100 ? len - inp_off : 100;
+		size_t n = s->inp_len;
+		*err = vinflate_stream(s);
+		inp_off += n - s->inp_len;
+	} while (!*err && !s->done && inp_off < len);
+	return s->out - out;
+}
+
+VTEST(test_verify) {
+	size_t len, text_len;
+	unsigned char *gz = readf(TEST_MULTI, &len);
+	unsigned char *text = readf(TEST_TEXT, &text_len);
+	if (!vassert_not_null(gz) || !vassert_not_null(text)) return;
+
+	// Every member of a multi-member file is checked
+	uint64_t total = 0;
+	vassert_eq(vinf_verify(gz, len, VINF_STREAM_GZIP, &total), VENF_ERR_SUCCESS);
+	vassert_eq_u(total, 4 * text_len);
+
+	vassert_eq(vinf_verify(gz, len - 1, VINF_STREAM_GZIP, NULL), VENF_ERR_EOF);
+	gz[len - 4] ^= 1;
+	vassert_eq(vinf_verify(gz, len, VINF_STREAM_GZIP, NULL), VENF_ERR_LEN_MISMATCH);
+	gz[len - 4] ^= 1;
+	gz[len - 8] ^= 1;
+	vassert_eq(vinf_verify(gz, len, VINF_STREAM_GZIP, NULL), VENF_ERR_CRC_MISMATCH);
+	free(gz);
+
+	// Streams discard their output when given none, in any size of input chunk
+	gz = readf(TEST_DYNAMIC, &len);
+	if (!vassert_not_null(gz)) goto end;
+	static struct vinf_stream s;
+	vinf_stream_init(&s, VINF_STREAM_GZIP);
+	for (size_t off = 0; off < len && !s.done; off += 100) {
+		s.inp = gz + off;
+		s.inp_len = len - off < 100 ? len - off : 100;
+		if (!vassert_eq(vinflate_stream(&s), VENF_ERR_SUCCESS)) break;
+	}
+	vassert(s.done);
+	vassert_eq_u(s.total_out, text_len);
+	free(gz);
+
+end:
+	free(text);
+}
+
+struct sink_buf {
+	unsigned char *buf;
+	size_t len, cap, nwrites, min_write;
+};
+
+static int sink_write(void *ctx, const unsigned char *buf, size_t len) {
+	struct sink_buf *b = ctx;
+	if (b->len + len > b->cap) return -1;
+	memcpy(b->buf + b->len, buf, len);
+	b->len += len;
+	if (!b->nwrites++ || len < b->min_write) b->min_write = len;
+	return 0;
+}
+
+VTEST(test_sink) {
+	size_t len, text_len;
+	unsigned char *gz = readf(TEST_MULTI, &len);
+	unsigned char *text = readf(TEST_TEXT, &text_len);
+	if (!vassert_not_null(gz) || !vassert_not_null(text)) return;
+
+	struct sink_buf b = {.buf = malloc(4 * text_len), .cap = 4 * text_len};
+	struct vinf_sink sink = {sink_write, &b};
+	uint64_t total = 0;
+	vassert_eq(vinflate_sink(gz, len, VINF_STREAM_GZIP, sink, &total), VENF_ERR_SUCCESS);
+	vassert_eq_u(total, 4 * text_len);
+	vassert_eq_u(b.len, 4 * text_len);
+	for (int i = 0; i < 4; i++) vassert(!memcmp(b.buf + i * text_len, text, text_len));
+
+	// A failing sink stops decoding
+	b.len = 0;
+	b.cap = text_len;
+	vassert_eq(vinflate_sink(gz, len, VINF_STREAM_GZIP, sink, NULL), VENF_ERR_WRITE);
+	free(b.buf);
+	free(gz);
+
+	// Output is written in whole windows, except at the end of the data
+	size_t log_len;
+	gz = readf(TEST_LOG, &log_len);
+	if (!vassert_not_null(gz)) goto end;
+	b = (struct sink_buf){.buf = malloc(1 << 20), .cap = 1 << 20};
+	vassert_eq(vinflate_sink(gz, log_len, VINF_STREAM_GZIP, sink, &total), VENF_ERR_SUCCESS);
+	vassert(b.nwrites > 2);
+	vassert(b.nwrites <= total / VINF_WSIZE + 1);
+	free(b.buf);
+
+	// File descriptor sinks write everything
+	int fd = open("/tmp/vinflate_sink_test", O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (vassert(fd >= 0)) {
+		unlink("/tmp/vinflate_sink_test");
+		vassert_eq(vinflate_sink(gz, log_len, VINF_STREAM_GZIP, vinf_fd_sink(fd), NULL), VENF_ERR_SUCCESS);
+		vassert_eq_u(lseek(fd, 0, SEEK_END), total);
+		close(fd);
+	}
+	free(gz);
+
+end:
+	free(text);
+}
+
+VTEST(test_zlib) {
+	size_t len, text_len;
+	unsigned char *zz = readf(TEST_ZLIB, &len);
+	unsigned char *text = readf(TEST_TEXT, &text_len);
+	if (!vassert_not_null(zz) || !vassert_not_null(text)) return;
+	unsigned char *out = malloc(text_len + 1);
+
+	size_t out_len = text_len + 1;
+	vassert_eq(vinflate_zlib(zz, len, out, &out_len, NULL, 0), VENF_ERR_SUCCESS);
+	vassert_eq_u(out_len, text_len);
+	vassert(!memcmp(out, text, text_len));
+
+	static struct vinf_stream s;
+	vinf_stream_init(&s, VINF_STREAM_ZLIB);
+	enum vinf_error err;
+	vassert_eq_u(stream_zlib(&s, zz, len, out, text_len, &err), text_len);
+	vassert_eq(err, VENF_ERR_SUCCESS);
+	vassert(s.done);
+	vassert_eq_x(s.zlib.cmf, 0x78);
+	vassert_eq_x(s.adler, 0xde5d9475);
+	vassert(!memcmp(out, text, text_len));
+
+	// Bad header check, then a bad Adler-32
+	zz[1] ^= 1;
+	out_len = text_len;
+	vassert_eq(vinflate_zlib(zz, len, out, &out_len, NULL, 0), VENF_ERR_ID_MISMATCH);
+	zz[1] ^= 1;
+	zz[len - 1] ^= 1;
+	out_len = text_len;
+	vassert_eq(vinflate_zlib(zz, len, out, &out_len, NULL, 0), VENF_ERR_CRC_MISMATCH);
+	vinf_stream_init(&s, VINF_STREAM_ZLIB);
+	stream_zlib(&s, zz, len, out, text_len, &err);
+	vassert_eq(err, VENF_ERR_CRC_MISMATCH);
+
+	free(out);
+	free(text);
+	free(zz);
+}
+
+VTEST(test_zlib_dict) {
+	size_t len, text_len;
+	unsigned char *zz = readf(TEST_ZLIB_DICT, &len);
+	unsigned char *text = readf(TEST_TEXT, &text_len);
+	if (!vassert_not_null(zz) || !vassert_not_null(text)) return;
+	const unsigned char *dict = text, *expect = text + 8192;
+	size_t dict_len = 8192, expect_len = text_len - 8192;
+	unsigned char *out = malloc(expect_len);
+
+	size_t out_len = expect_len;
+	vassert_eq(vinflate_zlib(zz, len, out, &out_len, NULL, 0), VENF_ERR_NEED_DICT);
+	out_len = expect_len;
+	vassert_eq(vinflate_zlib(zz, len, out, &out_len, dict, dict_len - 1), VENF_ERR_DICT_MISMATCH);
+	out_len = expect_len;
+	vassert_eq(vinflate_zlib(zz, len, out, &out_len, dict, dict_len), VENF_ERR_SUCCESS);
+	vassert_eq_u(out_len, expect_len);
+	vassert(!memcmp(out, expect, expect_len));
+
+	// The stream stops after the header, and resumes once given the dictionary
+	static struct vinf_stream s;
+	vinf_stream_init(&s, VINF_STREAM_ZLIB);
+	s.inp = zz;
+	s.inp_len = len;
+	s.out = out;
+	s.out_len = expect_len;
+	vassert_eq(vinflate_stream(&s), VENF_ERR_NEED_DICT);
+	vassert_eq_x(s.zlib.dictid, 0xe695e37d);
+	vassert_eq_u(s.inp_len, len - 6);
+
+	memset(out, 0, expect_len);
+	vinf_stream_set_dict(&s, dict, dict_len);
+	vassert_eq(vinflate_stream(&s), VENF_ERR_SUCCESS);
+	vassert(s.done);
+	vassert_eq_u(s.total_out, expect_len);
+	vassert(!memcmp(out, expect, expect_len));
+
+	free(out);
+	free(text);
+	free(zz);
+}
+
+VTEST(test_index) {
+	size_t len;
+	unsigned char *gz = readf(TEST_LOG, &len);
+	if (!vassert_not_null(gz)) return;
+
+	struct vinf_gzip hdr;
+	vassert_eq(vinf_read_gzip(gz, len, &hdr), VENF_ERR_SUCCESS);
+	unsigned char *text = hdr.data.out = malloc(hdr.data.out_len);
+	size_t text_len = hdr.data.out_len;
+	vassert_eq(vinflate(hdr.data), VENF_ERR_SUCCESS);
+
+	struct vinf_index idx;
+	vassert_eq(vinf_index_build(&idx, gz, len, VINF_STREAM_GZIP, 1 << 14), VENF_ERR_SUCCESS);
+	vassert_eq_u(idx.total_out, text_len);
+	vassert(idx.npoints >= 4);
+
+	// Round-trip through the serialized form
+	size_t ser_len = vinf_index_serialize(&idx, NULL);
+	unsigned char *ser = malloc(ser_len);
+	vassert_eq_u(vinf_index_serialize(&idx, ser), ser_len);
+	vinf_index_free(&idx);
+	vassert_eq(vinf_index_deserialize(&idx, ser, ser_len), VENF_ERR_SUCCESS);
+	vassert_eq(vinf_index_deserialize(&(struct vinf_index){0}, ser, ser_len - 1), VENF_ERR_EOF);
+	free(ser);
+
+	// Read ranges around each checkpoint, and running off the end
+	unsigned char buf[1000];
+	for (size_t i = 0; i < idx.npoints; i++) {
+		uint64_t offs[] = {idx.points[i].out_off - 1, idx.points[i].out_off, idx.points[i].out_off + 123};
+		for (int j = 0; j < 3; j++) {
+			size_t n;
+			vassert_eq(vinf_index_extract(&idx, gz, len, offs[j], buf, sizeof buf, &n), VENF_ERR_SUCCESS);
+			vassert_eq_u(n, sizeof buf);
+			vassert(!memcmp(buf, text + offs[j], sizeof buf));
+		}
+	}
+
+	size_t n;
+	vassert_eq(vinf_index_extract(&idx, gz, len, 17, buf, sizeof buf, &n), VENF_ERR_SUCCESS);
+	vassert_eq_u(n, sizeof buf);
+	vassert(!memcmp(buf, text + 17, sizeof buf));
+	vassert_eq(vinf_index_extract(&idx, gz, len, text_len - 10, buf, sizeof buf, &n), VENF_ERR_SUCCESS);
+	vassert_eq_u(n, 10);
+	vassert(!memcmp(buf, text + text_len - 10, 10));
+
+	vinf_index_free(&idx);
+	free(text);
+	free(gz);
+}
+
+VTEST(test_parallel) {
+	size_t seg_len;
+	unsigned char *seg = readf(TEST_SEGMENT, &seg_len);
+	if (!vassert_not_null(seg)) return;
+
+	// Repeat the segment to make a stream big enough to be split, and finish
+	// it with an empty final block
+	enum {NSEG = 48};
+	size_t len = NSEG * seg_len + 2;
+	unsigned char *inp = malloc(len);
+	for (int i = 0; i < NSEG; i++) memcpy(inp + i*seg_len, seg, seg_len);
+	inp[len - 2] = 0x03;
+	inp[len - 1] = 0x00;
+
+	// Decompress the stream normally for comparison
+	static struct vinf_stream s;
+	vinf_stream_init(&s, VINF_STREAM_RAW);
+	size_t out_len = 1 << 24;
+	unsigned char *expect = malloc(out_len);
+	s.inp = inp;
+	s.inp_len = len;
+	s.out = expect;
+	s.out_len = out_len;
+	vassert_eq(vinflate_stream(&s), VENF_ERR_SUCCESS);
+	vassert(s.done);
+	out_len = s.total_out;
+
+	struct vinf_data data = {inp, len, malloc(out_len), s.crc, out_len};
+	for (unsigned nthreads = 1; nthreads <= 4; nthreads++) {
+		memset(data.out, 0, out_len);
+		vassert_eq(vinflate_parallel(data, nthreads), VENF_ERR_SUCCESS);
+		vassert(!memcmp(data.out, expect, out_len));
+	}
+
+	// A corrupt chunk is caught whether or not its start was guessed
+	inp[len / 2] ^= 0x5a;
+	vassert(vinflate_parallel(data, 4) != VENF_ERR_SUCCESS);
+
+	free(data.out);
+	free(expect);
+	free(inp);
+	free(seg);
+}
+
+VTEST(test_members) {
+	size_t len, text_len;
+	unsigned char *text = readf(TEST_TEXT, &text_len);
+	if (!vassert_not_null(text)) return;
+
+	unsigned char *gz = readf(TEST_BGZF, &len);
+	if (!vassert_not_null(gz)) return;
+	vassert_eq_u(vinf_bgzf_size(gz, len), 1680);
+
+	unsigned char *out = malloc(4 * text_len);
+	for (unsigned nthreads = 1; nthreads <= 4; nthreads += 3) {
+		struct vinf_members m = {gz, len, out, text_len, nthreads};
+		vassert_eq(vinflate_members(&m), VENF_ERR_SUCCESS);
+		vassert_eq_u(m.nmembers, 8); // Including the empty EOF block
+		vassert_eq_u(m.total_out, text_len);
+		vassert_eq_x(m.out_crc, vinf_crc32_buf(0, text, text_len));
+		vassert(!memcmp(out, text, text_len));
+
+		m.out_len--;
+		vassert_eq(vinflate_members(&m), VENF_ERR_OVERFLOW);
+	}
+
+	// A corrupt block is reported, even when it is decompressed by another thread
+	gz[3000] ^= 0x5a;
+	struct vinf_members m = {gz, len, out, text_len, 4};
+	vassert(vinflate_members(&m) != VENF_ERR_SUCCESS);
+	free(gz);
+
+	gz = readf(TEST_MULTI, &len);
+	if (!vassert_not_null(gz)) return;
+	m = (struct vinf_members){gz, len, out, 4 * text_len, 4};
+	vassert_eq(vinflate_members(&m), VENF_ERR_SUCCESS);
+	vassert_eq_u(m.nmembers, 11);
+	vassert_eq_u(m.total_out, 4 * text_len);
+	for (int i = 0; i < 4; i++) {
+		vassert(!memcmp(out + i*text_len, text, text_len));
+	}
+	vassert_eq_x(m.out_crc, vinf_crc32_buf(0, out, 4 * text_len));
+	free(out);
+
+	// Output buffers over 4 GiB work. Only the pages that are written are used
+	if (SIZE_MAX > UINT32_MAX) {
+		size_t big_len = ((size_t)1 << 32) + 100;
+		out = mmap(NULL, big_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if (vassert(out != MAP_FAILED)) {
+			m = (struct vinf_members){gz, len, out, big_len, 4};
+			vassert_eq(vinflate_members(&m), VENF_ERR_SUCCESS);
+			vassert_eq_u(m.total_out, 4 * text_len);
+			vassert_eq_x(m.out_crc, vinf_crc32_buf(0, out, 4 * text_len));
+			munmap(out, big_len);
+		}
+	}
+
+	free(gz);
+	free(text);
+}
+
+VTESTS_BEGIN
+	test_bitreader,
+	test_crc32,
+	test_adler32,
+	test_fixed_tables,
+	test_dynamic,
+	test_fixed,
+	test_stored,
+	test_runs,
+	test_overflow,
+	test_truncated,
+	test_corrupt,
+	test_stream,
+	test_stream_raw,
+	test_stream_corrupt,
+	test_verify,
+	test_sink,
+	test_zlib,
+	test_zlib_dict,
+	test_index,
+	test_members,
+	test_parallel,
+VTESTS_END
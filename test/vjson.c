@@ -0,0 +1,1036 @@
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#include "vtest.h"
+#define VARENA_IMPL
+#include "../varena.h"
+#define VCHANNEL_IMPL
+#include "../vchannel.h"
+// Not a multiple of 64, to check that the nesting bitsets are big enough
+#define VJSON_MAX_DEPTH 100
+#define VJSON_IMPL
+#include "../vjson.h"
+
+// Deterministic random JSON {{{
+static unsigned long rng_state;
+static unsigned rng(unsigned n) {
+	rng_state = rng_state * 6364136223846793005ul + 1442695040888963407ul;
+	return (rng_state >> 33) % n;
+}
+
+static void gen_string(char **p) {
+	static const char *const pieces[] = {
+		"a", "xyz", " ", "[", "]", "{", "}", ",", ":",
+		"\\\"", "\\\\", "\\\\\\\"", "\\n", "\\u00e9", "\\/",
+	};
+	*(*p)++ = '"';
+	unsigned n = rng(4) ? rng(8) : 40 + rng(60);
+	while (n--) {
+		const char *s = pieces[rng(sizeof pieces / sizeof *pieces)];
+		size_t len = strlen(s);
+		memcpy(*p, s, len);
+		*p += len;
+	}
+	*(*p)++ = '"';
+}
+
+static void gen_space(char **p) {
+	static const char ws[] = " \t\n\r";
+	unsigned n = rng(3) ? 0 : rng(4);
+	while (n--) *(*p)++ = ws[rng(4)];
+}
+
+static void gen_value(char **p, unsigned depth) {
+	gen_space(p);
+	unsigned kind = depth > 4 ? rng(4) : rng(6);
+	switch (kind) {
+	case 0:
+		*p += sprintf(*p, "%d", (int)rng(200000) - 100000);
+		break;
+	case 1:
+		*p += sprintf(*p, "%s", rng(3) ? rng(2) ? "true" : "false" : "null");
+		break;
+	case 2:
+	case 3:
+		gen_string(p);
+		break;
+	case 4:
+	case 5:;
+		_Bool obj = kind == 5;
+		*(*p)++ = obj ? '{' : '[';
+		unsigned n = rng(5);
+		for (unsigned i = 0; i < n; i++) {
+			if (i) *(*p)++ = ',';
+			if (obj) {
+				gen_space(p);
+				gen_string(p);
+				gen_space(p);
+				*(*p)++ = ':';
+			}
+			gen_value(p, depth + 1);
+		}
+		gen_space(p);
+		*(*p)++ = obj ? '}' : ']';
+		break;
+	}
+	gen_space(p);
+}
+// }}}
+
+// Byte-by-byte versions of the structural index and container skipping
+static size_t naive_index(const char *src, size_t len, uint32_t *pos) {
+	size_t n = 0;
+	_Bool string = 0;
+	for (size_t i = 0; i < len; i++) {
+		char c = src[i];
+		if (string) {
+			if (c == '\\') i++;
+			else if (c == '"') string = 0;
+			continue;
+		}
+
+		if (c == '"') string = 1;
+		if (strchr("[]{}:,", c)) {
+			pos[n++] = i;
+		} else if (!strchr(" \t\n\r", c)) {
+			char prev = i ? src[i-1] : ' ';
+			if (prev == '"' || strchr(" \t\n\r[]{}:,", prev)) pos[n++] = i;
+		}
+	}
+	return n;
+}
+
+static const char *naive_skip(const char *src, const char *end) {
+	unsigned level = 0;
+	_Bool string = 0;
+	for (; src < end; src++) {
+		if (string) {
+			if (*src == '\\') src++;
+			else if (*src == '"') string = 0;
+		} else if (*src == '"') {
+			string = 1;
+		} else if (*src == '[' || *src == '{') {
+			level++;
+		} else if ((*src == ']' || *src == '}') && !--level) {
+			return src + 1;
+		}
+	}
+	return NULL;
+}
+
+VTEST(test_index) {
+	const char *doc = "{\"a\": [1, true, \"]\\\"\"], \"b\":null}";
+	static const uint32_t expect[] = {0, 1, 4, 6, 7, 8, 10, 14, 16, 21, 22, 24, 27, 28, 32, 33};
+	struct vjson_index idx;
+	if (!vassert_eq(vjson_index_build(&idx, doc, doc + strlen(doc)), 0)) return;
+	vassert_eq_u(idx.n, sizeof expect / sizeof *expect - 1);
+	vassert(!memcmp(idx.pos, expect, sizeof expect));
+	vjson_index_free(&idx);
+
+	// Empty documents have only the sentinel
+	if (vassert_eq(vjson_index_build(&idx, doc, doc), 0)) {
+		vassert_eq_u(idx.n, 0);
+		vassert_eq_u(idx.pos[0], 0);
+		vjson_index_free(&idx);
+	}
+
+	// Unterminated strings are rejected
+	vassert_eq(vjson_index_build(&idx, doc, doc + 17), -1);
+	vassert_null(idx.pos);
+}
+
+VTEST(test_index_random) {
+	char *buf = malloc(1 << 20);
+	uint32_t *pos = malloc((1 << 20) * sizeof *pos);
+	rng_state = 1;
+	for (int i = 0; i < 200; i++) {
+		char *p = buf;
+		gen_value(&p, 0);
+		size_t len = p - buf;
+
+		struct vjson_index idx;
+		if (!vassert_eq(vjson_index_build(&idx, buf, p), 0)) continue;
+		size_t n = naive_index(buf, len, pos);
+		if (vassert_eq_u(idx.n, n)) {
+			vassert(!memcmp(idx.pos, pos, n * sizeof *pos));
+		}
+		vassert_eq_u(idx.pos[idx.n], len);
+		vjson_index_free(&idx);
+	}
+	free(pos);
+	free(buf);
+}
+
+VTEST(test_skip) {
+	// Brackets and escaped quotes inside strings, and backslash runs over block boundaries
+	static const char *const docs[] = {
+		"[]",
+		"{}",
+		"[\"]\"]",
+		"{\"}\": \"\\\"}\"}",
+		"[\"\\\\\"]",
+		"[\"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa\\\\\\\\\\\\\\\"]\\\\\"]",
+		"[\"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa\\\\\\\\\\\\\\\\\", \"]\"]",
+		"[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]], 1]",
+	};
+	for (size_t i = 0; i < sizeof docs / sizeof *docs; i++) {
+		const char *src = docs[i], *end = src + strlen(src);
+		enum vjson_type t = *src == '[' ? VJSON_ARRAY : VJSON_OBJECT;
+		vassert_eq(vjson_value(&src, end), t);
+		vassert_msg(src == end, "doc %zu: stopped at %td", i, src - docs[i]);
+	}
+
+	// Unbalanced containers are errors
+	const char *src = "[[1, \"]\"]";
+	vassert_eq(vjson_array(&src, src + strlen(src)), VJSON_ERROR);
+	src = "[1, 2]";
+	vassert_eq(vjson_object(&src, src + strlen(src)), VJSON_ERROR);
+}
+
+VTEST(test_skip_random) {
+	char *buf = malloc(1 << 20);
+	rng_state = 2;
+	for (int i = 0; i < 200; i++) {
+		char *p = buf;
+		*p++ = '[';
+		gen_value(&p, 0);
+		*p++ = ']';
+		gen_value(&p, 0);
+
+		const char *src = buf;
+		vassert_eq(vjson_array(&src, p), VJSON_ARRAY);
+		vassert(src == naive_skip(buf, p));
+	}
+	free(buf);
+}
+
+VTEST(test_cursor) {
+	const char *src = " {\"a\": [1, -2.5, \"x\\ty\"],\r\n\"b\": {\"c\": [true, false, null]}} ";
+	const char *end = src + strlen(src);
+
+	const char *start = src;
+	if (!vassert_eq(vjson_value(&src, end), VJSON_OBJECT)) return;
+	vassert_eq_u(vjson_get_size(start), 2);
+
+	const char *obj = vjson_enter(start);
+	start = obj;
+	vassert_eq(vjson_key(&obj, src), VJSON_STRING);
+	char *s = vjson_get_string(start);
+	vassert_eq_s(s, "a");
+	free(s);
+
+	start = obj;
+	vassert_eq(vjson_item(&obj, src), VJSON_ARRAY);
+	vassert_eq_u(vjson_get_size(start), 3);
+	const char *arr = vjson_enter(start);
+	vassert_eq(vjson_item(&arr, obj), VJSON_NUMBER);
+	start = arr;
+	vassert_eq(vjson_item(&arr, obj), VJSON_NUMBER);
+	vassert(vjson_get_number(start) == -2.5);
+	start = arr;
+	vassert_eq(vjson_item(&arr, obj), VJSON_STRING);
+	s = vjson_get_string(start);
+	vassert_eq_s(s, "x\ty");
+	free(s);
+	vassert_eq(*arr, ']');
+
+	vassert_eq(vjson_key(&obj, src), VJSON_STRING);
+	start = obj;
+	vassert_eq(vjson_item(&obj, src), VJSON_OBJECT);
+	vassert_eq_u(vjson_get_size(start), 1);
+	vassert_eq(*obj, '}');
+
+	vassert_eq(vjson_value(&src, end), VJSON_EOF);
+
+	// Unterminated strings are not read past the end, even when it falls inside an escape
+	static const char *const cut[] = {"\"ab\\", "\"ab", "\"\\u12", "\"\\u", "\""};
+	for (size_t i = 0; i < sizeof cut / sizeof *cut; i++) {
+		size_t len = strlen(cut[i]);
+		char *buf = malloc(len);
+		memcpy(buf, cut[i], len);
+		const char *p = buf;
+		vassert_msg(vjson_string(&p, buf + len) == VJSON_ERROR, "%s", cut[i]);
+		free(buf);
+	}
+}
+
+// Check a tape against the cursor API, which walks the source directly
+static void check_tape(const struct vjson_tape *tape, const struct vjson_node *node, const char *src, int *_vtest_status) {
+	const char *start = vjson_node_src(tape, node);
+	const char *p = start;
+	vassert_eq(vjson_value(&p, tape->src + node->off + node->len), node->type);
+	vassert_eq_u(p - start, node->len);
+	if (node->type != VJSON_ARRAY && node->type != VJSON_OBJECT) return;
+
+	vassert_eq_u(vjson_node_size(node), vjson_get_size(start));
+	size_t i = 0;
+	for (const struct vjson_node *child = vjson_node_child(node); child; child = vjson_node_next(child), i++) {
+		vassert(vjson_node_at(node, i) == child);
+		if (node->type == VJSON_OBJECT) {
+			vassert_eq(child->type, VJSON_STRING);
+			vassert(!child->last);
+			child = vjson_node_next(child);
+		}
+		check_tape(tape, child, src, _vtest_status);
+	}
+	vassert_eq_u(i, vjson_node_size(node));
+	vassert_null(vjson_node_at(node, i));
+}
+
+VTEST(test_tape) {
+	struct varena *arena = varena_new(4096);
+	const char *src = " {\"a\": [1, -2.5, \"x\\\"y\"],\r\n\"b\": {\"c\": [true, false, null, []], \"d\": {}}, \"e\": 3} ";
+	struct vjson_tape tape;
+	if (!vassert_eq(vjson_tape_parse(&tape, &arena, src, src + strlen(src)), 0)) goto end;
+	vassert_eq_u(tape.n, 18);
+
+	const struct vjson_node *root = vjson_tape_root(&tape);
+	if (!vassert_not_null(root)) goto end;
+	vassert_eq(root->type, VJSON_OBJECT);
+	vassert(root->last);
+	vassert_null(vjson_node_next(root));
+	check_tape(&tape, root, src, _vtest_status);
+
+	// Object members are a key followed by a value
+	const struct vjson_node *key = vjson_node_at(root, 2);
+	vassert_eq(key->type, VJSON_STRING);
+	vassert(key->len == 3 && !memcmp(vjson_node_src(&tape, key), "\"e\"", 3));
+	vassert(vjson_get_number(vjson_node_src(&tape, vjson_node_next(key))) == 3);
+
+	// Arrays of scalars are indexed directly
+	const struct vjson_node *arr = vjson_node_next(vjson_node_child(root));
+	vassert_eq_u(vjson_node_size(arr), 3);
+	vassert_eq(vjson_node_at(arr, 2)->type, VJSON_STRING);
+	char *s = vjson_get_string(vjson_node_src(&tape, vjson_node_at(arr, 2)));
+	vassert_eq_s(s, "x\"y");
+	free(s);
+
+	// Sequences of values become sequences of top-level nodes
+	src = "1 [2] \"3\"";
+	if (vassert_eq(vjson_tape_parse(&tape, &arena, src, src + strlen(src)), 0)) {
+		root = vjson_tape_root(&tape);
+		vassert_eq(root->type, VJSON_NUMBER);
+		vassert_eq((root = vjson_node_next(root))->type, VJSON_ARRAY);
+		vassert_eq((root = vjson_node_next(root))->type, VJSON_STRING);
+		vassert_null(vjson_node_next(root));
+	}
+
+	vassert_eq(vjson_tape_parse(&tape, &arena, src, src), 0);
+	vassert_null(vjson_tape_root(&tape));
+
+	static const char *const bad[] = {
+		"[1,]", "[,1]", "{\"a\"}", "{\"a\":}", "{1: 2}", "{\"a\": 1,}", "[1 2]",
+		"[1}", "{\"a\": 1]", "[[]", "[]]", "tru", "[nul]", "\"a\"b", "1 :", "[\"a\": 1]",
+	};
+	for (size_t i = 0; i < sizeof bad / sizeof *bad; i++) {
+		vassert_msg(vjson_tape_parse(&tape, &arena, bad[i], bad[i] + strlen(bad[i])), "%s", bad[i]);
+	}
+
+end:
+	varena_free(arena);
+}
+
+VTEST(test_tape_random) {
+	struct varena *arena = varena_new(4096);
+	char *buf = malloc(1 << 20);
+	rng_state = 3;
+	for (int i = 0; i < 200; i++) {
+		char *p = buf;
+		gen_value(&p, 0);
+
+		struct vjson_tape tape;
+		if (!vassert_eq(vjson_tape_parse(&tape, &arena, buf, p), 0)) continue;
+		const struct vjson_node *root = vjson_tape_root(&tape);
+		vassert_eq_u(root->skip, tape.n);
+		check_tape(&tape, root, buf, _vtest_status);
+	}
+	free(buf);
+	varena_free(arena);
+}
+
+VTEST(test_strings) {
+	struct varena *arena = varena_new(4096);
+
+	// Strings without escapes are used in place
+	const char *src = " \"hello, world\" ";
+	struct vjson_view view = vjson_get_view(src);
+	vassert(view.s == src + 2);
+	vassert_eq_u(view.len, 12);
+	vassert(!view.escaped);
+	size_t len;
+	vassert(vjson_get_astring(src, &arena, &len) == src + 2);
+	vassert_eq_u(len, 12);
+
+	// Others are unescaped into a buffer or the arena
+	src = "\"a\\\"b\\\\c\\/d\\n\\u00e9\\ud83d\\ude00\\u2603\"";
+	static const char expect[] = "a\"b\\c/d\n\xc3\xa9\xf0\x9f\x98\x80\xe2\x98\x83";
+	view = vjson_get_view(src);
+	vassert(view.escaped);
+	vassert_eq_u(view.len, strlen(src) - 2);
+	char buf[64];
+	len = vjson_unescape(view, buf);
+	vassert(len == sizeof expect - 1 && !memcmp(buf, expect, len));
+
+	const char *s = vjson_get_astring(src, &arena, &len);
+	vassert(len == sizeof expect - 1 && !memcmp(s, expect, len));
+
+	char *m = vjson_get_string(src);
+	vassert_eq_s(m, expect);
+	free(m);
+
+	// Keys are compared without unescaping them first
+	vassert(vjson_key_eq("\"id\"", "id"));
+	vassert(!vjson_key_eq("\"id\"", "i"));
+	vassert(!vjson_key_eq("\"id\"", "ids"));
+	vassert(vjson_key_eq("\"\"", ""));
+	vassert(vjson_key_eq(src, expect));
+	vassert(!vjson_key_eq(src, "a\"b\\c/d\n\xc3\xa9"));
+	vassert(!vjson_key_eq("\"\\u0069d\"", "ie"));
+	vassert(vjson_key_eq("\"\\u0069d\"", "id"));
+
+	// Tape nodes know the length of their strings
+	struct vjson_tape tape;
+	src = "[\"plain\", \"esc\\taped\"]";
+	if (vassert_eq(vjson_tape_parse(&tape, &arena, src, src + strlen(src)), 0)) {
+		const struct vjson_node *root = vjson_tape_root(&tape);
+		view = vjson_node_view(&tape, vjson_node_at(root, 0));
+		vassert(view.len == 5 && !memcmp(view.s, "plain", 5) && !view.escaped);
+		view = vjson_node_view(&tape, vjson_node_at(root, 1));
+		vassert(view.len == 9 && view.escaped);
+		len = vjson_unescape(view, buf);
+		vassert(len == 8 && !memcmp(buf, "esc\taped", 8));
+	}
+
+	varena_free(arena);
+}
+
+VTEST(test_numbers) {
+	static const char *const valid[] = {
+		"0", "-0", "1", "-1", "0.5", "-0.5", "123.456e7", "1E+2", "1e-2", "0e0",
+		"2.2250738585072011e-308", "2.2250738585072014e-308", "4.9406564584124654e-324",
+		"2.4703282292062327e-324", "2.4703282292062328e-324", "1.7976931348623157e308",
+		"1.7976931348623158e308", "1.7976931348623159e308", "1e-400", "1e400", "1e-99999999999",
+		"9007199254740993", "9007199254740993.0000000000000000001", "0.1", "0.3",
+		"123456789012345678901234567890", "7.038531e-26", "3.0517578125e-05",
+		"89255.0e-22", "8.589973e9", "0.000000000000000000000000000000000000001",
+		"1.00000000000000011102230246251565404236316680908203125",
+		"1.00000000000000011102230246251565404236316680908203124",
+		"1.00000000000000011102230246251565404236316680908203126",
+	};
+	for (size_t i = 0; i < sizeof valid / sizeof *valid; i++) {
+		const char *src = valid[i];
+		vassert_eq(vjson_number(&src, src + strlen(src)), VJSON_NUMBER);
+		vassert_msg(!*src, "%s", valid[i]);
+
+		double d;
+		vjson_get_double(valid[i], &d);
+		vassert_msg(d == strtod(valid[i], NULL), "%s: %.17g", valid[i], d);
+	}
+
+	// Only the JSON grammar is accepted
+	static const char *const invalid[] = {
+		"-", "+1", ".5", "1.", "1.e5", "1e", "1e+", "-.5", "inf", "nan", " ",
+	};
+	for (size_t i = 0; i < sizeof invalid / sizeof *invalid; i++) {
+		const char *src = invalid[i];
+		vassert_msg(vjson_number(&src, src + strlen(src)) == VJSON_ERROR, "%s", invalid[i]);
+	}
+	const char *src = "0123";
+	vassert_eq(vjson_number(&src, src + 4), VJSON_NUMBER);
+	vassert_eq_u(src[-1], '0');
+	src = "1.5e10";
+	vassert_eq(vjson_number(&src, src + 4), VJSON_ERROR);
+
+	// Integers are exact, and report overflow
+	int64_t i;
+	uint64_t u;
+	double d;
+	vassert(vjson_get_i64("9223372036854775807", &i) && i == INT64_MAX);
+	vassert(vjson_get_i64("-9223372036854775808", &i) && i == INT64_MIN);
+	vassert(!vjson_get_i64("9223372036854775808", &i) && i == INT64_MAX);
+	vassert(!vjson_get_i64("-9223372036854775809", &i) && i == INT64_MIN);
+	vassert(!vjson_get_i64("-12.75", &i) && i == -12);
+	vassert(!vjson_get_i64("1e3", &i) && i == 1000);
+	vassert(vjson_get_i64("-0", &i) && i == 0);
+	vassert(vjson_get_u64("18446744073709551615", &u) && u == UINT64_MAX);
+	vassert(!vjson_get_u64("18446744073709551616", &u) && u == UINT64_MAX);
+	vassert(!vjson_get_u64("100000000000000000000000", &u) && u == UINT64_MAX);
+	vassert(!vjson_get_u64("-1", &u) && u == 0);
+	vassert(vjson_get_u64(" 42", &u) && u == 42);
+	vassert(vjson_get_double("42", &d) && d == 42);
+	vassert(!vjson_get_double("42.0", &d) && d == 42);
+	vassert(!vjson_get_double("x", &d));
+	vassert(vjson_get_number("0.1") == 0.1);
+}
+
+VTEST(test_numbers_random) {
+	char buf[64];
+	rng_state = 4;
+	for (int n = 0; n < 100000; n++) {
+		char *p = buf;
+		if (rng(2)) *p++ = '-';
+
+		// Random digits, with a random decimal point and exponent
+		unsigned ndigits = 1 + rng(rng(4) ? 17 : 30);
+		unsigned point = rng(ndigits + 1);
+		*p++ = '1' + rng(9);
+		for (unsigned i = 1; i < ndigits; i++) {
+			if (i == point) *p++ = '.';
+			*p++ = '0' + rng(10);
+		}
+		if (rng(2)) p += sprintf(p, "e%d", (int)rng(700) - 350);
+		*p = 0;
+
+		double d;
+		vjson_get_double(buf, &d);
+		vassert_msg(d == strtod(buf, NULL), "%s: %.17g", buf, d);
+
+		// Round-trip doubles
+		double x;
+		uint64_t bits = (uint64_t)rng(1u << 31) << 33 ^ (uint64_t)rng(1u << 31) << 2;
+		memcpy(&x, &bits, sizeof x);
+		if (x != x || x - x != 0) continue;
+		sprintf(buf, "%.17g", x);
+		vjson_get_double(buf, &d);
+		vassert_msg(d == x, "%s: %.17g", buf, d);
+	}
+}
+
+// Record push parser events as text
+struct event_log {
+	char *buf;
+	size_t len;
+	int stop_at;
+};
+
+static int log_event(void *ctx, enum vjson_event ev, enum vjson_type type, const char *tok, size_t len) {
+	struct event_log *log = ctx;
+	static const char names[] = "SEKV";
+	log->len += sprintf(log->buf + log->len, "%c%d:%.*s ", names[ev], type, (int)len, tok);
+
+	// Scalars can be read straight from the token
+	if (ev == VJSON_EV_SCALAR && type == VJSON_NUMBER) {
+		double d;
+		vjson_get_double(tok, &d);
+		log->len += sprintf(log->buf + log->len, "=%g ", d);
+	}
+	return !--log->stop_at;
+}
+
+static int push_chunks(const char *src, size_t len, size_t chunk, struct event_log *log) {
+	struct vjson_push p;
+	vjson_push_init(&p, (struct vjson_handler){log_event, log});
+	log->len = 0;
+	log->buf[0] = 0;
+
+	int ret = 0;
+	for (size_t off = 0; off < len && !ret; off += chunk) {
+		size_t n = len - off < chunk ? len - off : chunk;
+		ret = vjson_push(&p, src + off, n);
+	}
+	if (!ret) ret = vjson_push_end(&p);
+	vjson_push_free(&p);
+	return ret;
+}
+
+VTEST(test_push) {
+	char buf[8192];
+	struct event_log log = {buf, 0, -1};
+
+	const char *src = " {\"a\\\\\": [1, -2.5e1, \"x\\\"y\"], \"b\": {\"c\": true, \"d\": null}, \"e\": []} 42";
+	static const char events[] =
+		"S7:{ K5:\"a\\\\\" S6:[ V2:1 =1 V2:-2.5e1 =-25 V5:\"x\\\"y\" E6:] "
+		"K5:\"b\" S7:{ K5:\"c\" V3:true K5:\"d\" V4:null E7:} "
+		"K5:\"e\" S6:[ E6:] E7:} V2:42 =42 ";
+	size_t len = strlen(src);
+	vassert_eq(push_chunks(src, len, len, &log), 0);
+	vassert_eq_s(buf, events);
+
+	// The same events are produced however the document is split
+	for (size_t chunk = 1; chunk < len; chunk++) {
+		log.stop_at = -1;
+		vassert_eq(push_chunks(src, len, chunk, &log), 0);
+		vassert_msg(!strcmp(buf, events), "chunk %zu: %s", chunk, buf);
+	}
+
+	// Handlers can stop parsing
+	log.stop_at = 3;
+	vassert_eq(push_chunks(src, len, 7, &log), 1);
+	vassert_eq_s(buf, "S7:{ K5:\"a\\\\\" S6:[ ");
+
+	static const char *const bad[] = {
+		"[1,]", "{\"a\"}", "{\"a\":}", "{1: 2}", "[1 2]", "[1}", "[[]", "[]]",
+		"tru", "[nul]", "\"abc", "[\"a\": 1]", "-", "01", "1.e5",
+	};
+	for (size_t i = 0; i < sizeof bad / sizeof *bad; i++) {
+		for (size_t chunk = 1; chunk <= strlen(bad[i]); chunk++) {
+			log.stop_at = -1;
+			vassert_msg(push_chunks(bad[i], strlen(bad[i]), chunk, &log) == -1, "%s, chunk %zu", bad[i], chunk);
+		}
+	}
+
+	// Nesting is limited, and objects and arrays are told apart at every level
+	char deep[8 * VJSON_MAX_DEPTH + 16], *d = deep;
+	for (int i = 0; i < VJSON_MAX_DEPTH; i++) d += sprintf(d, i % 3 ? "[" : "{\"a\":");
+	*d++ = '0';
+	for (int i = VJSON_MAX_DEPTH; i--;) *d++ = i % 3 ? ']' : '}';
+	log.stop_at = -1;
+	vassert_eq(push_chunks(deep, d - deep, 64, &log), 0);
+	memmove(deep + 1, deep, d - deep);
+	deep[0] = '[';
+	*++d = ']';
+	log.stop_at = -1;
+	vassert_eq(push_chunks(deep, d + 1 - deep, 64, &log), -1);
+
+	// Errors report their offset
+	struct vjson_push p;
+	vjson_push_init(&p, (struct vjson_handler){log_event, &log});
+	log.len = 0;
+	vassert_eq(vjson_push(&p, "[1, 2", 5), 0);
+	vassert_eq(vjson_push(&p, ", :]", 4), -1);
+	vassert_eq_u(p.offset, 7);
+	vassert_eq(vjson_push(&p, "]", 1), -1);
+	vjson_push_free(&p);
+}
+
+VTEST(test_push_random) {
+	char *doc = malloc(1 << 20);
+	char *whole = malloc(1 << 20), *split = malloc(1 << 20);
+	rng_state = 5;
+	for (int i = 0; i < 100; i++) {
+		char *p = doc;
+		gen_value(&p, 0);
+		size_t len = p - doc;
+
+		struct event_log log = {whole, 0, -1};
+		vassert_eq(push_chunks(doc, len, len, &log), 0);
+		log = (struct event_log){split, 0, -1};
+		vassert_eq(push_chunks(doc, len, 1 + rng(100), &log), 0);
+		vassert(!strcmp(whole, split));
+	}
+	free(split);
+	free(whole);
+	free(doc);
+}
+
+#define TEST_NDJSON "data/vjson/records.ndjson"
+
+struct ndjson_state {
+	atomic_int count, errors;
+	int stop_at;
+};
+
+// Parse a record, returning its id plus one
+static int parse_record(void *ctx, struct vjson_record *rec) {
+	struct ndjson_state *st = ctx;
+	const char *src = rec->src;
+	if (vjson_value(&src, rec->end) != VJSON_OBJECT || src != rec->end) goto error;
+
+	int64_t id = -1;
+	size_t len;
+	const char *name = NULL;
+	src = vjson_enter(rec->src);
+	while (*src != '}') {
+		const char *key = src;
+		if (vjson_key(&src, rec->end) != VJSON_STRING) goto error;
+		const char *val = src;
+		if (vjson_item(&src, rec->end) == VJSON_ERROR) goto error;
+
+		if (vjson_key_eq(key, "id")) {
+			if (!vjson_get_i64(val, &id)) goto error;
+		} else if (vjson_key_eq(key, "name")) {
+			name = vjson_get_astring(val, rec->arena, &len);
+		}
+	}
+
+	char expect[32];
+	if (!name || (size_t)sprintf(expect, "rec\n%d", (int)id) != len || memcmp(name, expect, len)) goto error;
+
+	atomic_fetch_add(&st->count, 1);
+	rec->result = (void *)(uintptr_t)(id + 1);
+	return id == st->stop_at ? 7 : 0;
+
+error:
+	atomic_fetch_add(&st->errors, 1);
+	return 0;
+}
+
+struct ndjson_run {
+	const struct vjson_ndjson *opts;
+	int ret;
+};
+
+static int run_ndjson(void *arg) {
+	struct ndjson_run *run = arg;
+	run->ret = vjson_ndjson_file(TEST_NDJSON, run->opts);
+	return 0;
+}
+
+VTEST(test_ndjson) {
+	static const size_t chunk_sizes[] = {1, 50, 1000, 0};
+	for (size_t i = 0; i < sizeof chunk_sizes / sizeof *chunk_sizes; i++) {
+		for (unsigned nthreads = 1; nthreads <= 4; nthreads += 3) {
+			struct ndjson_state st = {.stop_at = -1};
+			struct vjson_ndjson opts = {.record = parse_record, .ctx = &st, .nthreads = nthreads, .chunk_size = chunk_sizes[i]};
+			vassert_eq(vjson_ndjson_file(TEST_NDJSON, &opts), 0);
+			vassert_eq(st.count, 100);
+			vassert_eq(st.errors, 0);
+		}
+	}
+
+	// Results arrive in order, or all arrive unordered
+	for (int ordered = 0; ordered < 2; ordered++) {
+		struct vch *ch = vch_new(4);
+		struct ndjson_state st = {.stop_at = -1};
+		struct vjson_ndjson opts = {parse_record, &st, 4, 100, ch, vch_send, ordered};
+		struct ndjson_run run = {.opts = &opts};
+		thrd_t thread;
+		if (!vassert_eq(thrd_create(&thread, run_ndjson, &run), thrd_success)) continue;
+
+		uint64_t seen[2] = {0};
+		int n = 0;
+		for (void *item; (item = vch_recv(ch)); n++) {
+			uintptr_t id = (uintptr_t)item - 1;
+			if (ordered) vassert_eq_u(id, n);
+			seen[id / 64] |= 1ull << id % 64;
+		}
+		thrd_join(thread, NULL);
+		vassert_eq(run.ret, 0);
+		vassert_eq(n, 100);
+		vassert(seen[0] == UINT64_MAX && seen[1] == (1ull << 36) - 1);
+		vch_del(ch);
+	}
+
+	// Records can stop processing
+	struct ndjson_state st = {.stop_at = 50};
+	struct vjson_ndjson opts = {.record = parse_record, .ctx = &st, .nthreads = 4, .chunk_size = 200};
+	vassert_eq(vjson_ndjson_file(TEST_NDJSON, &opts), 7);
+	vassert(st.count < 100);
+
+	// The last line doesn't need a newline
+	st = (struct ndjson_state){.stop_at = -1};
+	const char *src = "\n{\"id\": 1, \"name\": \"rec\\n1\"}\r\n\n{\"name\": \"rec\\u000a2\", \"id\": 2}";
+	vassert_eq(vjson_ndjson(src, src + strlen(src), &opts), 0);
+	vassert_eq(st.count, 2);
+	vassert_eq(st.errors, 0);
+
+	vassert_eq(vjson_ndjson_file("data/vjson/missing.ndjson", &opts), -1);
+}
+
+static int log_match(void *ctx, size_t path, const char *val, size_t len) {
+	struct event_log *log = ctx;
+	log->len += sprintf(log->buf + log->len, "%zu:%.*s ", path, (int)len, val);
+	return !--log->stop_at;
+}
+
+VTEST(test_query) {
+	const char *src =
+		"{\"skip\": [{\"user\": {\"id\": -1}}, \"}\"], \"us\\u0065r\": {\"id\": 42, \"name\": \"x\"},\n"
+		" \"items\": [{\"price\": 1.5, \"name\": \"a\"}, {\"name\": \"b\"}, {\"price\": 3}],\n"
+		" \"meta\": {\"a\": [1], \"b\": null}} [7]";
+	static const char *const paths[] = {
+		"$.user.id", "items[*].price", "$.items[1].name", "$.meta.*", "$.missing", "[0]", "$",
+	};
+	struct vjson_query *q = vjson_query_new(paths, sizeof paths / sizeof *paths);
+	if (!vassert_not_null(q)) return;
+
+	char buf[1024];
+	struct event_log log = {buf, 0, -1};
+	vassert_eq(vjson_query(q, src, src + strlen(src), log_match, &log), 0);
+	const char *doc = strchr(src, '{');
+	char expect[1024];
+	sprintf(expect, "0:42 1:1.5 2:\"b\" 1:3 3:[1] 3:null 6:%.*s 5:7 6:[7] ", (int)(strstr(src, " [7]") - doc), doc);
+	vassert_eq_s(buf, expect);
+
+	// Matches can stop the query
+	log = (struct event_log){buf, 0, 2};
+	vassert_eq(vjson_query(q, src, src + strlen(src), log_match, &log), 1);
+	vassert_eq_s(buf, "0:42 1:1.5 ");
+	vjson_query_free(q);
+
+	// Syntax errors in the parts that are searched are caught
+	static const char *const bad_docs[] = {"{\"user\" 1}", "{\"user\": {\"id\": 1]}", "[", "{\"a\": [}"};
+	static const char *const user_id[] = {"user.id"};
+	q = vjson_query_new(user_id, 1);
+	for (size_t i = 0; i < sizeof bad_docs / sizeof *bad_docs; i++) {
+		log = (struct event_log){buf, 0, -1};
+		vassert_msg(vjson_query(q, bad_docs[i], bad_docs[i] + strlen(bad_docs[i]), log_match, &log) == -1, "%s", bad_docs[i]);
+	}
+	vjson_query_free(q);
+
+	static const char *const bad_paths[] = {"$.", "a..b", "[x]", "[1", "a[*", "$a"};
+	for (size_t i = 0; i < sizeof bad_paths / sizeof *bad_paths; i++) {
+		vassert_msg(!vjson_query_new(&bad_paths[i], 1), "%s", bad_paths[i]);
+	}
+}
+
+static void write_doc(struct vjson_writer *w) {
+	vjson_write_object(w);
+	vjson_write_key(w, "a", 1);
+	vjson_write_array(w);
+	vjson_write_i64(w, INT64_MIN);
+	vjson_write_u64(w, UINT64_MAX);
+	vjson_write_double(w, 1.5);
+	vjson_write_array(w);
+	vjson_write_end(w);
+	vjson_write_end(w);
+	vjson_write_key(w, "b\n", 2);
+	vjson_write_object(w);
+	vjson_write_end(w);
+	vjson_write_key(w, "c", 1);
+	vjson_write_string(w, "\"\\\b\f\n\r\t\x01\x1f\x7f\xc3\xa9 and a longer tail", 30);
+	vjson_write_end(w);
+	vjson_write_bool(w, 1);
+	vjson_write_null(w);
+}
+
+VTEST(test_writer) {
+	struct vjson_writer w;
+	vjson_writer_init(&w, NULL, 0, -1);
+	write_doc(&w);
+	vassert_eq(w.err, 0);
+	const char *expect =
+		"{\"a\":[-9223372036854775808,18446744073709551615,1.5,[]],\"b\\n\":{},"
+		"\"c\":\"\\\"\\\\\\b\\f\\n\\r\\t\\u0001\\u001f\x7f\xc3\xa9 and a longer tail\"}\n"
+		"true\nnull";
+	vassert_eq_u(w.len, strlen(expect));
+	vassert(w.len == strlen(expect) && !memcmp(w.buf, expect, w.len));
+
+	// The output parses back to the same values
+	struct vjson_tape tape;
+	struct varena *arena = varena_new(4096);
+	vassert_eq(vjson_tape_parse(&tape, &arena, w.buf, w.buf + w.len), 0);
+	size_t len;
+	const char *s = vjson_get_astring(strstr(w.buf, "\"c\":") + 4, &arena, &len);
+	vassert_eq_u(len, 30);
+	vassert(s && !memcmp(s, "\"\\\b\f\n\r\t\x01\x1f\x7f\xc3\xa9 and a longer tail", 30));
+	varena_free(arena);
+	vjson_writer_free(&w);
+
+	vjson_writer_init(&w, NULL, 0, -1);
+	w.indent = "  ";
+	write_doc(&w);
+	w.buf[w.len] = 0;
+	vassert_eq_s(w.buf,
+		"{\n"
+		"  \"a\": [\n"
+		"    -9223372036854775808,\n"
+		"    18446744073709551615,\n"
+		"    1.5,\n"
+		"    []\n"
+		"  ],\n"
+		"  \"b\\n\": {},\n"
+		"  \"c\": \"\\\"\\\\\\b\\f\\n\\r\\t\\u0001\\u001f\x7f\xc3\xa9 and a longer tail\"\n"
+		"}\n"
+		"true\n"
+		"null");
+	vjson_writer_free(&w);
+
+	// Misplaced keys and ends are errors, which stick
+	vjson_writer_init(&w, NULL, 0, -1);
+	vassert_eq(vjson_write_key(&w, "a", 1), -1);
+	vassert_eq(vjson_write_null(&w), -1);
+	vjson_writer_free(&w);
+	vjson_writer_init(&w, NULL, 0, -1);
+	vjson_write_array(&w);
+	vassert_eq(vjson_write_key(&w, "a", 1), -1);
+	vjson_writer_free(&w);
+	vjson_writer_init(&w, NULL, 0, -1);
+	vjson_write_object(&w);
+	vjson_write_key(&w, "a", 1);
+	vassert_eq(vjson_write_end(&w), -1);
+	vjson_writer_free(&w);
+	vjson_writer_init(&w, NULL, 0, -1);
+	vjson_write_object(&w);
+	vassert_eq(vjson_write_i64(&w, 1), -1);
+	vassert_eq(vjson_write_end(&w), -1);
+	vjson_writer_free(&w);
+
+	// Nesting is limited, and objects and arrays are told apart at every level
+	char deep[8 * VJSON_MAX_DEPTH + 16], *d = deep;
+	vjson_writer_init(&w, NULL, 0, -1);
+	for (int i = 0; i < VJSON_MAX_DEPTH; i++) {
+		if (i % 3) {
+			vjson_write_array(&w);
+			*d++ = '[';
+		} else {
+			vjson_write_object(&w);
+			vjson_write_key(&w, "a", 1);
+			d += sprintf(d, "{\"a\":");
+		}
+	}
+	vassert_eq(vjson_write_array(&w), -1);
+	w.err = 0;
+	vjson_write_i64(&w, 0);
+	*d++ = '0';
+	for (int i = VJSON_MAX_DEPTH; i--;) {
+		vjson_write_end(&w);
+		*d++ = i % 3 ? ']' : '}';
+	}
+	vassert_eq(w.err, 0);
+	vassert(w.len == (size_t)(d - deep) && !memcmp(w.buf, deep, w.len));
+	vjson_writer_free(&w);
+
+	// Fixed buffers can fill up
+	char buf[16];
+	vjson_writer_init(&w, buf, sizeof buf, -1);
+	vassert_eq(vjson_write_string(&w, "0123456789abc", 13), 0);
+	vassert_eq(vjson_write_i64(&w, 1), -1);
+	vassert_eq(vjson_write_null(&w), -1);
+
+	// Files are written in pieces
+	FILE *f = tmpfile();
+	if (!vassert_not_null(f)) return;
+	vjson_writer_init(&w, buf, sizeof buf, fileno(f));
+	write_doc(&w);
+	vassert_eq(vjson_writer_flush(&w), 0);
+	char out[256];
+	rewind(f);
+	len = fread(out, 1, sizeof out, f);
+	vassert(len == strlen(expect) && !memcmp(out, expect, len));
+	fclose(f);
+}
+
+VTEST(test_writer_doubles) {
+	static const struct {
+		double x;
+		const char *s;
+	} cases[] = {
+		{0.0, "0.0"}, {-0.0, "-0.0"}, {1.0, "1.0"}, {-2.5, "-2.5"}, {0.1, "0.1"},
+		{1e21, "1e21"}, {1e20, "100000000000000000000.0"}, {123456.789, "123456.789"},
+		{0.000001, "0.000001"}, {1e-7, "1e-7"}, {1.5e-300, "1.5e-300"},
+		{5e-324, "5e-324"}, {1.7976931348623157e308, "1.7976931348623157e308"},
+		{0.30000000000000004, "0.30000000000000004"}, {HUGE_VAL, "null"},
+	};
+	char buf[64];
+	struct vjson_writer w;
+	for (size_t i = 0; i < sizeof cases / sizeof *cases; i++) {
+		vjson_writer_init(&w, buf, sizeof buf, -1);
+		vjson_write_double(&w, cases[i].x);
+		buf[w.len] = 0;
+		vassert_eq_s(buf, cases[i].s);
+	}
+
+	// Random doubles read back exactly, and are no longer than printf's
+	rng_state = 5;
+	for (int n = 0; n < 100000; n++) {
+		double x;
+		uint64_t bits = (uint64_t)rng(1u << 31) << 33 ^ (uint64_t)rng(1u << 31) << 2 ^ rng(4);
+		memcpy(&x, &bits, sizeof x);
+		if (x != x || x - x != 0) continue;
+
+		vjson_writer_init(&w, buf, sizeof buf - 1, -1);
+		vjson_write_double(&w, x);
+		buf[w.len] = 0;
+		double d;
+		vassert_msg(!vjson_get_double(buf, &d) && d == x, "%s: %.17g", buf, x);
+
+		// Count significant digits
+		const char *p = buf + strspn(buf, "-0.");
+		size_t ndigits = 0, zeros = 0;
+		for (; *p && *p != 'e'; p++) {
+			if (*p == '.') continue;
+			if (*p == '0') {
+				zeros++;
+			} else {
+				ndigits += zeros + 1;
+				zeros = 0;
+			}
+		}
+		vassert_msg(ndigits <= 17, "%s", buf);
+	}
+}
+
+struct bind_point {
+	double x, y;
+	char *label;
+};
+
+#define BIND_POINT_FIELDS(X) \
+	X(struct bind_point, x, DOUBLE) \
+	X(struct bind_point, y, DOUBLE) \
+	X(struct bind_point, label, STRING)
+VJSON_SCHEMA(bind_point_schema, BIND_POINT_FIELDS);
+
+struct bind_shape {
+	int id;
+	int64_t i64;
+	uint64_t u64;
+	_Bool visible;
+	char *name;
+	struct bind_point origin;
+};
+
+#define BIND_SHAPE_FIELDS(X) \
+	X(struct bind_shape, id, INT) \
+	X(struct bind_shape, i64, I64) \
+	X(struct bind_shape, u64, U64) \
+	X(struct bind_shape, visible, BOOL) \
+	X(struct bind_shape, name, STRING) \
+	X(struct bind_shape, origin, OBJECT(bind_point_schema))
+VJSON_SCHEMA(bind_shape_schema, BIND_SHAPE_FIELDS);
+
+VTEST(test_bind) {
+	const char *src =
+		"{\"u64\": 18446744073709551615, \"skip\": [{\"id\": 1}, \"}\"], \"id\": -7,\n"
+		" \"origin\": {\"y\": -2.5e3, \"label\": \"a\\u00e9\\n\", \"z\": {}, \"x\": 0.1},\n"
+		" \"i64\": -9223372036854775808, \"na\\u006de\": \"shape\", \"visible\": true, \"extra\": null} [1]";
+	const char *end = src + strlen(src);
+	struct varena *arena = varena_new(4096);
+	struct bind_shape shape = {.visible = 0};
+	const char *p = src;
+	vassert_eq(vjson_bind(&bind_shape_schema, &shape, &p, end, &arena), 0);
+	vassert_eq_s(p, " [1]");
+	vassert_eq(shape.id, -7);
+	vassert(shape.i64 == INT64_MIN);
+	vassert(shape.u64 == UINT64_MAX);
+	vassert(shape.visible);
+	vassert_eq_s(shape.name, "shape");
+	vassert(shape.origin.x == 0.1 && shape.origin.y == -2500);
+	vassert_eq_s(shape.origin.label, "a\xc3\xa9\n");
+
+	// Missing and null members are left alone
+	struct bind_point point = {1, 2, "old"};
+	static const char empty[] = " {\"x\": null, \"label\": null}";
+	p = empty;
+	vassert_eq(vjson_bind(&bind_point_schema, &point, &p, empty + strlen(empty), &arena), 0);
+	vassert(point.x == 1 && point.y == 2);
+	vassert_eq_s(point.label, "old");
+	varena_free(arena);
+
+	static const char *const bad[] = {
+		"{\"id\": 2147483648}", "{\"id\": 1.5}", "{\"u64\": -1}", "{\"i64\": 9223372036854775808}",
+		"{\"visible\": 1}", "{\"name\": 1}", "{\"origin\": []}", "{\"id\": 1,}", "{\"id\" 1}",
+		"{\"skip\": [1}", "{\"skip\": [}", "[]", "{\"name\": \"x", "{\"id\": 1",
+	};
+	for (size_t i = 0; i < sizeof bad / sizeof *bad; i++) {
+		arena = varena_new(4096);
+		p = bad[i];
+		vassert_msg(vjson_bind(&bind_shape_schema, &shape, &p, bad[i] + strlen(bad[i]), &arena) == -1, "%s", bad[i]);
+		varena_free(arena);
+	}
+}
+
+VTESTS_BEGIN
+	test_index,
+	test_index_random,
+	test_skip,
+	test_skip_random,
+	test_cursor,
+	test_tape,
+	test_tape_random,
+	test_strings,
+	test_numbers,
+	test_numbers_random,
+	test_push,
+	test_push_random,
+	test_ndjson,
+	test_query,
+	test_writer,
+	test_writer_doubles,
+	test_bind,
+VTESTS_END
@@ -0,0 +1,157 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+
+#include "vtest.h"
+#define VENFLATE_IMPL
+#include "../vinflate.h"
+#define VZIP_IMPL
+#include "../vzip.h"
+
+#define TEST_TEXT "data/vinflate/text.txt"
+
+// Check an entry extracts to the expected data
+static void check_entry(const struct vzip *z, const char *name, const unsigned char *expect, size_t expect_len, int *_vtest_status) {
+	const struct vzip_entry *e = vzip_find(z, name);
+	if (!vassert_msg(e, "%s not found", name)) return;
+	vassert_eq_u(e->size, expect_len);
+
+	unsigned char *out = malloc(e->size + 1);
+	enum vzip_error err = vzip_extract(z, e, out);
+	vassert_msg(!err, "%s: %s", name, vzip_error_string[err]);
+	if (expect_len) vassert(!memcmp(out, expect, expect_len));
+	free(out);
+}
+
+VTEST(test_open) {
+	size_t text_len;
+	unsigned char *text = mapfile(TEST_TEXT, &text_len);
+	if (!vassert_not_null(text)) return;
+
+	struct vzip z;
+	enum vzip_error err = vzip_open(&z, "data/vzip/basic.zip");
+	if (!vassert_msg(!err, "%s", vzip_error_string[err])) return;
+	vassert_eq_u(z.nentries, 5);
+	vassert(z.comment_len == 17 && !memcmp(z.comment, "vzip test archive", 17));
+
+	const struct vzip_entry *e = vzip_find(&z, "dir/text.txt");
+	if (vassert_not_null(e)) {
+		vassert_eq(e->method, VZIP_DEFLATED);
+		vassert(e->comp_size < e->size);
+		vassert_eq_u(e->crc, vinf_crc32_buf(0, text, text_len));
+	}
+	vassert_null(vzip_find(&z, "dir/text"));
+	vassert_null(vzip_find(&z, "missing"));
+
+	check_entry(&z, "dir/", NULL, 0, _vtest_status);
+	check_entry(&z, "dir/text.txt", text, text_len, _vtest_status);
+	check_entry(&z, "stored.txt", text, 1000, _vtest_status);
+	check_entry(&z, "empty", NULL, 0, _vtest_status);
+
+	// Stored data is available straight from the mapping
+	e = vzip_find(&z, "stored.txt");
+	const unsigned char *data;
+	if (vassert_not_null(e) && vassert_eq(vzip_data(&z, e, &data), VZIP_ERR_SUCCESS)) {
+		vassert(data > z.data && data + e->comp_size <= z.data + z.len);
+		vassert(!memcmp(data, text, 1000));
+	}
+
+	// Unsupported methods are reported as such
+	e = vzip_find(&z, "bzip2.txt");
+	unsigned char out[1000];
+	if (vassert_not_null(e)) vassert_eq(vzip_extract(&z, e, out), VZIP_ERR_UNSUPPORTED);
+
+	vzip_close(&z);
+	munmap(text, text_len);
+
+	vassert_eq(vzip_open(&z, "data/vzip/missing.zip"), VZIP_ERR_OPEN);
+	vassert_eq(vzip_open(&z, TEST_TEXT), VZIP_ERR_FORMAT);
+}
+
+VTEST(test_zip64) {
+	size_t text_len;
+	unsigned char *text = mapfile(TEST_TEXT, &text_len);
+	if (!vassert_not_null(text)) return;
+
+	struct vzip z;
+	enum vzip_error err = vzip_open(&z, "data/vzip/zip64.zip");
+	if (!vassert_msg(!err, "%s", vzip_error_string[err])) return;
+	vassert_eq_u(z.nentries, 1);
+	check_entry(&z, "big.txt", text, 5000, _vtest_status);
+
+	vzip_close(&z);
+	munmap(text, text_len);
+}
+
+VTEST(test_corrupt) {
+	size_t len;
+	unsigned char *zip = mapfile("data/vzip/basic.zip", &len);
+	if (!vassert_not_null(zip)) return;
+	unsigned char *buf = malloc(len);
+
+	// Truncated archives have no end record
+	struct vzip z;
+	vassert_eq(vzip_open_mem(&z, zip, len - 30), VZIP_ERR_FORMAT);
+
+	// Changing the data is caught by the CRC
+	memcpy(buf, zip, len);
+	vassert_eq(vzip_open_mem(&z, buf, len), VZIP_ERR_SUCCESS);
+	const struct vzip_entry *e = vzip_find(&z, "stored.txt");
+	const unsigned char *data;
+	if (vassert_not_null(e) && vassert_eq(vzip_data(&z, e, &data), VZIP_ERR_SUCCESS)) {
+		buf[data - buf + 10] ^= 1;
+		unsigned char out[1000];
+		vassert_eq(vzip_extract(&z, e, out), VZIP_ERR_CRC);
+	}
+	vzip_close(&z);
+
+	// So is a wrong size
+	memcpy(buf, zip, len);
+	vassert_eq(vzip_open_mem(&z, buf, len), VZIP_ERR_SUCCESS);
+	if (vassert_not_null(e = vzip_find(&z, "dir/text.txt"))) {
+		struct vzip_entry bad = *e;
+		bad.size--;
+		unsigned char *out = malloc(bad.size);
+		vassert_eq(vzip_extract(&z, &bad, out), VZIP_ERR_SIZE);
+		free(out);
+	}
+	vzip_close(&z);
+
+	free(buf);
+	munmap(zip, len);
+}
+
+VTEST(test_extract_all) {
+	size_t text_len;
+	unsigned char *text = mapfile(TEST_TEXT, &text_len);
+	if (!vassert_not_null(text)) return;
+
+	struct vzip z;
+	enum vzip_error err = vzip_open(&z, "data/vzip/basic.zip");
+	if (!vassert_msg(!err, "%s", vzip_error_string[err])) return;
+
+	// Extract every supported entry in parallel
+	struct vzip_job jobs[5];
+	size_t njobs = 0;
+	for (size_t i = 0; i < z.nentries; i++) {
+		int method = z.entries[i].method;
+		if (method != VZIP_STORED && method != VZIP_DEFLATED) continue;
+		jobs[njobs++] = (struct vzip_job){&z.entries[i], malloc(z.entries[i].size + 1)};
+	}
+	vassert_eq_u(njobs, 4);
+	vassert_eq(vzip_extract_all(&z, jobs, njobs, 4), VZIP_ERR_SUCCESS);
+	for (size_t i = 0; i < njobs; i++) {
+		vassert_eq(jobs[i].err, VZIP_ERR_SUCCESS);
+		vassert(!memcmp(jobs[i].out, text, jobs[i].entry->size));
+		free(jobs[i].out);
+	}
+
+	vzip_close(&z);
+	munmap(text, text_len);
+}
+
+VTESTS_BEGIN
+	test_open,
+	test_zip64,
+	test_corrupt,
+	test_extract_all,
+VTESTS_END
@@ -46,6 +46,7 @@ void *aalloc(struct varena **arena, size_t size);
 #endif
 
 #ifdef VARENA_IMPL
+#undef VARENA_IMPL
 
 #include <stdlib.h>
 
@@ -65,7 +65,7 @@ void *vch_recv(struct vch *ch);
 struct vch {
 	cnd_t full, empty;
 	mtx_t lock;
-	size_t start, end, len;
+	size_t start, count, len;
 	void *buf[];
 };
 
@@ -75,7 +75,7 @@ struct vch *vch_new(size_t buffer) {
 	_vch_te(cnd_init(&ch->full));
 	_vch_te(cnd_init(&ch->empty));
 	_vch_te(mtx_init(&ch->lock, mtx_plain));
-	ch->start = ch->end = 0;
+	ch->start = ch->count = 0;
 	ch->len = buffer;
 
 	return ch;
@@ -95,16 +95,12 @@ void vch_del(struct vch *ch) {
 void vch_send(struct vch *ch, void *item) {
 	_vch_tp(mtx_lock(&ch->lock));
 
-	if (ch->end >= ch->len) {
-		while (ch->start == 0) {
-			_vch_tp(cnd_wait(&ch->full, &ch->lock));
-		}
-		ch->end = 0;
-		if (ch->start >= ch->len) ch->start = 0;
+	while (ch->count == ch->len) {
+		_vch_tp(cnd_wait(&ch->full, &ch->lock));
 	}
 
-	ch->buf[ch->end] = item;
-	ch->end++;
+	ch->buf[(ch->start + ch->count) % ch->len] = item;
+	ch->count++;
 
 	_vch_tp(cnd_signal(&ch->empty));
 	_vch_tp(mtx_unlock(&ch->lock));
@@ -115,13 +111,13 @@ void vch_send(struct vch *ch, void *item) {
 void *vch_recv(struct vch *ch) {
 	_vch_tp(mtx_lock(&ch->lock));
 
-	while (ch->start == ch->end) {
+	while (ch->count == 0) {
 		_vch_tp(cnd_wait(&ch->empty, &ch->lock));
 	}
-	if (ch->start >= ch->end) ch->start = 0;
 
 	void *v = ch->buf[ch->start];
-	ch->start++;
+	ch->start = (ch->start + 1) % ch->len;
+	ch->count--;
 
 	_vch_tp(cnd_signal(&ch->full));
 	_vch_tp(mtx_unlock(&ch->lock));
@@ -0,0 +1,881 @@
+/* vdeflate.h
+ *
+ * DEFLATE compressor, producing raw DEFLATE, gzip or zlib data
+ * Define VDEFLATE_IMPL in one translation unit
+ * Depends on vinflate.h for checksums, so VENFLATE_IMPL must also be defined
+ * somewhere in the program
+ *
+ * Limitations:
+ * - Only a single gzip member is written, with no name, comment or mtime
+ */
+
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+ * this software, either in source code form or as a compiled binary, for any
+ * purpose, commercial or non-commercial, and by any means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors of
+ * this software dedicate any and all copyright interest in the software to the
+ * public domain. We make this dedication for the benefit of the public at
+ * large and to the detriment of our heirs and successors. We intend this
+ * dedication to be an overt act of relinquishment in perpetuity of all present
+ * and future rights to this software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ */
+#ifndef VDEFLATE_H
+#define VDEFLATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "vinflate.h"
+
+// Compression levels. Levels in between trade speed for size
+enum {
+	VDEF_LEVEL_STORE = 0, // No compression, stored blocks only
+	VDEF_LEVEL_FASTEST = 1, // Greedy matching, probing only the most recent match
+	VDEF_LEVEL_DEFAULT = 6,
+	VDEF_LEVEL_BEST = 9, // Lazy matching with long hash chains
+};
+
+// Flush modes for vdeflate_stream
+enum {
+	VDEF_NO_FLUSH, // Compress as input allows, buffering some internally
+	VDEF_SYNC_FLUSH, // Compress all input and align the output to a byte boundary
+	VDEF_FINISH, // Compress all input and end the stream
+};
+
+// Strategies, which limit the block types used
+enum {
+	VDEF_STRATEGY_DEFAULT, // Use whichever of stored, fixed or dynamic blocks is smallest
+	VDEF_STRATEGY_FIXED, // Never use dynamic blocks, which suits very short inputs
+};
+
+// Compress inp into out, in one of the VINF_STREAM_* formats, setting out_len
+// to the compressed size. Returns VENF_ERR_OVERFLOW if out is too small; an
+// output of vdeflate_bound(inp_len) bytes is always enough
+enum vinf_error vdeflate(const unsigned char *inp, size_t inp_len, unsigned char *out, size_t *out_len,
+	int format, int level);
+size_t vdeflate_bound(size_t len);
+
+// Compressor state {{{
+enum {
+	// Maximum number of symbols in literal/length alphabet
+	_vdef_NLIT = 286,
+	// Number of symbols in distance alphabet
+	_vdef_NDIST = 30,
+
+	_vdef_HASH_BITS = 15,
+	// Maximum number of symbols in a block
+	_vdef_SYMS = 1 << 14,
+	// A block never covers more than the window, and never compresses to
+	// more than storing it would take
+	_vdef_PENDING = 2 * VINF_WSIZE + 1024,
+};
+// }}}
+
+// Streaming compression {{{
+// A streaming compressor accepts input in arbitrary chunks and writes output
+// to arbitrary chunks, using a fixed amount of memory (about 300K, most of it
+// in the struct itself; allocate it statically or on the heap).
+//
+// Set inp/inp_len and out/out_len, then call vdeflate_stream. It consumes
+// input and produces output until it runs out of one or the other, advancing
+// the pointers and decrementing the lengths as it goes. With VDEF_NO_FLUSH,
+// some input may be held back until more arrives. Once called with
+// VDEF_FINISH and given enough output space, `done` is set.
+//
+// VDEF_SYNC_FLUSH ends the current block and appends an empty stored block,
+// so everything written so far can be decompressed, e.g. by a log reader
+struct vdef_stream {
+	const unsigned char *inp;
+	size_t inp_len;
+	unsigned char *out;
+	size_t out_len;
+
+	int format, level;
+	int strategy; // VDEF_STRATEGY_*. May be changed after vdef_stream_init
+	_Bool done;
+	uint32_t check; // CRC-32 (gzip and raw streams) or Adler-32 (zlib streams) of all input so far
+	uint64_t total_in, total_out;
+
+	// Internal state
+	_Bool finished; // The final block and trailer have been written to pending
+	_Bool synced; // No input has arrived since the last sync flush
+	_Bool match_available; // The byte before strstart has not been output yet
+	unsigned strstart; // Next window position to compress
+	unsigned lookahead; // Number of bytes in the window from strstart on
+	unsigned block_start; // Window position the current block starts at
+	unsigned match_length, match_start, prev_length, prev_match;
+
+	uint64_t bits;
+	unsigned nbits;
+	size_t pend_start, pend_end; // Output not yet copied to the caller
+
+	uint16_t nsyms;
+	uint32_t lit_freq[_vdef_NLIT];
+	uint32_t dist_freq[_vdef_NDIST];
+	uint16_t sym_dist[_vdef_SYMS]; // Match distance, or 0 for a literal
+	uint8_t sym_lc[_vdef_SYMS]; // Literal byte, or match length minus 3
+
+	// Hash chains. Entries are window positions, with 0 meaning none
+	uint16_t head[1 << _vdef_HASH_BITS];
+	uint16_t prev[VINF_WSIZE];
+
+	unsigned char pending[_vdef_PENDING];
+	unsigned char window[2 * VINF_WSIZE];
+};
+
+// Prepare a stream for compression. Format is one of VINF_STREAM_*, level one
+// of 0-9 or VDEF_LEVEL_*
+void vdef_stream_init(struct vdef_stream *s, int format, int level);
+// Compress as much as possible. Flush is one of VDEF_*_FLUSH or VDEF_FINISH
+void vdeflate_stream(struct vdef_stream *s, int flush);
+// }}}
+
+#endif
+
+#ifdef VDEFLATE_IMPL
+#undef VDEFLATE_IMPL
+
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+	_vdef_MIN_MATCH = 3,
+	_vdef_MAX_MATCH = 258,
+	// Bytes of lookahead needed to find a match of any length, plus the
+	// bytes after it needed to hash the next position
+	_vdef_MIN_LOOKAHEAD = _vdef_MAX_MATCH + _vdef_MIN_MATCH + 1,
+	// Length 3 matches further than this are not worth their distance code
+	_vdef_TOO_FAR = 4096,
+};
+
+// Match finder {{{
+struct _vdef_config {
+	uint16_t good; // Search less hard once a match this long is found
+	uint16_t lazy; // Don't look for a better match past this length. For greedy levels, the longest match whose positions are all hashed
+	uint16_t nice; // Stop searching once a match this long is found
+	uint16_t chain; // Maximum number of hash chain entries to check
+	_Bool greedy;
+};
+
+static const struct _vdef_config _vdef_configs[10] = {
+	{0, 0, 0, 0, 1}, // Store only
+	{4, 4, 8, 1, 1}, // Single probe, greedy
+	{4, 5, 16, 8, 1},
+	{4, 6, 32, 32, 1},
+	{4, 4, 16, 16, 0},
+	{8, 16, 32, 32, 0},
+	{8, 16, 128, 128, 0},
+	{8, 32, 128, 256, 0},
+	{32, 128, 258, 1024, 0},
+	{32, 258, 258, 4096, 0},
+};
+
+static inline uint32_t _vdef_hash(const unsigned char *p) {
+	uint32_t v = p[0] | p[1] << 8 | (uint32_t)p[2] << 16;
+	return (v * 0x9e3779b1u) >> (32 - _vdef_HASH_BITS);
+}
+
+// Add the string at pos to its hash chain, returning the previous head
+static inline unsigned _vdef_insert(struct vdef_stream *s, unsigned pos) {
+	uint32_t h = _vdef_hash(s->window + pos);
+	unsigned head = s->head[h];
+	s->prev[pos & (VINF_WSIZE - 1)] = head;
+	s->head[h] = pos;
+	return head;
+}
+
+// Length of the common prefix of a and b, up to max
+static inline unsigned _vdef_match_len(const unsigned char *a, const unsigned char *b, unsigned max) {
+	unsigned n = 0;
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	for (; n + 8 <= max; n += 8) {
+		uint64_t x, y;
+		memcpy(&x, a + n, 8);
+		memcpy(&y, b + n, 8);
+		if (x != y) return n + (__builtin_ctzll(x ^ y) >> 3);
+	}
+#endif
+	while (n < max && a[n] == b[n]) n++;
+	return n;
+}
+
+// Lowest window position a match from strstart may start at, exclusive
+static inline unsigned _vdef_limit(const struct vdef_stream *s) {
+	return s->strstart > VINF_WSIZE ? s->strstart - VINF_WSIZE : 0;
+}
+
+// Walk the hash chain from cur, looking for a match longer than best. Sets
+// match_start if one is found, and returns the length of the longest match
+static unsigned _vdef_longest_match(struct vdef_stream *s, unsigned cur, unsigned best) {
+	const struct _vdef_config *cfg = &_vdef_configs[s->level];
+	unsigned chain = cfg->chain;
+	if (best >= cfg->good) chain = (chain >> 2) + 1;
+
+	unsigned max = s->lookahead < _vdef_MAX_MATCH ? s->lookahead : _vdef_MAX_MATCH;
+	unsigned nice = cfg->nice < max ? cfg->nice : max;
+	if (best >= max) return best;
+
+	unsigned limit = _vdef_limit(s);
+	const unsigned char *scan = s->window + s->strstart;
+	do {
+		const unsigned char *m = s->window + cur;
+		// Only a match that beats the best so far is interesting, so check
+		// the byte that would extend it first
+		if (m[best] != scan[best] || m[0] != scan[0]) continue;
+
+		unsigned len = _vdef_match_len(m, scan, max);
+		if (len > best) {
+			best = len;
+			s->match_start = cur;
+			if (len >= nice) break;
+		}
+	} while ((cur = s->prev[cur & (VINF_WSIZE - 1)]) > limit && --chain);
+	return best;
+}
+// }}}
+
+// Symbols {{{
+// Length codes 0-7 have no extra bits, then each group of four adds one more,
+// up to code 28 which is length 258 alone. Distance codes work the same way
+// with groups of two. Codes are numbered from 0 here, so length code c is
+// literal/length symbol 257 + c
+static inline unsigned _vdef_log2(unsigned x) {
+#ifdef __GNUC__
+	return 31 - __builtin_clz(x);
+#else
+	unsigned n = 0;
+	while (x >>= 1) n++;
+	return n;
+#endif
+}
+
+// l is the match length minus 3
+static inline unsigned _vdef_len_code(unsigned l) {
+	if (l < 8) return l;
+	if (l == 255) return 28;
+	unsigned b = _vdef_log2(l);
+	return 4 * (b - 1) + (l >> (b - 2) & 3);
+}
+
+static inline unsigned _vdef_len_extra(unsigned c) {
+	return c < 8 || c == 28 ? 0 : c / 4 - 1;
+}
+
+// d is the distance minus 1
+static inline unsigned _vdef_dist_code(unsigned d) {
+	if (d < 4) return d;
+	unsigned b = _vdef_log2(d);
+	return 2 * b + (d >> (b - 1) & 1);
+}
+
+static inline unsigned _vdef_dist_extra(unsigned c) {
+	return c < 4 ? 0 : c / 2 - 1;
+}
+
+static inline void _vdef_tally_lit(struct vdef_stream *s, unsigned char c) {
+	s->sym_dist[s->nsyms] = 0;
+	s->sym_lc[s->nsyms++] = c;
+	s->lit_freq[c]++;
+}
+
+static inline void _vdef_tally_match(struct vdef_stream *s, unsigned len, unsigned dist) {
+	s->sym_dist[s->nsyms] = dist;
+	s->sym_lc[s->nsyms++] = len - _vdef_MIN_MATCH;
+	s->lit_freq[257 + _vdef_len_code(len - _vdef_MIN_MATCH)]++;
+	s->dist_freq[_vdef_dist_code(dist - 1)]++;
+}
+// }}}
+
+// Compression loops {{{
+// Both loops stop when the block is full, or when lookahead drops to stop.
+// Unless the stream is being flushed, stop leaves enough lookahead for a
+// match of any length
+
+// Take the longest match at each position, as found by a short search
+static void _vdef_greedy(struct vdef_stream *s, unsigned stop) {
+	const struct _vdef_config *cfg = &_vdef_configs[s->level];
+	while (s->lookahead > stop && s->nsyms < _vdef_SYMS) {
+		unsigned head = 0, len = 0;
+		if (s->lookahead >= _vdef_MIN_MATCH) head = _vdef_insert(s, s->strstart);
+		if (head > _vdef_limit(s)) len = _vdef_longest_match(s, head, _vdef_MIN_MATCH - 1);
+
+		if (len < _vdef_MIN_MATCH) {
+			_vdef_tally_lit(s, s->window[s->strstart]);
+			s->strstart++;
+			s->lookahead--;
+			continue;
+		}
+
+		_vdef_tally_match(s, len, s->strstart - s->match_start);
+		s->lookahead -= len;
+		// Hashing every position of a long match is slow, and matches
+		// starting inside it are rarely better than the match itself
+		if (len <= cfg->lazy && s->lookahead >= _vdef_MIN_MATCH) {
+			while (--len) _vdef_insert(s, ++s->strstart);
+			s->strstart++;
+		} else {
+			s->strstart += len;
+		}
+	}
+}
+
+// Before taking a match, check whether the next position has a longer one.
+// If it does, output a literal and take that match instead
+static void _vdef_lazy(struct vdef_stream *s, unsigned stop) {
+	const struct _vdef_config *cfg = &_vdef_configs[s->level];
+	while (s->lookahead > stop && s->nsyms < _vdef_SYMS) {
+		unsigned head = 0;
+		if (s->lookahead >= _vdef_MIN_MATCH) head = _vdef_insert(s, s->strstart);
+
+		s->prev_length = s->match_length;
+		s->prev_match = s->match_start;
+		s->match_length = _vdef_MIN_MATCH - 1;
+		if (head > _vdef_limit(s) && s->prev_length < cfg->lazy) {
+			s->match_length = _vdef_longest_match(s, head, s->prev_length);
+			if (s->match_length == _vdef_MIN_MATCH && s->strstart - s->match_start > _vdef_TOO_FAR) {
+				s->match_length = _vdef_MIN_MATCH - 1;
+			}
+		}
+
+		if (s->prev_length >= _vdef_MIN_MATCH && s->match_length <= s->prev_length) {
+			// The previous position's match is at least as good; take it
+			unsigned max_insert = s->strstart + s->lookahead - _vdef_MIN_MATCH;
+			_vdef_tally_match(s, s->prev_length, s->strstart - 1 - s->prev_match);
+			s->lookahead -= s->prev_length - 1;
+			for (unsigned n = s->prev_length - 2; n--;) {
+				if (++s->strstart <= max_insert) _vdef_insert(s, s->strstart);
+			}
+			s->match_available = 0;
+			s->match_length = _vdef_MIN_MATCH - 1;
+			s->strstart++;
+		} else {
+			// Output the previous position as a literal, and defer this one
+			if (s->match_available) _vdef_tally_lit(s, s->window[s->strstart - 1]);
+			s->match_available = 1;
+			s->strstart++;
+			s->lookahead--;
+		}
+	}
+
+	if (!stop && !s->lookahead && s->match_available && s->nsyms < _vdef_SYMS) {
+		_vdef_tally_lit(s, s->window[s->strstart - 1]);
+		s->match_available = 0;
+	}
+}
+
+static void _vdef_compress(struct vdef_stream *s, unsigned stop) {
+	if (s->level == VDEF_LEVEL_STORE) {
+		s->strstart += s->lookahead;
+		s->lookahead = 0;
+	} else if (_vdef_configs[s->level].greedy) {
+		_vdef_greedy(s, stop);
+	} else {
+		_vdef_lazy(s, stop);
+	}
+}
+// }}}
+
+// Output {{{
+// Bits are written least significant first, like vinflate reads them. n is
+// at most 32
+static inline void _vdef_put(struct vdef_stream *s, uint32_t v, unsigned n) {
+	s->bits |= (uint64_t)v << s->nbits;
+	s->nbits += n;
+	if (s->nbits >= 32) {
+		unsigned char *p = s->pending + s->pend_end;
+		p[0] = s->bits;
+		p[1] = s->bits >> 8;
+		p[2] = s->bits >> 16;
+		p[3] = s->bits >> 24;
+		s->pend_end += 4;
+		s->bits >>= 32;
+		s->nbits -= 32;
+	}
+}
+
+// Pad to a byte boundary and write out any buffered bits
+static void _vdef_align(struct vdef_stream *s) {
+	while (s->nbits > 0) {
+		s->pending[s->pend_end++] = s->bits;
+		s->bits >>= 8;
+		s->nbits = s->nbits > 8 ? s->nbits - 8 : 0;
+	}
+	s->bits = 0;
+}
+
+static void _vdef_put_bytes(struct vdef_stream *s, const void *buf, size_t len) {
+	if (!len) return;
+	memcpy(s->pending + s->pend_end, buf, len);
+	s->pend_end += len;
+}
+
+static void _vdef_put_le32(struct vdef_stream *s, uint32_t v) {
+	unsigned char b[4] = {v, v >> 8, v >> 16, v >> 24};
+	_vdef_put_bytes(s, b, 4);
+}
+
+static void _vdef_put_be32(struct vdef_stream *s, uint32_t v) {
+	unsigned char b[4] = {v >> 24, v >> 16, v >> 8, v};
+	_vdef_put_bytes(s, b, 4);
+}
+
+// Copy pending output to the caller
+static void _vdef_drain(struct vdef_stream *s) {
+	size_t n = s->pend_end - s->pend_start;
+	if (n > s->out_len) n = s->out_len;
+	memcpy(s->out, s->pending + s->pend_start, n);
+	s->pend_start += n;
+	s->out += n;
+	s->out_len -= n;
+	s->total_out += n;
+	if (s->pend_start == s->pend_end) s->pend_start = s->pend_end = 0;
+}
+// }}}
+
+// Huffman codes {{{
+enum {
+	_vdef_MAX_BITS = 15,
+	_vdef_MAX_CL_BITS = 7,
+	_vdef_NCL = 19,
+	// The fixed code includes two unused symbols, which affect the codes
+	// given to the others
+	_vdef_FIXED_NLIT = 288,
+};
+
+// Compute code lengths of at most maxlen bits for the symbols with nonzero
+// frequency. At least two symbols always get a code, so that the code is
+// complete, which every decoder accepts
+static void _vdef_huff_lengths(uint8_t *lens, const uint32_t *freq, unsigned n, unsigned maxlen) {
+	uint16_t syms[_vdef_NLIT];
+	unsigned nsyms = 0;
+	for (unsigned i = 0; i < n; i++) {
+		lens[i] = 0;
+		if (freq[i]) syms[nsyms++] = i;
+	}
+	if (nsyms < 2) {
+		unsigned sym = nsyms ? syms[0] : 0;
+		lens[sym] = 1;
+		lens[sym ? 0 : 1] = 1;
+		return;
+	}
+
+	// Sort by frequency; alphabets are small enough for insertion sort
+	for (unsigned i = 1; i < nsyms; i++) {
+		uint16_t sym = syms[i];
+		unsigned j = i;
+		for (; j > 0 && freq[syms[j - 1]] > freq[sym]; j--) syms[j] = syms[j - 1];
+		syms[j] = sym;
+	}
+
+	// Build the tree with two queues: the sorted leaves, and the internal
+	// nodes, which are created in order of increasing weight. Nodes are
+	// numbered with the leaves first and the root last
+	uint32_t weight[2 * _vdef_NLIT];
+	uint16_t parent[2 * _vdef_NLIT];
+	for (unsigned i = 0; i < nsyms; i++) weight[i] = freq[syms[i]];
+	unsigned leaf = 0, node = nsyms;
+	for (unsigned k = nsyms; k < 2 * nsyms - 1; k++) {
+		weight[k] = 0;
+		for (int j = 0; j < 2; j++) {
+			unsigned pick = leaf < nsyms && (node >= k || weight[leaf] <= weight[node]) ? leaf++ : node++;
+			weight[k] += weight[pick];
+			parent[pick] = k;
+		}
+	}
+
+	// Count the leaves at each depth, folding anything too deep into maxlen
+	uint16_t depth[2 * _vdef_NLIT];
+	unsigned count[_vdef_MAX_BITS + 1] = {0};
+	depth[2 * nsyms - 2] = 0;
+	for (unsigned k = 2 * nsyms - 2; k-- > 0;) {
+		depth[k] = depth[parent[k]] + 1;
+		if (k < nsyms) count[depth[k] < maxlen ? depth[k] : maxlen]++;
+	}
+
+	// Folding oversubscribes the code. Fix it by repeatedly moving a leaf
+	// from maxlen down to below the deepest shorter leaf, which splits that
+	// leaf in two
+	uint32_t total = 0;
+	for (unsigned l = 1; l <= maxlen; l++) total += count[l] << (maxlen - l);
+	while (total > 1u << maxlen) {
+		count[maxlen]--;
+		for (unsigned l = maxlen - 1; l > 0; l--) {
+			if (count[l]) {
+				count[l]--;
+				count[l + 1] += 2;
+				break;
+			}
+		}
+		total--;
+	}
+
+	// The longest codes go to the least frequent symbols
+	unsigned i = 0;
+	for (unsigned l = maxlen; l > 0; l--) {
+		for (unsigned c = count[l]; c--;) lens[syms[i++]] = l;
+	}
+}
+
+// Assign canonical codes, bit-reversed for writing least significant first
+static void _vdef_huff_codes(uint16_t *codes, const uint8_t *lens, unsigned n) {
+	uint16_t count[_vdef_MAX_BITS + 1] = {0}, next[_vdef_MAX_BITS + 1];
+	for (unsigned i = 0; i < n; i++) count[lens[i]]++;
+	count[0] = 0;
+
+	unsigned code = 0;
+	for (unsigned l = 1; l <= _vdef_MAX_BITS; l++) {
+		code = (code + count[l - 1]) << 1;
+		next[l] = code;
+	}
+
+	for (unsigned i = 0; i < n; i++) {
+		if (!lens[i]) continue;
+		unsigned c = next[lens[i]]++, r = 0;
+		for (unsigned l = lens[i]; l--; c >>= 1) r = r << 1 | (c & 1);
+		codes[i] = r;
+	}
+}
+
+// Run-length encode code lengths with the code length alphabet. Each output
+// entry is a symbol, with its repeat count (if any) in the bits above the
+// low 5
+static unsigned _vdef_rle_lens(uint16_t *out, uint32_t *freq, const uint8_t *lens, unsigned n) {
+	unsigned m = 0;
+	for (unsigned i = 0; i < n;) {
+		unsigned l = lens[i], run = 1;
+		while (i + run < n && lens[i + run] == l) run++;
+		i += run;
+
+		if (l == 0) {
+			for (; run >= 11; ) {
+				unsigned r = run < 138 ? run : 138;
+				out[m++] = 18 | (r - 11) << 5;
+				freq[18]++;
+				run -= r;
+			}
+			if (run >= 3) {
+				out[m++] = 17 | (run - 3) << 5;
+				freq[17]++;
+				run = 0;
+			}
+		} else {
+			out[m++] = l;
+			freq[l]++;
+			run--;
+			for (; run >= 3; ) {
+				unsigned r = run < 6 ? run : 6;
+				out[m++] = 16 | (r - 3) << 5;
+				freq[16]++;
+				run -= r;
+			}
+		}
+
+		while (run--) {
+			out[m++] = l;
+			freq[l]++;
+		}
+	}
+	return m;
+}
+// }}}
+
+// Blocks {{{
+static const uint8_t _vdef_cl_order[_vdef_NCL] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+static const uint8_t _vdef_cl_extra[_vdef_NCL] = {[16] = 2, [17] = 3, [18] = 7};
+
+// Specified in RFC 1951, section 3.2.6
+static void _vdef_fixed_lens(uint8_t *lit, uint8_t *dist) {
+	unsigned i = 0;
+	for (; i < 144; i++) lit[i] = 8;
+	for (; i < 256; i++) lit[i] = 9;
+	for (; i < 280; i++) lit[i] = 7;
+	for (; i < _vdef_FIXED_NLIT; i++) lit[i] = 8;
+	for (i = 0; i < _vdef_NDIST; i++) dist[i] = 5;
+}
+
+// Size in bits of the block's symbols with the given code lengths
+static uint64_t _vdef_block_bits(const struct vdef_stream *s, const uint8_t *lit, const uint8_t *dist) {
+	uint64_t bits = 0;
+	for (unsigned i = 0; i < _vdef_NLIT; i++) {
+		unsigned extra = i > 256 ? _vdef_len_extra(i - 257) : 0;
+		bits += (uint64_t)s->lit_freq[i] * (lit[i] + extra);
+	}
+	for (unsigned i = 0; i < _vdef_NDIST; i++) {
+		bits += (uint64_t)s->dist_freq[i] * (dist[i] + _vdef_dist_extra(i));
+	}
+	return bits;
+}
+
+static void _vdef_write_syms(struct vdef_stream *s, const uint16_t *lcodes, const uint8_t *llens, const uint16_t *dcodes, const uint8_t *dlens) {
+	for (unsigned i = 0; i < s->nsyms; i++) {
+		unsigned lc = s->sym_lc[i], dist = s->sym_dist[i];
+		if (!dist) {
+			_vdef_put(s, lcodes[lc], llens[lc]);
+			continue;
+		}
+
+		unsigned c = _vdef_len_code(lc), extra = _vdef_len_extra(c);
+		_vdef_put(s, lcodes[257 + c], llens[257 + c]);
+		if (extra) _vdef_put(s, lc & ((1u << extra) - 1), extra);
+
+		dist--;
+		c = _vdef_dist_code(dist);
+		extra = _vdef_dist_extra(c);
+		_vdef_put(s, dcodes[c], dlens[c]);
+		if (extra) _vdef_put(s, dist & ((1u << extra) - 1), extra);
+	}
+	_vdef_put(s, lcodes[256], llens[256]);
+}
+
+// Write stored blocks holding len bytes. With len 0, this is the empty block
+// used by a sync flush
+static void _vdef_write_stored(struct vdef_stream *s, const unsigned char *buf, size_t len, _Bool final) {
+	do {
+		size_t n = len < 0xffff ? len : 0xffff;
+		len -= n;
+		_vdef_put(s, final && !len, 3);
+		_vdef_align(s);
+		unsigned char hdr[4] = {n, n >> 8, ~n, ~n >> 8};
+		_vdef_put_bytes(s, hdr, 4);
+		_vdef_put_bytes(s, buf, n);
+		buf += n;
+	} while (len);
+}
+
+// Write the symbols collected since block_start as one block, in whichever of
+// the three block types is smallest
+static void _vdef_write_block(struct vdef_stream *s, _Bool final) {
+	unsigned end = s->strstart - s->match_available;
+	const unsigned char *raw = s->window + s->block_start;
+	size_t raw_len = end - s->block_start;
+	s->block_start = end;
+
+	// Each stored block takes at most 3 header bits, 7 bits of padding and
+	// 32 bits of LEN and NLEN
+	uint64_t stored_bits = 8 * (uint64_t)raw_len + (raw_len / 0xffff + 1) * 42;
+	if (s->level == VDEF_LEVEL_STORE) {
+		_vdef_write_stored(s, raw, raw_len, final);
+		goto reset;
+	}
+
+	s->lit_freq[256] = 1;
+	uint8_t llens[_vdef_NLIT], dlens[_vdef_NDIST];
+	_vdef_huff_lengths(llens, s->lit_freq, _vdef_NLIT, _vdef_MAX_BITS);
+	_vdef_huff_lengths(dlens, s->dist_freq, _vdef_NDIST, _vdef_MAX_BITS);
+
+	unsigned hlit = _vdef_NLIT, hdist = _vdef_NDIST;
+	while (hlit > 257 && !llens[hlit - 1]) hlit--;
+	while (hdist > 1 && !dlens[hdist - 1]) hdist--;
+
+	// The literal/length and distance code lengths are encoded as a single sequence
+	uint8_t lens[_vdef_NLIT + _vdef_NDIST];
+	memcpy(lens, llens, hlit);
+	memcpy(lens + hlit, dlens, hdist);
+	uint16_t cl_syms[_vdef_NLIT + _vdef_NDIST];
+	uint32_t cl_freq[_vdef_NCL] = {0};
+	unsigned ncl_syms = _vdef_rle_lens(cl_syms, cl_freq, lens, hlit + hdist);
+
+	uint8_t cl_lens[_vdef_NCL];
+	_vdef_huff_lengths(cl_lens, cl_freq, _vdef_NCL, _vdef_MAX_CL_BITS);
+	unsigned hclen = _vdef_NCL;
+	while (hclen > 4 && !cl_lens[_vdef_cl_order[hclen - 1]]) hclen--;
+
+	uint64_t dyn_bits = 3 + 5 + 5 + 4 + 3 * hclen + _vdef_block_bits(s, llens, dlens);
+	for (unsigned i = 0; i < _vdef_NCL; i++) {
+		dyn_bits += (uint64_t)cl_freq[i] * (cl_lens[i] + _vdef_cl_extra[i]);
+	}
+
+	uint8_t flens[_vdef_FIXED_NLIT], fdlens[_vdef_NDIST];
+	_vdef_fixed_lens(flens, fdlens);
+	uint64_t fixed_bits = 3 + _vdef_block_bits(s, flens, fdlens);
+	if (s->strategy == VDEF_STRATEGY_FIXED) dyn_bits = UINT64_MAX;
+
+	uint16_t lcodes[_vdef_FIXED_NLIT], dcodes[_vdef_NDIST];
+	if (stored_bits <= fixed_bits && stored_bits <= dyn_bits) {
+		_vdef_write_stored(s, raw, raw_len, final);
+	} else if (fixed_bits <= dyn_bits) {
+		_vdef_put(s, final | 1 << 1, 3);
+		_vdef_huff_codes(lcodes, flens, _vdef_FIXED_NLIT);
+		_vdef_huff_codes(dcodes, fdlens, _vdef_NDIST);
+		_vdef_write_syms(s, lcodes, flens, dcodes, fdlens);
+	} else {
+		_vdef_put(s, final | 2 << 1, 3);
+		_vdef_put(s, hlit - 257, 5);
+		_vdef_put(s, hdist - 1, 5);
+		_vdef_put(s, hclen - 4, 4);
+		for (unsigned i = 0; i < hclen; i++) _vdef_put(s, cl_lens[_vdef_cl_order[i]], 3);
+
+		uint16_t cl_codes[_vdef_NCL];
+		_vdef_huff_codes(cl_codes, cl_lens, _vdef_NCL);
+		for (unsigned i = 0; i < ncl_syms; i++) {
+			unsigned sym = cl_syms[i] & 31;
+			_vdef_put(s, cl_codes[sym], cl_lens[sym]);
+			if (_vdef_cl_extra[sym]) _vdef_put(s, cl_syms[i] >> 5, _vdef_cl_extra[sym]);
+		}
+
+		_vdef_huff_codes(lcodes, llens, _vdef_NLIT);
+		_vdef_huff_codes(dcodes, dlens, _vdef_NDIST);
+		_vdef_write_syms(s, lcodes, llens, dcodes, dlens);
+	}
+
+reset:
+	s->nsyms = 0;
+	memset(s->lit_freq, 0, sizeof s->lit_freq);
+	memset(s->dist_freq, 0, sizeof s->dist_freq);
+}
+// }}}
+
+// Streaming {{{
+void vdef_stream_init(struct vdef_stream *s, int format, int level) {
+	// The window, symbol buffer and pending output need no clearing
+	memset(s, 0, offsetof(struct vdef_stream, pending));
+	if (level < 0) level = VDEF_LEVEL_DEFAULT;
+	if (level > VDEF_LEVEL_BEST) level = VDEF_LEVEL_BEST;
+	s->format = format;
+	s->level = level;
+	s->match_length = s->prev_length = _vdef_MIN_MATCH - 1;
+
+	if (format == VINF_STREAM_GZIP) {
+		// No mtime, and an unknown OS. XFL records the extreme levels
+		unsigned char xfl = level == VDEF_LEVEL_BEST ? 2 : level == VDEF_LEVEL_FASTEST ? 4 : 0;
+		unsigned char hdr[10] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, xfl, 255};
+		_vdef_put_bytes(s, hdr, sizeof hdr);
+	} else if (format == VINF_STREAM_ZLIB) {
+		s->check = 1;
+		// Deflate with a 32K window. FLEVEL is a hint of the level used
+		unsigned cmf = 0x78, flevel = level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3;
+		unsigned flg = flevel << 6;
+		flg += 31 - (cmf << 8 | flg) % 31;
+		unsigned char hdr[2] = {cmf, flg};
+		_vdef_put_bytes(s, hdr, sizeof hdr);
+	}
+}
+
+// Move the upper half of the window down, to make room for more input
+static void _vdef_slide(struct vdef_stream *s) {
+	memcpy(s->window, s->window + VINF_WSIZE, VINF_WSIZE);
+	s->strstart -= VINF_WSIZE;
+	s->block_start -= VINF_WSIZE;
+	// These may wrap, but are only used relative to strstart
+	s->match_start -= VINF_WSIZE;
+	s->prev_match -= VINF_WSIZE;
+
+	for (size_t i = 0; i < sizeof s->head / sizeof *s->head; i++) {
+		s->head[i] = s->head[i] >= VINF_WSIZE ? s->head[i] - VINF_WSIZE : 0;
+	}
+	for (size_t i = 0; i < VINF_WSIZE; i++) {
+		s->prev[i] = s->prev[i] >= VINF_WSIZE ? s->prev[i] - VINF_WSIZE : 0;
+	}
+}
+
+// Copy as much input into the window as fits
+static void _vdef_fill(struct vdef_stream *s) {
+	size_t n = 2 * VINF_WSIZE - s->strstart - s->lookahead;
+	if (n > s->inp_len) n = s->inp_len;
+	if (!n) return;
+
+	unsigned char *p = s->window + s->strstart + s->lookahead;
+	memcpy(p, s->inp, n);
+	if (s->format == VINF_STREAM_ZLIB) s->check = vinf_adler32(s->check, p, n);
+	else s->check = vinf_crc32_buf(s->check, p, n);
+
+	s->inp += n;
+	s->inp_len -= n;
+	s->lookahead += n;
+	s->total_in += n;
+	s->synced = 0;
+}
+
+void vdeflate_stream(struct vdef_stream *s, int flush) {
+	for (;;) {
+		_vdef_drain(s);
+		if (s->pend_start != s->pend_end) return;
+		if (s->finished) {
+			s->done = 1;
+			return;
+		}
+
+		if (s->nsyms == _vdef_SYMS) {
+			_vdef_write_block(s, 0);
+			continue;
+		}
+
+		// Blocks never span a slide, so stored blocks can always be written
+		// from the window
+		if (s->strstart >= 2 * VINF_WSIZE - _vdef_MIN_LOOKAHEAD) {
+			if (s->strstart - s->match_available != s->block_start) {
+				_vdef_write_block(s, 0);
+				continue;
+			}
+			_vdef_slide(s);
+		}
+
+		_vdef_fill(s);
+		_Bool flushing = flush != VDEF_NO_FLUSH && !s->inp_len;
+		unsigned stop = flushing ? 0 : _vdef_MIN_LOOKAHEAD - 1;
+		if (s->lookahead > stop || (flushing && s->match_available)) {
+			_vdef_compress(s, stop);
+			continue;
+		}
+		if (!flushing) return;
+
+		// All input has been compressed
+		if (flush == VDEF_FINISH) {
+			_vdef_write_block(s, 1);
+			_vdef_align(s);
+			if (s->format == VINF_STREAM_GZIP) {
+				_vdef_put_le32(s, s->check);
+				_vdef_put_le32(s, s->total_in);
+			} else if (s->format == VINF_STREAM_ZLIB) {
+				_vdef_put_be32(s, s->check);
+			}
+			s->finished = 1;
+		} else if (!s->synced) {
+			if (s->strstart != s->block_start) _vdef_write_block(s, 0);
+			_vdef_write_stored(s, NULL, 0, 0);
+			s->synced = 1;
+		} else {
+			return;
+		}
+	}
+}
+// }}}
+
+enum vinf_error vdeflate(const unsigned char *inp, size_t inp_len, unsigned char *out, size_t *out_len,
+	int format, int level) {
+	struct vdef_stream *s = malloc(sizeof *s);
+	if (!s) return VENF_ERR_NOMEM;
+	vdef_stream_init(s, format, level);
+	s->inp = inp;
+	s->inp_len = inp_len;
+	s->out = out;
+	s->out_len = *out_len;
+
+	vdeflate_stream(s, VDEF_FINISH);
+	*out_len = s->total_out;
+	enum vinf_error err = s->done ? VENF_ERR_SUCCESS : VENF_ERR_OVERFLOW;
+	free(s);
+	return err;
+}
+
+size_t vdeflate_bound(size_t len) {
+	// Every block is stored if nothing smaller is possible. Blocks hold at
+	// least 16K bytes unless ended by a slide, which happens every 32K, and
+	// each costs at most 11 bytes of overhead. The 64 covers the partial
+	// blocks at the end and the container
+	return len + (len >> 9) + 64;
+}
+
+#endif
@@ -3,6 +3,7 @@
  * OpenGL helper library. Requires GLFW3, GLAD, OpenGL 3.3 or greater and C11 or greater
  * GLAD must be included before this file
  * Define VGL_IMPL in exactly one translation unit
+ * The implementation requires vinflate.h, for PNG loading
  */
 
 /*
@@ -276,12 +277,26 @@ GLuint vgl_shader_file(const char *vert_fn, const char *frag_fn);
 // }}}
 
 // Image loading {{{
+// Images are RGBA, with rows stored top to bottom. type is the GL type of
+// each component, and says which of data and data8 is valid. On failure,
+// data is NULL
 struct vgl_image {
 	unsigned width, height;
-	GLushort *data;
+	GLenum type; // GL_UNSIGNED_SHORT or GL_UNSIGNED_BYTE
+	union {
+		GLushort *data;
+		GLubyte *data8;
+	};
 };
 struct vgl_image vgl_load_farbfeld_data(const unsigned char *data, size_t len);
 struct vgl_image vgl_load_farbfeld(const char *fn);
+
+// PNG images of any color type and bit depth, optionally interlaced, are
+// converted to RGBA with components of the given type, which is
+// GL_UNSIGNED_BYTE or GL_UNSIGNED_SHORT. Loading doesn't touch the GL
+// context, so it can be done on any thread
+struct vgl_image vgl_load_png_data(const unsigned char *data, size_t len, GLenum type);
+struct vgl_image vgl_load_png(const char *fn, GLenum type);
 // }}}
 
 // Model loading {{{
@@ -349,6 +364,12 @@ struct vgl_mesh *vgl_load_vmesh(const char *fn);
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include "vinflate.h"
+
+#if defined(__SSE2__) && defined(__x86_64__) && defined(__GNUC__)
+#define _VGL_SSE2
+#include <emmintrin.h>
+#endif
 
 const char *vgl_strerror(void) {
 	switch (glGetError()) {
@@ -569,6 +590,7 @@ struct vgl_image vgl_load_farbfeld_data(const unsigned char *bytes, size_t len)
 	if (len < computed_len) return img;
 	len = computed_len;
 
+	img.type = GL_UNSIGNED_SHORT;
 	img.data = calloc(len, sizeof *img.data);
 	if (!img.data) return img;
 	for (int j = 0; i+1 < len; j++) {
@@ -585,6 +607,385 @@ struct vgl_image vgl_load_farbfeld(const char *fn) {
 	vgl_unmap(f);
 	return img;
 }
+
+// PNG {{{
+enum {
+	_vgl_PNG_GRAY = 0,
+	_vgl_PNG_RGB = 2,
+	_vgl_PNG_PALETTE = 3,
+	_vgl_PNG_GRAY_ALPHA = 4,
+	_vgl_PNG_RGBA = 6,
+};
+
+struct _vgl_png {
+	uint32_t width, height;
+	uint8_t depth, color, interlace;
+	unsigned channels; // Samples per pixel
+	GLushort palette[256][4]; // RGBA, scaled to 16 bits
+	_Bool has_key; // tRNS gives a gray or RGB value that is transparent
+	uint16_t key[3];
+};
+
+static inline uint32_t _vgl_be32(const unsigned char *p) {
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static inline unsigned char _vgl_paeth(unsigned char a, unsigned char b, unsigned char c) {
+	int pa = abs(b - c), pb = abs(a - c), pc = abs(a + b - 2*c);
+	if (pa <= pb && pa <= pc) return a;
+	if (pb <= pc) return b;
+	return c;
+}
+
+#ifdef _VGL_SSE2
+// Sub, Avg and Paeth depend on the pixel to the left, so each pixel is
+// handled in turn, with all its bytes in one vector. bpp is a constant after
+// inlining, which keeps the loads and stores to single moves
+static inline __m128i _vgl_load_px(const unsigned char *p, unsigned bpp) {
+	uint64_t v = 0;
+	memcpy(&v, p, bpp);
+	return _mm_cvtsi64_si128(v);
+}
+
+static inline void _vgl_store_px(unsigned char *p, __m128i x, unsigned bpp) {
+	uint64_t v = _mm_cvtsi128_si64(x);
+	memcpy(p, &v, bpp);
+}
+
+static inline void _vgl_unfilter_px(unsigned char *row, const unsigned char *prev, size_t len, unsigned bpp, unsigned filter) {
+	const __m128i zero = _mm_setzero_si128();
+	__m128i a = zero, c = zero;
+	switch (filter) {
+	case 1:
+		for (size_t i = 0; i < len; i += bpp) {
+			a = _mm_add_epi8(a, _vgl_load_px(row + i, bpp));
+			_vgl_store_px(row + i, a, bpp);
+		}
+		break;
+
+	case 3: {
+		// _mm_avg_epu8 rounds up, so take off the low bit it adds
+		const __m128i one = _mm_set1_epi8(1);
+		for (size_t i = 0; i < len; i += bpp) {
+			__m128i b = _vgl_load_px(prev + i, bpp);
+			__m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+			a = _mm_add_epi8(_vgl_load_px(row + i, bpp), avg);
+			_vgl_store_px(row + i, a, bpp);
+		}
+		break;
+	}
+
+	case 4:
+		// Widened to 16 bits, where pa = |b - c|, pb = |a - c| and pc = |a + b - 2c|
+		for (size_t i = 0; i < len; i += bpp) {
+			__m128i b = _mm_unpacklo_epi8(_vgl_load_px(prev + i, bpp), zero);
+			__m128i bc = _mm_sub_epi16(b, c), ac = _mm_sub_epi16(a, c), abc = _mm_add_epi16(bc, ac);
+			__m128i pa = _mm_max_epi16(bc, _mm_sub_epi16(zero, bc));
+			__m128i pb = _mm_max_epi16(ac, _mm_sub_epi16(zero, ac));
+			__m128i pc = _mm_max_epi16(abc, _mm_sub_epi16(zero, abc));
+
+			__m128i m = _mm_min_epi16(pa, _mm_min_epi16(pb, pc));
+			__m128i ma = _mm_cmpeq_epi16(pa, m), mb = _mm_cmpeq_epi16(pb, m);
+			__m128i pred = _mm_or_si128(_mm_and_si128(mb, b), _mm_andnot_si128(mb, c));
+			pred = _mm_or_si128(_mm_and_si128(ma, a), _mm_andnot_si128(ma, pred));
+
+			__m128i x = _mm_unpacklo_epi8(_vgl_load_px(row + i, bpp), zero);
+			a = _mm_and_si128(_mm_add_epi16(x, pred), _mm_set1_epi16(0xff));
+			c = b;
+			_vgl_store_px(row + i, _mm_packus_epi16(a, a), bpp);
+		}
+		break;
+	}
+}
+#endif
+
+// Undo the filter on a row of len bytes. bpp is the number of bytes per pixel,
+// rounded up to 1, and prev is the previous row of the pass, already
+// unfiltered, or zeros for the first row
+static _Bool _vgl_png_unfilter(unsigned char *row, const unsigned char *prev, size_t len, unsigned bpp, unsigned filter) {
+	switch (filter) {
+	case 0:
+		return 1;
+
+	case 2: {
+		size_t i = 0;
+#ifdef _VGL_SSE2
+		for (; i + 16 <= len; i += 16) {
+			__m128i x = _mm_loadu_si128((const __m128i *)(row + i));
+			__m128i b = _mm_loadu_si128((const __m128i *)(prev + i));
+			_mm_storeu_si128((__m128i *)(row + i), _mm_add_epi8(x, b));
+		}
+#endif
+		for (; i < len; i++) row[i] += prev[i];
+		return 1;
+	}
+
+	case 1: case 3: case 4:
+		break;
+
+	default:
+		return 0;
+	}
+
+#ifdef _VGL_SSE2
+	switch (bpp) {
+	case 3: _vgl_unfilter_px(row, prev, len, 3, filter); return 1;
+	case 4: _vgl_unfilter_px(row, prev, len, 4, filter); return 1;
+	case 6: _vgl_unfilter_px(row, prev, len, 6, filter); return 1;
+	case 8: _vgl_unfilter_px(row, prev, len, 8, filter); return 1;
+	}
+#endif
+
+	// The first pixel has nothing to its left, which makes Paeth pick the byte above
+	size_t n = bpp < len ? bpp : len;
+	switch (filter) {
+	case 1:
+		for (size_t i = bpp; i < len; i++) row[i] += row[i - bpp];
+		break;
+	case 3:
+		for (size_t i = 0; i < n; i++) row[i] += prev[i] >> 1;
+		for (size_t i = bpp; i < len; i++) row[i] += (row[i - bpp] + prev[i]) >> 1;
+		break;
+	case 4:
+		for (size_t i = 0; i < n; i++) row[i] += prev[i];
+		for (size_t i = bpp; i < len; i++) row[i] += _vgl_paeth(row[i - bpp], prev[i], prev[i - bpp]);
+		break;
+	}
+	return 1;
+}
+
+// Read sample k of a row. Samples smaller than a byte are packed from the most
+// significant bit
+static inline unsigned _vgl_png_sample(const unsigned char *row, size_t k, unsigned depth) {
+	switch (depth) {
+	case 16: return row[2*k] << 8 | row[2*k + 1];
+	case 8: return row[k];
+	default: return row[k * depth >> 3] >> (8 - depth - (k * depth & 7)) & ((1u << depth) - 1);
+	}
+}
+
+// Convert an unfiltered row of n pixels to RGBA, scaled to 16 bits
+static void _vgl_png_convert(const struct _vgl_png *png, const unsigned char *row, size_t n, GLushort (*px)[4]) {
+	unsigned depth = png->depth, scale = 65535 / ((1u << depth) - 1);
+	for (size_t x = 0; x < n; x++) {
+		GLushort *p = px[x];
+		switch (png->color) {
+		case _vgl_PNG_GRAY: {
+			unsigned v = _vgl_png_sample(row, x, depth);
+			p[0] = p[1] = p[2] = v * scale;
+			p[3] = png->has_key && v == png->key[0] ? 0 : 65535;
+			break;
+		}
+
+		case _vgl_PNG_RGB: {
+			unsigned r = _vgl_png_sample(row, 3*x, depth);
+			unsigned g = _vgl_png_sample(row, 3*x + 1, depth);
+			unsigned b = _vgl_png_sample(row, 3*x + 2, depth);
+			p[0] = r * scale;
+			p[1] = g * scale;
+			p[2] = b * scale;
+			p[3] = png->has_key && r == png->key[0] && g == png->key[1] && b == png->key[2] ? 0 : 65535;
+			break;
+		}
+
+		case _vgl_PNG_PALETTE:
+			memcpy(p, png->palette[_vgl_png_sample(row, x, depth)], sizeof png->palette[0]);
+			break;
+
+		case _vgl_PNG_GRAY_ALPHA:
+			p[0] = p[1] = p[2] = _vgl_png_sample(row, 2*x, depth) * scale;
+			p[3] = _vgl_png_sample(row, 2*x + 1, depth) * scale;
+			break;
+
+		case _vgl_PNG_RGBA:
+			for (int c = 0; c < 4; c++) p[c] = _vgl_png_sample(row, 4*x + c, depth) * scale;
+			break;
+		}
+	}
+}
+
+// Parse and check IHDR, returning the number of bits per pixel, or 0 if it is invalid
+static unsigned _vgl_png_header(struct _vgl_png *png, const unsigned char *body) {
+	png->width = _vgl_be32(body);
+	png->height = _vgl_be32(body + 4);
+	png->depth = body[8];
+	png->color = body[9];
+	png->interlace = body[12];
+	if (!png->width || !png->height || png->width > 0x7fffffff || png->height > 0x7fffffff) return 0;
+	if (body[10] || body[11] || png->interlace > 1) return 0;
+
+	// Bit depths allowed for each color type, as a mask of 1 << depth
+	unsigned depths;
+	switch (png->color) {
+	case _vgl_PNG_GRAY: png->channels = 1; depths = 1<<1 | 1<<2 | 1<<4 | 1<<8 | 1<<16; break;
+	case _vgl_PNG_RGB: png->channels = 3; depths = 1<<8 | 1<<16; break;
+	case _vgl_PNG_PALETTE: png->channels = 1; depths = 1<<1 | 1<<2 | 1<<4 | 1<<8; break;
+	case _vgl_PNG_GRAY_ALPHA: png->channels = 2; depths = 1<<8 | 1<<16; break;
+	case _vgl_PNG_RGBA: png->channels = 4; depths = 1<<8 | 1<<16; break;
+	default: return 0;
+	}
+	if (png->depth > 16 || !(depths & 1u << png->depth)) return 0;
+
+	// Palette entries that aren't given are opaque black
+	for (int i = 0; i < 256; i++) {
+		png->palette[i][0] = png->palette[i][1] = png->palette[i][2] = 0;
+		png->palette[i][3] = 65535;
+	}
+	return png->channels * png->depth;
+}
+
+// Adam7 passes, as x offset, y offset, x step and y step. Images that aren't
+// interlaced are a single pass
+static const unsigned char _vgl_png_passes[2][7][4] = {
+	{{0, 0, 1, 1}},
+	{{0, 0, 8, 8}, {4, 0, 8, 8}, {0, 4, 4, 8}, {2, 0, 4, 4}, {0, 2, 2, 4}, {1, 0, 2, 2}, {0, 1, 1, 2}},
+};
+
+struct vgl_image vgl_load_png_data(const unsigned char *data, size_t len, GLenum type) {
+	struct vgl_image img = {0};
+	if (type != GL_UNSIGNED_BYTE && type != GL_UNSIGNED_SHORT) return img;
+	if (len < 8 || memcmp(data, "\x89PNG\r\n\x1a\n", 8)) return img;
+
+	struct _vgl_png png = {0};
+	struct vinf_stream *s = NULL;
+	unsigned char *raw = NULL, *zero = NULL;
+	GLushort (*px)[4] = NULL;
+	size_t raw_len = 0, bits = 0;
+	_Bool ok = 0;
+
+	// Chunks are length, type, data and a CRC of the type and data. IDAT
+	// chunks together make up one zlib stream, which is decompressed as each
+	// one is reached
+	size_t i = 8;
+	while (len - i >= 12) {
+		uint32_t n = _vgl_be32(data + i);
+		const unsigned char *ctype = data + i + 4, *body = data + i + 8;
+		if (n > len - i - 12) goto end;
+		if (vinf_crc32_buf(0, ctype, n + 4) != _vgl_be32(body + n)) goto end;
+		i += n + 12;
+
+		if (!memcmp(ctype, "IHDR", 4)) {
+			if (n != 13 || s) goto end;
+			bits = _vgl_png_header(&png, body);
+			if (!bits) goto end;
+
+			// Limit the size so the filtered data's length can't overflow
+			if ((uint64_t)png.width * png.height > SIZE_MAX >> 4) goto end;
+
+			uint64_t total = 0;
+			const unsigned char (*passes)[4] = _vgl_png_passes[png.interlace];
+			for (int p = 0; p < (png.interlace ? 7 : 1); p++) {
+				uint64_t pw = png.width > passes[p][0] ? (png.width - passes[p][0] + passes[p][2] - 1) / passes[p][2] : 0;
+				uint64_t ph = png.height > passes[p][1] ? (png.height - passes[p][1] + passes[p][3] - 1) / passes[p][3] : 0;
+				if (pw) total += ph * (1 + (pw * bits + 7) / 8);
+			}
+			if (total > SIZE_MAX) goto end;
+			raw_len = total;
+
+			s = malloc(sizeof *s);
+			raw = malloc(raw_len);
+			if (!s || !raw) goto end;
+			vinf_stream_init(s, VINF_STREAM_ZLIB);
+			s->out = raw;
+			s->out_len = raw_len;
+		} else if (!s) {
+			// IHDR must come first
+			goto end;
+		} else if (!memcmp(ctype, "PLTE", 4)) {
+			if (n % 3 || n > 3*256) goto end;
+			for (uint32_t j = 0; j < n / 3; j++) {
+				for (int c = 0; c < 3; c++) png.palette[j][c] = body[3*j + c] * 257;
+			}
+		} else if (!memcmp(ctype, "tRNS", 4)) {
+			if (png.color == _vgl_PNG_PALETTE) {
+				if (n > 256) goto end;
+				for (uint32_t j = 0; j < n; j++) png.palette[j][3] = body[j] * 257;
+			} else if (png.color == _vgl_PNG_GRAY || png.color == _vgl_PNG_RGB) {
+				if (n != 2 * png.channels) goto end;
+				for (unsigned c = 0; c < png.channels; c++) png.key[c] = body[2*c] << 8 | body[2*c + 1];
+				png.has_key = 1;
+			}
+		} else if (!memcmp(ctype, "IDAT", 4)) {
+			// Any data after the end of the zlib stream is ignored
+			if (s->done) continue;
+			s->inp = body;
+			s->inp_len = n;
+			if (vinflate_stream(s)) goto end;
+		} else if (!memcmp(ctype, "IEND", 4)) {
+			ok = 1;
+			break;
+		} else if (!(ctype[0] & 0x20)) {
+			// Unknown critical chunk
+			goto end;
+		}
+	}
+	if (!ok || !s->done || s->total_out != raw_len) goto end;
+	ok = 0;
+
+	size_t npx = (size_t)png.width * png.height;
+	img.width = png.width;
+	img.height = png.height;
+	img.type = type;
+	img.data8 = malloc(npx * 4 * (type == GL_UNSIGNED_SHORT ? 2 : 1));
+	zero = calloc(1, ((size_t)png.width * bits + 7) / 8);
+	px = malloc(png.width * sizeof *px);
+	if (!img.data8 || !zero || !px) goto end;
+
+	// Unfilter each pass in place, and spread its pixels over the image
+	unsigned bpp = (bits + 7) / 8;
+	unsigned char *p = raw;
+	const unsigned char (*passes)[4] = _vgl_png_passes[png.interlace];
+	for (int pass = 0; pass < (png.interlace ? 7 : 1); pass++) {
+		unsigned x0 = passes[pass][0], y0 = passes[pass][1], dx = passes[pass][2], dy = passes[pass][3];
+		if (png.width <= x0 || png.height <= y0) continue;
+		size_t pw = (png.width - x0 + dx - 1) / dx;
+		size_t stride = (pw * bits + 7) / 8;
+
+		const unsigned char *prev = zero;
+		for (size_t y = y0; y < png.height; y += dy) {
+			unsigned char *row = p + 1;
+			if (!_vgl_png_unfilter(row, prev, stride, bpp, p[0])) goto end;
+			prev = row;
+			p += 1 + stride;
+
+			size_t off = y * png.width + x0;
+			if (type == GL_UNSIGNED_BYTE && png.color == _vgl_PNG_RGBA && png.depth == 8 && dx == 1) {
+				memcpy(img.data8 + 4*off, row, 4*pw);
+				continue;
+			}
+
+			_vgl_png_convert(&png, row, pw, px);
+			if (type == GL_UNSIGNED_SHORT) {
+				for (size_t x = 0; x < pw; x++) memcpy(img.data + 4*(off + x*dx), px[x], sizeof px[x]);
+			} else {
+				for (size_t x = 0; x < pw; x++) {
+					// Round to the nearest 8-bit value
+					for (int c = 0; c < 4; c++) img.data8[4*(off + x*dx) + c] = (px[x][c] * 255u + 32895) >> 16;
+				}
+			}
+		}
+	}
+	ok = 1;
+
+end:
+	if (!ok) {
+		free(img.data8);
+		img = (struct vgl_image){0};
+	}
+	free(px);
+	free(zero);
+	free(raw);
+	free(s);
+	return img;
+}
+
+struct vgl_image vgl_load_png(const char *fn, GLenum type) {
+	struct vgl_mbuf f = vgl_mapfile(fn);
+	struct vgl_image img = vgl_load_png_data(f.udata, f.len, type);
+	vgl_unmap(f);
+	return img;
+}
+// }}}
 // }}}
 
 // Model loading {{{
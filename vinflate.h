@@ -4,9 +4,10 @@
  * Define VENFLATE_IMPL in one translation unit
  *
  * Limitations:
- * - The output buffer must be statically sized. Because of how gzip files
- *   store uncompressed length, this means gzip files storing more than 4GiB
- *   of uncompressed data are not currently supported
+ * - vinflate requires the output buffer to be statically sized. Because of
+ *   how gzip files store uncompressed length, this means it cannot be used for
+ *   gzip files storing more than 4GiB of uncompressed data. Use the streaming
+ *   interface (vinflate_stream) for those
  */
 
 /*
@@ -68,6 +69,16 @@ enum {
 	VENF_GZ_COMMENT = 1<<4,
 };
 
+// zlib (RFC 1950) header
+struct vinf_zlib {
+	uint8_t cmf, flg;
+	uint32_t dictid; // Adler-32 of the preset dictionary, if VENF_ZL_FDICT is set
+};
+
+enum {
+	VENF_ZL_FDICT = 1<<5,
+};
+
 enum vinf_error {
 	VENF_ERR_SUCCESS, // No error
 	VENF_ERR_EOF,
@@ -79,6 +90,10 @@ enum vinf_error {
 	VENF_ERR_CODE_INVALID,
 	VENF_ERR_DIST_INVALID,
 	VENF_ERR_TYPE_INVALID,
+	VENF_ERR_NOMEM,
+	VENF_ERR_NEED_DICT,
+	VENF_ERR_DICT_MISMATCH,
+	VENF_ERR_WRITE,
 
 	VENF_NERR,
 };
@@ -87,19 +102,325 @@ extern const char *vinf_error_string[VENF_NERR];
 
 enum vinf_error vinflate(struct vinf_data data);
 enum vinf_error vinf_read_gzip(const unsigned char *data, size_t data_len, struct vinf_gzip *hdr);
+// Decompress a zlib stream into out, setting out_len to the decompressed size.
+// If the stream needs a preset dictionary, it must be passed as dict, or
+// VENF_ERR_NEED_DICT is returned
+enum vinf_error vinflate_zlib(const unsigned char *inp, size_t inp_len, unsigned char *out, size_t *out_len,
+	const unsigned char *dict, size_t dict_len);
 
 // Internal stuff that might be useful externally {{{
+// Bits are read least significant first, through a 64-bit accumulator which
+// is refilled a word at a time. Bits past the end of the input read as zero
 struct vinf_bitreader {
-	const unsigned char *data; // Stores a pointer to the end of the data buffer
-	size_t bit; // Stores a negative bit index into the data buffer
+	const unsigned char *p; // Next byte to be loaded into the accumulator
+	const unsigned char *end; // End of the data buffer
+	uint64_t bits; // Accumulator; the next bit of input is the LSB
+	unsigned nbits; // Number of valid bits in the accumulator
 };
 
+// Maximum number of bits that can be peeked at once
+#define VINF_BR_MAXBITS 56
+
+static inline uint64_t _vinf_load64le(const unsigned char *p) {
+	return (uint64_t)p[0] | (uint64_t)p[1] << 8 | (uint64_t)p[2] << 16 | (uint64_t)p[3] << 24
+		| (uint64_t)p[4] << 32 | (uint64_t)p[5] << 40 | (uint64_t)p[6] << 48 | (uint64_t)p[7] << 56;
+}
+
+// Fill the accumulator with at least VINF_BR_MAXBITS bits, or all remaining input
+static inline void vinf_brrefill(struct vinf_bitreader *br) {
+	if (br->end - br->p >= 8) {
+		// The top byte loaded here is not counted, but will be loaded again
+		// with identical contents by the next refill
+		br->bits |= _vinf_load64le(br->p) << br->nbits;
+		br->p += (63 - br->nbits) >> 3;
+		br->nbits |= VINF_BR_MAXBITS;
+	} else {
+		while (br->nbits < VINF_BR_MAXBITS && br->p < br->end) {
+			br->bits |= (uint64_t)*br->p++ << br->nbits;
+			br->nbits += 8;
+		}
+	}
+}
+
+// Return the next nbits (at most VINF_BR_MAXBITS) bits without consuming them
+static inline uint64_t vinf_brpeek(struct vinf_bitreader *br, unsigned nbits) {
+	if (br->nbits < nbits) vinf_brrefill(br);
+	return br->bits & (((uint64_t)1 << nbits) - 1);
+}
+
+// Consume nbits bits, which must already be in the accumulator (ie. a peek of
+// at least nbits must come first). Returns 0 if there are not enough bits left
+static inline _Bool vinf_brconsume(struct vinf_bitreader *br, unsigned nbits) {
+	if (br->nbits < nbits) return 0;
+	br->bits >>= nbits;
+	br->nbits -= nbits;
+	return 1;
+}
+
 void vinf_brinit(struct vinf_bitreader *br, const unsigned char *data, size_t len);
 int vinf_readbit(struct vinf_bitreader *br);
 int vinf_readval(struct vinf_bitreader *br, int nbits);
+// Skip to the next byte boundary, then return a pointer to the next nbytes bytes
 const unsigned char *vinf_readbyt(struct vinf_bitreader *br, int nbytes);
 
+// CRC-32 as used by gzip. Pass 0 as crc to start a new checksum
 uint32_t vinf_crc32(uint32_t crc, unsigned char byt);
+uint32_t vinf_crc32_buf(uint32_t crc, const unsigned char *buf, size_t len);
+// Compute the CRC of two concatenated buffers, given the CRC of each and the
+// length of the second
+uint32_t vinf_crc32_combine(uint32_t crc1, uint32_t crc2, uint64_t len2);
+
+// Adler-32 as used by zlib. Pass 1 as adler to start a new checksum
+uint32_t vinf_adler32(uint32_t adler, const unsigned char *buf, size_t len);
+// }}}
+
+// Decoder state {{{
+// Each entry of a decoding table describes the code whose first `len` bits
+// match the entry's index. Literal entries store the decoded byte (or code
+// length symbol) in `val`, length and distance entries store the base value
+// in `val` and the number of extra bits that follow the code in `extra`.
+// Codes longer than the primary table's index width go through a subtable:
+// the primary entry stores the subtable's offset in `val` and its index width
+// in `extra`, and the subtable entries store the remaining code length
+struct _vinf_hent {
+	uint32_t val: 16, len: 5, kind: 3, extra: 5;
+};
+
+enum {
+	_vinf_HE_BAD, // Invalid code
+	_vinf_HE_LIT, // Literal byte or code length symbol
+	_vinf_HE_EOB, // End of block
+	_vinf_HE_BASE, // Length or distance with extra bits
+	_vinf_HE_SUB, // Link to subtable
+};
+
+enum {
+	// Maximum number of symbols in literal/length alphabet
+	_vinf_NLIT = 286,
+	// Maximum number of symbols in distance alphabet
+	_vinf_NDIST = 30,
+	// Number of symbols in fixed literal/length alphabet
+	_vinf_FIXED_NLIT = 288,
+	// Number of symbols in fixed distance alphabet
+	_vinf_FIXED_NDIST = 32,
+	// Number of symbols in huffman-decoding alphabet
+	_vinf_HUFF_NSYM = 19,
+
+	// Index widths of the primary tables
+	_vinf_LIT_BITS = 9,
+	_vinf_DIST_BITS = 6,
+	_vinf_HUFF_BITS = 7,
+
+	// Maximum table sizes, including subtables. These are the values computed
+	// by zlib's examples/enough.c for the above alphabet sizes and index widths
+	_vinf_LIT_ENOUGH = 852,
+	_vinf_DIST_ENOUGH = 592,
+	_vinf_HUFF_ENOUGH = 1 << _vinf_HUFF_BITS,
+};
+
+// Window size. Back-references may reach this far into the output
+#define VINF_WSIZE 32768
+
+struct _vinf_stream {
+	struct vinf_bitreader r;
+	unsigned char *wstart; // Start of output; back-references may not reach past this
+	unsigned char *w; // Next output byte
+	unsigned char *wend; // End of output buffer
+
+	// Where decoding will resume from; one of the _vinf_M_* modes
+	uint8_t mode, final;
+	uint16_t hlit, hdist, hclen;
+	uint16_t n; // Number of code lengths read so far
+	uint32_t len, dist; // Remaining length of the current back-reference or stored block, and its distance
+
+	// Output is checksummed in spans, after each block and whenever the
+	// decoder stops
+	uint32_t check;
+	unsigned char *check_pos; // End of the data covered by check
+	_Bool adler; // Checksum with Adler-32 rather than CRC-32
+
+	_Bool stop_block; // Return after each block, with mode set to _vinf_M_HEADER
+
+	const struct _vinf_hent *lit, *dist_table;
+	struct _vinf_hent hc_tables[_vinf_HUFF_ENOUGH];
+	struct _vinf_hent lit_tables[_vinf_LIT_ENOUGH];
+	struct _vinf_hent dist_tables[_vinf_DIST_ENOUGH];
+	uint8_t lens[_vinf_NLIT + _vinf_NDIST];
+};
+// }}}
+
+// Streaming decompression {{{
+// A streaming decoder can be fed input in arbitrary chunks, and writes output
+// to arbitrary chunks. It keeps only a small fixed-size window internally, so
+// there is no limit on the size of the uncompressed data.
+//
+// Set inp/inp_len and out/out_len, then call vinflate_stream. It will consume
+// input and produce output until it runs out of one or the other, advancing
+// the pointers and decrementing the lengths as it goes. Once the end of the
+// stream is reached, `done` is set and inp points just past the compressed
+// data (and gzip footer); any following input is left unconsumed.
+//
+// If out is NULL, output is discarded rather than copied, and out_len is
+// ignored. The checksum and length are still checked, so this verifies a
+// stream using only the window's memory.
+//
+// If a sink is set, output is instead passed to it straight from the window,
+// with no copy. Each span is as large as the window allows, so output arrives
+// in batches of at least VINF_WSIZE bytes except at the end of each call.
+//
+// A zlib stream that needs a preset dictionary stops with VENF_ERR_NEED_DICT
+// once its header has been read. Pass the dictionary named by zlib.dictid to
+// vinf_stream_set_dict, then continue decoding.
+enum {
+	VINF_STREAM_RAW, // Raw DEFLATE data
+	VINF_STREAM_GZIP, // A gzip member. The header is parsed into `gzip` and the footer checked
+	VINF_STREAM_ZLIB, // A zlib stream. The header is parsed into `zlib` and the Adler-32 checked
+};
+
+// Receives output from a stream. write returns nonzero to stop decoding,
+// which then fails with VENF_ERR_WRITE
+struct vinf_sink {
+	int (*write)(void *ctx, const unsigned char *buf, size_t len);
+	void *ctx;
+};
+
+struct vinf_stream {
+	const unsigned char *inp;
+	size_t inp_len;
+	unsigned char *out;
+	size_t out_len;
+	struct vinf_sink sink; // Used instead of out, if write is set
+
+	int format;
+	_Bool done;
+	uint32_t crc; // CRC of all data decoded so far (gzip and raw streams)
+	uint32_t adler; // Adler-32 of all data decoded so far (zlib streams)
+	uint64_t total_out; // Total number of bytes output so far
+
+	// gzip header. f_name and f_comment are not available, since the header
+	// may be split between input chunks
+	struct vinf_gzip gzip;
+	struct vinf_zlib zlib;
+
+	// Internal state
+	_Bool at_block; // Stopped at the end of a block, because st.stop_block is set
+	uint8_t gz_state;
+	uint16_t gz_n, gz_len;
+	uint32_t gz_crc;
+	uint32_t dict_adler; // Adler-32 of the dictionary given to vinf_stream_set_dict
+	_Bool dict; // A dictionary has been set
+	unsigned char *flushed; // End of data in the window already copied to the caller
+	struct _vinf_stream st;
+	unsigned char window[2 * VINF_WSIZE];
+};
+
+// Prepare a stream for decoding. Format is one of VINF_STREAM_*
+void vinf_stream_init(struct vinf_stream *s, int format);
+// Prime the window with a preset dictionary. Only the last VINF_WSIZE bytes
+// are used. Must be called before any data is decoded
+void vinf_stream_set_dict(struct vinf_stream *s, const unsigned char *dict, size_t len);
+// Decode as much as possible. Returns VENF_ERR_SUCCESS unless the data is corrupt
+enum vinf_error vinflate_stream(struct vinf_stream *s);
+
+// Decompress data in memory to a sink. gzip data may have several members,
+// which are decompressed in turn. On success, total_out is set to the
+// decompressed size, if not NULL
+enum vinf_error vinflate_sink(const unsigned char *inp, size_t inp_len, int format, struct vinf_sink sink, uint64_t *total_out);
+
+#if defined(__unix__) || defined(__APPLE__)
+// A sink that writes to a file descriptor
+struct vinf_sink vinf_fd_sink(int fd);
+#endif
+
+// Check the integrity of compressed data without keeping the output, by
+// decoding into the stream window and checking the checksum and length. gzip
+// data may have several members, all of which are checked. On success,
+// total_out is set to the decompressed size, if not NULL
+enum vinf_error vinf_verify(const unsigned char *inp, size_t inp_len, int format, uint64_t *total_out);
+// }}}
+
+// Random access {{{
+// An index records checkpoints in a DEFLATE or gzip stream, allowing
+// decompression to start part-way through. Checkpoints are placed at block
+// boundaries roughly every `span` bytes of output, and each stores the 32K of
+// output before it, since back-references may reach that far.
+//
+// The index refers to the compressed data by offset, so the same data must be
+// passed to vinf_index_extract. It can be serialized, eg. to keep in a file
+// alongside the compressed data.
+struct vinf_index_point {
+	uint64_t out_off; // Offset in the uncompressed data
+	uint64_t inp_off; // Offset of the first whole byte of the block in the compressed data
+	uint8_t bits; // Number of bits of the block in the byte before inp_off
+	unsigned char window[VINF_WSIZE]; // Uncompressed data before out_off, zero-padded at the start
+};
+
+struct vinf_index {
+	int format; // VINF_STREAM_*
+	uint64_t span;
+	uint64_t total_out;
+	size_t npoints;
+	struct vinf_index_point *points;
+};
+
+// Decompress the data to build an index with checkpoints every span bytes
+enum vinf_error vinf_index_build(struct vinf_index *idx, const unsigned char *data, size_t data_len, int format, uint64_t span);
+void vinf_index_free(struct vinf_index *idx);
+// Read up to len bytes of uncompressed data, starting at off. The number of
+// bytes read is stored in nread, which is less than len only at the end of
+// the data
+enum vinf_error vinf_index_extract(const struct vinf_index *idx, const unsigned char *data, size_t data_len,
+	uint64_t off, unsigned char *buf, size_t len, size_t *nread);
+
+// Serialize an index into buf, returning its serialized length. If buf is
+// NULL, just returns the length
+size_t vinf_index_serialize(const struct vinf_index *idx, unsigned char *buf);
+// The serialized form is checked for consistency. Returns VENF_ERR_ID_MISMATCH
+// for data that is not a serialized index
+enum vinf_error vinf_index_deserialize(struct vinf_index *idx, const unsigned char *buf, size_t len);
+// }}}
+
+// Multi-member gzip {{{
+// A gzip file may consist of several members, such as those written by bgzip
+// or by concatenating gzip files. vinflate_members decompresses all of them.
+//
+// BGZF members record their compressed size in a "BC" extra field, so their
+// boundaries and output offsets can be found without decompressing them;
+// these are decompressed in parallel. Other members have to be decompressed
+// in order to find where they end, so they are decompressed one at a time as
+// the file is scanned. Parallelism requires C11 threads, and is disabled
+// without them.
+struct vinf_members {
+	const unsigned char *inp;
+	size_t inp_len;
+	unsigned char *out;
+	size_t out_len; // Must be at least the total uncompressed size
+
+	unsigned nthreads; // Maximum number of threads to use, including the caller
+
+	// Set on success
+	size_t total_out;
+	uint32_t out_crc; // CRC of all members' data, computed from the per-member CRCs
+	size_t nmembers;
+};
+
+enum vinf_error vinflate_members(struct vinf_members *m);
+// Returns the size of a BGZF member starting at data, or 0 if it is not one
+size_t vinf_bgzf_size(const unsigned char *data, size_t data_len);
+// }}}
+
+// Parallel decompression {{{
+// EXPERIMENTAL: decompress a single DEFLATE stream using several threads. The
+// input is split into chunks, and a thread for each chunk after the first
+// searches for a plausible block boundary near its start and decodes from
+// there. Until the preceding data is known, back-references into it are
+// recorded as references into an unknown window, which are filled in once it
+// is. Chunks whose guessed start turns out to be wrong are decoded again in
+// order, so the result is always the same as vinflate's.
+//
+// This works best on large streams made of dynamic Huffman blocks, as written
+// by gzip and zlib. Without C11 threads, this is the same as vinflate
+enum vinf_error vinflate_parallel(struct vinf_data data, unsigned nthreads);
 // }}}
 
 #endif
@@ -107,45 +428,42 @@ uint32_t vinf_crc32(uint32_t crc, unsigned char byt);
 #ifdef VENFLATE_IMPL
 #undef VENFLATE_IMPL
 
-#if __STDC_VERSION__ >= 201112L
-#define _vinf_thread_local _Thread_local
-#elif defined(__GNUC__)
-#define _vinf_thread_local __thread
-#else
-#error "Unsupported implemention: vinflate requires either C11 _Thread_local or GCC __thread"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define _VINF_X86
+#include <immintrin.h>
 #endif
 
+static inline uint32_t _vinf_bswap32(uint32_t x) {
+	return x >> 24 | (x >> 8 & 0xff00) | (x << 8 & 0xff0000) | x << 24;
+}
+
 void vinf_brinit(struct vinf_bitreader *br, const unsigned char *data, size_t len) {
-	br->data = data + len;
-	br->bit = len * 8;
+	*br = (struct vinf_bitreader){data, data + len, 0, 0};
 }
 
 int vinf_readbit(struct vinf_bitreader *br) {
-	if (br->bit <= 1) return -1;
-	br->bit--;
-
-	size_t ibyt = br->bit / 8 + 1;
-	size_t ibit = 7 - br->bit % 8;
-
-	unsigned char byt = br->data[-ibyt];
-	return byt>>ibit & 1;
+	return vinf_readval(br, 1);
 }
 
 int vinf_readval(struct vinf_bitreader *br, int nbits) {
-	int val = 0;
-	for (int i = 0; i < nbits; i++) {
-		int bit = vinf_readbit(br);
-		if (bit < 0) return -1;
-		val |= bit << i;
-	}
+	int val = vinf_brpeek(br, nbits);
+	if (!vinf_brconsume(br, nbits)) return -1;
 	return val;
 }
 
 const unsigned char *vinf_readbyt(struct vinf_bitreader *br, int nbytes) {
-	br->bit -= br->bit % 8;
-	if (br->bit < 8 * nbytes) return NULL;
-	const unsigned char *ret = br->data - (br->bit / 8);
-	br->bit -= 8 * nbytes;
+	// Drop the partial byte, and give any whole bytes in the accumulator back
+	// to the input. The accumulator always ends with the byte before br->p
+	br->p -= br->nbits / 8;
+	br->bits = 0;
+	br->nbits = 0;
+
+	if (br->end - br->p < nbytes) return NULL;
+	const unsigned char *ret = br->p;
+	br->p += nbytes;
 	return ret;
 }
 
@@ -153,39 +471,80 @@ const char *vinf_error_string[VENF_NERR] = {
 	"Success",
 	"Unexpected end of file",
 	"Uncompressed file too large",
-	"GZIP ID mismatch",
+	"Header ID mismatch",
 	"Checksum mismatch",
 	"Block LEN/NLEN mismatch",
 	"Invalid Huffman tree",
 	"Invalid bit sequence",
 	"Distance out of range",
 	"Invalid block type",
+	"Out of memory",
+	"Preset dictionary required",
+	"Preset dictionary mismatch",
+	"Output write failed",
 };
 
-// b0 and b1 specify indices into the tree array for the 0 and 1 children
-// A leaf node has b0 = b1 = 0 and the symbol value stored in val
-struct _vinf_huff {
-	uint32_t b0: 11, b1: 11, val: 10;
+// Decoding tables {{{
+// Describes how the symbols of an alphabet map to table entries
+struct _vinf_alphabet {
+	uint16_t nlit; // Symbols [0, nlit) are literals
+	uint16_t neob; // The next neob symbols end the block
+	uint16_t nbase; // The next nbase symbols have a base value and extra bits
+	const uint16_t *base;
+	const uint8_t *extra;
 };
-#define _vinf_huffbit(node, bit) ((bit) ? (node).b1 : (node).b0)
-#define _vinf_set_huffbit(node, bit, v) ((bit) ? ((node).b1 = (v)) : ((node).b0 = (v)))
 
-enum {
-	// Number of symbols in literal or distance alphabet
-	_vinf_NSYM = 286,
-	// Number of symbols in fixed alphabet
-	_vinf_FIXED_NSYM = 288,
-	// Number of symbols in huffman-decoding alphabet
-	_vinf_HUFF_NSYM = 19,
+// Specified in RFC 1951, section 3.2.5
+static const uint16_t _vinf_len_base[] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
 };
+static const uint8_t _vinf_len_extra[] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+};
+static const uint16_t _vinf_dist_base[] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577,
+};
+static const uint8_t _vinf_dist_extra[] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+};
+
+static const struct _vinf_alphabet _vinf_lit_alphabet = {256, 1, 29, _vinf_len_base, _vinf_len_extra};
+static const struct _vinf_alphabet _vinf_dist_alphabet = {0, 0, 30, _vinf_dist_base, _vinf_dist_extra};
+static const struct _vinf_alphabet _vinf_huff_alphabet = {_vinf_HUFF_NSYM, 0, 0, NULL, NULL};
+
+static struct _vinf_hent _vinf_symbol_entry(const struct _vinf_alphabet *ab, unsigned sym, unsigned len) {
+	if (sym < ab->nlit) return (struct _vinf_hent){sym, len, _vinf_HE_LIT, 0};
+	sym -= ab->nlit;
+	if (sym < ab->neob) return (struct _vinf_hent){0, len, _vinf_HE_EOB, 0};
+	sym -= ab->neob;
+	if (sym < ab->nbase) return (struct _vinf_hent){ab->base[sym], len, _vinf_HE_BASE, ab->extra[sym]};
+	return (struct _vinf_hent){0, len, _vinf_HE_BAD, 0};
+}
 
-// A full binary tree with n leaf nodes has exactly 2n-1 total nodes
-#define _vinf_NNODE(nsym) (2*(nsym) - 1)
+// Reverse the low n bits of code. Huffman codes are packed starting with the
+// most significant bit, but the bit reader returns the first bit in the LSB
+static inline unsigned _vinf_bitrev(unsigned code, unsigned n) {
+	unsigned rev = 0;
+	while (n--) {
+		rev = rev << 1 | (code & 1);
+		code >>= 1;
+	}
+	return rev;
+}
 
-// Fills tree (array of length 2*nsym - 1) with the huffman tree described by desc (array of length nsym)
-// This algorithm is described by RFC 1951, section 3.2.2
+// Fills table (array of length `size`) with the decoding table for the huffman
+// code described by desc (array of length nsym)
+// Codes are assigned as described by RFC 1951, section 3.2.2
 enum {_vinf_NLENGTHS = 16};
-static enum vinf_error _vinf_mkhuff(struct _vinf_huff *tree, const uint8_t *desc, unsigned nsym) {
+static enum vinf_error _vinf_mkhuff(
+	struct _vinf_hent *table, unsigned size, unsigned root,
+	const uint8_t *desc, unsigned nsym,
+	const struct _vinf_alphabet *ab
+) {
 	// Count codes per bit length
 	unsigned bl_count[_vinf_NLENGTHS] = {0};
 	for (unsigned i = 0; i < nsym; i++) {
@@ -194,362 +553,1058 @@ static enum vinf_error _vinf_mkhuff(struct _vinf_huff *tree, const uint8_t *desc
 		}
 		bl_count[desc[i]]++;
 	}
+	bl_count[0] = 0;
+
+	// Reject over-subscribed and incomplete codes. As in zlib, a single code of
+	// length 1 is permitted, since a block may only use one distance
+	unsigned max = 0;
+	int left = 1;
+	for (unsigned i = 1; i < _vinf_NLENGTHS; i++) {
+		left = 2*left - bl_count[i];
+		if (left < 0) return VENF_ERR_TREE_INVALID;
+		if (bl_count[i]) max = i;
+	}
+	if (left > 0 && max > 1) return VENF_ERR_TREE_INVALID;
+
+	// Anything not covered by a code is invalid
+	for (unsigned i = 0; i < 1u << root; i++) {
+		table[i] = (struct _vinf_hent){0, 1, _vinf_HE_BAD, 0};
+	}
+	if (!max) return 0;
+
+	// Sort symbols by code length, then by value
+	uint16_t offs[_vinf_NLENGTHS] = {0};
+	for (unsigned i = 1; i < _vinf_NLENGTHS - 1; i++) {
+		offs[i+1] = offs[i] + bl_count[i];
+	}
+	uint16_t sorted[_vinf_FIXED_NLIT];
+	for (unsigned i = 0; i < nsym; i++) {
+		if (desc[i]) sorted[offs[desc[i]]++] = i;
+	}
 
 	// Compute starting codes for each bit length
-	bl_count[0] = 0;
 	uint16_t next_code[_vinf_NLENGTHS] = {0};
 	for (unsigned i = 1; i < _vinf_NLENGTHS; i++) {
 		next_code[i] = 2 * (next_code[i-1] + bl_count[i-1]);
 	}
 
-	// Insert into tree
-	tree[0] = (struct _vinf_huff){0, 0, ~0};
-	unsigned nnode = 1;
-	for (unsigned i = 0; i < nsym; i++) {
-		unsigned bitlen = desc[i];
-		// Skip 0-bit codes
-		if (!bitlen) continue;
-
-		unsigned j = 0;
-		uint16_t code = next_code[bitlen]++;
-
-		while (bitlen--) {
-			_Bool bit = (code >> bitlen) & 1;
-
-			unsigned next = _vinf_huffbit(tree[j], bit);
-			if (!next) {
-				next = nnode++;
-				if (nnode > 2 * nsym - 1) return VENF_ERR_TREE_INVALID;
-				tree[next] = (struct _vinf_huff){0, 0, ~0};
-				_vinf_set_huffbit(tree[j], bit, next);
+	unsigned used = 1u << root;
+	unsigned sub_prefix = ~0u, sub_off = 0, sub_bits = 0;
+	unsigned ncode = offs[_vinf_NLENGTHS - 1];
+	for (unsigned i = 0; i < ncode; i++) {
+		unsigned sym = sorted[i];
+		unsigned len = desc[sym];
+		unsigned code = _vinf_bitrev(next_code[len]++, len);
+
+		if (len <= root) {
+			// Replicate the entry for every index starting with this code
+			struct _vinf_hent ent = _vinf_symbol_entry(ab, sym, len);
+			for (unsigned j = code; j < 1u << root; j += 1u << len) {
+				table[j] = ent;
+			}
+		} else {
+			unsigned prefix = code & ((1u << root) - 1);
+			if (prefix != sub_prefix) {
+				// Start a new subtable, large enough to fit all the codes sharing
+				// this prefix. This is the same sizing rule zlib uses, so the
+				// _ENOUGH bounds above hold
+				sub_bits = len - root;
+				int sub_left = 1 << sub_bits;
+				while (sub_bits + root < max) {
+					sub_left -= bl_count[sub_bits + root];
+					if (sub_left <= 0) break;
+					sub_bits++;
+					sub_left <<= 1;
+				}
+
+				sub_off = used;
+				used += 1u << sub_bits;
+				if (used > size) return VENF_ERR_TREE_INVALID;
+
+				sub_prefix = prefix;
+				table[prefix] = (struct _vinf_hent){sub_off, root, _vinf_HE_SUB, sub_bits};
+				for (unsigned j = 0; j < 1u << sub_bits; j++) {
+					table[sub_off + j] = (struct _vinf_hent){0, 1, _vinf_HE_BAD, 0};
+				}
 			}
 
-			j = next;
+			struct _vinf_hent ent = _vinf_symbol_entry(ab, sym, len - root);
+			for (unsigned j = code >> root; j < 1u << sub_bits; j += 1u << (len - root)) {
+				table[sub_off + j] = ent;
+			}
 		}
 
-		tree[j] = (struct _vinf_huff){0, 0, i};
+		bl_count[len]--;
 	}
 
 	return 0;
 }
+// }}}
 
-struct _vinf_stream {
-	struct vinf_bitreader r;
-	unsigned char *wstart; // Pointer to start of destination buffer
-	unsigned char *w; // Pointer to end
-	size_t wp; // Negative index
-	uint32_t crc; // CRC of written data
-};
-
-#define _vinf_readu(st, v, nbyte) do { \
-		int _n = (nbyte); \
-		const unsigned char *buf = vinf_readbyt(&(st)->r, _n); \
-		if (!buf) return VENF_ERR_EOF; \
-		(v) = 0; \
-		while (_n--) { \
-			(v) = (v) << 8 | buf[_n]; \
-		} \
+// Decoder {{{
+// The decoder is a state machine, so that it can stop when it runs out of
+// input or output space and resume later. Each step either completes, or
+// returns VENF_ERR_EOF or VENF_ERR_OVERFLOW having made no progress
+enum {
+	_vinf_M_HEADER, // Block header
+	_vinf_M_STORED, // Stored block length
+	_vinf_M_COPY, // Stored block data
+	_vinf_M_TABLE, // Dynamic block HLIT, HDIST and HCLEN
+	_vinf_M_HCLENS, // Code length code lengths
+	_vinf_M_LENS, // Literal/length and distance code lengths
+	_vinf_M_LIT, // Literal/length symbols
+	_vinf_M_MATCH, // Back-reference data
+	_vinf_M_DONE,
+};
+
+// Read an nbits-bit field into v
+#define _vinf_bits(br, v, nbits) do { \
+		unsigned _nb = (nbits); \
+		(v) = vinf_brpeek((br), _nb); \
+		if (!vinf_brconsume((br), _nb)) return VENF_ERR_EOF; \
 	} while (0)
 
-#define _vinf_write(st, buffer, buf_length) do { \
-		const unsigned char *_buf = (buffer); \
-		if (!_buf) return VENF_ERR_EOF; \
-		size_t _len = (buf_length); \
-		if ((st)->wp < _len) return VENF_ERR_OVERFLOW; \
-		while (_len--) { \
-			(st)->crc = vinf_crc32((st)->crc, *_buf); \
-			(st)->w[-(st)->wp--] = *_buf++; \
+// Decode one symbol using the given table, storing its entry in e
+#define _vinf_read_huff_code(br, table, root, e) do { \
+		(e) = (table)[vinf_brpeek((br), (root))]; \
+		if ((e).kind == _vinf_HE_SUB) { \
+			if (!vinf_brconsume((br), (root))) return VENF_ERR_EOF; \
+			(e) = (table)[(e).val + vinf_brpeek((br), (e).extra)]; \
 		} \
+		if (!vinf_brconsume((br), (e).len)) return VENF_ERR_EOF; \
+		if ((e).kind == _vinf_HE_BAD) return VENF_ERR_CODE_INVALID; \
 	} while (0)
 
-#define _vinf_read_huff_code(st, huff, v) do { \
-		uint16_t _node = 0; \
-		do { \
-			int _bit = vinf_readbit(&(st)->r); \
-			if (_bit < 0) return VENF_ERR_EOF; \
-			_node = _vinf_huffbit((huff)[_node], _bit); \
-		} while ((huff)[_node].b0 || (huff)[_node].b1); \
-		if ((huff)[_node].val >= _vinf_NSYM) return VENF_ERR_CODE_INVALID; \
-		(v) = (huff)[_node].val; \
-	} while (0)
+static void _vinf_init(struct _vinf_stream *st, unsigned char *out, size_t out_len) {
+	st->wstart = st->w = st->check_pos = out;
+	st->wend = out + out_len;
+	st->mode = _vinf_M_HEADER;
+	st->check = 0;
+	st->adler = 0;
+	st->stop_block = 0;
+}
+
+static void _vinf_check_sync(struct _vinf_stream *st) {
+	size_t n = st->w - st->check_pos;
+	if (st->adler) st->check = vinf_adler32(st->check, st->check_pos, n);
+	else st->check = vinf_crc32_buf(st->check, st->check_pos, n);
+	st->check_pos = st->w;
+}
+
+// Decoding tables for the fixed codes of RFC 1951, section 3.2.6, as built by
+// _vinf_mkhuff. Each entry is {val, len, kind, extra}. Every fixed code fits
+// in the primary table, so there are no subtables
+static const struct _vinf_hent _vinf_fixed_lit[1 << _vinf_LIT_BITS] = {
+	{0, 7, 2, 0}, {80, 8, 1, 0}, {16, 8, 1, 0}, {115, 8, 3, 4}, {31, 7, 3, 2}, {112, 8, 1, 0},
+	{48, 8, 1, 0}, {192, 9, 1, 0}, {10, 7, 3, 0}, {96, 8, 1, 0}, {32, 8, 1, 0}, {160, 9, 1, 0},
+	{0, 8, 1, 0}, {128, 8, 1, 0}, {64, 8, 1, 0}, {224, 9, 1, 0}, {6, 7, 3, 0}, {88, 8, 1, 0},
+	{24, 8, 1, 0}, {144, 9, 1, 0}, {59, 7, 3, 3}, {120, 8, 1, 0}, {56, 8, 1, 0}, {208, 9, 1, 0},
+	{17, 7, 3, 1}, {104, 8, 1, 0}, {40, 8, 1, 0}, {176, 9, 1, 0}, {8, 8, 1, 0}, {136, 8, 1, 0},
+	{72, 8, 1, 0}, {240, 9, 1, 0}, {4, 7, 3, 0}, {84, 8, 1, 0}, {20, 8, 1, 0}, {227, 8, 3, 5},
+	{43, 7, 3, 3}, {116, 8, 1, 0}, {52, 8, 1, 0}, {200, 9, 1, 0}, {13, 7, 3, 1}, {100, 8, 1, 0},
+	{36, 8, 1, 0}, {168, 9, 1, 0}, {4, 8, 1, 0}, {132, 8, 1, 0}, {68, 8, 1, 0}, {232, 9, 1, 0},
+	{8, 7, 3, 0}, {92, 8, 1, 0}, {28, 8, 1, 0}, {152, 9, 1, 0}, {83, 7, 3, 4}, {124, 8, 1, 0},
+	{60, 8, 1, 0}, {216, 9, 1, 0}, {23, 7, 3, 2}, {108, 8, 1, 0}, {44, 8, 1, 0}, {184, 9, 1, 0},
+	{12, 8, 1, 0}, {140, 8, 1, 0}, {76, 8, 1, 0}, {248, 9, 1, 0}, {3, 7, 3, 0}, {82, 8, 1, 0},
+	{18, 8, 1, 0}, {163, 8, 3, 5}, {35, 7, 3, 3}, {114, 8, 1, 0}, {50, 8, 1, 0}, {196, 9, 1, 0},
+	{11, 7, 3, 1}, {98, 8, 1, 0}, {34, 8, 1, 0}, {164, 9, 1, 0}, {2, 8, 1, 0}, {130, 8, 1, 0},
+	{66, 8, 1, 0}, {228, 9, 1, 0}, {7, 7, 3, 0}, {90, 8, 1, 0}, {26, 8, 1, 0}, {148, 9, 1, 0},
+	{67, 7, 3, 4}, {122, 8, 1, 0}, {58, 8, 1, 0}, {212, 9, 1, 0}, {19, 7, 3, 2}, {106, 8, 1, 0},
+	{42, 8, 1, 0}, {180, 9, 1, 0}, {10, 8, 1, 0}, {138, 8, 1, 0}, {74, 8, 1, 0}, {244, 9, 1, 0},
+	{5, 7, 3, 0}, {86, 8, 1, 0}, {22, 8, 1, 0}, {0, 8, 0, 0}, {51, 7, 3, 3}, {118, 8, 1, 0},
+	{54, 8, 1, 0}, {204, 9, 1, 0}, {15, 7, 3, 1}, {102, 8, 1, 0}, {38, 8, 1, 0}, {172, 9, 1, 0},
+	{6, 8, 1, 0}, {134, 8, 1, 0}, {70, 8, 1, 0}, {236, 9, 1, 0}, {9, 7, 3, 0}, {94, 8, 1, 0},
+	{30, 8, 1, 0}, {156, 9, 1, 0}, {99, 7, 3, 4}, {126, 8, 1, 0}, {62, 8, 1, 0}, {220, 9, 1, 0},
+	{27, 7, 3, 2}, {110, 8, 1, 0}, {46, 8, 1, 0}, {188, 9, 1, 0}, {14, 8, 1, 0}, {142, 8, 1, 0},
+	{78, 8, 1, 0}, {252, 9, 1, 0}, {0, 7, 2, 0}, {81, 8, 1, 0}, {17, 8, 1, 0}, {131, 8, 3, 5},
+	{31, 7, 3, 2}, {113, 8, 1, 0}, {49, 8, 1, 0}, {194, 9, 1, 0}, {10, 7, 3, 0}, {97, 8, 1, 0},
+	{33, 8, 1, 0}, {162, 9, 1, 0}, {1, 8, 1, 0}, {129, 8, 1, 0}, {65, 8, 1, 0}, {226, 9, 1, 0},
+	{6, 7, 3, 0}, {89, 8, 1, 0}, {25, 8, 1, 0}, {146, 9, 1, 0}, {59, 7, 3, 3}, {121, 8, 1, 0},
+	{57, 8, 1, 0}, {210, 9, 1, 0}, {17, 7, 3, 1}, {105, 8, 1, 0}, {41, 8, 1, 0}, {178, 9, 1, 0},
+	{9, 8, 1, 0}, {137, 8, 1, 0}, {73, 8, 1, 0}, {242, 9, 1, 0}, {4, 7, 3, 0}, {85, 8, 1, 0},
+	{21, 8, 1, 0}, {258, 8, 3, 0}, {43, 7, 3, 3}, {117, 8, 1, 0}, {53, 8, 1, 0}, {202, 9, 1, 0},
+	{13, 7, 3, 1}, {101, 8, 1, 0}, {37, 8, 1, 0}, {170, 9, 1, 0}, {5, 8, 1, 0}, {133, 8, 1, 0},
+	{69, 8, 1, 0}, {234, 9, 1, 0}, {8, 7, 3, 0}, {93, 8, 1, 0}, {29, 8, 1, 0}, {154, 9, 1, 0},
+	{83, 7, 3, 4}, {125, 8, 1, 0}, {61, 8, 1, 0}, {218, 9, 1, 0}, {23, 7, 3, 2}, {109, 8, 1, 0},
+	{45, 8, 1, 0}, {186, 9, 1, 0}, {13, 8, 1, 0}, {141, 8, 1, 0}, {77, 8, 1, 0}, {250, 9, 1, 0},
+	{3, 7, 3, 0}, {83, 8, 1, 0}, {19, 8, 1, 0}, {195, 8, 3, 5}, {35, 7, 3, 3}, {115, 8, 1, 0},
+	{51, 8, 1, 0}, {198, 9, 1, 0}, {11, 7, 3, 1}, {99, 8, 1, 0}, {35, 8, 1, 0}, {166, 9, 1, 0},
+	{3, 8, 1, 0}, {131, 8, 1, 0}, {67, 8, 1, 0}, {230, 9, 1, 0}, {7, 7, 3, 0}, {91, 8, 1, 0},
+	{27, 8, 1, 0}, {150, 9, 1, 0}, {67, 7, 3, 4}, {123, 8, 1, 0}, {59, 8, 1, 0}, {214, 9, 1, 0},
+	{19, 7, 3, 2}, {107, 8, 1, 0}, {43, 8, 1, 0}, {182, 9, 1, 0}, {11, 8, 1, 0}, {139, 8, 1, 0},
+	{75, 8, 1, 0}, {246, 9, 1, 0}, {5, 7, 3, 0}, {87, 8, 1, 0}, {23, 8, 1, 0}, {0, 8, 0, 0},
+	{51, 7, 3, 3}, {119, 8, 1, 0}, {55, 8, 1, 0}, {206, 9, 1, 0}, {15, 7, 3, 1}, {103, 8, 1, 0},
+	{39, 8, 1, 0}, {174, 9, 1, 0}, {7, 8, 1, 0}, {135, 8, 1, 0}, {71, 8, 1, 0}, {238, 9, 1, 0},
+	{9, 7, 3, 0}, {95, 8, 1, 0}, {31, 8, 1, 0}, {158, 9, 1, 0}, {99, 7, 3, 4}, {127, 8, 1, 0},
+	{63, 8, 1, 0}, {222, 9, 1, 0}, {27, 7, 3, 2}, {111, 8, 1, 0}, {47, 8, 1, 0}, {190, 9, 1, 0},
+	{15, 8, 1, 0}, {143, 8, 1, 0}, {79, 8, 1, 0}, {254, 9, 1, 0}, {0, 7, 2, 0}, {80, 8, 1, 0},
+	{16, 8, 1, 0}, {115, 8, 3, 4}, {31, 7, 3, 2}, {112, 8, 1, 0}, {48, 8, 1, 0}, {193, 9, 1, 0},
+	{10, 7, 3, 0}, {96, 8, 1, 0}, {32, 8, 1, 0}, {161, 9, 1, 0}, {0, 8, 1, 0}, {128, 8, 1, 0},
+	{64, 8, 1, 0}, {225, 9, 1, 0}, {6, 7, 3, 0}, {88, 8, 1, 0}, {24, 8, 1, 0}, {145, 9, 1, 0},
+	{59, 7, 3, 3}, {120, 8, 1, 0}, {56, 8, 1, 0}, {209, 9, 1, 0}, {17, 7, 3, 1}, {104, 8, 1, 0},
+	{40, 8, 1, 0}, {177, 9, 1, 0}, {8, 8, 1, 0}, {136, 8, 1, 0}, {72, 8, 1, 0}, {241, 9, 1, 0},
+	{4, 7, 3, 0}, {84, 8, 1, 0}, {20, 8, 1, 0}, {227, 8, 3, 5}, {43, 7, 3, 3}, {116, 8, 1, 0},
+	{52, 8, 1, 0}, {201, 9, 1, 0}, {13, 7, 3, 1}, {100, 8, 1, 0}, {36, 8, 1, 0}, {169, 9, 1, 0},
+	{4, 8, 1, 0}, {132, 8, 1, 0}, {68, 8, 1, 0}, {233, 9, 1, 0}, {8, 7, 3, 0}, {92, 8, 1, 0},
+	{28, 8, 1, 0}, {153, 9, 1, 0}, {83, 7, 3, 4}, {124, 8, 1, 0}, {60, 8, 1, 0}, {217, 9, 1, 0},
+	{23, 7, 3, 2}, {108, 8, 1, 0}, {44, 8, 1, 0}, {185, 9, 1, 0}, {12, 8, 1, 0}, {140, 8, 1, 0},
+	{76, 8, 1, 0}, {249, 9, 1, 0}, {3, 7, 3, 0}, {82, 8, 1, 0}, {18, 8, 1, 0}, {163, 8, 3, 5},
+	{35, 7, 3, 3}, {114, 8, 1, 0}, {50, 8, 1, 0}, {197, 9, 1, 0}, {11, 7, 3, 1}, {98, 8, 1, 0},
+	{34, 8, 1, 0}, {165, 9, 1, 0}, {2, 8, 1, 0}, {130, 8, 1, 0}, {66, 8, 1, 0}, {229, 9, 1, 0},
+	{7, 7, 3, 0}, {90, 8, 1, 0}, {26, 8, 1, 0}, {149, 9, 1, 0}, {67, 7, 3, 4}, {122, 8, 1, 0},
+	{58, 8, 1, 0}, {213, 9, 1, 0}, {19, 7, 3, 2}, {106, 8, 1, 0}, {42, 8, 1, 0}, {181, 9, 1, 0},
+	{10, 8, 1, 0}, {138, 8, 1, 0}, {74, 8, 1, 0}, {245, 9, 1, 0}, {5, 7, 3, 0}, {86, 8, 1, 0},
+	{22, 8, 1, 0}, {0, 8, 0, 0}, {51, 7, 3, 3}, {118, 8, 1, 0}, {54, 8, 1, 0}, {205, 9, 1, 0},
+	{15, 7, 3, 1}, {102, 8, 1, 0}, {38, 8, 1, 0}, {173, 9, 1, 0}, {6, 8, 1, 0}, {134, 8, 1, 0},
+	{70, 8, 1, 0}, {237, 9, 1, 0}, {9, 7, 3, 0}, {94, 8, 1, 0}, {30, 8, 1, 0}, {157, 9, 1, 0},
+	{99, 7, 3, 4}, {126, 8, 1, 0}, {62, 8, 1, 0}, {221, 9, 1, 0}, {27, 7, 3, 2}, {110, 8, 1, 0},
+	{46, 8, 1, 0}, {189, 9, 1, 0}, {14, 8, 1, 0}, {142, 8, 1, 0}, {78, 8, 1, 0}, {253, 9, 1, 0},
+	{0, 7, 2, 0}, {81, 8, 1, 0}, {17, 8, 1, 0}, {131, 8, 3, 5}, {31, 7, 3, 2}, {113, 8, 1, 0},
+	{49, 8, 1, 0}, {195, 9, 1, 0}, {10, 7, 3, 0}, {97, 8, 1, 0}, {33, 8, 1, 0}, {163, 9, 1, 0},
+	{1, 8, 1, 0}, {129, 8, 1, 0}, {65, 8, 1, 0}, {227, 9, 1, 0}, {6, 7, 3, 0}, {89, 8, 1, 0},
+	{25, 8, 1, 0}, {147, 9, 1, 0}, {59, 7, 3, 3}, {121, 8, 1, 0}, {57, 8, 1, 0}, {211, 9, 1, 0},
+	{17, 7, 3, 1}, {105, 8, 1, 0}, {41, 8, 1, 0}, {179, 9, 1, 0}, {9, 8, 1, 0}, {137, 8, 1, 0},
+	{73, 8, 1, 0}, {243, 9, 1, 0}, {4, 7, 3, 0}, {85, 8, 1, 0}, {21, 8, 1, 0}, {258, 8, 3, 0},
+	{43, 7, 3, 3}, {117, 8, 1, 0}, {53, 8, 1, 0}, {203, 9, 1, 0}, {13, 7, 3, 1}, {101, 8, 1, 0},
+	{37, 8, 1, 0}, {171, 9, 1, 0}, {5, 8, 1, 0}, {133, 8, 1, 0}, {69, 8, 1, 0}, {235, 9, 1, 0},
+	{8, 7, 3, 0}, {93, 8, 1, 0}, {29, 8, 1, 0}, {155, 9, 1, 0}, {83, 7, 3, 4}, {125, 8, 1, 0},
+	{61, 8, 1, 0}, {219, 9, 1, 0}, {23, 7, 3, 2}, {109, 8, 1, 0}, {45, 8, 1, 0}, {187, 9, 1, 0},
+	{13, 8, 1, 0}, {141, 8, 1, 0}, {77, 8, 1, 0}, {251, 9, 1, 0}, {3, 7, 3, 0}, {83, 8, 1, 0},
+	{19, 8, 1, 0}, {195, 8, 3, 5}, {35, 7, 3, 3}, {115, 8, 1, 0}, {51, 8, 1, 0}, {199, 9, 1, 0},
+	{11, 7, 3, 1}, {99, 8, 1, 0}, {35, 8, 1, 0}, {167, 9, 1, 0}, {3, 8, 1, 0}, {131, 8, 1, 0},
+	{67, 8, 1, 0}, {231, 9, 1, 0}, {7, 7, 3, 0}, {91, 8, 1, 0}, {27, 8, 1, 0}, {151, 9, 1, 0},
+	{67, 7, 3, 4}, {123, 8, 1, 0}, {59, 8, 1, 0}, {215, 9, 1, 0}, {19, 7, 3, 2}, {107, 8, 1, 0},
+	{43, 8, 1, 0}, {183, 9, 1, 0}, {11, 8, 1, 0}, {139, 8, 1, 0}, {75, 8, 1, 0}, {247, 9, 1, 0},
+	{5, 7, 3, 0}, {87, 8, 1, 0}, {23, 8, 1, 0}, {0, 8, 0, 0}, {51, 7, 3, 3}, {119, 8, 1, 0},
+	{55, 8, 1, 0}, {207, 9, 1, 0}, {15, 7, 3, 1}, {103, 8, 1, 0}, {39, 8, 1, 0}, {175, 9, 1, 0},
+	{7, 8, 1, 0}, {135, 8, 1, 0}, {71, 8, 1, 0}, {239, 9, 1, 0}, {9, 7, 3, 0}, {95, 8, 1, 0},
+	{31, 8, 1, 0}, {159, 9, 1, 0}, {99, 7, 3, 4}, {127, 8, 1, 0}, {63, 8, 1, 0}, {223, 9, 1, 0},
+	{27, 7, 3, 2}, {111, 8, 1, 0}, {47, 8, 1, 0}, {191, 9, 1, 0}, {15, 8, 1, 0}, {143, 8, 1, 0},
+	{79, 8, 1, 0}, {255, 9, 1, 0},
+};
+static const struct _vinf_hent _vinf_fixed_dist[1 << _vinf_DIST_BITS] = {
+	{1, 5, 3, 0}, {257, 5, 3, 7}, {17, 5, 3, 3}, {4097, 5, 3, 11}, {5, 5, 3, 1}, {1025, 5, 3, 9},
+	{65, 5, 3, 5}, {16385, 5, 3, 13}, {3, 5, 3, 0}, {513, 5, 3, 8}, {33, 5, 3, 4}, {8193, 5, 3, 12},
+	{9, 5, 3, 2}, {2049, 5, 3, 10}, {129, 5, 3, 6}, {0, 5, 0, 0}, {2, 5, 3, 0}, {385, 5, 3, 7},
+	{25, 5, 3, 3}, {6145, 5, 3, 11}, {7, 5, 3, 1}, {1537, 5, 3, 9}, {97, 5, 3, 5}, {24577, 5, 3, 13},
+	{4, 5, 3, 0}, {769, 5, 3, 8}, {49, 5, 3, 4}, {12289, 5, 3, 12}, {13, 5, 3, 2}, {3073, 5, 3, 10},
+	{193, 5, 3, 6}, {0, 5, 0, 0}, {1, 5, 3, 0}, {257, 5, 3, 7}, {17, 5, 3, 3}, {4097, 5, 3, 11},
+	{5, 5, 3, 1}, {1025, 5, 3, 9}, {65, 5, 3, 5}, {16385, 5, 3, 13}, {3, 5, 3, 0}, {513, 5, 3, 8},
+	{33, 5, 3, 4}, {8193, 5, 3, 12}, {9, 5, 3, 2}, {2049, 5, 3, 10}, {129, 5, 3, 6}, {0, 5, 0, 0},
+	{2, 5, 3, 0}, {385, 5, 3, 7}, {25, 5, 3, 3}, {6145, 5, 3, 11}, {7, 5, 3, 1}, {1537, 5, 3, 9},
+	{97, 5, 3, 5}, {24577, 5, 3, 13}, {4, 5, 3, 0}, {769, 5, 3, 8}, {49, 5, 3, 4}, {12289, 5, 3, 12},
+	{13, 5, 3, 2}, {3073, 5, 3, 10}, {193, 5, 3, 6}, {0, 5, 0, 0},
+};
+
+static enum vinf_error _vinf_step_header(struct _vinf_stream *st) {
+	// BFINAL and BTYPE
+	unsigned hdr;
+	_vinf_bits(&st->r, hdr, 3);
+	st->final = hdr & 1;
+
+	switch (hdr >> 1) {
+	case 0:
+		st->mode = _vinf_M_STORED;
+		return 0;
+
+	case 1:
+		st->mode = _vinf_M_LIT;
+		st->lit = _vinf_fixed_lit;
+		st->dist_table = _vinf_fixed_dist;
+		return 0;
+
+	case 2:
+		st->mode = _vinf_M_TABLE;
+		return 0;
+
+	default:
+		return VENF_ERR_TYPE_INVALID;
+	}
+}
+
+static enum vinf_error _vinf_step_stored(struct _vinf_stream *st) {
+	// Skip to the next byte boundary. The accumulator always ends on one
+	vinf_brconsume(&st->r, st->r.nbits % 8);
+
+	uint32_t hdr;
+	_vinf_bits(&st->r, hdr, 32);
+	uint16_t len = hdr, nlen = ~(hdr >> 16);
+	if (len != nlen) return VENF_ERR_LEN_MISMATCH;
+
+	st->len = len;
+	st->mode = _vinf_M_COPY;
+	return 0;
+}
+
+static enum vinf_error _vinf_step_copy(struct _vinf_stream *st) {
+	if (!st->len) {
+		st->mode = st->final ? _vinf_M_DONE : _vinf_M_HEADER;
+		return 0;
+	}
+	if (st->w == st->wend) return VENF_ERR_OVERFLOW;
+
+	// Bytes left in the accumulator come first, then straight from the input
+	if (st->r.nbits) {
+		while (st->r.nbits && st->len && st->w < st->wend) {
+			*st->w++ = st->r.bits;
+			vinf_brconsume(&st->r, 8);
+			st->len--;
+		}
+		return 0;
+	}
+
+	// The accumulator may still hold bits past nbits from a refill, which
+	// would no longer line up with the input once we skip past it
+	st->r.bits = 0;
+
+	size_t n = st->len;
+	if (n > (size_t)(st->r.end - st->r.p)) n = st->r.end - st->r.p;
+	if (n > (size_t)(st->wend - st->w)) n = st->wend - st->w;
+	if (!n) return VENF_ERR_EOF;
+
+	memcpy(st->w, st->r.p, n);
+	st->w += n;
+	st->r.p += n;
+	st->len -= n;
+	return 0;
+}
+
+static enum vinf_error _vinf_step_table(struct _vinf_stream *st) {
+	// HLIT, HDIST and HCLEN
+	unsigned hdr;
+	_vinf_bits(&st->r, hdr, 14);
+	st->hlit = (hdr & 0x1f) + 257;
+	st->hdist = (hdr >> 5 & 0x1f) + 1;
+	st->hclen = (hdr >> 10) + 4;
+	if (st->hlit > _vinf_NLIT || st->hdist > _vinf_NDIST) return VENF_ERR_TREE_INVALID;
+
+	// The code length code lengths are collected in lens until they are complete
+	memset(st->lens, 0, _vinf_HUFF_NSYM);
+	st->n = 0;
+	st->mode = _vinf_M_HCLENS;
+	return 0;
+}
+
+static enum vinf_error _vinf_step_hclens(struct _vinf_stream *st) {
+	// The code lengths are 3 bits each, so they are read in two batches
+	static const uint8_t hc_order[_vinf_HUFF_NSYM] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+	if (st->n < st->hclen) {
+		int n = st->hclen - st->n < 10 ? st->hclen - st->n : 10;
+		uint32_t hc_lens;
+		_vinf_bits(&st->r, hc_lens, 3 * n);
+		while (n--) {
+			st->lens[hc_order[st->n++]] = hc_lens & 7;
+			hc_lens >>= 3;
+		}
+		return 0;
+	}
+
+	enum vinf_error err = _vinf_mkhuff(st->hc_tables, _vinf_HUFF_ENOUGH, _vinf_HUFF_BITS, st->lens, _vinf_HUFF_NSYM, &_vinf_huff_alphabet);
+	if (err) return err;
 
-static enum vinf_error _vinf_read_alphabet(struct _vinf_stream *st, struct _vinf_huff *hc_tree, struct _vinf_huff *tree, int count) {
-	uint8_t desc[_vinf_NSYM] = {0};
-	for (int i = 0; i < count;) {
-		int value, count;
-		_vinf_read_huff_code(st, hc_tree, value);
+	st->n = 0;
+	st->mode = _vinf_M_LENS;
+	return 0;
+}
 
+// Read one code length (or run of code lengths). The literal/length and
+// distance lengths form a single sequence, so runs may cross from one into
+// the other. Once all have been read, build the decoding tables
+static enum vinf_error _vinf_step_lens(struct _vinf_stream *st) {
+	int total = st->hlit + st->hdist;
+	if (st->n < total) {
+		struct _vinf_hent e;
+		_vinf_read_huff_code(&st->r, st->hc_tables, _vinf_HUFF_BITS, e);
+
+		int value = e.val, count;
 		if (value < 16) {
 			count = 1;
 		} else if (value == 16) {
-			count = vinf_readval(&st->r, 2);
-			if (count < 0) return VENF_ERR_EOF;
+			if (st->n == 0) return VENF_ERR_TREE_INVALID;
+			_vinf_bits(&st->r, count, 2);
 			count += 3;
-			value = desc[i-1];
+			value = st->lens[st->n - 1];
 		} else if (value == 17) {
-			count = vinf_readval(&st->r, 3);
-			if (count < 0) return VENF_ERR_EOF;
+			_vinf_bits(&st->r, count, 3);
 			count += 3;
 			value = 0;
-		} else if (value == 18) {
-			count = vinf_readval(&st->r, 7);
-			if (count < 0) return VENF_ERR_EOF;
+		} else {
+			_vinf_bits(&st->r, count, 7);
 			count += 11;
 			value = 0;
-		} else {
-			return VENF_ERR_TREE_INVALID;
 		}
 
+		if (st->n + count > total) return VENF_ERR_TREE_INVALID;
 		while (count--) {
-			desc[i++] = value;
+			st->lens[st->n++] = value;
 		}
+		return 0;
 	}
 
-	return _vinf_mkhuff(tree, desc, _vinf_NSYM);
-}
-
-static enum vinf_error _vinf_block_huff(
-	struct _vinf_stream *st,
-	const struct _vinf_huff *lit_tree,
-	const struct _vinf_huff *dist_tree
-) {
-	enum {END_OF_BLOCK = 256};
-	static const uint8_t len_table[] = {
-		0, 0, 0, 0,
-		0, 0, 0, 0,
-		1, 1, 1, 1,
-		2, 2, 2, 2,
-		3, 3, 3, 3,
-		4, 4, 4, 4,
-		5, 5, 5, 5,
-		0,
-	};
-
-	static const uint8_t dist_table[] = {
-		0, 0, 0, 0,
-		1, 1, 2, 2,
-		3, 3, 4, 4,
-		5, 5, 6, 6,
-		7, 7, 8, 8,
-		9, 9, 10, 10,
-		11, 11, 12, 12,
-		13, 13,
-	};
+	// The end-of-block code must be present
+	if (!st->lens[256]) return VENF_ERR_TREE_INVALID;
 
-	uint16_t value;
-	unsigned char byt;
-	do {
-		_vinf_read_huff_code(st, lit_tree, value);
-		if (value < END_OF_BLOCK) {
-			byt = value;
-			_vinf_write(st, &byt, 1);
-		} else if (value > END_OF_BLOCK) {
-			value -= END_OF_BLOCK + 1;
-			if (value >= sizeof len_table / sizeof *len_table) {
-				return VENF_ERR_CODE_INVALID;
-			}
+	enum vinf_error err = _vinf_mkhuff(st->lit_tables, _vinf_LIT_ENOUGH, _vinf_LIT_BITS, st->lens, st->hlit, &_vinf_lit_alphabet);
+	if (err) return err;
+	err = _vinf_mkhuff(st->dist_tables, _vinf_DIST_ENOUGH, _vinf_DIST_BITS, st->lens + st->hlit, st->hdist, &_vinf_dist_alphabet);
+	if (err) return err;
 
-			// Calculate backref length
-			int len = vinf_readval(&st->r, len_table[value]);
-			if (len < 0) return VENF_ERR_EOF;
-			len += 3;
-			for (uint8_t i = 0; i < value; i++) {
-				len += 1 << len_table[i];
-			}
+	st->lit = st->lit_tables;
+	st->dist_table = st->dist_tables;
+	st->mode = _vinf_M_LIT;
+	return 0;
+}
 
-			// Read distance code
-			_vinf_read_huff_code(st, dist_tree, value);
-			if (value >= sizeof dist_table / sizeof *dist_table) {
-				return VENF_ERR_CODE_INVALID;
-			}
+// Decode the distance following a length code, and check it is in range
+#define _vinf_read_dist(br, table, e, dist, avail) do { \
+		_vinf_read_huff_code(br, table, _vinf_DIST_BITS, e); \
+		if ((e).kind != _vinf_HE_BASE) return VENF_ERR_CODE_INVALID; \
+		_vinf_bits(br, dist, (e).extra); \
+		(dist) += (e).val; \
+		if ((dist) > (avail)) return VENF_ERR_DIST_INVALID; \
+	} while (0)
 
-			// Calculate backref distance
-			int off = vinf_readval(&st->r, dist_table[value]);
-			if (off < 0) return VENF_ERR_EOF;
-			off += 1;
-			for (uint8_t i = 0; i < value; i++) {
-				off += 1 << dist_table[i];
-			}
+// Copy a back-reference in whole chunks, which may write up to
+// _vinf_COPY_SLACK bytes past its end. Returns the end of the copied data
+enum {_vinf_COPY_SLACK = 32};
+static inline unsigned char *_vinf_copy_match(unsigned char *w, unsigned dist, unsigned len) {
+	const unsigned char *src = w - dist;
+	unsigned char *end = w + len;
+
+	if (dist >= 32) {
+		// Chunks never overlap the data they are copied from, so each one
+		// only reads bytes that have already been written
+		do {
+			memcpy(w, src, 32);
+			w += 32;
+			src += 32;
+		} while (w < end);
+	} else if (dist >= 8) {
+		do {
+			memcpy(w, src, 8);
+			w += 8;
+			src += 8;
+		} while (w < end);
+	} else if (dist == 1) {
+		memset(w, *src, len);
+	} else {
+		// Repeat the pattern to fill 8 bytes, then write it out, advancing by
+		// the largest multiple of dist that fits so that it stays in phase
+		unsigned char pat[8];
+		for (unsigned i = 0; i < 8; i++) pat[i] = src[i % dist];
+		unsigned step = 8 - 8 % dist;
+		do {
+			memcpy(w, pat, 8);
+			w += step;
+		} while (w < end);
+	}
 
-			unsigned char *src = st->w - st->wp - off;
-			if (src < st->wstart) return VENF_ERR_DIST_INVALID;
+	return end;
+}
 
-			// Copy backref data
-			_vinf_write(st, src, len);
+// Decode symbols for as long as there is enough input and output space that
+// neither can run out part-way through one. This is where most time is spent
+static enum vinf_error _vinf_fast(struct _vinf_stream *st) {
+	// Work on local copies, since output writes could otherwise alias them
+	struct vinf_bitreader r = st->r;
+	unsigned char *w = st->w;
+	const struct _vinf_hent *lit = st->lit, *dist_table = st->dist_table;
+	enum vinf_error err = 0;
+
+	// A length/distance pair takes at most 48 bits of input, so a refill
+	// with 8 bytes of input left covers it. A back-reference writes at most
+	// 258 bytes, plus slack. Neither can run out part-way through a symbol
+	while (r.end - r.p >= 8 && st->wend - w >= 258 + _vinf_COPY_SLACK) {
+		vinf_brrefill(&r);
+
+		struct _vinf_hent e = lit[r.bits & ((1 << _vinf_LIT_BITS) - 1)];
+		if (e.kind == _vinf_HE_SUB) {
+			vinf_brconsume(&r, _vinf_LIT_BITS);
+			e = lit[e.val + (r.bits & ((1u << e.extra) - 1))];
+		}
+		vinf_brconsume(&r, e.len);
+
+		if (e.kind == _vinf_HE_LIT) {
+			*w++ = e.val;
+			continue;
+		} else if (e.kind == _vinf_HE_EOB) {
+			st->mode = st->final ? _vinf_M_DONE : _vinf_M_HEADER;
+			break;
+		} else if (e.kind == _vinf_HE_BAD) {
+			err = VENF_ERR_CODE_INVALID;
+			break;
 		}
-	} while (value != END_OF_BLOCK);
-	return 0;
-}
 
-static enum vinf_error _vinf_block_uncompressed(struct _vinf_stream *st) {
-	uint16_t len, nlen;
-	_vinf_readu(st, len, 2);
-	_vinf_readu(st, nlen, 2);
-	nlen = ~nlen;
-	if (len != nlen) return VENF_ERR_LEN_MISMATCH;
+		unsigned len = e.val + (r.bits & ((1u << e.extra) - 1));
+		vinf_brconsume(&r, e.extra);
 
-	_vinf_write(st, vinf_readbyt(&st->r, len), len);
-	return 0;
-}
+		e = dist_table[r.bits & ((1 << _vinf_DIST_BITS) - 1)];
+		if (e.kind == _vinf_HE_SUB) {
+			vinf_brconsume(&r, _vinf_DIST_BITS);
+			e = dist_table[e.val + (r.bits & ((1u << e.extra) - 1))];
+		}
+		vinf_brconsume(&r, e.len);
+		if (e.kind != _vinf_HE_BASE) {
+			err = VENF_ERR_CODE_INVALID;
+			break;
+		}
 
-static enum vinf_error _vinf_block_fixed(struct _vinf_stream *st) {
-	// Specified in RFC 1951, section 3.2.6
-	static const uint8_t desc[_vinf_FIXED_NSYM] = {
-		8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
-		8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
-		8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
-		8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
-		8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
-		8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
-		9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9,
-		9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9,
-		9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9,
-		9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9,
-		9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 7, 7, 7, 7, 7, 7, 7, 7,
-		7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 8, 8, 8, 8, 8, 8, 8, 8,
-	};
+		unsigned dist = e.val + (r.bits & ((1u << e.extra) - 1));
+		vinf_brconsume(&r, e.extra);
+		if (dist > (size_t)(w - st->wstart)) {
+			err = VENF_ERR_DIST_INVALID;
+			break;
+		}
 
-	static _vinf_thread_local struct _vinf_huff tree[_vinf_NNODE(_vinf_FIXED_NSYM)] = {0};
-	static _vinf_thread_local _Bool inited = 0;
-	if (!inited) {
-		inited = 1;
-		enum vinf_error err = _vinf_mkhuff(tree, desc, _vinf_FIXED_NSYM);
-		if (err) return err;
+		w = _vinf_copy_match(w, dist, len);
 	}
 
-	return _vinf_block_huff(st, tree, tree);
+	st->r = r;
+	st->w = w;
+	return err;
 }
 
-static enum vinf_error _vinf_block_dynamic(struct _vinf_stream *st) {
-	int hlit = vinf_readval(&st->r, 5);
-	if (hlit < 0) return VENF_ERR_EOF;
-	hlit += 257;
-
-	int hdist = vinf_readval(&st->r, 5);
-	if (hdist < 0) return VENF_ERR_EOF;
-	hdist += 1;
-
-	int hclen = vinf_readval(&st->r, 4);
-	if (hclen < 0) return VENF_ERR_EOF;
-	hclen += 4;
-	if (hclen >= _vinf_HUFF_NSYM) return VENF_ERR_TREE_INVALID;
-
-	static const uint8_t hc_order[_vinf_HUFF_NSYM] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
-	uint8_t hc_desc[_vinf_HUFF_NSYM] = {0};
-	for (int i = 0; i < hclen; i++) {
-		int v = vinf_readval(&st->r, 3);
-		if (v < 0) return VENF_ERR_EOF;
-		hc_desc[hc_order[i]] = v;
+static enum vinf_error _vinf_step_lit(struct _vinf_stream *st) {
+	struct _vinf_hent e;
+	_vinf_read_huff_code(&st->r, st->lit, _vinf_LIT_BITS, e);
+	if (e.kind == _vinf_HE_LIT) {
+		if (st->w == st->wend) return VENF_ERR_OVERFLOW;
+		*st->w++ = e.val;
+		return 0;
+	} else if (e.kind == _vinf_HE_EOB) {
+		st->mode = st->final ? _vinf_M_DONE : _vinf_M_HEADER;
+		return 0;
 	}
 
-	struct _vinf_huff hc_tree[_vinf_NNODE(_vinf_HUFF_NSYM)];
-	enum vinf_error err = _vinf_mkhuff(hc_tree, hc_desc, _vinf_HUFF_NSYM);
-	if (err) return err;
+	unsigned len, dist;
+	_vinf_bits(&st->r, len, e.extra);
+	len += e.val;
+	_vinf_read_dist(&st->r, st->dist_table, e, dist, (size_t)(st->w - st->wstart));
 
-	struct _vinf_huff lit_tree[_vinf_NNODE(_vinf_NSYM)];
-	err = _vinf_read_alphabet(st, hc_tree, lit_tree, hlit);
-	if (err) return err;
+	st->len = len;
+	st->dist = dist;
+	st->mode = _vinf_M_MATCH;
+	return 0;
+}
 
-	struct _vinf_huff dist_tree[_vinf_NNODE(_vinf_NSYM)];
-	err = _vinf_read_alphabet(st, hc_tree, dist_tree, hdist);
-	if (err) return err;
+static enum vinf_error _vinf_step_match(struct _vinf_stream *st) {
+	if (st->w == st->wend) return VENF_ERR_OVERFLOW;
 
-	return _vinf_block_huff(st, lit_tree, dist_tree);
-}
+	const unsigned char *src = st->w - st->dist;
+	while (st->len && st->w < st->wend) {
+		*st->w++ = *src++;
+		st->len--;
+	}
 
-static enum vinf_error _vinf_block_reserved(struct _vinf_stream *st) {
-	return VENF_ERR_TYPE_INVALID;
+	if (!st->len) st->mode = _vinf_M_LIT;
+	return 0;
 }
 
-enum vinf_error vinflate(struct vinf_data data) {
+// Run the decoder until the end of the stream, or until it needs more input
+// (VENF_ERR_EOF) or output space (VENF_ERR_OVERFLOW). Other errors are fatal
+static enum vinf_error _vinf_run(struct _vinf_stream *st) {
 	// This type is cursed, so here's an explanation, courtesy of cdecl.org:
 	//
-	//   declare block_types as array of pointer to function (pointer to struct _vinf_stream) returning enum vinf_error
+	//   declare steps as array of pointer to function (pointer to struct _vinf_stream) returning enum vinf_error
 	//
 	// That didn't really help, did it
-	static enum vinf_error (*block_types[])(struct _vinf_stream *st) = {
-		_vinf_block_uncompressed,
-		_vinf_block_fixed,
-		_vinf_block_dynamic,
-		_vinf_block_reserved,
+	static enum vinf_error (*steps[])(struct _vinf_stream *st) = {
+		[_vinf_M_HEADER] = _vinf_step_header,
+		[_vinf_M_STORED] = _vinf_step_stored,
+		[_vinf_M_COPY] = _vinf_step_copy,
+		[_vinf_M_TABLE] = _vinf_step_table,
+		[_vinf_M_HCLENS] = _vinf_step_hclens,
+		[_vinf_M_LENS] = _vinf_step_lens,
+		[_vinf_M_LIT] = _vinf_step_lit,
+		[_vinf_M_MATCH] = _vinf_step_match,
 	};
 
-	struct _vinf_stream st = {
-		{0},
-		data.out,
-		data.out + data.out_len,
-		data.out_len,
-		0,
-	};
-	vinf_brinit(&st.r, data.inp, data.inp_len);
+	enum vinf_error err = 0;
+	while (st->mode != _vinf_M_DONE) {
+		uint8_t mode = st->mode;
+		if (mode == _vinf_M_LIT) {
+			err = _vinf_fast(st);
+			if (err) break;
+		}
 
-	int b_final, b_type;
-	enum vinf_error err;
-	do {
-		b_final = vinf_readbit(&st.r);
-		if (b_final < 0) return VENF_ERR_EOF;
+		if (st->mode == mode) {
+			// If a step stops part-way through, rewind to its start. No step
+			// needs more than VINF_BR_MAXBITS bits, so when one runs out of
+			// input the refill afterwards takes everything that is left
+			struct vinf_bitreader save = st->r;
+			err = steps[mode](st);
+			if (err) {
+				if (err == VENF_ERR_EOF || err == VENF_ERR_OVERFLOW) st->r = save;
+				if (err == VENF_ERR_EOF) vinf_brrefill(&st->r);
+				break;
+			}
+		}
+
+		// Checksum each block while its output is still in cache
+		if (st->mode == _vinf_M_HEADER && mode != _vinf_M_HEADER) {
+			_vinf_check_sync(st);
+			if (st->stop_block) break;
+		}
+	}
+
+	_vinf_check_sync(st);
+	return err;
+}
+// }}}
 
-		b_type = vinf_readval(&st.r, 2);
-		if (b_type < 0) return VENF_ERR_EOF;
+enum vinf_error vinflate(struct vinf_data data) {
+	struct _vinf_stream st;
+	vinf_brinit(&st.r, data.inp, data.inp_len);
+	_vinf_init(&st, data.out, data.out_len);
 
-		err = block_types[b_type](&st);
-		if (err) return err;
-	} while (!b_final);
+	enum vinf_error err = _vinf_run(&st);
+	if (err) return err;
 
-	if (st.wp != 0) {
+	if (st.w != st.wend) {
 		return VENF_ERR_EOF;
 	}
 
-	if (st.crc != data.out_crc) {
+	if (st.check != data.out_crc) {
 		return VENF_ERR_CRC_MISMATCH;
 	}
 
 	return 0;
 }
 
-enum vinf_error vinf_read_gzip(const unsigned char *data, size_t data_len, struct vinf_gzip *hdr) {
-	*hdr = (struct vinf_gzip){0};
-
-	uint32_t crc = 0;
+// Streaming {{{
+enum {
+	_vinf_GZ_HEADER, // Fixed-size part of the gzip header
+	_vinf_GZ_XLEN,
+	_vinf_GZ_EXTRA,
+	_vinf_GZ_NAME,
+	_vinf_GZ_COMMENT,
+	_vinf_GZ_HCRC,
+	_vinf_ZL_HEADER, // zlib CMF and FLG
+	_vinf_ZL_DICTID,
+	_vinf_ZL_DICT, // Waiting for vinf_stream_set_dict
+	_vinf_GZ_DATA, // Compressed data
+	_vinf_GZ_FOOTER,
+	_vinf_GZ_DONE,
+};
 
-#define _vinf_advance(step, n) do { \
-		size_t _n = (n); \
-		if (data_len < _n) return VENF_ERR_EOF; \
-		for (int _i = 0; _i < _n; _i++) { \
-			step; \
-			crc = vinf_crc32(crc, *data); \
-			data++; \
-			data_len--; \
-		} \
-	} while (0)
+void vinf_stream_init(struct vinf_stream *s, int format) {
+	// The decoder's tables and window don't need clearing, which keeps
+	// setting up a stream for a small message cheap
+	memset(s, 0, offsetof(struct vinf_stream, st));
+	s->format = format;
+	switch (format) {
+	case VINF_STREAM_GZIP: s->gz_state = _vinf_GZ_HEADER; break;
+	case VINF_STREAM_ZLIB: s->gz_state = _vinf_ZL_HEADER; break;
+	default: s->gz_state = _vinf_GZ_DATA; break;
+	}
+	s->flushed = s->window;
+	s->adler = 1;
+
+	vinf_brinit(&s->st.r, NULL, 0);
+	_vinf_init(&s->st, s->window, sizeof s->window);
+	if (format == VINF_STREAM_ZLIB) {
+		s->st.adler = 1;
+		s->st.check = 1;
+	}
+}
 
-#define _vinf_read(v, n) do { (v) = 0; _vinf_advance((v) |= *data << (8*_i), n); } while (0)
+void vinf_stream_set_dict(struct vinf_stream *s, const unsigned char *dict, size_t len) {
+	s->dict_adler = vinf_adler32(1, dict, len);
+	s->dict = 1;
+	if (len > VINF_WSIZE) {
+		dict += len - VINF_WSIZE;
+		len = VINF_WSIZE;
+	}
 
-	_vinf_read(hdr->id, 2);
-	if (hdr->id != 0x8b1f) return VENF_ERR_ID_MISMATCH;
+	unsigned char *w = s->window + VINF_WSIZE;
+	memcpy(w - len, dict, len);
+	s->st.wstart = w - len;
+	s->st.w = s->st.check_pos = s->flushed = w;
+}
 
-	_vinf_read(hdr->cm, 1);
-	_vinf_read(hdr->flg, 1);
-	_vinf_read(hdr->mtime, 4);
-	_vinf_read(hdr->xfl, 1);
-	_vinf_read(hdr->os, 1);
+// Check a zlib header, given CMF and FLG as a big-endian 16-bit value
+static enum vinf_error _vinf_zlib_header(struct vinf_zlib *hdr, uint16_t v) {
+	hdr->cmf = v >> 8;
+	hdr->flg = v & 0xff;
+	// Deflate with a window of at most 32K, and a check value over both bytes
+	if ((hdr->cmf & 0xf) != 8 || hdr->cmf >> 4 > 7 || v % 31) {
+		return VENF_ERR_ID_MISMATCH;
+	}
+	return 0;
+}
 
-	if (hdr->flg & VENF_GZ_EXTRA) {
-		uint16_t xlen;
-		_vinf_read(xlen, 2);
-		_vinf_advance(, xlen);
+static enum vinf_error _vinf_stream_zlib_header(struct vinf_stream *s) {
+	struct _vinf_stream *st = &s->st;
+	if (s->gz_state == _vinf_ZL_HEADER) {
+		uint32_t v;
+		_vinf_bits(&st->r, v, 16);
+		enum vinf_error err = _vinf_zlib_header(&s->zlib, v >> 8 | (v & 0xff) << 8);
+		if (err) return err;
+		s->gz_state = s->zlib.flg & VENF_ZL_FDICT ? _vinf_ZL_DICTID : _vinf_GZ_DATA;
 	}
 
-	if (hdr->flg & VENF_GZ_NAME) {
-		hdr->f_name = (const char *)data;
-		unsigned char ch = 1;
-		while (ch) _vinf_read(ch, 1);
+	if (s->gz_state == _vinf_ZL_DICTID) {
+		uint32_t v;
+		_vinf_bits(&st->r, v, 32);
+		s->zlib.dictid = _vinf_bswap32(v);
+		s->gz_state = _vinf_ZL_DICT;
 	}
 
-	if (hdr->flg & VENF_GZ_COMMENT) {
-		hdr->f_comment = (const char *)data;
-		unsigned char ch = 1;
-		while (ch) _vinf_read(ch, 1);
+	if (s->gz_state == _vinf_ZL_DICT) {
+		if (!s->dict) return VENF_ERR_NEED_DICT;
+		if (s->dict_adler != s->zlib.dictid) return VENF_ERR_DICT_MISMATCH;
+		s->gz_state = _vinf_GZ_DATA;
+	}
+	return 0;
+}
+
+// Parse the gzip header one byte at a time, since it may be split anywhere
+static enum vinf_error _vinf_stream_header(struct vinf_stream *s) {
+	struct _vinf_stream *st = &s->st;
+	struct vinf_gzip *hdr = &s->gzip;
+	for (;;) {
+		// Skip fields that are not present
+		if (s->gz_state == _vinf_GZ_XLEN && !(hdr->flg & VENF_GZ_EXTRA)) s->gz_state = _vinf_GZ_NAME;
+		if (s->gz_state == _vinf_GZ_EXTRA && !s->gz_len) s->gz_state = _vinf_GZ_NAME;
+		if (s->gz_state == _vinf_GZ_NAME && !(hdr->flg & VENF_GZ_NAME)) s->gz_state = _vinf_GZ_COMMENT;
+		if (s->gz_state == _vinf_GZ_COMMENT && !(hdr->flg & VENF_GZ_COMMENT)) s->gz_state = _vinf_GZ_HCRC;
+		if (s->gz_state == _vinf_GZ_HCRC && !(hdr->flg & VENF_GZ_HCRC)) s->gz_state = _vinf_GZ_DATA;
+		if (s->gz_state == _vinf_GZ_DATA) return 0;
+
+		uint32_t byt;
+		_vinf_bits(&st->r, byt, 8);
+		uint16_t i = s->gz_n++;
+
+		switch (s->gz_state) {
+		case _vinf_GZ_HEADER:
+			if (i < 2) hdr->id |= byt << 8*i;
+			else if (i == 2) hdr->cm = byt;
+			else if (i == 3) hdr->flg = byt;
+			else if (i < 8) hdr->mtime |= byt << 8*(i - 4);
+			else if (i == 8) hdr->xfl = byt;
+			else hdr->os = byt;
+
+			if (i == 1 && hdr->id != 0x8b1f) return VENF_ERR_ID_MISMATCH;
+			if (s->gz_n < 10) break;
+			s->gz_state++;
+			s->gz_n = 0;
+			break;
+
+		case _vinf_GZ_XLEN:
+			s->gz_len |= byt << 8*i;
+			if (s->gz_n < 2) break;
+			s->gz_state++;
+			s->gz_n = 0;
+			break;
+
+		case _vinf_GZ_EXTRA:
+			if (s->gz_n < s->gz_len) break;
+			s->gz_state++;
+			s->gz_n = 0;
+			s->gz_len = 0;
+			break;
+
+		case _vinf_GZ_NAME:
+		case _vinf_GZ_COMMENT:
+			if (byt) break;
+			s->gz_state++;
+			s->gz_n = 0;
+			break;
+
+		case _vinf_GZ_HCRC:
+			// The header CRC does not cover itself
+			hdr->f_hcrc = s->gz_crc;
+			s->gz_len |= byt << 8*i;
+			if (s->gz_n < 2) continue;
+			if (s->gz_len != hdr->f_hcrc) return VENF_ERR_CRC_MISMATCH;
+			s->gz_state++;
+			s->gz_n = 0;
+			continue;
+		}
+
+		s->gz_crc = vinf_crc32(s->gz_crc, byt);
+	}
+}
+
+// The CRC and length are read separately, so that each read fits in the accumulator
+static enum vinf_error _vinf_stream_footer(struct vinf_stream *s) {
+	struct _vinf_stream *st = &s->st;
+	vinf_brconsume(&st->r, st->r.nbits % 8);
+
+	if (s->format == VINF_STREAM_ZLIB) {
+		uint32_t val;
+		_vinf_bits(&st->r, val, 32);
+		if (_vinf_bswap32(val) != s->adler) return VENF_ERR_CRC_MISMATCH;
+		s->gz_state = _vinf_GZ_DONE;
+		return 0;
+	}
+
+	while (s->gz_n < 2) {
+		uint32_t val;
+		_vinf_bits(&st->r, val, 32);
+		if (s->gz_n++ == 0) {
+			if (val != s->crc) return VENF_ERR_CRC_MISMATCH;
+		} else {
+			if (val != (uint32_t)s->total_out) return VENF_ERR_LEN_MISMATCH;
+		}
+	}
+
+	s->gz_state = _vinf_GZ_DONE;
+	return 0;
+}
+
+// Copy as much decoded data out of the window as will fit
+static enum vinf_error _vinf_stream_flush(struct vinf_stream *s) {
+	size_t n = s->st.w - s->flushed;
+	if (s->sink.write) {
+		if (n && s->sink.write(s->sink.ctx, s->flushed, n)) return VENF_ERR_WRITE;
+		s->flushed += n;
+		return 0;
+	}
+	if (!s->out) {
+		s->flushed += n;
+		return 0;
+	}
+
+	if (n > s->out_len) n = s->out_len;
+	if (!n) return 0;
+
+	memcpy(s->out, s->flushed, n);
+	s->flushed += n;
+	s->out += n;
+	s->out_len -= n;
+	return 0;
+}
+
+enum vinf_error vinflate_stream(struct vinf_stream *s) {
+	struct _vinf_stream *st = &s->st;
+
+	// Continue reading from the new input, keeping any bits left in the accumulator
+	const unsigned char *inp = s->inp;
+	st->r.p = inp;
+	st->r.end = inp + s->inp_len;
+	s->at_block = 0;
+
+	enum vinf_error err = 0;
+	while (!s->done) {
+		if (s->gz_state < _vinf_GZ_DATA) {
+			if (s->format == VINF_STREAM_ZLIB) err = _vinf_stream_zlib_header(s);
+			else err = _vinf_stream_header(s);
+			if (err) break;
+		}
+
+		if (s->gz_state == _vinf_GZ_DATA) {
+			err = _vinf_stream_flush(s);
+			if (err) break;
+
+			// Slide the window down once everything before it has been flushed
+			if (st->w == st->wend) {
+				if (s->flushed != st->w) {
+					err = VENF_ERR_OVERFLOW;
+					break;
+				}
+				memcpy(s->window, st->w - VINF_WSIZE, VINF_WSIZE);
+				st->wstart = s->window;
+				st->w = st->check_pos = s->flushed = s->window + VINF_WSIZE;
+			}
+
+			unsigned char *w = st->w;
+			err = _vinf_run(st);
+			s->total_out += st->w - w;
+			if (st->adler) s->adler = st->check;
+			else s->crc = st->check;
+			if (err == VENF_ERR_OVERFLOW) continue;
+			if (err) break;
+
+			if (st->mode != _vinf_M_DONE) {
+				s->at_block = 1;
+				break;
+			}
+
+			// All data must be flushed before the stream is complete
+			err = _vinf_stream_flush(s);
+			if (err) break;
+			if (s->flushed != st->w) {
+				err = VENF_ERR_OVERFLOW;
+				break;
+			}
+
+			s->gz_state = s->format == VINF_STREAM_RAW ? _vinf_GZ_DONE : _vinf_GZ_FOOTER;
+		}
+
+		if (s->gz_state == _vinf_GZ_FOOTER) {
+			err = _vinf_stream_footer(s);
+			if (err) break;
+		}
+
+		if (s->gz_state == _vinf_GZ_DONE) s->done = 1;
+	}
+	enum vinf_error flush_err = _vinf_stream_flush(s);
+	if (flush_err) return flush_err;
+
+	// A missing dictionary is not fatal, so the input position must be kept
+	// consistent for when decoding resumes
+	if (err != VENF_ERR_SUCCESS && err != VENF_ERR_EOF && err != VENF_ERR_OVERFLOW && err != VENF_ERR_NEED_DICT) {
+		return err;
+	}
+
+	// Unless decoding stopped for lack of input, give back any whole bytes in
+	// the accumulator that came from this input chunk. Bits from earlier
+	// chunks are always needed by the step that is waiting to run
+	if (err != VENF_ERR_EOF) {
+		size_t n = st->r.nbits / 8;
+		if (n > (size_t)(st->r.p - inp)) n = st->r.p - inp;
+		st->r.p -= n;
+		st->r.nbits -= 8 * n;
+	}
+	st->r.bits &= ((uint64_t)1 << st->r.nbits) - 1;
+
+	s->inp_len -= st->r.p - inp;
+	s->inp = st->r.p;
+	return err == VENF_ERR_NEED_DICT ? err : 0;
+}
+
+enum vinf_error vinflate_sink(const unsigned char *inp, size_t inp_len, int format, struct vinf_sink sink, uint64_t *total_out) {
+	struct vinf_stream *s = malloc(sizeof *s);
+	if (!s) return VENF_ERR_NOMEM;
+
+	uint64_t total = 0;
+	enum vinf_error err;
+	do {
+		vinf_stream_init(s, format);
+		s->sink = sink;
+		s->inp = inp;
+		s->inp_len = inp_len;
+		err = vinflate_stream(s);
+		if (!err && !s->done) err = VENF_ERR_EOF;
+		total += s->total_out;
+		inp = s->inp;
+		inp_len = s->inp_len;
+	} while (!err && format == VINF_STREAM_GZIP && inp_len);
+
+	free(s);
+	if (!err && total_out) *total_out = total;
+	return err;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <errno.h>
+#include <unistd.h>
+
+static int _vinf_fd_write(void *ctx, const unsigned char *buf, size_t len) {
+	int fd = (intptr_t)ctx;
+	while (len) {
+		ssize_t n = write(fd, buf, len);
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			return -1;
+		}
+		buf += n;
+		len -= n;
+	}
+	return 0;
+}
+
+struct vinf_sink vinf_fd_sink(int fd) {
+	return (struct vinf_sink){_vinf_fd_write, (void *)(intptr_t)fd};
+}
+#endif
+
+enum vinf_error vinf_verify(const unsigned char *inp, size_t inp_len, int format, uint64_t *total_out) {
+	// With no sink, the stream discards its output
+	return vinflate_sink(inp, inp_len, format, (struct vinf_sink){0}, total_out);
+}
+// }}}
+
+// zlib {{{
+enum vinf_error vinflate_zlib(const unsigned char *inp, size_t inp_len, unsigned char *out, size_t *out_len,
+	const unsigned char *dict, size_t dict_len) {
+	if (dict) {
+		// Back-references may reach into the dictionary, so it has to sit in
+		// front of the output. The stream's window provides that
+		struct vinf_stream *s = malloc(sizeof *s);
+		if (!s) return VENF_ERR_NOMEM;
+		vinf_stream_init(s, VINF_STREAM_ZLIB);
+		vinf_stream_set_dict(s, dict, dict_len);
+		s->inp = inp;
+		s->inp_len = inp_len;
+		s->out = out;
+		s->out_len = *out_len;
+
+		enum vinf_error err = vinflate_stream(s);
+		if (!err && !s->done) err = s->out_len ? VENF_ERR_EOF : VENF_ERR_OVERFLOW;
+		*out_len = s->total_out;
+		free(s);
+		return err;
+	}
+
+	// Without a dictionary, decode straight into the output
+	if (inp_len < 2) return VENF_ERR_EOF;
+	struct vinf_zlib hdr;
+	enum vinf_error err = _vinf_zlib_header(&hdr, inp[0] << 8 | inp[1]);
+	if (err) return err;
+	if (hdr.flg & VENF_ZL_FDICT) return VENF_ERR_NEED_DICT;
+
+	struct _vinf_stream st;
+	vinf_brinit(&st.r, inp + 2, inp_len - 2);
+	_vinf_init(&st, out, *out_len);
+	st.adler = 1;
+	st.check = 1;
+
+	err = _vinf_run(&st);
+	*out_len = st.w - out;
+	if (err) return err;
+
+	uint32_t adler;
+	vinf_brconsume(&st.r, st.r.nbits % 8);
+	_vinf_bits(&st.r, adler, 32);
+	if (_vinf_bswap32(adler) != st.check) return VENF_ERR_CRC_MISMATCH;
+	return 0;
+}
+// }}}
+enum vinf_error vinf_read_gzip(const unsigned char *data, size_t data_len, struct vinf_gzip *hdr) {
+	*hdr = (struct vinf_gzip){0};
+
+	uint32_t crc = 0;
+
+#define _vinf_advance(step, n) do { \
+		size_t _n = (n); \
+		if (data_len < _n) return VENF_ERR_EOF; \
+		for (int _i = 0; _i < _n; _i++) { \
+			step; \
+			crc = vinf_crc32(crc, *data); \
+			data++; \
+			data_len--; \
+		} \
+	} while (0)
+
+#define _vinf_read(v, n) do { (v) = 0; _vinf_advance((v) |= *data << (8*_i), n); } while (0)
+
+	_vinf_read(hdr->id, 2);
+	if (hdr->id != 0x8b1f) return VENF_ERR_ID_MISMATCH;
+
+	_vinf_read(hdr->cm, 1);
+	_vinf_read(hdr->flg, 1);
+	_vinf_read(hdr->mtime, 4);
+	_vinf_read(hdr->xfl, 1);
+	_vinf_read(hdr->os, 1);
+
+	if (hdr->flg & VENF_GZ_EXTRA) {
+		uint16_t xlen;
+		_vinf_read(xlen, 2);
+		_vinf_advance(, xlen);
+	}
+
+	if (hdr->flg & VENF_GZ_NAME) {
+		hdr->f_name = (const char *)data;
+		unsigned char ch = 1;
+		while (ch) _vinf_read(ch, 1);
+	}
+
+	if (hdr->flg & VENF_GZ_COMMENT) {
+		hdr->f_comment = (const char *)data;
+		unsigned char ch = 1;
+		while (ch) _vinf_read(ch, 1);
 	}
 
 	if (hdr->flg & VENF_GZ_HCRC) {
@@ -578,6 +1633,655 @@ enum vinf_error vinf_read_gzip(const unsigned char *data, size_t data_len, struc
 	return 0;
 }
 
+// Random access {{{
+enum vinf_error vinf_index_build(struct vinf_index *idx, const unsigned char *data, size_t data_len, int format, uint64_t span) {
+	*idx = (struct vinf_index){format, span};
+
+	struct vinf_stream *s = malloc(sizeof *s);
+	if (!s) return VENF_ERR_NOMEM;
+	vinf_stream_init(s, format);
+	s->st.stop_block = 1;
+	s->inp = data;
+	s->inp_len = data_len;
+
+	// The output isn't needed, only the window
+	unsigned char scratch[1 << 14];
+	size_t cap = 0;
+	uint64_t last = 0;
+	enum vinf_error err = 0;
+	while (!s->done) {
+		s->out = scratch;
+		s->out_len = sizeof scratch;
+		err = vinflate_stream(s);
+		if (err) break;
+
+		if (!s->at_block) {
+			if (!s->done && s->out_len) {
+				err = VENF_ERR_EOF;
+				break;
+			}
+			continue;
+		}
+
+		// The first checkpoint is always skipped, since decompression can
+		// start from the beginning instead
+		if (s->total_out - last < span || s->total_out == 0) continue;
+		last = s->total_out;
+
+		if (idx->npoints == cap) {
+			cap = cap ? 2*cap : 8;
+			struct vinf_index_point *points = realloc(idx->points, cap * sizeof *points);
+			if (!points) {
+				err = VENF_ERR_NOMEM;
+				break;
+			}
+			idx->points = points;
+		}
+
+		// Whole bytes have been returned to the input, so fewer than 8 bits
+		// remain in the accumulator
+		struct vinf_index_point *pt = &idx->points[idx->npoints++];
+		pt->out_off = s->total_out;
+		pt->inp_off = s->inp - data;
+		pt->bits = s->st.r.nbits;
+
+		size_t n = s->st.w - s->window;
+		if (n > VINF_WSIZE) n = VINF_WSIZE;
+		memset(pt->window, 0, VINF_WSIZE - n);
+		memcpy(pt->window + VINF_WSIZE - n, s->st.w - n, n);
+	}
+
+	idx->total_out = s->total_out;
+	free(s);
+	if (err) vinf_index_free(idx);
+	return err;
+}
+
+void vinf_index_free(struct vinf_index *idx) {
+	free(idx->points);
+	idx->points = NULL;
+	idx->npoints = 0;
+}
+
+enum vinf_error vinf_index_extract(const struct vinf_index *idx, const unsigned char *data, size_t data_len,
+	uint64_t off, unsigned char *buf, size_t len, size_t *nread) {
+	*nread = 0;
+	if (off >= idx->total_out) return 0;
+
+	// Find the last checkpoint before the requested offset
+	size_t lo = 0, hi = idx->npoints;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (idx->points[mid].out_off <= off) lo = mid + 1;
+		else hi = mid;
+	}
+
+	struct vinf_stream *s = malloc(sizeof *s);
+	if (!s) return VENF_ERR_NOMEM;
+
+	if (lo == 0) {
+		vinf_stream_init(s, idx->format);
+		s->inp = data;
+		s->inp_len = data_len;
+	} else {
+		// Resume as raw DEFLATE, with the checkpoint's window. The footer of a
+		// gzip stream is not checked, since the CRC of the earlier data is unknown
+		const struct vinf_index_point *pt = &idx->points[lo - 1];
+		if (pt->inp_off > data_len || (pt->bits && !pt->inp_off)) {
+			free(s);
+			return VENF_ERR_EOF;
+		}
+
+		vinf_stream_init(s, VINF_STREAM_RAW);
+		memcpy(s->window, pt->window, VINF_WSIZE);
+		s->st.w = s->st.check_pos = s->flushed = s->window + VINF_WSIZE;
+		if (pt->bits) {
+			s->st.r.bits = data[pt->inp_off - 1] >> (8 - pt->bits);
+			s->st.r.nbits = pt->bits;
+		}
+		s->total_out = pt->out_off;
+		s->inp = data + pt->inp_off;
+		s->inp_len = data_len - pt->inp_off;
+	}
+
+	// Decompress and discard everything up to the offset, then the data we want
+	unsigned char scratch[1 << 14];
+	enum vinf_error err = 0;
+	uint64_t skip = off - s->total_out;
+	while (!s->done && *nread < len) {
+		if (skip) {
+			s->out = scratch;
+			s->out_len = skip < sizeof scratch ? skip : sizeof scratch;
+		} else {
+			s->out = buf + *nread;
+			s->out_len = len - *nread;
+		}
+		size_t out_len = s->out_len;
+
+		err = vinflate_stream(s);
+		if (err) break;
+
+		size_t n = out_len - s->out_len;
+		if (skip) skip -= n;
+		else *nread += n;
+		if (!s->done && s->out_len) {
+			err = VENF_ERR_EOF;
+			break;
+		}
+	}
+
+	free(s);
+	return err;
+}
+
+// Little-endian integers in serialized indices
+static unsigned char *_vinf_put(unsigned char *p, uint64_t v, int n) {
+	for (int i = 0; i < n; i++) *p++ = v >> 8*i;
+	return p;
+}
+static uint64_t _vinf_get(const unsigned char *p, int n) {
+	uint64_t v = 0;
+	for (int i = 0; i < n; i++) v |= (uint64_t)p[i] << 8*i;
+	return v;
+}
+
+static const unsigned char _vinf_index_magic[8] = "vinfidx1";
+enum {
+	_vinf_INDEX_HDR = 8 + 1 + 3*8,
+	_vinf_INDEX_POINT = 2*8 + 1 + VINF_WSIZE,
+};
+
+size_t vinf_index_serialize(const struct vinf_index *idx, unsigned char *buf) {
+	size_t len = _vinf_INDEX_HDR + idx->npoints * _vinf_INDEX_POINT;
+	if (!buf) return len;
+
+	memcpy(buf, _vinf_index_magic, 8);
+	unsigned char *p = buf + 8;
+	p = _vinf_put(p, idx->format, 1);
+	p = _vinf_put(p, idx->span, 8);
+	p = _vinf_put(p, idx->total_out, 8);
+	p = _vinf_put(p, idx->npoints, 8);
+	for (size_t i = 0; i < idx->npoints; i++) {
+		const struct vinf_index_point *pt = &idx->points[i];
+		p = _vinf_put(p, pt->out_off, 8);
+		p = _vinf_put(p, pt->inp_off, 8);
+		p = _vinf_put(p, pt->bits, 1);
+		memcpy(p, pt->window, VINF_WSIZE);
+		p += VINF_WSIZE;
+	}
+	return len;
+}
+
+enum vinf_error vinf_index_deserialize(struct vinf_index *idx, const unsigned char *buf, size_t len) {
+	*idx = (struct vinf_index){0};
+	if (len < _vinf_INDEX_HDR) return VENF_ERR_EOF;
+	if (memcmp(buf, _vinf_index_magic, 8)) return VENF_ERR_ID_MISMATCH;
+
+	const unsigned char *p = buf + 8;
+	int format = _vinf_get(p, 1);
+	uint64_t span = _vinf_get(p + 1, 8);
+	uint64_t total_out = _vinf_get(p + 9, 8);
+	uint64_t npoints = _vinf_get(p + 17, 8);
+	p += 25;
+	if (npoints > (len - _vinf_INDEX_HDR) / _vinf_INDEX_POINT) return VENF_ERR_EOF;
+
+	struct vinf_index_point *points = malloc(npoints * sizeof *points);
+	if (npoints && !points) return VENF_ERR_NOMEM;
+	for (size_t i = 0; i < npoints; i++) {
+		struct vinf_index_point *pt = &points[i];
+		pt->out_off = _vinf_get(p, 8);
+		pt->inp_off = _vinf_get(p + 8, 8);
+		pt->bits = _vinf_get(p + 16, 1);
+		memcpy(pt->window, p + 17, VINF_WSIZE);
+		p += _vinf_INDEX_POINT;
+
+		// Checkpoints must be in order
+		if (pt->bits > 7 || pt->out_off > total_out || (i && pt->out_off <= points[i-1].out_off)) {
+			free(points);
+			return VENF_ERR_LEN_MISMATCH;
+		}
+	}
+
+	*idx = (struct vinf_index){format, span, total_out, npoints, points};
+	return 0;
+}
+// }}}
+
+// Multi-member gzip {{{
+#if __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_THREADS__) && !defined(__STDC_NO_ATOMICS__)
+#define _VINF_THREADS
+#include <stdatomic.h>
+#include <threads.h>
+#endif
+
+size_t vinf_bgzf_size(const unsigned char *data, size_t data_len) {
+	// ID, CM and FLG must match, and the extra field must be present
+	if (data_len < 18 || data[0] != 0x1f || data[1] != 0x8b || data[2] != 8) return 0;
+	if (!(data[3] & VENF_GZ_EXTRA)) return 0;
+
+	size_t xlen = data[10] | data[11] << 8;
+	if (data_len < 12 + xlen) return 0;
+
+	// Look for the BC subfield, which stores the member size minus one
+	const unsigned char *p = data + 12, *end = p + xlen;
+	while (end - p >= 4) {
+		size_t slen = p[2] | p[3] << 8;
+		if ((size_t)(end - p - 4) < slen) return 0;
+		if (p[0] == 'B' && p[1] == 'C' && slen == 2) {
+			size_t size = (p[4] | p[5] << 8) + 1;
+			return size <= data_len ? size : 0;
+		}
+		p += 4 + slen;
+	}
+	return 0;
+}
+
+struct _vinf_member {
+	struct vinf_data data; // For BGZF members, whose size fits in 32 bits
+	size_t out_len;
+	uint32_t out_crc;
+	_Bool done; // Already decompressed while scanning
+	enum vinf_error err;
+};
+
+struct _vinf_members_job {
+	struct _vinf_member *members;
+	size_t nmembers;
+#ifdef _VINF_THREADS
+	atomic_size_t next;
+#else
+	size_t next;
+#endif
+};
+
+static int _vinf_members_worker(void *arg) {
+	struct _vinf_members_job *job = arg;
+	for (;;) {
+#ifdef _VINF_THREADS
+		size_t i = atomic_fetch_add(&job->next, 1);
+#else
+		size_t i = job->next++;
+#endif
+		if (i >= job->nmembers) return 0;
+
+		struct _vinf_member *mem = &job->members[i];
+		if (!mem->done) mem->err = vinflate(mem->data);
+	}
+}
+
+// Decompress a non-BGZF member into out, returning its compressed length in *len
+static enum vinf_error _vinf_member_stream(struct _vinf_member *mem, unsigned char *out, size_t out_len, const unsigned char *inp, size_t inp_len, size_t *len) {
+	struct vinf_stream *s = malloc(sizeof *s);
+	if (!s) return VENF_ERR_NOMEM;
+
+	vinf_stream_init(s, VINF_STREAM_GZIP);
+	s->inp = inp;
+	s->inp_len = inp_len;
+	s->out = out;
+	s->out_len = out_len;
+
+	enum vinf_error err = vinflate_stream(s);
+	if (!err && !s->done) err = s->out_len ? VENF_ERR_EOF : VENF_ERR_OVERFLOW;
+
+	mem->out_len = s->total_out;
+	mem->out_crc = s->crc;
+	mem->done = 1;
+	*len = s->inp - inp;
+
+	free(s);
+	return err;
+}
+
+enum vinf_error vinflate_members(struct vinf_members *m) {
+	struct _vinf_members_job job = {0};
+	size_t cap = 0;
+	enum vinf_error err = 0;
+
+	// Find the members, and decompress any whose size is not known up front
+	const unsigned char *p = m->inp, *end = m->inp + m->inp_len;
+	size_t off = 0;
+	do {
+		if (job.nmembers == cap) {
+			cap = cap ? 2*cap : 16;
+			struct _vinf_member *members = realloc(job.members, cap * sizeof *members);
+			if (!members) {
+				err = VENF_ERR_NOMEM;
+				goto end;
+			}
+			job.members = members;
+		}
+		struct _vinf_member *mem = &job.members[job.nmembers++];
+		*mem = (struct _vinf_member){0};
+
+		size_t len = vinf_bgzf_size(p, end - p);
+		if (len) {
+			struct vinf_gzip hdr;
+			err = vinf_read_gzip(p, len, &hdr);
+			if (err) goto end;
+			if (hdr.data.out_len > m->out_len - off) {
+				err = VENF_ERR_OVERFLOW;
+				goto end;
+			}
+			mem->data = hdr.data;
+			mem->data.out = m->out + off;
+			mem->out_len = hdr.data.out_len;
+			mem->out_crc = hdr.data.out_crc;
+		} else {
+			err = _vinf_member_stream(mem, m->out + off, m->out_len - off, p, end - p, &len);
+			if (err) goto end;
+		}
+
+		p += len;
+		off += mem->out_len;
+	} while (p < end);
+
+	// Decompress the BGZF members
+#ifdef _VINF_THREADS
+	// The calling thread works too. If threads can't be created, carry on
+	// with fewer of them
+	size_t nthreads = m->nthreads < job.nmembers ? m->nthreads : job.nmembers;
+	thrd_t *threads = nthreads > 1 ? malloc((nthreads - 1) * sizeof *threads) : NULL;
+	size_t started = 0;
+	if (threads) {
+		for (; started + 1 < nthreads; started++) {
+			if (thrd_create(&threads[started], _vinf_members_worker, &job) != thrd_success) break;
+		}
+	}
+	_vinf_members_worker(&job);
+	for (size_t i = 0; i < started; i++) thrd_join(threads[i], NULL);
+	free(threads);
+#else
+	_vinf_members_worker(&job);
+#endif
+
+	// Each member's CRC and length have been checked against its footer
+	uint32_t crc = 0;
+	for (size_t i = 0; i < job.nmembers; i++) {
+		struct _vinf_member *mem = &job.members[i];
+		if (mem->err) {
+			err = mem->err;
+			goto end;
+		}
+		crc = vinf_crc32_combine(crc, mem->out_crc, mem->out_len);
+	}
+
+	m->total_out = off;
+	m->out_crc = crc;
+	m->nmembers = job.nmembers;
+
+end:
+	free(job.members);
+	return err;
+}
+// }}}
+
+// Parallel decompression {{{
+// Position a bit reader at an arbitrary bit offset
+static void _vinf_brseek(struct vinf_bitreader *br, const unsigned char *data, size_t len, uint64_t bit) {
+	vinf_brinit(br, data + bit/8, len - bit/8);
+	if (bit % 8 && br->p < br->end) {
+		br->bits = *br->p++ >> bit % 8;
+		br->nbits = 8 - bit % 8;
+	}
+}
+
+static uint64_t _vinf_brtell(const struct vinf_bitreader *br, const unsigned char *data) {
+	return (uint64_t)(br->p - data) * 8 - br->nbits;
+}
+
+enum {
+	// Minimum amount of input per thread
+	_vinf_PAR_CHUNK = 1 << 20,
+	// A guessed block that decodes to more symbols than this is assumed to be
+	// garbage. zlib's blocks hold at most 64K symbols
+	_vinf_PAR_MAX_SYMS = 1 << 17,
+};
+
+// A chunk decoded from a guessed starting point. Output symbols below 256 are
+// bytes; others refer to byte (sym - 256) of the 32K window preceding the chunk
+struct _vinf_par_chunk {
+	const unsigned char *data;
+	size_t len;
+	uint64_t search, search_end; // Range of bit offsets to search for a block start
+	uint64_t stop; // Stop at the first block boundary at or after this bit offset
+
+	uint64_t start, end; // Bit offsets of the decoded data; start is UINT64_MAX if none was found
+	_Bool final; // The chunk contains the final block
+
+	uint16_t *out;
+	size_t out_len, out_cap;
+	struct _vinf_stream st;
+};
+
+#ifdef _VINF_THREADS
+// Decode one block into the chunk's output, from a guessed position
+static enum vinf_error _vinf_par_block(struct _vinf_par_chunk *c, size_t max_syms) {
+	struct _vinf_stream *st = &c->st;
+	st->mode = _vinf_M_HEADER;
+
+	// Read the block header with the usual decoder steps
+	enum vinf_error err = 0;
+	while (!err && st->mode != _vinf_M_LIT && st->mode != _vinf_M_COPY) {
+		switch (st->mode) {
+		case _vinf_M_HEADER: err = _vinf_step_header(st); break;
+		case _vinf_M_STORED: err = _vinf_step_stored(st); break;
+		case _vinf_M_TABLE: err = _vinf_step_table(st); break;
+		case _vinf_M_HCLENS: err = _vinf_step_hclens(st); break;
+		case _vinf_M_LENS: err = _vinf_step_lens(st); break;
+		}
+	}
+	if (err) return err;
+
+	for (size_t nsyms = 0; nsyms < max_syms; nsyms++) {
+		if (c->out_cap - c->out_len < 258) {
+			size_t cap = c->out_cap ? 2*c->out_cap : 1 << 16;
+			uint16_t *out = realloc(c->out, cap * sizeof *out);
+			if (!out) return VENF_ERR_NOMEM;
+			c->out = out;
+			c->out_cap = cap;
+		}
+
+		if (st->mode == _vinf_M_COPY) {
+			if (!st->len) return 0;
+			unsigned byt;
+			_vinf_bits(&st->r, byt, 8);
+			c->out[c->out_len++] = byt;
+			st->len--;
+			continue;
+		}
+
+		struct _vinf_hent e;
+		_vinf_read_huff_code(&st->r, st->lit, _vinf_LIT_BITS, e);
+		if (e.kind == _vinf_HE_LIT) {
+			c->out[c->out_len++] = e.val;
+			continue;
+		} else if (e.kind == _vinf_HE_EOB) {
+			return 0;
+		}
+
+		unsigned len, dist;
+		_vinf_bits(&st->r, len, e.extra);
+		len += e.val;
+		_vinf_read_dist(&st->r, st->dist_table, e, dist, c->out_len + VINF_WSIZE);
+
+		// Data from before the chunk becomes a reference into the window
+		uint16_t *w = c->out + c->out_len;
+		for (unsigned i = 0; i < len && i < dist && dist - i > c->out_len; i++) {
+			*w++ = 256 + VINF_WSIZE - (dist - i - c->out_len);
+		}
+		for (const uint16_t *src = w - dist; w < c->out + c->out_len + len;) *w++ = *src++;
+		c->out_len += len;
+	}
+	return VENF_ERR_CODE_INVALID;
+}
+
+// Search for a dynamic block that decodes successfully, then decode from
+// there to the chunk's stopping point
+static int _vinf_par_worker(void *arg) {
+	struct _vinf_par_chunk *c = arg;
+	c->start = UINT64_MAX;
+
+	for (uint64_t bit = c->search; bit < c->search_end; bit++) {
+		// Only consider blocks with BFINAL clear and BTYPE 2
+		unsigned hdr = (c->data[bit/8] | c->data[bit/8 + 1] << 8) >> bit % 8;
+		if ((hdr & 7) != 4) continue;
+
+		_vinf_brseek(&c->st.r, c->data, c->len, bit);
+		c->out_len = 0;
+		if (!_vinf_par_block(c, _vinf_PAR_MAX_SYMS)) {
+			c->start = bit;
+			break;
+		}
+	}
+	if (c->start == UINT64_MAX) return 0;
+
+	// Later blocks are trusted; if they fail, so does the chunk
+	while (!c->st.final && _vinf_brtell(&c->st.r, c->data) < c->stop) {
+		if (_vinf_par_block(c, SIZE_MAX)) {
+			c->start = UINT64_MAX;
+			return 0;
+		}
+	}
+	c->end = _vinf_brtell(&c->st.r, c->data);
+	c->final = c->st.final;
+	return 0;
+}
+#endif
+
+// Decode in order from a known position and window, up to the first block
+// boundary at or after stop
+static enum vinf_error _vinf_par_seq(struct vinf_stream *s, struct vinf_data *data, uint64_t *pos, size_t *off, uint64_t stop, _Bool *final) {
+	vinf_stream_init(s, VINF_STREAM_RAW);
+	s->st.stop_block = 1;
+
+	size_t n = *off < VINF_WSIZE ? *off : VINF_WSIZE;
+	memcpy(s->window + VINF_WSIZE - n, data->out + *off - n, n);
+	s->st.w = s->st.check_pos = s->flushed = s->window + VINF_WSIZE;
+
+	_vinf_brseek(&s->st.r, data->inp, data->inp_len, *pos);
+	s->inp = s->st.r.p;
+	s->inp_len = data->inp + data->inp_len - s->inp;
+	s->out = data->out + *off;
+	s->out_len = data->out_len - *off;
+
+	for (;;) {
+		enum vinf_error err = vinflate_stream(s);
+		if (err) return err;
+		*off = s->out - data->out;
+		*pos = _vinf_brtell(&s->st.r, data->inp);
+
+		if (s->done) {
+			*final = 1;
+			return 0;
+		} else if (!s->at_block) {
+			return s->out_len ? VENF_ERR_EOF : VENF_ERR_OVERFLOW;
+		} else if (*pos >= stop) {
+			return 0;
+		}
+	}
+}
+
+enum vinf_error vinflate_parallel(struct vinf_data data, unsigned nthreads) {
+	size_t nchunks = data.inp_len / _vinf_PAR_CHUNK;
+	if (nchunks > nthreads) nchunks = nthreads;
+#ifndef _VINF_THREADS
+	nchunks = 1;
+#endif
+	if (nchunks <= 1) return vinflate(data);
+
+	struct _vinf_par_chunk *chunks = calloc(nchunks, sizeof *chunks);
+	struct vinf_stream *s = malloc(sizeof *s);
+	enum vinf_error err = 0;
+	if (!chunks || !s) {
+		err = VENF_ERR_NOMEM;
+		goto end;
+	}
+
+	// The search stops two bytes early so the block type check can read
+	// whole bytes. The last chunk decodes to the end of the stream
+	uint64_t chunk_bits = (uint64_t)(data.inp_len / nchunks) * 8;
+	for (size_t i = 1; i < nchunks; i++) {
+		struct _vinf_par_chunk *c = &chunks[i];
+		c->data = data.inp;
+		c->len = data.inp_len;
+		c->search = i * chunk_bits;
+		c->search_end = (i + 1) * chunk_bits - 16;
+		c->stop = i + 1 < nchunks ? (i + 1) * chunk_bits : UINT64_MAX;
+	}
+
+#ifdef _VINF_THREADS
+	thrd_t *threads = malloc(nchunks * sizeof *threads);
+	_Bool *started = calloc(nchunks, sizeof *started);
+	if (!threads || !started) {
+		free(threads);
+		free(started);
+		err = VENF_ERR_NOMEM;
+		goto end;
+	}
+	for (size_t i = 1; i < nchunks; i++) {
+		started[i] = thrd_create(&threads[i], _vinf_par_worker, &chunks[i]) == thrd_success;
+	}
+#endif
+
+	// Decode the first chunk while the others are searched
+	uint64_t pos = 0;
+	size_t off = 0;
+	_Bool final = 0;
+	err = _vinf_par_seq(s, &data, &pos, &off, chunk_bits, &final);
+
+#ifdef _VINF_THREADS
+	for (size_t i = 1; i < nchunks; i++) {
+		if (started[i]) thrd_join(threads[i], NULL);
+		else _vinf_par_worker(&chunks[i]);
+	}
+	free(threads);
+	free(started);
+#endif
+
+	// Stitch the chunks together, falling back to decoding in order where a
+	// guessed start was wrong
+	for (size_t i = 1; i < nchunks && !err && !final; i++) {
+		struct _vinf_par_chunk *c = &chunks[i];
+		if (c->start != pos) {
+			err = _vinf_par_seq(s, &data, &pos, &off, c->stop, &final);
+			continue;
+		}
+
+		if (c->out_len > data.out_len - off) {
+			err = VENF_ERR_OVERFLOW;
+			break;
+		}
+		unsigned char *w = data.out + off;
+		for (size_t j = 0; j < c->out_len; j++) {
+			uint16_t sym = c->out[j];
+			if (sym < 256) {
+				w[j] = sym;
+			} else if (off + (sym - 256) < VINF_WSIZE) {
+				err = VENF_ERR_DIST_INVALID;
+				break;
+			} else {
+				w[j] = w[(ptrdiff_t)(sym - 256) - VINF_WSIZE];
+			}
+		}
+		off += c->out_len;
+		pos = c->end;
+		final = c->final;
+	}
+
+	if (!err && !final) err = VENF_ERR_EOF;
+	if (!err && off != data.out_len) err = VENF_ERR_EOF;
+	if (!err && vinf_crc32_buf(0, data.out, data.out_len) != data.out_crc) err = VENF_ERR_CRC_MISMATCH;
+
+end:
+	if (chunks) {
+		for (size_t i = 0; i < nchunks; i++) free(chunks[i].out);
+	}
+	free(chunks);
+	free(s);
+	return err;
+}
+// }}}
+
 _Bool vinf_verify_gzip(const unsigned char *data, size_t data_len, uint32_t crc, size_t len) {
 	if (data_len < 8) return 0;
 
@@ -588,37 +2292,516 @@ _Bool vinf_verify_gzip(const unsigned char *data, size_t data_len, uint32_t crc,
 	return file_crc == crc && file_len == (len & ~(uint32_t)0);
 }
 
+// CRC-32 {{{
+// _vinf_crc_table[0] is the usual bytewise table. _vinf_crc_table[k][i] is the
+// CRC of byte i followed by k zero bytes, which lets slice-by-8 process eight
+// bytes with independent lookups
+static const uint32_t _vinf_crc_table[8][256] = {
+	{
+		0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f, 0xe963a535, 0x9e6495a3,
+		0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988, 0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91,
+		0x1db71064, 0x6ab020f2, 0xf3b97148, 0x84be41de, 0x1adad47d, 0x6ddde4eb, 0xf4d4b551, 0x83d385c7,
+		0x136c9856, 0x646ba8c0, 0xfd62f97a, 0x8a65c9ec, 0x14015c4f, 0x63066cd9, 0xfa0f3d63, 0x8d080df5,
+		0x3b6e20c8, 0x4c69105e, 0xd56041e4, 0xa2677172, 0x3c03e4d1, 0x4b04d447, 0xd20d85fd, 0xa50ab56b,
+		0x35b5a8fa, 0x42b2986c, 0xdbbbc9d6, 0xacbcf940, 0x32d86ce3, 0x45df5c75, 0xdcd60dcf, 0xabd13d59,
+		0x26d930ac, 0x51de003a, 0xc8d75180, 0xbfd06116, 0x21b4f4b5, 0x56b3c423, 0xcfba9599, 0xb8bda50f,
+		0x2802b89e, 0x5f058808, 0xc60cd9b2, 0xb10be924, 0x2f6f7c87, 0x58684c11, 0xc1611dab, 0xb6662d3d,
+		0x76dc4190, 0x01db7106, 0x98d220bc, 0xefd5102a, 0x71b18589, 0x06b6b51f, 0x9fbfe4a5, 0xe8b8d433,
+		0x7807c9a2, 0x0f00f934, 0x9609a88e, 0xe10e9818, 0x7f6a0dbb, 0x086d3d2d, 0x91646c97, 0xe6635c01,
+		0x6b6b51f4, 0x1c6c6162, 0x856530d8, 0xf262004e, 0x6c0695ed, 0x1b01a57b, 0x8208f4c1, 0xf50fc457,
+		0x65b0d9c6, 0x12b7e950, 0x8bbeb8ea, 0xfcb9887c, 0x62dd1ddf, 0x15da2d49, 0x8cd37cf3, 0xfbd44c65,
+		0x4db26158, 0x3ab551ce, 0xa3bc0074, 0xd4bb30e2, 0x4adfa541, 0x3dd895d7, 0xa4d1c46d, 0xd3d6f4fb,
+		0x4369e96a, 0x346ed9fc, 0xad678846, 0xda60b8d0, 0x44042d73, 0x33031de5, 0xaa0a4c5f, 0xdd0d7cc9,
+		0x5005713c, 0x270241aa, 0xbe0b1010, 0xc90c2086, 0x5768b525, 0x206f85b3, 0xb966d409, 0xce61e49f,
+		0x5edef90e, 0x29d9c998, 0xb0d09822, 0xc7d7a8b4, 0x59b33d17, 0x2eb40d81, 0xb7bd5c3b, 0xc0ba6cad,
+		0xedb88320, 0x9abfb3b6, 0x03b6e20c, 0x74b1d29a, 0xead54739, 0x9dd277af, 0x04db2615, 0x73dc1683,
+		0xe3630b12, 0x94643b84, 0x0d6d6a3e, 0x7a6a5aa8, 0xe40ecf0b, 0x9309ff9d, 0x0a00ae27, 0x7d079eb1,
+		0xf00f9344, 0x8708a3d2, 0x1e01f268, 0x6906c2fe, 0xf762575d, 0x806567cb, 0x196c3671, 0x6e6b06e7,
+		0xfed41b76, 0x89d32be0, 0x10da7a5a, 0x67dd4acc, 0xf9b9df6f, 0x8ebeeff9, 0x17b7be43, 0x60b08ed5,
+		0xd6d6a3e8, 0xa1d1937e, 0x38d8c2c4, 0x4fdff252, 0xd1bb67f1, 0xa6bc5767, 0x3fb506dd, 0x48b2364b,
+		0xd80d2bda, 0xaf0a1b4c, 0x36034af6, 0x41047a60, 0xdf60efc3, 0xa867df55, 0x316e8eef, 0x4669be79,
+		0xcb61b38c, 0xbc66831a, 0x256fd2a0, 0x5268e236, 0xcc0c7795, 0xbb0b4703, 0x220216b9, 0x5505262f,
+		0xc5ba3bbe, 0xb2bd0b28, 0x2bb45a92, 0x5cb36a04, 0xc2d7ffa7, 0xb5d0cf31, 0x2cd99e8b, 0x5bdeae1d,
+		0x9b64c2b0, 0xec63f226, 0x756aa39c, 0x026d930a, 0x9c0906a9, 0xeb0e363f, 0x72076785, 0x05005713,
+		0x95bf4a82, 0xe2b87a14, 0x7bb12bae, 0x0cb61b38, 0x92d28e9b, 0xe5d5be0d, 0x7cdcefb7, 0x0bdbdf21,
+		0x86d3d2d4, 0xf1d4e242, 0x68ddb3f8, 0x1fda836e, 0x81be16cd, 0xf6b9265b, 0x6fb077e1, 0x18b74777,
+		0x88085ae6, 0xff0f6a70, 0x66063bca, 0x11010b5c, 0x8f659eff, 0xf862ae69, 0x616bffd3, 0x166ccf45,
+		0xa00ae278, 0xd70dd2ee, 0x4e048354, 0x3903b3c2, 0xa7672661, 0xd06016f7, 0x4969474d, 0x3e6e77db,
+		0xaed16a4a, 0xd9d65adc, 0x40df0b66, 0x37d83bf0, 0xa9bcae53, 0xdebb9ec5, 0x47b2cf7f, 0x30b5ffe9,
+		0xbdbdf21c, 0xcabac28a, 0x53b39330, 0x24b4a3a6, 0xbad03605, 0xcdd70693, 0x54de5729, 0x23d967bf,
+		0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94, 0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d,
+	},
+	{
+		0x00000000, 0x191b3141, 0x32366282, 0x2b2d53c3, 0x646cc504, 0x7d77f445, 0x565aa786, 0x4f4196c7,
+		0xc8d98a08, 0xd1c2bb49, 0xfaefe88a, 0xe3f4d9cb, 0xacb54f0c, 0xb5ae7e4d, 0x9e832d8e, 0x87981ccf,
+		0x4ac21251, 0x53d92310, 0x78f470d3, 0x61ef4192, 0x2eaed755, 0x37b5e614, 0x1c98b5d7, 0x05838496,
+		0x821b9859, 0x9b00a918, 0xb02dfadb, 0xa936cb9a, 0xe6775d5d, 0xff6c6c1c, 0xd4413fdf, 0xcd5a0e9e,
+		0x958424a2, 0x8c9f15e3, 0xa7b24620, 0xbea97761, 0xf1e8e1a6, 0xe8f3d0e7, 0xc3de8324, 0xdac5b265,
+		0x5d5daeaa, 0x44469feb, 0x6f6bcc28, 0x7670fd69, 0x39316bae, 0x202a5aef, 0x0b07092c, 0x121c386d,
+		0xdf4636f3, 0xc65d07b2, 0xed705471, 0xf46b6530, 0xbb2af3f7, 0xa231c2b6, 0x891c9175, 0x9007a034,
+		0x179fbcfb, 0x0e848dba, 0x25a9de79, 0x3cb2ef38, 0x73f379ff, 0x6ae848be, 0x41c51b7d, 0x58de2a3c,
+		0xf0794f05, 0xe9627e44, 0xc24f2d87, 0xdb541cc6, 0x94158a01, 0x8d0ebb40, 0xa623e883, 0xbf38d9c2,
+		0x38a0c50d, 0x21bbf44c, 0x0a96a78f, 0x138d96ce, 0x5ccc0009, 0x45d73148, 0x6efa628b, 0x77e153ca,
+		0xbabb5d54, 0xa3a06c15, 0x888d3fd6, 0x91960e97, 0xded79850, 0xc7cca911, 0xece1fad2, 0xf5facb93,
+		0x7262d75c, 0x6b79e61d, 0x4054b5de, 0x594f849f, 0x160e1258, 0x0f152319, 0x243870da, 0x3d23419b,
+		0x65fd6ba7, 0x7ce65ae6, 0x57cb0925, 0x4ed03864, 0x0191aea3, 0x188a9fe2, 0x33a7cc21, 0x2abcfd60,
+		0xad24e1af, 0xb43fd0ee, 0x9f12832d, 0x8609b26c, 0xc94824ab, 0xd05315ea, 0xfb7e4629, 0xe2657768,
+		0x2f3f79f6, 0x362448b7, 0x1d091b74, 0x04122a35, 0x4b53bcf2, 0x52488db3, 0x7965de70, 0x607eef31,
+		0xe7e6f3fe, 0xfefdc2bf, 0xd5d0917c, 0xcccba03d, 0x838a36fa, 0x9a9107bb, 0xb1bc5478, 0xa8a76539,
+		0x3b83984b, 0x2298a90a, 0x09b5fac9, 0x10aecb88, 0x5fef5d4f, 0x46f46c0e, 0x6dd93fcd, 0x74c20e8c,
+		0xf35a1243, 0xea412302, 0xc16c70c1, 0xd8774180, 0x9736d747, 0x8e2de606, 0xa500b5c5, 0xbc1b8484,
+		0x71418a1a, 0x685abb5b, 0x4377e898, 0x5a6cd9d9, 0x152d4f1e, 0x0c367e5f, 0x271b2d9c, 0x3e001cdd,
+		0xb9980012, 0xa0833153, 0x8bae6290, 0x92b553d1, 0xddf4c516, 0xc4eff457, 0xefc2a794, 0xf6d996d5,
+		0xae07bce9, 0xb71c8da8, 0x9c31de6b, 0x852aef2a, 0xca6b79ed, 0xd37048ac, 0xf85d1b6f, 0xe1462a2e,
+		0x66de36e1, 0x7fc507a0, 0x54e85463, 0x4df36522, 0x02b2f3e5, 0x1ba9c2a4, 0x30849167, 0x299fa026,
+		0xe4c5aeb8, 0xfdde9ff9, 0xd6f3cc3a, 0xcfe8fd7b, 0x80a96bbc, 0x99b25afd, 0xb29f093e, 0xab84387f,
+		0x2c1c24b0, 0x350715f1, 0x1e2a4632, 0x07317773, 0x4870e1b4, 0x516bd0f5, 0x7a468336, 0x635db277,
+		0xcbfad74e, 0xd2e1e60f, 0xf9ccb5cc, 0xe0d7848d, 0xaf96124a, 0xb68d230b, 0x9da070c8, 0x84bb4189,
+		0x03235d46, 0x1a386c07, 0x31153fc4, 0x280e0e85, 0x674f9842, 0x7e54a903, 0x5579fac0, 0x4c62cb81,
+		0x8138c51f, 0x9823f45e, 0xb30ea79d, 0xaa1596dc, 0xe554001b, 0xfc4f315a, 0xd7626299, 0xce7953d8,
+		0x49e14f17, 0x50fa7e56, 0x7bd72d95, 0x62cc1cd4, 0x2d8d8a13, 0x3496bb52, 0x1fbbe891, 0x06a0d9d0,
+		0x5e7ef3ec, 0x4765c2ad, 0x6c48916e, 0x7553a02f, 0x3a1236e8, 0x230907a9, 0x0824546a, 0x113f652b,
+		0x96a779e4, 0x8fbc48a5, 0xa4911b66, 0xbd8a2a27, 0xf2cbbce0, 0xebd08da1, 0xc0fdde62, 0xd9e6ef23,
+		0x14bce1bd, 0x0da7d0fc, 0x268a833f, 0x3f91b27e, 0x70d024b9, 0x69cb15f8, 0x42e6463b, 0x5bfd777a,
+		0xdc656bb5, 0xc57e5af4, 0xee530937, 0xf7483876, 0xb809aeb1, 0xa1129ff0, 0x8a3fcc33, 0x9324fd72,
+	},
+	{
+		0x00000000, 0x01c26a37, 0x0384d46e, 0x0246be59, 0x0709a8dc, 0x06cbc2eb, 0x048d7cb2, 0x054f1685,
+		0x0e1351b8, 0x0fd13b8f, 0x0d9785d6, 0x0c55efe1, 0x091af964, 0x08d89353, 0x0a9e2d0a, 0x0b5c473d,
+		0x1c26a370, 0x1de4c947, 0x1fa2771e, 0x1e601d29, 0x1b2f0bac, 0x1aed619b, 0x18abdfc2, 0x1969b5f5,
+		0x1235f2c8, 0x13f798ff, 0x11b126a6, 0x10734c91, 0x153c5a14, 0x14fe3023, 0x16b88e7a, 0x177ae44d,
+		0x384d46e0, 0x398f2cd7, 0x3bc9928e, 0x3a0bf8b9, 0x3f44ee3c, 0x3e86840b, 0x3cc03a52, 0x3d025065,
+		0x365e1758, 0x379c7d6f, 0x35dac336, 0x3418a901, 0x3157bf84, 0x3095d5b3, 0x32d36bea, 0x331101dd,
+		0x246be590, 0x25a98fa7, 0x27ef31fe, 0x262d5bc9, 0x23624d4c, 0x22a0277b, 0x20e69922, 0x2124f315,
+		0x2a78b428, 0x2bbade1f, 0x29fc6046, 0x283e0a71, 0x2d711cf4, 0x2cb376c3, 0x2ef5c89a, 0x2f37a2ad,
+		0x709a8dc0, 0x7158e7f7, 0x731e59ae, 0x72dc3399, 0x7793251c, 0x76514f2b, 0x7417f172, 0x75d59b45,
+		0x7e89dc78, 0x7f4bb64f, 0x7d0d0816, 0x7ccf6221, 0x798074a4, 0x78421e93, 0x7a04a0ca, 0x7bc6cafd,
+		0x6cbc2eb0, 0x6d7e4487, 0x6f38fade, 0x6efa90e9, 0x6bb5866c, 0x6a77ec5b, 0x68315202, 0x69f33835,
+		0x62af7f08, 0x636d153f, 0x612bab66, 0x60e9c151, 0x65a6d7d4, 0x6464bde3, 0x662203ba, 0x67e0698d,
+		0x48d7cb20, 0x4915a117, 0x4b531f4e, 0x4a917579, 0x4fde63fc, 0x4e1c09cb, 0x4c5ab792, 0x4d98dda5,
+		0x46c49a98, 0x4706f0af, 0x45404ef6, 0x448224c1, 0x41cd3244, 0x400f5873, 0x4249e62a, 0x438b8c1d,
+		0x54f16850, 0x55330267, 0x5775bc3e, 0x56b7d609, 0x53f8c08c, 0x523aaabb, 0x507c14e2, 0x51be7ed5,
+		0x5ae239e8, 0x5b2053df, 0x5966ed86, 0x58a487b1, 0x5deb9134, 0x5c29fb03, 0x5e6f455a, 0x5fad2f6d,
+		0xe1351b80, 0xe0f771b7, 0xe2b1cfee, 0xe373a5d9, 0xe63cb35c, 0xe7fed96b, 0xe5b86732, 0xe47a0d05,
+		0xef264a38, 0xeee4200f, 0xeca29e56, 0xed60f461, 0xe82fe2e4, 0xe9ed88d3, 0xebab368a, 0xea695cbd,
+		0xfd13b8f0, 0xfcd1d2c7, 0xfe976c9e, 0xff5506a9, 0xfa1a102c, 0xfbd87a1b, 0xf99ec442, 0xf85cae75,
+		0xf300e948, 0xf2c2837f, 0xf0843d26, 0xf1465711, 0xf4094194, 0xf5cb2ba3, 0xf78d95fa, 0xf64fffcd,
+		0xd9785d60, 0xd8ba3757, 0xdafc890e, 0xdb3ee339, 0xde71f5bc, 0xdfb39f8b, 0xddf521d2, 0xdc374be5,
+		0xd76b0cd8, 0xd6a966ef, 0xd4efd8b6, 0xd52db281, 0xd062a404, 0xd1a0ce33, 0xd3e6706a, 0xd2241a5d,
+		0xc55efe10, 0xc49c9427, 0xc6da2a7e, 0xc7184049, 0xc25756cc, 0xc3953cfb, 0xc1d382a2, 0xc011e895,
+		0xcb4dafa8, 0xca8fc59f, 0xc8c97bc6, 0xc90b11f1, 0xcc440774, 0xcd866d43, 0xcfc0d31a, 0xce02b92d,
+		0x91af9640, 0x906dfc77, 0x922b422e, 0x93e92819, 0x96a63e9c, 0x976454ab, 0x9522eaf2, 0x94e080c5,
+		0x9fbcc7f8, 0x9e7eadcf, 0x9c381396, 0x9dfa79a1, 0x98b56f24, 0x99770513, 0x9b31bb4a, 0x9af3d17d,
+		0x8d893530, 0x8c4b5f07, 0x8e0de15e, 0x8fcf8b69, 0x8a809dec, 0x8b42f7db, 0x89044982, 0x88c623b5,
+		0x839a6488, 0x82580ebf, 0x801eb0e6, 0x81dcdad1, 0x8493cc54, 0x8551a663, 0x8717183a, 0x86d5720d,
+		0xa9e2d0a0, 0xa820ba97, 0xaa6604ce, 0xaba46ef9, 0xaeeb787c, 0xaf29124b, 0xad6fac12, 0xacadc625,
+		0xa7f18118, 0xa633eb2f, 0xa4755576, 0xa5b73f41, 0xa0f829c4, 0xa13a43f3, 0xa37cfdaa, 0xa2be979d,
+		0xb5c473d0, 0xb40619e7, 0xb640a7be, 0xb782cd89, 0xb2cddb0c, 0xb30fb13b, 0xb1490f62, 0xb08b6555,
+		0xbbd72268, 0xba15485f, 0xb853f606, 0xb9919c31, 0xbcde8ab4, 0xbd1ce083, 0xbf5a5eda, 0xbe9834ed,
+	},
+	{
+		0x00000000, 0xb8bc6765, 0xaa09c88b, 0x12b5afee, 0x8f629757, 0x37def032, 0x256b5fdc, 0x9dd738b9,
+		0xc5b428ef, 0x7d084f8a, 0x6fbde064, 0xd7018701, 0x4ad6bfb8, 0xf26ad8dd, 0xe0df7733, 0x58631056,
+		0x5019579f, 0xe8a530fa, 0xfa109f14, 0x42acf871, 0xdf7bc0c8, 0x67c7a7ad, 0x75720843, 0xcdce6f26,
+		0x95ad7f70, 0x2d111815, 0x3fa4b7fb, 0x8718d09e, 0x1acfe827, 0xa2738f42, 0xb0c620ac, 0x087a47c9,
+		0xa032af3e, 0x188ec85b, 0x0a3b67b5, 0xb28700d0, 0x2f503869, 0x97ec5f0c, 0x8559f0e2, 0x3de59787,
+		0x658687d1, 0xdd3ae0b4, 0xcf8f4f5a, 0x7733283f, 0xeae41086, 0x525877e3, 0x40edd80d, 0xf851bf68,
+		0xf02bf8a1, 0x48979fc4, 0x5a22302a, 0xe29e574f, 0x7f496ff6, 0xc7f50893, 0xd540a77d, 0x6dfcc018,
+		0x359fd04e, 0x8d23b72b, 0x9f9618c5, 0x272a7fa0, 0xbafd4719, 0x0241207c, 0x10f48f92, 0xa848e8f7,
+		0x9b14583d, 0x23a83f58, 0x311d90b6, 0x89a1f7d3, 0x1476cf6a, 0xaccaa80f, 0xbe7f07e1, 0x06c36084,
+		0x5ea070d2, 0xe61c17b7, 0xf4a9b859, 0x4c15df3c, 0xd1c2e785, 0x697e80e0, 0x7bcb2f0e, 0xc377486b,
+		0xcb0d0fa2, 0x73b168c7, 0x6104c729, 0xd9b8a04c, 0x446f98f5, 0xfcd3ff90, 0xee66507e, 0x56da371b,
+		0x0eb9274d, 0xb6054028, 0xa4b0efc6, 0x1c0c88a3, 0x81dbb01a, 0x3967d77f, 0x2bd27891, 0x936e1ff4,
+		0x3b26f703, 0x839a9066, 0x912f3f88, 0x299358ed, 0xb4446054, 0x0cf80731, 0x1e4da8df, 0xa6f1cfba,
+		0xfe92dfec, 0x462eb889, 0x549b1767, 0xec277002, 0x71f048bb, 0xc94c2fde, 0xdbf98030, 0x6345e755,
+		0x6b3fa09c, 0xd383c7f9, 0xc1366817, 0x798a0f72, 0xe45d37cb, 0x5ce150ae, 0x4e54ff40, 0xf6e89825,
+		0xae8b8873, 0x1637ef16, 0x048240f8, 0xbc3e279d, 0x21e91f24, 0x99557841, 0x8be0d7af, 0x335cb0ca,
+		0xed59b63b, 0x55e5d15e, 0x47507eb0, 0xffec19d5, 0x623b216c, 0xda874609, 0xc832e9e7, 0x708e8e82,
+		0x28ed9ed4, 0x9051f9b1, 0x82e4565f, 0x3a58313a, 0xa78f0983, 0x1f336ee6, 0x0d86c108, 0xb53aa66d,
+		0xbd40e1a4, 0x05fc86c1, 0x1749292f, 0xaff54e4a, 0x322276f3, 0x8a9e1196, 0x982bbe78, 0x2097d91d,
+		0x78f4c94b, 0xc048ae2e, 0xd2fd01c0, 0x6a4166a5, 0xf7965e1c, 0x4f2a3979, 0x5d9f9697, 0xe523f1f2,
+		0x4d6b1905, 0xf5d77e60, 0xe762d18e, 0x5fdeb6eb, 0xc2098e52, 0x7ab5e937, 0x680046d9, 0xd0bc21bc,
+		0x88df31ea, 0x3063568f, 0x22d6f961, 0x9a6a9e04, 0x07bda6bd, 0xbf01c1d8, 0xadb46e36, 0x15080953,
+		0x1d724e9a, 0xa5ce29ff, 0xb77b8611, 0x0fc7e174, 0x9210d9cd, 0x2aacbea8, 0x38191146, 0x80a57623,
+		0xd8c66675, 0x607a0110, 0x72cfaefe, 0xca73c99b, 0x57a4f122, 0xef189647, 0xfdad39a9, 0x45115ecc,
+		0x764dee06, 0xcef18963, 0xdc44268d, 0x64f841e8, 0xf92f7951, 0x41931e34, 0x5326b1da, 0xeb9ad6bf,
+		0xb3f9c6e9, 0x0b45a18c, 0x19f00e62, 0xa14c6907, 0x3c9b51be, 0x842736db, 0x96929935, 0x2e2efe50,
+		0x2654b999, 0x9ee8defc, 0x8c5d7112, 0x34e11677, 0xa9362ece, 0x118a49ab, 0x033fe645, 0xbb838120,
+		0xe3e09176, 0x5b5cf613, 0x49e959fd, 0xf1553e98, 0x6c820621, 0xd43e6144, 0xc68bceaa, 0x7e37a9cf,
+		0xd67f4138, 0x6ec3265d, 0x7c7689b3, 0xc4caeed6, 0x591dd66f, 0xe1a1b10a, 0xf3141ee4, 0x4ba87981,
+		0x13cb69d7, 0xab770eb2, 0xb9c2a15c, 0x017ec639, 0x9ca9fe80, 0x241599e5, 0x36a0360b, 0x8e1c516e,
+		0x866616a7, 0x3eda71c2, 0x2c6fde2c, 0x94d3b949, 0x090481f0, 0xb1b8e695, 0xa30d497b, 0x1bb12e1e,
+		0x43d23e48, 0xfb6e592d, 0xe9dbf6c3, 0x516791a6, 0xccb0a91f, 0x740cce7a, 0x66b96194, 0xde0506f1,
+	},
+	{
+		0x00000000, 0x3d6029b0, 0x7ac05360, 0x47a07ad0, 0xf580a6c0, 0xc8e08f70, 0x8f40f5a0, 0xb220dc10,
+		0x30704bc1, 0x0d106271, 0x4ab018a1, 0x77d03111, 0xc5f0ed01, 0xf890c4b1, 0xbf30be61, 0x825097d1,
+		0x60e09782, 0x5d80be32, 0x1a20c4e2, 0x2740ed52, 0x95603142, 0xa80018f2, 0xefa06222, 0xd2c04b92,
+		0x5090dc43, 0x6df0f5f3, 0x2a508f23, 0x1730a693, 0xa5107a83, 0x98705333, 0xdfd029e3, 0xe2b00053,
+		0xc1c12f04, 0xfca106b4, 0xbb017c64, 0x866155d4, 0x344189c4, 0x0921a074, 0x4e81daa4, 0x73e1f314,
+		0xf1b164c5, 0xccd14d75, 0x8b7137a5, 0xb6111e15, 0x0431c205, 0x3951ebb5, 0x7ef19165, 0x4391b8d5,
+		0xa121b886, 0x9c419136, 0xdbe1ebe6, 0xe681c256, 0x54a11e46, 0x69c137f6, 0x2e614d26, 0x13016496,
+		0x9151f347, 0xac31daf7, 0xeb91a027, 0xd6f18997, 0x64d15587, 0x59b17c37, 0x1e1106e7, 0x23712f57,
+		0x58f35849, 0x659371f9, 0x22330b29, 0x1f532299, 0xad73fe89, 0x9013d739, 0xd7b3ade9, 0xead38459,
+		0x68831388, 0x55e33a38, 0x124340e8, 0x2f236958, 0x9d03b548, 0xa0639cf8, 0xe7c3e628, 0xdaa3cf98,
+		0x3813cfcb, 0x0573e67b, 0x42d39cab, 0x7fb3b51b, 0xcd93690b, 0xf0f340bb, 0xb7533a6b, 0x8a3313db,
+		0x0863840a, 0x3503adba, 0x72a3d76a, 0x4fc3feda, 0xfde322ca, 0xc0830b7a, 0x872371aa, 0xba43581a,
+		0x9932774d, 0xa4525efd, 0xe3f2242d, 0xde920d9d, 0x6cb2d18d, 0x51d2f83d, 0x167282ed, 0x2b12ab5d,
+		0xa9423c8c, 0x9422153c, 0xd3826fec, 0xeee2465c, 0x5cc29a4c, 0x61a2b3fc, 0x2602c92c, 0x1b62e09c,
+		0xf9d2e0cf, 0xc4b2c97f, 0x8312b3af, 0xbe729a1f, 0x0c52460f, 0x31326fbf, 0x7692156f, 0x4bf23cdf,
+		0xc9a2ab0e, 0xf4c282be, 0xb362f86e, 0x8e02d1de, 0x3c220dce, 0x0142247e, 0x46e25eae, 0x7b82771e,
+		0xb1e6b092, 0x8c869922, 0xcb26e3f2, 0xf646ca42, 0x44661652, 0x79063fe2, 0x3ea64532, 0x03c66c82,
+		0x8196fb53, 0xbcf6d2e3, 0xfb56a833, 0xc6368183, 0x74165d93, 0x49767423, 0x0ed60ef3, 0x33b62743,
+		0xd1062710, 0xec660ea0, 0xabc67470, 0x96a65dc0, 0x248681d0, 0x19e6a860, 0x5e46d2b0, 0x6326fb00,
+		0xe1766cd1, 0xdc164561, 0x9bb63fb1, 0xa6d61601, 0x14f6ca11, 0x2996e3a1, 0x6e369971, 0x5356b0c1,
+		0x70279f96, 0x4d47b626, 0x0ae7ccf6, 0x3787e546, 0x85a73956, 0xb8c710e6, 0xff676a36, 0xc2074386,
+		0x4057d457, 0x7d37fde7, 0x3a978737, 0x07f7ae87, 0xb5d77297, 0x88b75b27, 0xcf1721f7, 0xf2770847,
+		0x10c70814, 0x2da721a4, 0x6a075b74, 0x576772c4, 0xe547aed4, 0xd8278764, 0x9f87fdb4, 0xa2e7d404,
+		0x20b743d5, 0x1dd76a65, 0x5a7710b5, 0x67173905, 0xd537e515, 0xe857cca5, 0xaff7b675, 0x92979fc5,
+		0xe915e8db, 0xd475c16b, 0x93d5bbbb, 0xaeb5920b, 0x1c954e1b, 0x21f567ab, 0x66551d7b, 0x5b3534cb,
+		0xd965a31a, 0xe4058aaa, 0xa3a5f07a, 0x9ec5d9ca, 0x2ce505da, 0x11852c6a, 0x562556ba, 0x6b457f0a,
+		0x89f57f59, 0xb49556e9, 0xf3352c39, 0xce550589, 0x7c75d999, 0x4115f029, 0x06b58af9, 0x3bd5a349,
+		0xb9853498, 0x84e51d28, 0xc34567f8, 0xfe254e48, 0x4c059258, 0x7165bbe8, 0x36c5c138, 0x0ba5e888,
+		0x28d4c7df, 0x15b4ee6f, 0x521494bf, 0x6f74bd0f, 0xdd54611f, 0xe03448af, 0xa794327f, 0x9af41bcf,
+		0x18a48c1e, 0x25c4a5ae, 0x6264df7e, 0x5f04f6ce, 0xed242ade, 0xd044036e, 0x97e479be, 0xaa84500e,
+		0x4834505d, 0x755479ed, 0x32f4033d, 0x0f942a8d, 0xbdb4f69d, 0x80d4df2d, 0xc774a5fd, 0xfa148c4d,
+		0x78441b9c, 0x4524322c, 0x028448fc, 0x3fe4614c, 0x8dc4bd5c, 0xb0a494ec, 0xf704ee3c, 0xca64c78c,
+	},
+	{
+		0x00000000, 0xcb5cd3a5, 0x4dc8a10b, 0x869472ae, 0x9b914216, 0x50cd91b3, 0xd659e31d, 0x1d0530b8,
+		0xec53826d, 0x270f51c8, 0xa19b2366, 0x6ac7f0c3, 0x77c2c07b, 0xbc9e13de, 0x3a0a6170, 0xf156b2d5,
+		0x03d6029b, 0xc88ad13e, 0x4e1ea390, 0x85427035, 0x9847408d, 0x531b9328, 0xd58fe186, 0x1ed33223,
+		0xef8580f6, 0x24d95353, 0xa24d21fd, 0x6911f258, 0x7414c2e0, 0xbf481145, 0x39dc63eb, 0xf280b04e,
+		0x07ac0536, 0xccf0d693, 0x4a64a43d, 0x81387798, 0x9c3d4720, 0x57619485, 0xd1f5e62b, 0x1aa9358e,
+		0xebff875b, 0x20a354fe, 0xa6372650, 0x6d6bf5f5, 0x706ec54d, 0xbb3216e8, 0x3da66446, 0xf6fab7e3,
+		0x047a07ad, 0xcf26d408, 0x49b2a6a6, 0x82ee7503, 0x9feb45bb, 0x54b7961e, 0xd223e4b0, 0x197f3715,
+		0xe82985c0, 0x23755665, 0xa5e124cb, 0x6ebdf76e, 0x73b8c7d6, 0xb8e41473, 0x3e7066dd, 0xf52cb578,
+		0x0f580a6c, 0xc404d9c9, 0x4290ab67, 0x89cc78c2, 0x94c9487a, 0x5f959bdf, 0xd901e971, 0x125d3ad4,
+		0xe30b8801, 0x28575ba4, 0xaec3290a, 0x659ffaaf, 0x789aca17, 0xb3c619b2, 0x35526b1c, 0xfe0eb8b9,
+		0x0c8e08f7, 0xc7d2db52, 0x4146a9fc, 0x8a1a7a59, 0x971f4ae1, 0x5c439944, 0xdad7ebea, 0x118b384f,
+		0xe0dd8a9a, 0x2b81593f, 0xad152b91, 0x6649f834, 0x7b4cc88c, 0xb0101b29, 0x36846987, 0xfdd8ba22,
+		0x08f40f5a, 0xc3a8dcff, 0x453cae51, 0x8e607df4, 0x93654d4c, 0x58399ee9, 0xdeadec47, 0x15f13fe2,
+		0xe4a78d37, 0x2ffb5e92, 0xa96f2c3c, 0x6233ff99, 0x7f36cf21, 0xb46a1c84, 0x32fe6e2a, 0xf9a2bd8f,
+		0x0b220dc1, 0xc07ede64, 0x46eaacca, 0x8db67f6f, 0x90b34fd7, 0x5bef9c72, 0xdd7beedc, 0x16273d79,
+		0xe7718fac, 0x2c2d5c09, 0xaab92ea7, 0x61e5fd02, 0x7ce0cdba, 0xb7bc1e1f, 0x31286cb1, 0xfa74bf14,
+		0x1eb014d8, 0xd5ecc77d, 0x5378b5d3, 0x98246676, 0x852156ce, 0x4e7d856b, 0xc8e9f7c5, 0x03b52460,
+		0xf2e396b5, 0x39bf4510, 0xbf2b37be, 0x7477e41b, 0x6972d4a3, 0xa22e0706, 0x24ba75a8, 0xefe6a60d,
+		0x1d661643, 0xd63ac5e6, 0x50aeb748, 0x9bf264ed, 0x86f75455, 0x4dab87f0, 0xcb3ff55e, 0x006326fb,
+		0xf135942e, 0x3a69478b, 0xbcfd3525, 0x77a1e680, 0x6aa4d638, 0xa1f8059d, 0x276c7733, 0xec30a496,
+		0x191c11ee, 0xd240c24b, 0x54d4b0e5, 0x9f886340, 0x828d53f8, 0x49d1805d, 0xcf45f2f3, 0x04192156,
+		0xf54f9383, 0x3e134026, 0xb8873288, 0x73dbe12d, 0x6eded195, 0xa5820230, 0x2316709e, 0xe84aa33b,
+		0x1aca1375, 0xd196c0d0, 0x5702b27e, 0x9c5e61db, 0x815b5163, 0x4a0782c6, 0xcc93f068, 0x07cf23cd,
+		0xf6999118, 0x3dc542bd, 0xbb513013, 0x700de3b6, 0x6d08d30e, 0xa65400ab, 0x20c07205, 0xeb9ca1a0,
+		0x11e81eb4, 0xdab4cd11, 0x5c20bfbf, 0x977c6c1a, 0x8a795ca2, 0x41258f07, 0xc7b1fda9, 0x0ced2e0c,
+		0xfdbb9cd9, 0x36e74f7c, 0xb0733dd2, 0x7b2fee77, 0x662adecf, 0xad760d6a, 0x2be27fc4, 0xe0beac61,
+		0x123e1c2f, 0xd962cf8a, 0x5ff6bd24, 0x94aa6e81, 0x89af5e39, 0x42f38d9c, 0xc467ff32, 0x0f3b2c97,
+		0xfe6d9e42, 0x35314de7, 0xb3a53f49, 0x78f9ecec, 0x65fcdc54, 0xaea00ff1, 0x28347d5f, 0xe368aefa,
+		0x16441b82, 0xdd18c827, 0x5b8cba89, 0x90d0692c, 0x8dd55994, 0x46898a31, 0xc01df89f, 0x0b412b3a,
+		0xfa1799ef, 0x314b4a4a, 0xb7df38e4, 0x7c83eb41, 0x6186dbf9, 0xaada085c, 0x2c4e7af2, 0xe712a957,
+		0x15921919, 0xdececabc, 0x585ab812, 0x93066bb7, 0x8e035b0f, 0x455f88aa, 0xc3cbfa04, 0x089729a1,
+		0xf9c19b74, 0x329d48d1, 0xb4093a7f, 0x7f55e9da, 0x6250d962, 0xa90c0ac7, 0x2f987869, 0xe4c4abcc,
+	},
+	{
+		0x00000000, 0xa6770bb4, 0x979f1129, 0x31e81a9d, 0xf44f2413, 0x52382fa7, 0x63d0353a, 0xc5a73e8e,
+		0x33ef4e67, 0x959845d3, 0xa4705f4e, 0x020754fa, 0xc7a06a74, 0x61d761c0, 0x503f7b5d, 0xf64870e9,
+		0x67de9cce, 0xc1a9977a, 0xf0418de7, 0x56368653, 0x9391b8dd, 0x35e6b369, 0x040ea9f4, 0xa279a240,
+		0x5431d2a9, 0xf246d91d, 0xc3aec380, 0x65d9c834, 0xa07ef6ba, 0x0609fd0e, 0x37e1e793, 0x9196ec27,
+		0xcfbd399c, 0x69ca3228, 0x582228b5, 0xfe552301, 0x3bf21d8f, 0x9d85163b, 0xac6d0ca6, 0x0a1a0712,
+		0xfc5277fb, 0x5a257c4f, 0x6bcd66d2, 0xcdba6d66, 0x081d53e8, 0xae6a585c, 0x9f8242c1, 0x39f54975,
+		0xa863a552, 0x0e14aee6, 0x3ffcb47b, 0x998bbfcf, 0x5c2c8141, 0xfa5b8af5, 0xcbb39068, 0x6dc49bdc,
+		0x9b8ceb35, 0x3dfbe081, 0x0c13fa1c, 0xaa64f1a8, 0x6fc3cf26, 0xc9b4c492, 0xf85cde0f, 0x5e2bd5bb,
+		0x440b7579, 0xe27c7ecd, 0xd3946450, 0x75e36fe4, 0xb044516a, 0x16335ade, 0x27db4043, 0x81ac4bf7,
+		0x77e43b1e, 0xd19330aa, 0xe07b2a37, 0x460c2183, 0x83ab1f0d, 0x25dc14b9, 0x14340e24, 0xb2430590,
+		0x23d5e9b7, 0x85a2e203, 0xb44af89e, 0x123df32a, 0xd79acda4, 0x71edc610, 0x4005dc8d, 0xe672d739,
+		0x103aa7d0, 0xb64dac64, 0x87a5b6f9, 0x21d2bd4d, 0xe47583c3, 0x42028877, 0x73ea92ea, 0xd59d995e,
+		0x8bb64ce5, 0x2dc14751, 0x1c295dcc, 0xba5e5678, 0x7ff968f6, 0xd98e6342, 0xe86679df, 0x4e11726b,
+		0xb8590282, 0x1e2e0936, 0x2fc613ab, 0x89b1181f, 0x4c162691, 0xea612d25, 0xdb8937b8, 0x7dfe3c0c,
+		0xec68d02b, 0x4a1fdb9f, 0x7bf7c102, 0xdd80cab6, 0x1827f438, 0xbe50ff8c, 0x8fb8e511, 0x29cfeea5,
+		0xdf879e4c, 0x79f095f8, 0x48188f65, 0xee6f84d1, 0x2bc8ba5f, 0x8dbfb1eb, 0xbc57ab76, 0x1a20a0c2,
+		0x8816eaf2, 0x2e61e146, 0x1f89fbdb, 0xb9fef06f, 0x7c59cee1, 0xda2ec555, 0xebc6dfc8, 0x4db1d47c,
+		0xbbf9a495, 0x1d8eaf21, 0x2c66b5bc, 0x8a11be08, 0x4fb68086, 0xe9c18b32, 0xd82991af, 0x7e5e9a1b,
+		0xefc8763c, 0x49bf7d88, 0x78576715, 0xde206ca1, 0x1b87522f, 0xbdf0599b, 0x8c184306, 0x2a6f48b2,
+		0xdc27385b, 0x7a5033ef, 0x4bb82972, 0xedcf22c6, 0x28681c48, 0x8e1f17fc, 0xbff70d61, 0x198006d5,
+		0x47abd36e, 0xe1dcd8da, 0xd034c247, 0x7643c9f3, 0xb3e4f77d, 0x1593fcc9, 0x247be654, 0x820cede0,
+		0x74449d09, 0xd23396bd, 0xe3db8c20, 0x45ac8794, 0x800bb91a, 0x267cb2ae, 0x1794a833, 0xb1e3a387,
+		0x20754fa0, 0x86024414, 0xb7ea5e89, 0x119d553d, 0xd43a6bb3, 0x724d6007, 0x43a57a9a, 0xe5d2712e,
+		0x139a01c7, 0xb5ed0a73, 0x840510ee, 0x22721b5a, 0xe7d525d4, 0x41a22e60, 0x704a34fd, 0xd63d3f49,
+		0xcc1d9f8b, 0x6a6a943f, 0x5b828ea2, 0xfdf58516, 0x3852bb98, 0x9e25b02c, 0xafcdaab1, 0x09baa105,
+		0xfff2d1ec, 0x5985da58, 0x686dc0c5, 0xce1acb71, 0x0bbdf5ff, 0xadcafe4b, 0x9c22e4d6, 0x3a55ef62,
+		0xabc30345, 0x0db408f1, 0x3c5c126c, 0x9a2b19d8, 0x5f8c2756, 0xf9fb2ce2, 0xc813367f, 0x6e643dcb,
+		0x982c4d22, 0x3e5b4696, 0x0fb35c0b, 0xa9c457bf, 0x6c636931, 0xca146285, 0xfbfc7818, 0x5d8b73ac,
+		0x03a0a617, 0xa5d7ada3, 0x943fb73e, 0x3248bc8a, 0xf7ef8204, 0x519889b0, 0x6070932d, 0xc6079899,
+		0x304fe870, 0x9638e3c4, 0xa7d0f959, 0x01a7f2ed, 0xc400cc63, 0x6277c7d7, 0x539fdd4a, 0xf5e8d6fe,
+		0x647e3ad9, 0xc209316d, 0xf3e12bf0, 0x55962044, 0x90311eca, 0x3646157e, 0x07ae0fe3, 0xa1d90457,
+		0x579174be, 0xf1e67f0a, 0xc00e6597, 0x66796e23, 0xa3de50ad, 0x05a95b19, 0x34414184, 0x92364a30,
+	},
+	{
+		0x00000000, 0xccaa009e, 0x4225077d, 0x8e8f07e3, 0x844a0efa, 0x48e00e64, 0xc66f0987, 0x0ac50919,
+		0xd3e51bb5, 0x1f4f1b2b, 0x91c01cc8, 0x5d6a1c56, 0x57af154f, 0x9b0515d1, 0x158a1232, 0xd92012ac,
+		0x7cbb312b, 0xb01131b5, 0x3e9e3656, 0xf23436c8, 0xf8f13fd1, 0x345b3f4f, 0xbad438ac, 0x767e3832,
+		0xaf5e2a9e, 0x63f42a00, 0xed7b2de3, 0x21d12d7d, 0x2b142464, 0xe7be24fa, 0x69312319, 0xa59b2387,
+		0xf9766256, 0x35dc62c8, 0xbb53652b, 0x77f965b5, 0x7d3c6cac, 0xb1966c32, 0x3f196bd1, 0xf3b36b4f,
+		0x2a9379e3, 0xe639797d, 0x68b67e9e, 0xa41c7e00, 0xaed97719, 0x62737787, 0xecfc7064, 0x205670fa,
+		0x85cd537d, 0x496753e3, 0xc7e85400, 0x0b42549e, 0x01875d87, 0xcd2d5d19, 0x43a25afa, 0x8f085a64,
+		0x562848c8, 0x9a824856, 0x140d4fb5, 0xd8a74f2b, 0xd2624632, 0x1ec846ac, 0x9047414f, 0x5ced41d1,
+		0x299dc2ed, 0xe537c273, 0x6bb8c590, 0xa712c50e, 0xadd7cc17, 0x617dcc89, 0xeff2cb6a, 0x2358cbf4,
+		0xfa78d958, 0x36d2d9c6, 0xb85dde25, 0x74f7debb, 0x7e32d7a2, 0xb298d73c, 0x3c17d0df, 0xf0bdd041,
+		0x5526f3c6, 0x998cf358, 0x1703f4bb, 0xdba9f425, 0xd16cfd3c, 0x1dc6fda2, 0x9349fa41, 0x5fe3fadf,
+		0x86c3e873, 0x4a69e8ed, 0xc4e6ef0e, 0x084cef90, 0x0289e689, 0xce23e617, 0x40ace1f4, 0x8c06e16a,
+		0xd0eba0bb, 0x1c41a025, 0x92cea7c6, 0x5e64a758, 0x54a1ae41, 0x980baedf, 0x1684a93c, 0xda2ea9a2,
+		0x030ebb0e, 0xcfa4bb90, 0x412bbc73, 0x8d81bced, 0x8744b5f4, 0x4beeb56a, 0xc561b289, 0x09cbb217,
+		0xac509190, 0x60fa910e, 0xee7596ed, 0x22df9673, 0x281a9f6a, 0xe4b09ff4, 0x6a3f9817, 0xa6959889,
+		0x7fb58a25, 0xb31f8abb, 0x3d908d58, 0xf13a8dc6, 0xfbff84df, 0x37558441, 0xb9da83a2, 0x7570833c,
+		0x533b85da, 0x9f918544, 0x111e82a7, 0xddb48239, 0xd7718b20, 0x1bdb8bbe, 0x95548c5d, 0x59fe8cc3,
+		0x80de9e6f, 0x4c749ef1, 0xc2fb9912, 0x0e51998c, 0x04949095, 0xc83e900b, 0x46b197e8, 0x8a1b9776,
+		0x2f80b4f1, 0xe32ab46f, 0x6da5b38c, 0xa10fb312, 0xabcaba0b, 0x6760ba95, 0xe9efbd76, 0x2545bde8,
+		0xfc65af44, 0x30cfafda, 0xbe40a839, 0x72eaa8a7, 0x782fa1be, 0xb485a120, 0x3a0aa6c3, 0xf6a0a65d,
+		0xaa4de78c, 0x66e7e712, 0xe868e0f1, 0x24c2e06f, 0x2e07e976, 0xe2ade9e8, 0x6c22ee0b, 0xa088ee95,
+		0x79a8fc39, 0xb502fca7, 0x3b8dfb44, 0xf727fbda, 0xfde2f2c3, 0x3148f25d, 0xbfc7f5be, 0x736df520,
+		0xd6f6d6a7, 0x1a5cd639, 0x94d3d1da, 0x5879d144, 0x52bcd85d, 0x9e16d8c3, 0x1099df20, 0xdc33dfbe,
+		0x0513cd12, 0xc9b9cd8c, 0x4736ca6f, 0x8b9ccaf1, 0x8159c3e8, 0x4df3c376, 0xc37cc495, 0x0fd6c40b,
+		0x7aa64737, 0xb60c47a9, 0x3883404a, 0xf42940d4, 0xfeec49cd, 0x32464953, 0xbcc94eb0, 0x70634e2e,
+		0xa9435c82, 0x65e95c1c, 0xeb665bff, 0x27cc5b61, 0x2d095278, 0xe1a352e6, 0x6f2c5505, 0xa386559b,
+		0x061d761c, 0xcab77682, 0x44387161, 0x889271ff, 0x825778e6, 0x4efd7878, 0xc0727f9b, 0x0cd87f05,
+		0xd5f86da9, 0x19526d37, 0x97dd6ad4, 0x5b776a4a, 0x51b26353, 0x9d1863cd, 0x1397642e, 0xdf3d64b0,
+		0x83d02561, 0x4f7a25ff, 0xc1f5221c, 0x0d5f2282, 0x079a2b9b, 0xcb302b05, 0x45bf2ce6, 0x89152c78,
+		0x50353ed4, 0x9c9f3e4a, 0x121039a9, 0xdeba3937, 0xd47f302e, 0x18d530b0, 0x965a3753, 0x5af037cd,
+		0xff6b144a, 0x33c114d4, 0xbd4e1337, 0x71e413a9, 0x7b211ab0, 0xb78b1a2e, 0x39041dcd, 0xf5ae1d53,
+		0x2c8e0fff, 0xe0240f61, 0x6eab0882, 0xa201081c, 0xa8c40105, 0x646e019b, 0xeae10678, 0x264b06e6,
+	},
+};
+
 uint32_t vinf_crc32(uint32_t crc, uint8_t byt) {
-	static _vinf_thread_local uint32_t table[256];
-	static _vinf_thread_local _Bool table_inited = 0;
-
-	if (!table_inited) {
-		for (int i = 0; i < 256; i++) {
-			uint32_t c = i;
-			for (int j = 0; j < 8; j++) {
-				if (c & 1) {
-					c /= 2;
-					c ^= 0xEDB88320;
-				} else {
-					c /= 2;
-				}
-			}
-			table[i] = c;
-		}
-		table_inited = 1;
+	crc = ~crc;
+	crc = _vinf_crc_table[0][(crc ^ byt) & 0xff] ^ crc >> 8;
+	return ~crc;
+}
+
+static inline uint32_t _vinf_load32le(const unsigned char *p) {
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// Operates on the inverted CRC
+static uint32_t _vinf_crc32_slice8(uint32_t crc, const unsigned char *buf, size_t len) {
+	for (; len >= 8; buf += 8, len -= 8) {
+		uint32_t lo = crc ^ _vinf_load32le(buf), hi = _vinf_load32le(buf + 4);
+		crc = _vinf_crc_table[7][lo & 0xff] ^ _vinf_crc_table[6][lo >> 8 & 0xff]
+			^ _vinf_crc_table[5][lo >> 16 & 0xff] ^ _vinf_crc_table[4][lo >> 24]
+			^ _vinf_crc_table[3][hi & 0xff] ^ _vinf_crc_table[2][hi >> 8 & 0xff]
+			^ _vinf_crc_table[1][hi >> 16 & 0xff] ^ _vinf_crc_table[0][hi >> 24];
+	}
+	while (len--) {
+		crc = _vinf_crc_table[0][(crc ^ *buf++) & 0xff] ^ crc >> 8;
+	}
+	return crc;
+}
+
+#ifdef _VINF_X86
+// Folds 64 bytes at a time with carry-less multiplication, as described in
+// Intel's "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ
+// Instruction". Operates on the inverted CRC. len must be a multiple of 16,
+// and at least 64
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t _vinf_crc32_clmul(uint32_t crc, const unsigned char *buf, size_t len) {
+	// Bit-reflected fold constants (x^(4*128+32), x^(4*128-32), etc. mod P) and
+	// the Barrett reduction constants, from the end of the paper
+	const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+	const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+	const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124);
+	const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+	const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+#define _vinf_fold(x, k, y) _mm_xor_si128( \
+		_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00), _mm_clmulepi64_si128(x, k, 0x11)), \
+		(y))
+
+	__m128i x0 = _mm_loadu_si128((const __m128i *)buf);
+	__m128i x1 = _mm_loadu_si128((const __m128i *)(buf + 16));
+	__m128i x2 = _mm_loadu_si128((const __m128i *)(buf + 32));
+	__m128i x3 = _mm_loadu_si128((const __m128i *)(buf + 48));
+	x0 = _mm_xor_si128(x0, _mm_cvtsi32_si128(crc));
+	buf += 64;
+	len -= 64;
+
+	// Fold four lanes in parallel
+	for (; len >= 64; buf += 64, len -= 64) {
+		x0 = _vinf_fold(x0, k1k2, _mm_loadu_si128((const __m128i *)buf));
+		x1 = _vinf_fold(x1, k1k2, _mm_loadu_si128((const __m128i *)(buf + 16)));
+		x2 = _vinf_fold(x2, k1k2, _mm_loadu_si128((const __m128i *)(buf + 32)));
+		x3 = _vinf_fold(x3, k1k2, _mm_loadu_si128((const __m128i *)(buf + 48)));
 	}
 
+	// Fold the lanes into one, then the remaining 16-byte blocks into that
+	x0 = _vinf_fold(x0, k3k4, x1);
+	x0 = _vinf_fold(x0, k3k4, x2);
+	x0 = _vinf_fold(x0, k3k4, x3);
+	for (; len >= 16; buf += 16, len -= 16) {
+		x0 = _vinf_fold(x0, k3k4, _mm_loadu_si128((const __m128i *)buf));
+	}
+
+#undef _vinf_fold
+
+	// Reduce 128 bits to 64
+	x1 = _mm_clmulepi64_si128(x0, k3k4, 0x10);
+	x0 = _mm_xor_si128(_mm_srli_si128(x0, 8), x1);
+	x1 = _mm_srli_si128(x0, 4);
+	x0 = _mm_clmulepi64_si128(_mm_and_si128(x0, mask32), k5k0, 0x00);
+	x0 = _mm_xor_si128(x0, x1);
+
+	// Barrett reduction to 32 bits
+	x1 = _mm_clmulepi64_si128(_mm_and_si128(x0, mask32), poly, 0x10);
+	x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), poly, 0x00);
+	x0 = _mm_xor_si128(x0, x1);
+	return _mm_extract_epi32(x0, 1);
+}
+
+static _Bool _vinf_have_clmul(void) {
+	return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+}
+#endif
+
+uint32_t vinf_crc32_buf(uint32_t crc, const unsigned char *buf, size_t len) {
 	crc = ~crc;
-	uint8_t idx = crc ^ byt;
-	crc >>= 8;
-	crc ^= table[idx];
+#ifdef _VINF_X86
+	if (len >= 64 && _vinf_have_clmul()) {
+		size_t n = len & ~(size_t)15;
+		crc = _vinf_crc32_clmul(crc, buf, n);
+		buf += n;
+		len -= n;
+	}
+#endif
+	crc = _vinf_crc32_slice8(crc, buf, len);
 	return ~crc;
 }
 
-uint32_t vinf_crc32_buf(unsigned char *buf, size_t len) {
-	uint32_t crc = 0;
-	while (len--) crc = vinf_crc32(crc, *buf++);
-	return crc;
+// Multiply two polynomials modulo the CRC polynomial. Bit 31 is x^0
+static uint32_t _vinf_crc32_mulmod(uint32_t a, uint32_t b) {
+	uint32_t prod = 0;
+	for (uint32_t m = 1u << 31; m; m >>= 1) {
+		if (a & m) prod ^= b;
+		b = b & 1 ? b >> 1 ^ 0xEDB88320 : b >> 1;
+	}
+	return prod;
 }
 
+uint32_t vinf_crc32_combine(uint32_t crc1, uint32_t crc2, uint64_t len2) {
+	// Appending len2 bytes multiplies crc1 by x^(8*len2). Compute that power
+	// by squaring, starting from x^8
+	uint32_t xn = 1u << 31, sq = 1u << 23;
+	for (; len2; len2 >>= 1) {
+		if (len2 & 1) xn = _vinf_crc32_mulmod(xn, sq);
+		sq = _vinf_crc32_mulmod(sq, sq);
+	}
+	return _vinf_crc32_mulmod(xn, crc1) ^ crc2;
+}
+// }}}
+
+// Adler-32 {{{
+enum {
+	_vinf_ADLER_MOD = 65521,
+	// Largest n such that 255n(n+1)/2 + (n+1)(MOD-1) fits in 32 bits, so the
+	// sums need only be reduced once every this many bytes
+	_vinf_ADLER_NMAX = 5552,
+};
+
+#ifdef _VINF_X86
+// Each of these adds a block of len bytes to the sums, where len is a multiple
+// of the vector width and at most _vinf_ADLER_NMAX. The byte at index i
+// contributes to s2 with weight len - i. Per vector, the bytes are summed into
+// v_s1 and their weighted sum within the vector into v_s2, and v_ps tracks the
+// value of v_s1 before each vector, which covers the weight of the vectors
+// that follow
+static void _vinf_adler32_sse2(uint32_t *s1, uint32_t *s2, const unsigned char *buf, size_t len) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i w_lo = _mm_setr_epi16(16, 15, 14, 13, 12, 11, 10, 9);
+	const __m128i w_hi = _mm_setr_epi16(8, 7, 6, 5, 4, 3, 2, 1);
+	__m128i v_s1 = zero, v_s2 = zero, v_ps = zero;
+
+	for (size_t i = 0; i < len; i += 16) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(buf + i));
+		v_ps = _mm_add_epi32(v_ps, v_s1);
+		v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(x, zero));
+		v_s2 = _mm_add_epi32(v_s2, _mm_madd_epi16(_mm_unpacklo_epi8(x, zero), w_lo));
+		v_s2 = _mm_add_epi32(v_s2, _mm_madd_epi16(_mm_unpackhi_epi8(x, zero), w_hi));
+	}
+
+	uint32_t a[4], b[4], c[4];
+	_mm_storeu_si128((__m128i *)a, v_s1);
+	_mm_storeu_si128((__m128i *)b, v_s2);
+	_mm_storeu_si128((__m128i *)c, v_ps);
+	uint64_t sum = (uint64_t)a[0] + a[2];
+	uint64_t wsum = (uint64_t)b[0] + b[1] + b[2] + b[3] + 16 * ((uint64_t)c[0] + c[2]);
+
+	*s2 = (*s2 + len * (uint64_t)*s1 + wsum) % _vinf_ADLER_MOD;
+	*s1 = (*s1 + sum) % _vinf_ADLER_MOD;
+}
+
+__attribute__((target("avx2")))
+static void _vinf_adler32_avx2(uint32_t *s1, uint32_t *s2, const unsigned char *buf, size_t len) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i ones = _mm256_set1_epi16(1);
+	const __m256i w = _mm256_setr_epi8(
+		32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17,
+		16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+	__m256i v_s1 = zero, v_s2 = zero, v_ps = zero;
+
+	for (size_t i = 0; i < len; i += 32) {
+		__m256i x = _mm256_loadu_si256((const __m256i *)(buf + i));
+		v_ps = _mm256_add_epi32(v_ps, v_s1);
+		v_s1 = _mm256_add_epi32(v_s1, _mm256_sad_epu8(x, zero));
+		v_s2 = _mm256_add_epi32(v_s2, _mm256_madd_epi16(_mm256_maddubs_epi16(x, w), ones));
+	}
+
+	uint32_t a[8], b[8], c[8];
+	_mm256_storeu_si256((__m256i *)a, v_s1);
+	_mm256_storeu_si256((__m256i *)b, v_s2);
+	_mm256_storeu_si256((__m256i *)c, v_ps);
+	uint64_t sum = 0, wsum = 0, ps = 0;
+	for (int i = 0; i < 8; i++) {
+		sum += a[i];
+		wsum += b[i];
+		ps += c[i];
+	}
+	wsum += 32 * ps;
+
+	*s2 = (*s2 + len * (uint64_t)*s1 + wsum) % _vinf_ADLER_MOD;
+	*s1 = (*s1 + sum) % _vinf_ADLER_MOD;
+}
+
+static _Bool _vinf_have_avx2(void) {
+	return __builtin_cpu_supports("avx2");
+}
+#endif
+
+uint32_t vinf_adler32(uint32_t adler, const unsigned char *buf, size_t len) {
+	uint32_t s1 = adler & 0xffff, s2 = adler >> 16;
+
+#ifdef _VINF_X86
+	if (len >= 64) {
+		void (*kernel)(uint32_t *, uint32_t *, const unsigned char *, size_t) =
+			_vinf_have_avx2() ? _vinf_adler32_avx2 : _vinf_adler32_sse2;
+		while (len >= 64) {
+			// NMAX rounded down to a multiple of 32
+			size_t n = len < 5536 ? len & ~(size_t)31 : 5536;
+			kernel(&s1, &s2, buf, n);
+			buf += n;
+			len -= n;
+		}
+	}
+#endif
+
+	while (len) {
+		size_t n = len < _vinf_ADLER_NMAX ? len : _vinf_ADLER_NMAX;
+		len -= n;
+		while (n--) {
+			s1 += *buf++;
+			s2 += s1;
+		}
+		s1 %= _vinf_ADLER_MOD;
+		s2 %= _vinf_ADLER_MOD;
+	}
+	return s2 << 16 | s1;
+}
+// }}}
+
 #endif
@@ -30,6 +30,8 @@
 #define VJSON_H
 
 #include <stddef.h>
+#include <stdint.h>
+#include "varena.h"
 
 enum vjson_type {
 	VJSON_ERROR,
@@ -59,28 +61,1504 @@ enum vjson_type vjson_object(const char **src, const char *end);
 const char *vjson_enter(const char *src);
 
 long double vjson_get_number(const char *src);
+// The integer functions return 1 if the number is an integer that fits in the
+// type. Otherwise, the value is truncated towards zero and saturated.
+// vjson_get_double returns 1 if the number has no fraction or exponent
+_Bool vjson_get_i64(const char *src, int64_t *val);
+_Bool vjson_get_u64(const char *src, uint64_t *val);
+_Bool vjson_get_double(const char *src, double *val);
 _Bool vjson_get_bool(const char *src);
 char *vjson_get_string(const char *src);
 // Get the number of items in an array or object
 size_t vjson_get_size(const char *src);
 
+// String views {{{
+// A view of the contents of a string, between the quotes. If escaped is set,
+// the string contains escape sequences and must be unescaped before use.
+// Unescaping never makes a string longer, so len bytes is always enough space.
+struct vjson_view {
+	const char *s;
+	size_t len;
+	_Bool escaped;
+};
+
+struct vjson_view vjson_get_view(const char *src);
+// Unescape a view into buf, which must be at least view.len bytes, and return
+// the unescaped length. The result is not nul-terminated
+size_t vjson_unescape(struct vjson_view view, char *buf);
+// Get the contents of a string, pointing into the source if it has no escapes
+// and unescaped into the arena otherwise. The result is not nul-terminated
+const char *vjson_get_astring(const char *src, struct varena **arena, size_t *len);
+// Compare a string with a nul-terminated key, without unescaping it
+_Bool vjson_key_eq(const char *src, const char *key);
+// }}}
+
+// Structural index {{{
+// vjson_index_build finds the structural characters of a document in a single
+// pass, classifying 64 bytes at a time with SSE2 or AVX2 where available.
+// These are brackets, colons and commas outside strings, and the first byte
+// of each string and scalar. Their offsets are stored in pos, followed by the
+// document's length. Documents must be smaller than 4GiB.
+//
+// vjson_array and vjson_object use the same classification to skip over
+// arrays and objects, rather than stepping through them byte by byte.
+struct vjson_index {
+	const char *src;
+	size_t len;
+	size_t n; // Number of structurals, not counting the final length
+	uint32_t *pos;
+};
+
+// Returns 0 on success, or -1 if a string is unterminated or memory runs out
+int vjson_index_build(struct vjson_index *idx, const char *src, const char *end);
+void vjson_index_free(struct vjson_index *idx);
+// }}}
+
+// Tape {{{
+// vjson_tape_parse parses a whole document in one pass over its structural
+// index, into a flat array of nodes allocated from an arena. Each node stores
+// the size of its subtree, so moving to the next sibling never re-scans the
+// source, and a container's size is known without visiting its items.
+//
+// The items of an array are its child nodes. The members of an object are
+// pairs of nodes: a key string followed by its value. Documents containing a
+// sequence of values produce a sequence of top-level nodes.
+struct vjson_node {
+	uint8_t type; // enum vjson_type
+	_Bool last; // Last item in its container, or last top-level value
+	uint32_t off, len; // Span of the value in the source
+	uint32_t size; // Number of items in an array, or members in an object
+	uint32_t skip; // Number of nodes in this value, including its children
+};
+
+struct vjson_tape {
+	const char *src;
+	size_t n;
+	struct vjson_node *nodes;
+};
+
+// Returns 0 on success, or -1 on a syntax error or if memory runs out
+int vjson_tape_parse(struct vjson_tape *tape, struct varena **arena, const char *src, const char *end);
+
+// Get the first top-level value, or NULL if the document is empty
+const struct vjson_node *vjson_tape_root(const struct vjson_tape *tape);
+// Get a pointer to the source of a node, for use with the vjson_get_* functions
+const char *vjson_node_src(const struct vjson_tape *tape, const struct vjson_node *node);
+// Get a view of a string node. This uses the node's length rather than
+// searching for the closing quote
+struct vjson_view vjson_node_view(const struct vjson_tape *tape, const struct vjson_node *node);
+
+// Get the first item of an array or key of an object, or NULL if empty
+const struct vjson_node *vjson_node_child(const struct vjson_node *node);
+// Get the next item in the same container, or NULL if this is the last one.
+// The next node after an object key is its value
+const struct vjson_node *vjson_node_next(const struct vjson_node *node);
+// Get the number of items in an array or object
+size_t vjson_node_size(const struct vjson_node *node);
+// Get the item at index i in an array, or the key at index i in an object.
+// This is constant time if the items are all scalars, and otherwise steps
+// through the previous siblings
+const struct vjson_node *vjson_node_at(const struct vjson_node *node, size_t i);
+// }}}
+
+// Incremental parsing {{{
+// A push parser accepts a document in chunks of any size, such as those read
+// from a socket or a decompressor, and reports its contents as events. Only
+// the bytes of a token split between chunks are kept.
+#ifndef VJSON_MAX_DEPTH
+#define VJSON_MAX_DEPTH 1024
+#endif
+
+enum vjson_event {
+	VJSON_EV_START, // Start of an array or object
+	VJSON_EV_END, // End of an array or object
+	VJSON_EV_KEY, // Object key
+	VJSON_EV_SCALAR, // Number, bool, null or string
+};
+
+// Receives events from a push parser. type is the type of the value, or
+// VJSON_STRING for keys. tok is the source of the token, which can be passed
+// to the vjson_get_* functions and is only valid until the handler returns.
+// Returning nonzero stops parsing
+struct vjson_handler {
+	int (*event)(void *ctx, enum vjson_event ev, enum vjson_type type, const char *tok, size_t len);
+	void *ctx;
+};
+
+struct vjson_push {
+	struct vjson_handler handler;
+	uint64_t offset; // Number of bytes parsed, or the offset of an error
+
+	// Internal state
+	int err;
+	uint8_t state, tok;
+	_Bool esc; // The next byte of a split string is escaped
+	size_t depth;
+	uint64_t stack[(VJSON_MAX_DEPTH + 63) / 64]; // Set bits are objects
+	char *buf; // The start of a split token
+	size_t buf_len, buf_cap;
+};
+
+void vjson_push_init(struct vjson_push *p, struct vjson_handler handler);
+// Parse the next chunk of a document. Returns 0 on success, -1 on a syntax
+// error or if memory runs out, or the value returned by the handler if it
+// stopped parsing. Once parsing has stopped, all further calls fail the same
+// way
+int vjson_push(struct vjson_push *p, const char *data, size_t len);
+// Finish parsing, checking that the document is complete
+int vjson_push_end(struct vjson_push *p);
+void vjson_push_free(struct vjson_push *p);
+// }}}
+
+// NDJSON {{{
+// vjson_ndjson calls a function for each record of newline-delimited JSON,
+// using up to nthreads threads including the caller. The input is split into
+// chunks ending at newlines, which are handed out to the threads in turn.
+// Blank lines are skipped. Parallelism requires C11 threads, and is disabled
+// without them.
+//
+// Each record can produce a result, which is sent through a channel such as
+// a vch from vchannel.h, either as soon as it is produced or in the order of
+// the records. The channel must be drained by another thread. When every
+// record has been processed, NULL is sent. Results need threads, and are not
+// sent without them.
+struct vch;
+
+struct vjson_record {
+	const char *src, *end; // The record, without its line ending
+	uint64_t offset; // Offset of the record in the input
+	unsigned thread; // Index of the thread processing the record
+	struct varena **arena; // Scratch space for this thread, freed after each chunk
+	void *result; // Set to send a result to the channel
+};
+
+struct vjson_ndjson {
+	// Called for each record. Returns nonzero to stop processing. Records
+	// being processed by other threads are still completed
+	int (*record)(void *ctx, struct vjson_record *rec);
+	void *ctx;
+
+	unsigned nthreads;
+	size_t chunk_size; // Defaults to 1MiB
+	struct vch *results; // Results are only sent if this is set
+	void (*send)(struct vch *ch, void *item); // Usually vch_send
+	_Bool ordered; // Send results in the order of their records
+};
+
+// Returns 0 on success, -1 if memory runs out, or the first nonzero value
+// returned by the record function
+int vjson_ndjson(const char *src, const char *end, const struct vjson_ndjson *opts);
+#if defined(_POSIX_C_SOURCE) && _POSIX_C_SOURCE >= 200112L
+// Map a file and process it. Returns -1 if it can't be opened
+int vjson_ndjson_file(const char *fn, const struct vjson_ndjson *opts);
+#endif
+// }}}
+
+// Path queries {{{
+// A query finds the values at a set of paths in a single pass over a
+// document. Keys are compared directly with the source, and values that
+// can't match any path are skipped with the structural classifier, without
+// parsing them.
+//
+// Paths are written like "$.user.id" or "items[*].price". Each step is one of:
+//   .key    A member of an object. The first step may leave out the dot if
+//           there is no $
+//   .*      Every member of an object
+//   [n]     An item of an array
+//   [*]     Every item of an array
+// The leading $ is optional, and "$" alone matches the whole document.
+struct vjson_query;
+
+// Compile a set of paths. Returns NULL if a path is invalid or memory runs out
+struct vjson_query *vjson_query_new(const char *const *paths, size_t npaths);
+void vjson_query_free(struct vjson_query *q);
+
+// Called for each value matching a path, with the index of the path. val is
+// the source of the value, for use with the vjson_get_* functions, and len
+// its length. Values inside a matching value are reported before it. Returns
+// nonzero to stop
+typedef int (*vjson_match_fn)(void *ctx, size_t path, const char *val, size_t len);
+
+// Run a query over each value in a document. Returns 0 on success, -1 on a
+// syntax error, or the value returned by match if it stopped the query.
+// Values that are skipped are only checked for balanced brackets
+int vjson_query(const struct vjson_query *q, const char *src, const char *end, vjson_match_fn match, void *ctx);
+// }}}
+
+// Writer {{{
+// A writer formats JSON into a buffer. The buffer is either allocated and
+// grown as needed, or provided by the caller. If fd is not negative, the
+// buffer is written to it whenever it fills up and when the writer is
+// flushed; otherwise, a caller-provided buffer that fills up is an error.
+// Files can only be written on Unix-like systems.
+//
+// Compact output is the default. Setting indent to a string such as "  "
+// puts each item on its own line, indented by one copy per level of nesting.
+// Top-level values are separated by newlines.
+//
+// Strings are escaped as JSON requires, and checked 16 bytes at a time with
+// SSE2 where available. Doubles are written with the Grisu2 algorithm, which
+// gives the shortest representation that reads back exactly in almost every
+// case, and always one that reads back exactly. They always have a decimal
+// point or exponent, so they can be told apart from integers. Infinities and
+// NaN are written as null.
+struct vjson_writer {
+	char *buf;
+	size_t len, cap;
+	int fd;
+	const char *indent; // Pretty-print if set
+	int err; // Set after any error, which makes all further writes fail
+
+	// Internal state
+	_Bool alloc; // buf is allocated by the writer
+	_Bool first; // Nothing has been written at the current level yet
+	_Bool key; // A key has been written, and not its value
+	size_t depth;
+	uint64_t stack[(VJSON_MAX_DEPTH + 63) / 64]; // Set bits are objects
+};
+
+// If buf is NULL, a buffer of cap bytes is allocated, which is grown as needed
+// unless fd is set. A cap of 0 picks a default size for files
+void vjson_writer_init(struct vjson_writer *w, char *buf, size_t cap, int fd);
+// Write the buffered output to the file, if there is one
+int vjson_writer_flush(struct vjson_writer *w);
+void vjson_writer_free(struct vjson_writer *w);
+
+// These return 0 on success, or -1 on error
+int vjson_write_null(struct vjson_writer *w);
+int vjson_write_bool(struct vjson_writer *w, _Bool val);
+int vjson_write_i64(struct vjson_writer *w, int64_t val);
+int vjson_write_u64(struct vjson_writer *w, uint64_t val);
+int vjson_write_double(struct vjson_writer *w, double val);
+int vjson_write_string(struct vjson_writer *w, const char *s, size_t len);
+int vjson_write_key(struct vjson_writer *w, const char *s, size_t len);
+int vjson_write_array(struct vjson_writer *w);
+int vjson_write_object(struct vjson_writer *w);
+// End the innermost array or object
+int vjson_write_end(struct vjson_writer *w);
+// }}}
+
+// Struct binding {{{
+// A schema describes how the members of an object are stored in a struct. It
+// is declared from a list of fields, each giving the struct type, the member,
+// and its kind:
+//
+//	#define POINT_FIELDS(X) X(struct point, x, DOUBLE) X(struct point, label, STRING)
+//	VJSON_SCHEMA(point_schema, POINT_FIELDS);
+//
+// The key for each member is its name. Members of kind OBJECT(schema) are
+// structs, bound using another schema.
+enum vjson_kind {
+	VJSON_K_BOOL, // _Bool
+	VJSON_K_INT, // int
+	VJSON_K_I64, // int64_t
+	VJSON_K_U64, // uint64_t
+	VJSON_K_DOUBLE, // double
+	VJSON_K_STRING, // char *, nul-terminated
+	VJSON_K_OBJECT, // struct
+};
+
+struct vjson_field {
+	const char *name;
+	size_t len, offset;
+	enum vjson_kind kind;
+	const struct vjson_schema *schema; // For VJSON_K_OBJECT
+};
+
+struct vjson_schema {
+	size_t nfields;
+	const struct vjson_field *fields;
+};
+
+#define VJSON_FIELD(type, member, kind) {#member, sizeof #member - 1, offsetof(type, member), _vjson_K_##kind},
+#define VJSON_SCHEMA(name, fields) \
+	static const struct vjson_field name##_fields[] = {fields(VJSON_FIELD)}; \
+	static const struct vjson_schema name = {sizeof name##_fields / sizeof *name##_fields, name##_fields}
+
+#define _vjson_K_BOOL VJSON_K_BOOL, NULL
+#define _vjson_K_INT VJSON_K_INT, NULL
+#define _vjson_K_I64 VJSON_K_I64, NULL
+#define _vjson_K_U64 VJSON_K_U64, NULL
+#define _vjson_K_DOUBLE VJSON_K_DOUBLE, NULL
+#define _vjson_K_STRING VJSON_K_STRING, NULL
+#define _vjson_K_OBJECT(schema) VJSON_K_OBJECT, &(schema)
+
+// Bind the object at *src to the struct at out, and move past it. Members that
+// are missing or null are left unchanged, and unknown keys are skipped. Strings
+// are copied into the arena. Numbers must fit the member exactly.
+// Returns 0 on success, or -1 on error, which may leave out partly filled.
+// Values that are skipped are only checked for balanced brackets
+int vjson_bind(const struct vjson_schema *schema, void *out, const char **src, const char *end, struct varena **arena);
+// }}}
+
 #endif
 
 #ifdef VJSON_IMPL
 #undef VJSON_IMPL
 
+#include <float.h>
+#include <limits.h>
+#include <locale.h>
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(_POSIX_C_SOURCE) && _POSIX_C_SOURCE >= 200112L
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <errno.h>
+#include <unistd.h>
+#endif
+
+#if __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_THREADS__) && !defined(__STDC_NO_ATOMICS__)
+#define _VJSON_THREADS
+#include <stdatomic.h>
+#include <threads.h>
+#endif
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define _VJSON_X86
+#include <immintrin.h>
+#endif
+
+static inline _Bool _vjson_is_space(char c) {
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static inline const char *_vjson_skip_space(const char *src) {
+	while (_vjson_is_space(*src)) src++;
+	return src;
+}
+
 static inline void _vjson_whitespace(const char **src, const char *end) {
-	while (*src < end && strchr(" \t\n", **src)) {
+	while (*src < end && _vjson_is_space(**src)) {
 		++*src;
 	}
 }
 
+// Stage 1 {{{
+// Documents are classified in blocks of 64 bytes, with one bit per byte in
+// each mask. This follows simdjson: escaped characters are found from runs of
+// backslashes, then the bytes inside strings from a prefix XOR of the
+// remaining quotes, which masks out brackets and separators inside strings.
+struct _vjson_masks {
+	uint64_t quote, backslash, space;
+	uint64_t open, close, sep; // [{, ]} and :,
+};
+
+// State carried from one block to the next
+struct _vjson_scanner {
+	uint64_t escaped; // 1 if the first byte of the next block is escaped
+	uint64_t string; // All ones if the next block starts inside a string
+	uint64_t scalar; // 1 if the last block ended in a scalar
+};
+
+struct _vjson_block {
+	uint64_t string; // Inside a string, including the opening quote but not the closing one
+	uint64_t open, close, sep; // Outside strings
+	uint64_t structural;
+};
+
+static inline unsigned _vjson_popcount(uint64_t x) {
+#ifdef __GNUC__
+	return __builtin_popcountll(x);
+#else
+	unsigned n = 0;
+	for (; x; x &= x - 1) n++;
+	return n;
+#endif
+}
+
+static inline unsigned _vjson_ctz(uint64_t x) {
+#ifdef __GNUC__
+	return __builtin_ctzll(x);
+#else
+	unsigned n = 0;
+	for (; !(x & 1); x >>= 1) n++;
+	return n;
+#endif
+}
+
+static inline uint64_t _vjson_prefix_xor(uint64_t x) {
+	x ^= x << 1;
+	x ^= x << 2;
+	x ^= x << 4;
+	x ^= x << 8;
+	x ^= x << 16;
+	x ^= x << 32;
+	return x;
+}
+
+enum {
+	_vjson_C_QUOTE = 1<<0,
+	_vjson_C_BACKSLASH = 1<<1,
+	_vjson_C_SPACE = 1<<2,
+	_vjson_C_OPEN = 1<<3,
+	_vjson_C_CLOSE = 1<<4,
+	_vjson_C_SEP = 1<<5,
+};
+
+static const unsigned char _vjson_class[256] = {
+	['"'] = _vjson_C_QUOTE,
+	['\\'] = _vjson_C_BACKSLASH,
+	[' '] = _vjson_C_SPACE, ['\t'] = _vjson_C_SPACE, ['\n'] = _vjson_C_SPACE, ['\r'] = _vjson_C_SPACE,
+	['['] = _vjson_C_OPEN, ['{'] = _vjson_C_OPEN,
+	[']'] = _vjson_C_CLOSE, ['}'] = _vjson_C_CLOSE,
+	[':'] = _vjson_C_SEP, [','] = _vjson_C_SEP,
+};
+
+#ifndef _VJSON_X86
+static void _vjson_classify_scalar(const char *p, struct _vjson_masks *m) {
+	*m = (struct _vjson_masks){0};
+	for (unsigned i = 0; i < 64; i++) {
+		unsigned c = _vjson_class[(unsigned char)p[i]];
+		m->quote |= (uint64_t)(c & 1) << i;
+		m->backslash |= (uint64_t)(c >> 1 & 1) << i;
+		m->space |= (uint64_t)(c >> 2 & 1) << i;
+		m->open |= (uint64_t)(c >> 3 & 1) << i;
+		m->close |= (uint64_t)(c >> 4 & 1) << i;
+		m->sep |= (uint64_t)(c >> 5 & 1) << i;
+	}
+}
+#else
+// Brackets are compared with the 0x20 bit set, which maps [ to { and ] to }
+#define _vjson_eq(v, c) _mm_cmpeq_epi8(v, _mm_set1_epi8(c))
+#define _vjson_eq256(v, c) _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c))
+
+static void _vjson_classify_sse2(const char *p, struct _vjson_masks *m) {
+	*m = (struct _vjson_masks){0};
+	for (unsigned i = 0; i < 64; i += 16) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(p + i));
+		__m128i lx = _mm_or_si128(x, _mm_set1_epi8(0x20));
+		__m128i space = _mm_or_si128(_mm_or_si128(_vjson_eq(x, ' '), _vjson_eq(x, '\t')),
+			_mm_or_si128(_vjson_eq(x, '\n'), _vjson_eq(x, '\r')));
+#define _vjson_mask(v) ((uint64_t)(uint16_t)_mm_movemask_epi8(v) << i)
+		m->quote |= _vjson_mask(_vjson_eq(x, '"'));
+		m->backslash |= _vjson_mask(_vjson_eq(x, '\\'));
+		m->space |= _vjson_mask(space);
+		m->open |= _vjson_mask(_vjson_eq(lx, '{'));
+		m->close |= _vjson_mask(_vjson_eq(lx, '}'));
+		m->sep |= _vjson_mask(_mm_or_si128(_vjson_eq(x, ':'), _vjson_eq(x, ',')));
+#undef _vjson_mask
+	}
+}
+
+__attribute__((target("avx2")))
+static void _vjson_classify_avx2(const char *p, struct _vjson_masks *m) {
+	*m = (struct _vjson_masks){0};
+	for (unsigned i = 0; i < 64; i += 32) {
+		__m256i x = _mm256_loadu_si256((const __m256i *)(p + i));
+		__m256i lx = _mm256_or_si256(x, _mm256_set1_epi8(0x20));
+		__m256i space = _mm256_or_si256(_mm256_or_si256(_vjson_eq256(x, ' '), _vjson_eq256(x, '\t')),
+			_mm256_or_si256(_vjson_eq256(x, '\n'), _vjson_eq256(x, '\r')));
+#define _vjson_mask(v) ((uint64_t)(uint32_t)_mm256_movemask_epi8(v) << i)
+		m->quote |= _vjson_mask(_vjson_eq256(x, '"'));
+		m->backslash |= _vjson_mask(_vjson_eq256(x, '\\'));
+		m->space |= _vjson_mask(space);
+		m->open |= _vjson_mask(_vjson_eq256(lx, '{'));
+		m->close |= _vjson_mask(_vjson_eq256(lx, '}'));
+		m->sep |= _vjson_mask(_mm256_or_si256(_vjson_eq256(x, ':'), _vjson_eq256(x, ',')));
+#undef _vjson_mask
+	}
+}
+
+#undef _vjson_eq
+#undef _vjson_eq256
+
+static _Bool _vjson_have_avx2(void) {
+	return __builtin_cpu_supports("avx2");
+}
+#endif
+
+typedef void (*_vjson_classify_fn)(const char *p, struct _vjson_masks *m);
+
+static _vjson_classify_fn _vjson_classifier(void) {
+#ifdef _VJSON_X86
+	return _vjson_have_avx2() ? _vjson_classify_avx2 : _vjson_classify_sse2;
+#else
+	return _vjson_classify_scalar;
+#endif
+}
+
+// Classify the block at p, which may be cut short by end. The missing bytes
+// are treated as whitespace
+static inline void _vjson_load_block(_vjson_classify_fn classify, const char *p, const char *end, struct _vjson_masks *m) {
+	if (end - p >= 64) {
+		classify(p, m);
+	} else {
+		char buf[64];
+		memset(buf, ' ', sizeof buf);
+		memcpy(buf, p, end - p);
+		classify(buf, m);
+	}
+}
+
+static inline void _vjson_scan(struct _vjson_scanner *s, const struct _vjson_masks *m, struct _vjson_block *b) {
+	// Backslashes that are themselves escaped don't escape anything. A run of
+	// backslashes escapes the byte after it if it has odd length, which is
+	// found by adding the start of each run to it and seeing where the carry
+	// lands, separately for runs starting on odd and even bits
+	const uint64_t even = 0x5555555555555555;
+	uint64_t bs = m->backslash & ~s->escaped;
+	uint64_t follows = bs << 1 | s->escaped;
+	uint64_t odd_starts = bs & ~even & ~follows;
+	uint64_t even_seqs = odd_starts + bs;
+	s->escaped = even_seqs < bs;
+	uint64_t escaped = (even ^ even_seqs << 1) & follows;
+
+	uint64_t quote = m->quote & ~escaped;
+	uint64_t string = _vjson_prefix_xor(quote) ^ s->string;
+	s->string = 0 - (string >> 63);
+
+	uint64_t op = m->open | m->close | m->sep;
+	b->string = string;
+	b->open = m->open & ~string;
+	b->close = m->close & ~string;
+	b->sep = m->sep & ~string;
+
+	// Scalars start at any non-whitespace byte that doesn't follow another,
+	// not counting quotes, so each string starts at its opening quote. The
+	// contents and closing quotes of strings are then removed
+	uint64_t scalar = ~(op | m->space);
+	uint64_t nonquote = scalar & ~quote;
+	uint64_t start = scalar & ~(nonquote << 1 | s->scalar);
+	s->scalar = nonquote >> 63;
+	b->structural = (op | start) & ~(string ^ quote);
+}
+
+// Find the end of the array or object starting at src
+static const char *_vjson_skip_container(const char *src, const char *end) {
+	_vjson_classify_fn classify = _vjson_classifier();
+	struct _vjson_scanner s = {0};
+	size_t depth = 0;
+	for (const char *p = src; p < end; p += 64) {
+		struct _vjson_masks m;
+		struct _vjson_block b;
+		_vjson_load_block(classify, p, end, &m);
+		_vjson_scan(&s, &m, &b);
+
+		// The depth can only reach zero in this block if it has enough closing brackets
+		if (_vjson_popcount(b.close) < depth) {
+			depth += _vjson_popcount(b.open);
+			depth -= _vjson_popcount(b.close);
+			continue;
+		}
+
+		for (uint64_t bits = b.open | b.close; bits; bits &= bits - 1) {
+			unsigned i = _vjson_ctz(bits);
+			if (b.open >> i & 1) {
+				depth++;
+			} else if (!--depth) {
+				return p + i + 1;
+			}
+		}
+	}
+	return NULL;
+}
+
+int vjson_index_build(struct vjson_index *idx, const char *src, const char *end) {
+	size_t len = end - src;
+	*idx = (struct vjson_index){.src = src, .len = len};
+	if (len >= UINT32_MAX) return -1;
+
+	_vjson_classify_fn classify = _vjson_classifier();
+	struct _vjson_scanner s = {0};
+	size_t cap = 0;
+	for (size_t off = 0; off < len; off += 64) {
+		if (cap - idx->n < 64) {
+			cap = cap ? 2*cap : len / 4 + 64;
+			uint32_t *pos = realloc(idx->pos, (cap + 1) * sizeof *pos);
+			if (!pos) goto error;
+			idx->pos = pos;
+		}
+
+		struct _vjson_masks m;
+		struct _vjson_block b;
+		_vjson_load_block(classify, src + off, end, &m);
+		_vjson_scan(&s, &m, &b);
+		for (uint64_t bits = b.structural; bits; bits &= bits - 1) {
+			idx->pos[idx->n++] = off + _vjson_ctz(bits);
+		}
+	}
+	if (s.string) goto error;
+
+	if (!idx->pos && !(idx->pos = malloc(sizeof *idx->pos))) goto error;
+	idx->pos[idx->n] = len;
+	return 0;
+
+error:
+	vjson_index_free(idx);
+	return -1;
+}
+
+void vjson_index_free(struct vjson_index *idx) {
+	free(idx->pos);
+	idx->pos = NULL;
+	idx->n = 0;
+}
+// }}}
+
+// Numbers {{{
+// Numbers are scanned according to the JSON grammar, keeping the first 19
+// significant digits as an integer mantissa. Doubles are then converted with
+// the Eisel-Lemire algorithm, as used by fast_float, which is exact unless
+// digits were dropped and the result depends on them. Those rare numbers are
+// passed to strtod.
+struct _vjson_number {
+	uint64_t mantissa; // First 19 significant digits
+	int64_t exp10; // Value is mantissa * 10^exp10
+	uint64_t u; // Integer value, if integral and not overflowed
+	_Bool negative, integral, truncated, overflow;
+};
+
+static inline _Bool _vjson_digit(const char *p, const char *end) {
+	return (!end || p < end) && (unsigned)(*p - '0') < 10;
+}
+
+// Scan a number, returning a pointer to its end or NULL if it is invalid. end may be NULL
+static const char *_vjson_scan_number(const char *p, const char *end, struct _vjson_number *n) {
+	*n = (struct _vjson_number){.integral = 1};
+	if ((!end || p < end) && *p == '-') {
+		n->negative = 1;
+		p++;
+	}
+	if (!_vjson_digit(p, end)) return NULL;
+
+	// Integer part, with no leading zeros
+	unsigned ndigits = 0;
+	if (*p == '0') {
+		p++;
+	} else {
+		for (; _vjson_digit(p, end); p++) {
+			unsigned d = *p - '0';
+			if (n->u > (UINT64_MAX - d) / 10) n->overflow = 1;
+			n->u = n->u * 10 + d;
+
+			if (ndigits < 19) {
+				n->mantissa = n->mantissa * 10 + d;
+				ndigits++;
+			} else {
+				n->truncated |= d != 0;
+				n->exp10++;
+			}
+		}
+	}
+
+	if ((!end || p < end) && *p == '.') {
+		n->integral = 0;
+		if (!_vjson_digit(++p, end)) return NULL;
+		for (; _vjson_digit(p, end); p++) {
+			unsigned d = *p - '0';
+			if (!ndigits && !d) {
+				// Leading zero
+				n->exp10--;
+			} else if (ndigits < 19) {
+				n->mantissa = n->mantissa * 10 + d;
+				n->exp10--;
+				ndigits++;
+			} else {
+				n->truncated |= d != 0;
+			}
+		}
+	}
+
+	if ((!end || p < end) && (*p | 0x20) == 'e') {
+		n->integral = 0;
+		p++;
+		_Bool negative = 0;
+		if ((!end || p < end) && (*p == '-' || *p == '+')) negative = *p++ == '-';
+		if (!_vjson_digit(p, end)) return NULL;
+
+		// Anything past this is out of range whatever the mantissa
+		int64_t exp = 0;
+		for (; _vjson_digit(p, end); p++) {
+			if (exp < 100000) exp = exp * 10 + (*p - '0');
+		}
+		n->exp10 += negative ? -exp : exp;
+	}
+
+	return p;
+}
+
+static inline uint64_t _vjson_mul128(uint64_t a, uint64_t b, uint64_t *lo) {
+#ifdef __SIZEOF_INT128__
+	__extension__ unsigned __int128 r = (unsigned __int128)a * b;
+	*lo = r;
+	return r >> 64;
+#else
+	uint64_t a0 = (uint32_t)a, a1 = a >> 32;
+	uint64_t b0 = (uint32_t)b, b1 = b >> 32;
+	uint64_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+	uint64_t mid = (p00 >> 32) + (uint32_t)p01 + (uint32_t)p10;
+	*lo = mid << 32 | (uint32_t)p00;
+	return p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+#endif
+}
+
+static inline unsigned _vjson_clz(uint64_t x) {
+#ifdef __GNUC__
+	return __builtin_clzll(x);
+#else
+	unsigned n = 0;
+	for (; !(x >> 63); x <<= 1) n++;
+	return n;
+#endif
+}
+
+// 128-bit approximations of 5^q for q from -342 to 308, normalized so the
+// top bit is set
+static const uint64_t _vjson_pow5[][2] = {
+	{0xeef453d6923bd65a, 0x113faa2906a13b3f},
+	{0x9558b4661b6565f8, 0x4ac7ca59a424c507},
+	{0xbaaee17fa23ebf76, 0x5d79bcf00d2df649},
+	{0xe95a99df8ace6f53, 0xf4d82c2c107973dc},
+	{0x91d8a02bb6c10594, 0x79071b9b8a4be869},
+	{0xb64ec836a47146f9, 0x9748e2826cdee284},
+	{0xe3e27a444d8d98b7, 0xfd1b1b2308169b25},
+	{0x8e6d8c6ab0787f72, 0xfe30f0f5e50e20f7},
+	{0xb208ef855c969f4f, 0xbdbd2d335e51a935},
+	{0xde8b2b66b3bc4723, 0xad2c788035e61382},
+	{0x8b16fb203055ac76, 0x4c3bcb5021afcc31},
+	{0xaddcb9e83c6b1793, 0xdf4abe242a1bbf3d},
+	{0xd953e8624b85dd78, 0xd71d6dad34a2af0d},
+	{0x87d4713d6f33aa6b, 0x8672648c40e5ad68},
+	{0xa9c98d8ccb009506, 0x680efdaf511f18c2},
+	{0xd43bf0effdc0ba48, 0x0212bd1b2566def2},
+	{0x84a57695fe98746d, 0x014bb630f7604b57},
+	{0xa5ced43b7e3e9188, 0x419ea3bd35385e2d},
+	{0xcf42894a5dce35ea, 0x52064cac828675b9},
+	{0x818995ce7aa0e1b2, 0x7343efebd1940993},
+	{0xa1ebfb4219491a1f, 0x1014ebe6c5f90bf8},
+	{0xca66fa129f9b60a6, 0xd41a26e077774ef6},
+	{0xfd00b897478238d0, 0x8920b098955522b4},
+	{0x9e20735e8cb16382, 0x55b46e5f5d5535b0},
+	{0xc5a890362fddbc62, 0xeb2189f734aa831d},
+	{0xf712b443bbd52b7b, 0xa5e9ec7501d523e4},
+	{0x9a6bb0aa55653b2d, 0x47b233c92125366e},
+	{0xc1069cd4eabe89f8, 0x999ec0bb696e840a},
+	{0xf148440a256e2c76, 0xc00670ea43ca250d},
+	{0x96cd2a865764dbca, 0x380406926a5e5728},
+	{0xbc807527ed3e12bc, 0xc605083704f5ecf2},
+	{0xeba09271e88d976b, 0xf7864a44c633682e},
+	{0x93445b8731587ea3, 0x7ab3ee6afbe0211d},
+	{0xb8157268fdae9e4c, 0x5960ea05bad82964},
+	{0xe61acf033d1a45df, 0x6fb92487298e33bd},
+	{0x8fd0c16206306bab, 0xa5d3b6d479f8e056},
+	{0xb3c4f1ba87bc8696, 0x8f48a4899877186c},
+	{0xe0b62e2929aba83c, 0x331acdabfe94de87},
+	{0x8c71dcd9ba0b4925, 0x9ff0c08b7f1d0b14},
+	{0xaf8e5410288e1b6f, 0x07ecf0ae5ee44dd9},
+	{0xdb71e91432b1a24a, 0xc9e82cd9f69d6150},
+	{0x892731ac9faf056e, 0xbe311c083a225cd2},
+	{0xab70fe17c79ac6ca, 0x6dbd630a48aaf406},
+	{0xd64d3d9db981787d, 0x092cbbccdad5b108},
+	{0x85f0468293f0eb4e, 0x25bbf56008c58ea5},
+	{0xa76c582338ed2621, 0xaf2af2b80af6f24e},
+	{0xd1476e2c07286faa, 0x1af5af660db4aee1},
+	{0x82cca4db847945ca, 0x50d98d9fc890ed4d},
+	{0xa37fce126597973c, 0xe50ff107bab528a0},
+	{0xcc5fc196fefd7d0c, 0x1e53ed49a96272c8},
+	{0xff77b1fcbebcdc4f, 0x25e8e89c13bb0f7a},
+	{0x9faacf3df73609b1, 0x77b191618c54e9ac},
+	{0xc795830d75038c1d, 0xd59df5b9ef6a2417},
+	{0xf97ae3d0d2446f25, 0x4b0573286b44ad1d},
+	{0x9becce62836ac577, 0x4ee367f9430aec32},
+	{0xc2e801fb244576d5, 0x229c41f793cda73f},
+	{0xf3a20279ed56d48a, 0x6b43527578c1110f},
+	{0x9845418c345644d6, 0x830a13896b78aaa9},
+	{0xbe5691ef416bd60c, 0x23cc986bc656d553},
+	{0xedec366b11c6cb8f, 0x2cbfbe86b7ec8aa8},
+	{0x94b3a202eb1c3f39, 0x7bf7d71432f3d6a9},
+	{0xb9e08a83a5e34f07, 0xdaf5ccd93fb0cc53},
+	{0xe858ad248f5c22c9, 0xd1b3400f8f9cff68},
+	{0x91376c36d99995be, 0x23100809b9c21fa1},
+	{0xb58547448ffffb2d, 0xabd40a0c2832a78a},
+	{0xe2e69915b3fff9f9, 0x16c90c8f323f516c},
+	{0x8dd01fad907ffc3b, 0xae3da7d97f6792e3},
+	{0xb1442798f49ffb4a, 0x99cd11cfdf41779c},
+	{0xdd95317f31c7fa1d, 0x40405643d711d583},
+	{0x8a7d3eef7f1cfc52, 0x482835ea666b2572},
+	{0xad1c8eab5ee43b66, 0xda3243650005eecf},
+	{0xd863b256369d4a40, 0x90bed43e40076a82},
+	{0x873e4f75e2224e68, 0x5a7744a6e804a291},
+	{0xa90de3535aaae202, 0x711515d0a205cb36},
+	{0xd3515c2831559a83, 0x0d5a5b44ca873e03},
+	{0x8412d9991ed58091, 0xe858790afe9486c2},
+	{0xa5178fff668ae0b6, 0x626e974dbe39a872},
+	{0xce5d73ff402d98e3, 0xfb0a3d212dc8128f},
+	{0x80fa687f881c7f8e, 0x7ce66634bc9d0b99},
+	{0xa139029f6a239f72, 0x1c1fffc1ebc44e80},
+	{0xc987434744ac874e, 0xa327ffb266b56220},
+	{0xfbe9141915d7a922, 0x4bf1ff9f0062baa8},
+	{0x9d71ac8fada6c9b5, 0x6f773fc3603db4a9},
+	{0xc4ce17b399107c22, 0xcb550fb4384d21d3},
+	{0xf6019da07f549b2b, 0x7e2a53a146606a48},
+	{0x99c102844f94e0fb, 0x2eda7444cbfc426d},
+	{0xc0314325637a1939, 0xfa911155fefb5308},
+	{0xf03d93eebc589f88, 0x793555ab7eba27ca},
+	{0x96267c7535b763b5, 0x4bc1558b2f3458de},
+	{0xbbb01b9283253ca2, 0x9eb1aaedfb016f16},
+	{0xea9c227723ee8bcb, 0x465e15a979c1cadc},
+	{0x92a1958a7675175f, 0x0bfacd89ec191ec9},
+	{0xb749faed14125d36, 0xcef980ec671f667b},
+	{0xe51c79a85916f484, 0x82b7e12780e7401a},
+	{0x8f31cc0937ae58d2, 0xd1b2ecb8b0908810},
+	{0xb2fe3f0b8599ef07, 0x861fa7e6dcb4aa15},
+	{0xdfbdcece67006ac9, 0x67a791e093e1d49a},
+	{0x8bd6a141006042bd, 0xe0c8bb2c5c6d24e0},
+	{0xaecc49914078536d, 0x58fae9f773886e18},
+	{0xda7f5bf590966848, 0xaf39a475506a899e},
+	{0x888f99797a5e012d, 0x6d8406c952429603},
+	{0xaab37fd7d8f58178, 0xc8e5087ba6d33b83},
+	{0xd5605fcdcf32e1d6, 0xfb1e4a9a90880a64},
+	{0x855c3be0a17fcd26, 0x5cf2eea09a55067f},
+	{0xa6b34ad8c9dfc06f, 0xf42faa48c0ea481e},
+	{0xd0601d8efc57b08b, 0xf13b94daf124da26},
+	{0x823c12795db6ce57, 0x76c53d08d6b70858},
+	{0xa2cb1717b52481ed, 0x54768c4b0c64ca6e},
+	{0xcb7ddcdda26da268, 0xa9942f5dcf7dfd09},
+	{0xfe5d54150b090b02, 0xd3f93b35435d7c4c},
+	{0x9efa548d26e5a6e1, 0xc47bc5014a1a6daf},
+	{0xc6b8e9b0709f109a, 0x359ab6419ca1091b},
+	{0xf867241c8cc6d4c0, 0xc30163d203c94b62},
+	{0x9b407691d7fc44f8, 0x79e0de63425dcf1d},
+	{0xc21094364dfb5636, 0x985915fc12f542e4},
+	{0xf294b943e17a2bc4, 0x3e6f5b7b17b2939d},
+	{0x979cf3ca6cec5b5a, 0xa705992ceecf9c42},
+	{0xbd8430bd08277231, 0x50c6ff782a838353},
+	{0xece53cec4a314ebd, 0xa4f8bf5635246428},
+	{0x940f4613ae5ed136, 0x871b7795e136be99},
+	{0xb913179899f68584, 0x28e2557b59846e3f},
+	{0xe757dd7ec07426e5, 0x331aeada2fe589cf},
+	{0x9096ea6f3848984f, 0x3ff0d2c85def7621},
+	{0xb4bca50b065abe63, 0x0fed077a756b53a9},
+	{0xe1ebce4dc7f16dfb, 0xd3e8495912c62894},
+	{0x8d3360f09cf6e4bd, 0x64712dd7abbbd95c},
+	{0xb080392cc4349dec, 0xbd8d794d96aacfb3},
+	{0xdca04777f541c567, 0xecf0d7a0fc5583a0},
+	{0x89e42caaf9491b60, 0xf41686c49db57244},
+	{0xac5d37d5b79b6239, 0x311c2875c522ced5},
+	{0xd77485cb25823ac7, 0x7d633293366b828b},
+	{0x86a8d39ef77164bc, 0xae5dff9c02033197},
+	{0xa8530886b54dbdeb, 0xd9f57f830283fdfc},
+	{0xd267caa862a12d66, 0xd072df63c324fd7b},
+	{0x8380dea93da4bc60, 0x4247cb9e59f71e6d},
+	{0xa46116538d0deb78, 0x52d9be85f074e608},
+	{0xcd795be870516656, 0x67902e276c921f8b},
+	{0x806bd9714632dff6, 0x00ba1cd8a3db53b6},
+	{0xa086cfcd97bf97f3, 0x80e8a40eccd228a4},
+	{0xc8a883c0fdaf7df0, 0x6122cd128006b2cd},
+	{0xfad2a4b13d1b5d6c, 0x796b805720085f81},
+	{0x9cc3a6eec6311a63, 0xcbe3303674053bb0},
+	{0xc3f490aa77bd60fc, 0xbedbfc4411068a9c},
+	{0xf4f1b4d515acb93b, 0xee92fb5515482d44},
+	{0x991711052d8bf3c5, 0x751bdd152d4d1c4a},
+	{0xbf5cd54678eef0b6, 0xd262d45a78a0635d},
+	{0xef340a98172aace4, 0x86fb897116c87c34},
+	{0x9580869f0e7aac0e, 0xd45d35e6ae3d4da0},
+	{0xbae0a846d2195712, 0x8974836059cca109},
+	{0xe998d258869facd7, 0x2bd1a438703fc94b},
+	{0x91ff83775423cc06, 0x7b6306a34627ddcf},
+	{0xb67f6455292cbf08, 0x1a3bc84c17b1d542},
+	{0xe41f3d6a7377eeca, 0x20caba5f1d9e4a93},
+	{0x8e938662882af53e, 0x547eb47b7282ee9c},
+	{0xb23867fb2a35b28d, 0xe99e619a4f23aa43},
+	{0xdec681f9f4c31f31, 0x6405fa00e2ec94d4},
+	{0x8b3c113c38f9f37e, 0xde83bc408dd3dd04},
+	{0xae0b158b4738705e, 0x9624ab50b148d445},
+	{0xd98ddaee19068c76, 0x3badd624dd9b0957},
+	{0x87f8a8d4cfa417c9, 0xe54ca5d70a80e5d6},
+	{0xa9f6d30a038d1dbc, 0x5e9fcf4ccd211f4c},
+	{0xd47487cc8470652b, 0x7647c3200069671f},
+	{0x84c8d4dfd2c63f3b, 0x29ecd9f40041e073},
+	{0xa5fb0a17c777cf09, 0xf468107100525890},
+	{0xcf79cc9db955c2cc, 0x7182148d4066eeb4},
+	{0x81ac1fe293d599bf, 0xc6f14cd848405530},
+	{0xa21727db38cb002f, 0xb8ada00e5a506a7c},
+	{0xca9cf1d206fdc03b, 0xa6d90811f0e4851c},
+	{0xfd442e4688bd304a, 0x908f4a166d1da663},
+	{0x9e4a9cec15763e2e, 0x9a598e4e043287fe},
+	{0xc5dd44271ad3cdba, 0x40eff1e1853f29fd},
+	{0xf7549530e188c128, 0xd12bee59e68ef47c},
+	{0x9a94dd3e8cf578b9, 0x82bb74f8301958ce},
+	{0xc13a148e3032d6e7, 0xe36a52363c1faf01},
+	{0xf18899b1bc3f8ca1, 0xdc44e6c3cb279ac1},
+	{0x96f5600f15a7b7e5, 0x29ab103a5ef8c0b9},
+	{0xbcb2b812db11a5de, 0x7415d448f6b6f0e7},
+	{0xebdf661791d60f56, 0x111b495b3464ad21},
+	{0x936b9fcebb25c995, 0xcab10dd900beec34},
+	{0xb84687c269ef3bfb, 0x3d5d514f40eea742},
+	{0xe65829b3046b0afa, 0x0cb4a5a3112a5112},
+	{0x8ff71a0fe2c2e6dc, 0x47f0e785eaba72ab},
+	{0xb3f4e093db73a093, 0x59ed216765690f56},
+	{0xe0f218b8d25088b8, 0x306869c13ec3532c},
+	{0x8c974f7383725573, 0x1e414218c73a13fb},
+	{0xafbd2350644eeacf, 0xe5d1929ef90898fa},
+	{0xdbac6c247d62a583, 0xdf45f746b74abf39},
+	{0x894bc396ce5da772, 0x6b8bba8c328eb783},
+	{0xab9eb47c81f5114f, 0x066ea92f3f326564},
+	{0xd686619ba27255a2, 0xc80a537b0efefebd},
+	{0x8613fd0145877585, 0xbd06742ce95f5f36},
+	{0xa798fc4196e952e7, 0x2c48113823b73704},
+	{0xd17f3b51fca3a7a0, 0xf75a15862ca504c5},
+	{0x82ef85133de648c4, 0x9a984d73dbe722fb},
+	{0xa3ab66580d5fdaf5, 0xc13e60d0d2e0ebba},
+	{0xcc963fee10b7d1b3, 0x318df905079926a8},
+	{0xffbbcfe994e5c61f, 0xfdf17746497f7052},
+	{0x9fd561f1fd0f9bd3, 0xfeb6ea8bedefa633},
+	{0xc7caba6e7c5382c8, 0xfe64a52ee96b8fc0},
+	{0xf9bd690a1b68637b, 0x3dfdce7aa3c673b0},
+	{0x9c1661a651213e2d, 0x06bea10ca65c084e},
+	{0xc31bfa0fe5698db8, 0x486e494fcff30a62},
+	{0xf3e2f893dec3f126, 0x5a89dba3c3efccfa},
+	{0x986ddb5c6b3a76b7, 0xf89629465a75e01c},
+	{0xbe89523386091465, 0xf6bbb397f1135823},
+	{0xee2ba6c0678b597f, 0x746aa07ded582e2c},
+	{0x94db483840b717ef, 0xa8c2a44eb4571cdc},
+	{0xba121a4650e4ddeb, 0x92f34d62616ce413},
+	{0xe896a0d7e51e1566, 0x77b020baf9c81d17},
+	{0x915e2486ef32cd60, 0x0ace1474dc1d122e},
+	{0xb5b5ada8aaff80b8, 0x0d819992132456ba},
+	{0xe3231912d5bf60e6, 0x10e1fff697ed6c69},
+	{0x8df5efabc5979c8f, 0xca8d3ffa1ef463c1},
+	{0xb1736b96b6fd83b3, 0xbd308ff8a6b17cb2},
+	{0xddd0467c64bce4a0, 0xac7cb3f6d05ddbde},
+	{0x8aa22c0dbef60ee4, 0x6bcdf07a423aa96b},
+	{0xad4ab7112eb3929d, 0x86c16c98d2c953c6},
+	{0xd89d64d57a607744, 0xe871c7bf077ba8b7},
+	{0x87625f056c7c4a8b, 0x11471cd764ad4972},
+	{0xa93af6c6c79b5d2d, 0xd598e40d3dd89bcf},
+	{0xd389b47879823479, 0x4aff1d108d4ec2c3},
+	{0x843610cb4bf160cb, 0xcedf722a585139ba},
+	{0xa54394fe1eedb8fe, 0xc2974eb4ee658828},
+	{0xce947a3da6a9273e, 0x733d226229feea32},
+	{0x811ccc668829b887, 0x0806357d5a3f525f},
+	{0xa163ff802a3426a8, 0xca07c2dcb0cf26f7},
+	{0xc9bcff6034c13052, 0xfc89b393dd02f0b5},
+	{0xfc2c3f3841f17c67, 0xbbac2078d443ace2},
+	{0x9d9ba7832936edc0, 0xd54b944b84aa4c0d},
+	{0xc5029163f384a931, 0x0a9e795e65d4df11},
+	{0xf64335bcf065d37d, 0x4d4617b5ff4a16d5},
+	{0x99ea0196163fa42e, 0x504bced1bf8e4e45},
+	{0xc06481fb9bcf8d39, 0xe45ec2862f71e1d6},
+	{0xf07da27a82c37088, 0x5d767327bb4e5a4c},
+	{0x964e858c91ba2655, 0x3a6a07f8d510f86f},
+	{0xbbe226efb628afea, 0x890489f70a55368b},
+	{0xeadab0aba3b2dbe5, 0x2b45ac74ccea842e},
+	{0x92c8ae6b464fc96f, 0x3b0b8bc90012929d},
+	{0xb77ada0617e3bbcb, 0x09ce6ebb40173744},
+	{0xe55990879ddcaabd, 0xcc420a6a101d0515},
+	{0x8f57fa54c2a9eab6, 0x9fa946824a12232d},
+	{0xb32df8e9f3546564, 0x47939822dc96abf9},
+	{0xdff9772470297ebd, 0x59787e2b93bc56f7},
+	{0x8bfbea76c619ef36, 0x57eb4edb3c55b65a},
+	{0xaefae51477a06b03, 0xede622920b6b23f1},
+	{0xdab99e59958885c4, 0xe95fab368e45eced},
+	{0x88b402f7fd75539b, 0x11dbcb0218ebb414},
+	{0xaae103b5fcd2a881, 0xd652bdc29f26a119},
+	{0xd59944a37c0752a2, 0x4be76d3346f0495f},
+	{0x857fcae62d8493a5, 0x6f70a4400c562ddb},
+	{0xa6dfbd9fb8e5b88e, 0xcb4ccd500f6bb952},
+	{0xd097ad07a71f26b2, 0x7e2000a41346a7a7},
+	{0x825ecc24c873782f, 0x8ed400668c0c28c8},
+	{0xa2f67f2dfa90563b, 0x728900802f0f32fa},
+	{0xcbb41ef979346bca, 0x4f2b40a03ad2ffb9},
+	{0xfea126b7d78186bc, 0xe2f610c84987bfa8},
+	{0x9f24b832e6b0f436, 0x0dd9ca7d2df4d7c9},
+	{0xc6ede63fa05d3143, 0x91503d1c79720dbb},
+	{0xf8a95fcf88747d94, 0x75a44c6397ce912a},
+	{0x9b69dbe1b548ce7c, 0xc986afbe3ee11aba},
+	{0xc24452da229b021b, 0xfbe85badce996168},
+	{0xf2d56790ab41c2a2, 0xfae27299423fb9c3},
+	{0x97c560ba6b0919a5, 0xdccd879fc967d41a},
+	{0xbdb6b8e905cb600f, 0x5400e987bbc1c920},
+	{0xed246723473e3813, 0x290123e9aab23b68},
+	{0x9436c0760c86e30b, 0xf9a0b6720aaf6521},
+	{0xb94470938fa89bce, 0xf808e40e8d5b3e69},
+	{0xe7958cb87392c2c2, 0xb60b1d1230b20e04},
+	{0x90bd77f3483bb9b9, 0xb1c6f22b5e6f48c2},
+	{0xb4ecd5f01a4aa828, 0x1e38aeb6360b1af3},
+	{0xe2280b6c20dd5232, 0x25c6da63c38de1b0},
+	{0x8d590723948a535f, 0x579c487e5a38ad0e},
+	{0xb0af48ec79ace837, 0x2d835a9df0c6d851},
+	{0xdcdb1b2798182244, 0xf8e431456cf88e65},
+	{0x8a08f0f8bf0f156b, 0x1b8e9ecb641b58ff},
+	{0xac8b2d36eed2dac5, 0xe272467e3d222f3f},
+	{0xd7adf884aa879177, 0x5b0ed81dcc6abb0f},
+	{0x86ccbb52ea94baea, 0x98e947129fc2b4e9},
+	{0xa87fea27a539e9a5, 0x3f2398d747b36224},
+	{0xd29fe4b18e88640e, 0x8eec7f0d19a03aad},
+	{0x83a3eeeef9153e89, 0x1953cf68300424ac},
+	{0xa48ceaaab75a8e2b, 0x5fa8c3423c052dd7},
+	{0xcdb02555653131b6, 0x3792f412cb06794d},
+	{0x808e17555f3ebf11, 0xe2bbd88bbee40bd0},
+	{0xa0b19d2ab70e6ed6, 0x5b6aceaeae9d0ec4},
+	{0xc8de047564d20a8b, 0xf245825a5a445275},
+	{0xfb158592be068d2e, 0xeed6e2f0f0d56712},
+	{0x9ced737bb6c4183d, 0x55464dd69685606b},
+	{0xc428d05aa4751e4c, 0xaa97e14c3c26b886},
+	{0xf53304714d9265df, 0xd53dd99f4b3066a8},
+	{0x993fe2c6d07b7fab, 0xe546a8038efe4029},
+	{0xbf8fdb78849a5f96, 0xde98520472bdd033},
+	{0xef73d256a5c0f77c, 0x963e66858f6d4440},
+	{0x95a8637627989aad, 0xdde7001379a44aa8},
+	{0xbb127c53b17ec159, 0x5560c018580d5d52},
+	{0xe9d71b689dde71af, 0xaab8f01e6e10b4a6},
+	{0x9226712162ab070d, 0xcab3961304ca70e8},
+	{0xb6b00d69bb55c8d1, 0x3d607b97c5fd0d22},
+	{0xe45c10c42a2b3b05, 0x8cb89a7db77c506a},
+	{0x8eb98a7a9a5b04e3, 0x77f3608e92adb242},
+	{0xb267ed1940f1c61c, 0x55f038b237591ed3},
+	{0xdf01e85f912e37a3, 0x6b6c46dec52f6688},
+	{0x8b61313bbabce2c6, 0x2323ac4b3b3da015},
+	{0xae397d8aa96c1b77, 0xabec975e0a0d081a},
+	{0xd9c7dced53c72255, 0x96e7bd358c904a21},
+	{0x881cea14545c7575, 0x7e50d64177da2e54},
+	{0xaa242499697392d2, 0xdde50bd1d5d0b9e9},
+	{0xd4ad2dbfc3d07787, 0x955e4ec64b44e864},
+	{0x84ec3c97da624ab4, 0xbd5af13bef0b113e},
+	{0xa6274bbdd0fadd61, 0xecb1ad8aeacdd58e},
+	{0xcfb11ead453994ba, 0x67de18eda5814af2},
+	{0x81ceb32c4b43fcf4, 0x80eacf948770ced7},
+	{0xa2425ff75e14fc31, 0xa1258379a94d028d},
+	{0xcad2f7f5359a3b3e, 0x096ee45813a04330},
+	{0xfd87b5f28300ca0d, 0x8bca9d6e188853fc},
+	{0x9e74d1b791e07e48, 0x775ea264cf55347e},
+	{0xc612062576589dda, 0x95364afe032a819e},
+	{0xf79687aed3eec551, 0x3a83ddbd83f52205},
+	{0x9abe14cd44753b52, 0xc4926a9672793543},
+	{0xc16d9a0095928a27, 0x75b7053c0f178294},
+	{0xf1c90080baf72cb1, 0x5324c68b12dd6339},
+	{0x971da05074da7bee, 0xd3f6fc16ebca5e04},
+	{0xbce5086492111aea, 0x88f4bb1ca6bcf585},
+	{0xec1e4a7db69561a5, 0x2b31e9e3d06c32e6},
+	{0x9392ee8e921d5d07, 0x3aff322e62439fd0},
+	{0xb877aa3236a4b449, 0x09befeb9fad487c3},
+	{0xe69594bec44de15b, 0x4c2ebe687989a9b4},
+	{0x901d7cf73ab0acd9, 0x0f9d37014bf60a11},
+	{0xb424dc35095cd80f, 0x538484c19ef38c95},
+	{0xe12e13424bb40e13, 0x2865a5f206b06fba},
+	{0x8cbccc096f5088cb, 0xf93f87b7442e45d4},
+	{0xafebff0bcb24aafe, 0xf78f69a51539d749},
+	{0xdbe6fecebdedd5be, 0xb573440e5a884d1c},
+	{0x89705f4136b4a597, 0x31680a88f8953031},
+	{0xabcc77118461cefc, 0xfdc20d2b36ba7c3e},
+	{0xd6bf94d5e57a42bc, 0x3d32907604691b4d},
+	{0x8637bd05af6c69b5, 0xa63f9a49c2c1b110},
+	{0xa7c5ac471b478423, 0x0fcf80dc33721d54},
+	{0xd1b71758e219652b, 0xd3c36113404ea4a9},
+	{0x83126e978d4fdf3b, 0x645a1cac083126ea},
+	{0xa3d70a3d70a3d70a, 0x3d70a3d70a3d70a4},
+	{0xcccccccccccccccc, 0xcccccccccccccccd},
+	{0x8000000000000000, 0x0000000000000000},
+	{0xa000000000000000, 0x0000000000000000},
+	{0xc800000000000000, 0x0000000000000000},
+	{0xfa00000000000000, 0x0000000000000000},
+	{0x9c40000000000000, 0x0000000000000000},
+	{0xc350000000000000, 0x0000000000000000},
+	{0xf424000000000000, 0x0000000000000000},
+	{0x9896800000000000, 0x0000000000000000},
+	{0xbebc200000000000, 0x0000000000000000},
+	{0xee6b280000000000, 0x0000000000000000},
+	{0x9502f90000000000, 0x0000000000000000},
+	{0xba43b74000000000, 0x0000000000000000},
+	{0xe8d4a51000000000, 0x0000000000000000},
+	{0x9184e72a00000000, 0x0000000000000000},
+	{0xb5e620f480000000, 0x0000000000000000},
+	{0xe35fa931a0000000, 0x0000000000000000},
+	{0x8e1bc9bf04000000, 0x0000000000000000},
+	{0xb1a2bc2ec5000000, 0x0000000000000000},
+	{0xde0b6b3a76400000, 0x0000000000000000},
+	{0x8ac7230489e80000, 0x0000000000000000},
+	{0xad78ebc5ac620000, 0x0000000000000000},
+	{0xd8d726b7177a8000, 0x0000000000000000},
+	{0x878678326eac9000, 0x0000000000000000},
+	{0xa968163f0a57b400, 0x0000000000000000},
+	{0xd3c21bcecceda100, 0x0000000000000000},
+	{0x84595161401484a0, 0x0000000000000000},
+	{0xa56fa5b99019a5c8, 0x0000000000000000},
+	{0xcecb8f27f4200f3a, 0x0000000000000000},
+	{0x813f3978f8940984, 0x4000000000000000},
+	{0xa18f07d736b90be5, 0x5000000000000000},
+	{0xc9f2c9cd04674ede, 0xa400000000000000},
+	{0xfc6f7c4045812296, 0x4d00000000000000},
+	{0x9dc5ada82b70b59d, 0xf020000000000000},
+	{0xc5371912364ce305, 0x6c28000000000000},
+	{0xf684df56c3e01bc6, 0xc732000000000000},
+	{0x9a130b963a6c115c, 0x3c7f400000000000},
+	{0xc097ce7bc90715b3, 0x4b9f100000000000},
+	{0xf0bdc21abb48db20, 0x1e86d40000000000},
+	{0x96769950b50d88f4, 0x1314448000000000},
+	{0xbc143fa4e250eb31, 0x17d955a000000000},
+	{0xeb194f8e1ae525fd, 0x5dcfab0800000000},
+	{0x92efd1b8d0cf37be, 0x5aa1cae500000000},
+	{0xb7abc627050305ad, 0xf14a3d9e40000000},
+	{0xe596b7b0c643c719, 0x6d9ccd05d0000000},
+	{0x8f7e32ce7bea5c6f, 0xe4820023a2000000},
+	{0xb35dbf821ae4f38b, 0xdda2802c8a800000},
+	{0xe0352f62a19e306e, 0xd50b2037ad200000},
+	{0x8c213d9da502de45, 0x4526f422cc340000},
+	{0xaf298d050e4395d6, 0x9670b12b7f410000},
+	{0xdaf3f04651d47b4c, 0x3c0cdd765f114000},
+	{0x88d8762bf324cd0f, 0xa5880a69fb6ac800},
+	{0xab0e93b6efee0053, 0x8eea0d047a457a00},
+	{0xd5d238a4abe98068, 0x72a4904598d6d880},
+	{0x85a36366eb71f041, 0x47a6da2b7f864750},
+	{0xa70c3c40a64e6c51, 0x999090b65f67d924},
+	{0xd0cf4b50cfe20765, 0xfff4b4e3f741cf6d},
+	{0x82818f1281ed449f, 0xbff8f10e7a8921a4},
+	{0xa321f2d7226895c7, 0xaff72d52192b6a0d},
+	{0xcbea6f8ceb02bb39, 0x9bf4f8a69f764490},
+	{0xfee50b7025c36a08, 0x02f236d04753d5b4},
+	{0x9f4f2726179a2245, 0x01d762422c946590},
+	{0xc722f0ef9d80aad6, 0x424d3ad2b7b97ef5},
+	{0xf8ebad2b84e0d58b, 0xd2e0898765a7deb2},
+	{0x9b934c3b330c8577, 0x63cc55f49f88eb2f},
+	{0xc2781f49ffcfa6d5, 0x3cbf6b71c76b25fb},
+	{0xf316271c7fc3908a, 0x8bef464e3945ef7a},
+	{0x97edd871cfda3a56, 0x97758bf0e3cbb5ac},
+	{0xbde94e8e43d0c8ec, 0x3d52eeed1cbea317},
+	{0xed63a231d4c4fb27, 0x4ca7aaa863ee4bdd},
+	{0x945e455f24fb1cf8, 0x8fe8caa93e74ef6a},
+	{0xb975d6b6ee39e436, 0xb3e2fd538e122b44},
+	{0xe7d34c64a9c85d44, 0x60dbbca87196b616},
+	{0x90e40fbeea1d3a4a, 0xbc8955e946fe31cd},
+	{0xb51d13aea4a488dd, 0x6babab6398bdbe41},
+	{0xe264589a4dcdab14, 0xc696963c7eed2dd1},
+	{0x8d7eb76070a08aec, 0xfc1e1de5cf543ca2},
+	{0xb0de65388cc8ada8, 0x3b25a55f43294bcb},
+	{0xdd15fe86affad912, 0x49ef0eb713f39ebe},
+	{0x8a2dbf142dfcc7ab, 0x6e3569326c784337},
+	{0xacb92ed9397bf996, 0x49c2c37f07965404},
+	{0xd7e77a8f87daf7fb, 0xdc33745ec97be906},
+	{0x86f0ac99b4e8dafd, 0x69a028bb3ded71a3},
+	{0xa8acd7c0222311bc, 0xc40832ea0d68ce0c},
+	{0xd2d80db02aabd62b, 0xf50a3fa490c30190},
+	{0x83c7088e1aab65db, 0x792667c6da79e0fa},
+	{0xa4b8cab1a1563f52, 0x577001b891185938},
+	{0xcde6fd5e09abcf26, 0xed4c0226b55e6f86},
+	{0x80b05e5ac60b6178, 0x544f8158315b05b4},
+	{0xa0dc75f1778e39d6, 0x696361ae3db1c721},
+	{0xc913936dd571c84c, 0x03bc3a19cd1e38e9},
+	{0xfb5878494ace3a5f, 0x04ab48a04065c723},
+	{0x9d174b2dcec0e47b, 0x62eb0d64283f9c76},
+	{0xc45d1df942711d9a, 0x3ba5d0bd324f8394},
+	{0xf5746577930d6500, 0xca8f44ec7ee36479},
+	{0x9968bf6abbe85f20, 0x7e998b13cf4e1ecb},
+	{0xbfc2ef456ae276e8, 0x9e3fedd8c321a67e},
+	{0xefb3ab16c59b14a2, 0xc5cfe94ef3ea101e},
+	{0x95d04aee3b80ece5, 0xbba1f1d158724a12},
+	{0xbb445da9ca61281f, 0x2a8a6e45ae8edc97},
+	{0xea1575143cf97226, 0xf52d09d71a3293bd},
+	{0x924d692ca61be758, 0x593c2626705f9c56},
+	{0xb6e0c377cfa2e12e, 0x6f8b2fb00c77836c},
+	{0xe498f455c38b997a, 0x0b6dfb9c0f956447},
+	{0x8edf98b59a373fec, 0x4724bd4189bd5eac},
+	{0xb2977ee300c50fe7, 0x58edec91ec2cb657},
+	{0xdf3d5e9bc0f653e1, 0x2f2967b66737e3ed},
+	{0x8b865b215899f46c, 0xbd79e0d20082ee74},
+	{0xae67f1e9aec07187, 0xecd8590680a3aa11},
+	{0xda01ee641a708de9, 0xe80e6f4820cc9495},
+	{0x884134fe908658b2, 0x3109058d147fdcdd},
+	{0xaa51823e34a7eede, 0xbd4b46f0599fd415},
+	{0xd4e5e2cdc1d1ea96, 0x6c9e18ac7007c91a},
+	{0x850fadc09923329e, 0x03e2cf6bc604ddb0},
+	{0xa6539930bf6bff45, 0x84db8346b786151c},
+	{0xcfe87f7cef46ff16, 0xe612641865679a63},
+	{0x81f14fae158c5f6e, 0x4fcb7e8f3f60c07e},
+	{0xa26da3999aef7749, 0xe3be5e330f38f09d},
+	{0xcb090c8001ab551c, 0x5cadf5bfd3072cc5},
+	{0xfdcb4fa002162a63, 0x73d9732fc7c8f7f6},
+	{0x9e9f11c4014dda7e, 0x2867e7fddcdd9afa},
+	{0xc646d63501a1511d, 0xb281e1fd541501b8},
+	{0xf7d88bc24209a565, 0x1f225a7ca91a4226},
+	{0x9ae757596946075f, 0x3375788de9b06958},
+	{0xc1a12d2fc3978937, 0x0052d6b1641c83ae},
+	{0xf209787bb47d6b84, 0xc0678c5dbd23a49a},
+	{0x9745eb4d50ce6332, 0xf840b7ba963646e0},
+	{0xbd176620a501fbff, 0xb650e5a93bc3d898},
+	{0xec5d3fa8ce427aff, 0xa3e51f138ab4cebe},
+	{0x93ba47c980e98cdf, 0xc66f336c36b10137},
+	{0xb8a8d9bbe123f017, 0xb80b0047445d4184},
+	{0xe6d3102ad96cec1d, 0xa60dc059157491e5},
+	{0x9043ea1ac7e41392, 0x87c89837ad68db2f},
+	{0xb454e4a179dd1877, 0x29babe4598c311fb},
+	{0xe16a1dc9d8545e94, 0xf4296dd6fef3d67a},
+	{0x8ce2529e2734bb1d, 0x1899e4a65f58660c},
+	{0xb01ae745b101e9e4, 0x5ec05dcff72e7f8f},
+	{0xdc21a1171d42645d, 0x76707543f4fa1f73},
+	{0x899504ae72497eba, 0x6a06494a791c53a8},
+	{0xabfa45da0edbde69, 0x0487db9d17636892},
+	{0xd6f8d7509292d603, 0x45a9d2845d3c42b6},
+	{0x865b86925b9bc5c2, 0x0b8a2392ba45a9b2},
+	{0xa7f26836f282b732, 0x8e6cac7768d7141e},
+	{0xd1ef0244af2364ff, 0x3207d795430cd926},
+	{0x8335616aed761f1f, 0x7f44e6bd49e807b8},
+	{0xa402b9c5a8d3a6e7, 0x5f16206c9c6209a6},
+	{0xcd036837130890a1, 0x36dba887c37a8c0f},
+	{0x802221226be55a64, 0xc2494954da2c9789},
+	{0xa02aa96b06deb0fd, 0xf2db9baa10b7bd6c},
+	{0xc83553c5c8965d3d, 0x6f92829494e5acc7},
+	{0xfa42a8b73abbf48c, 0xcb772339ba1f17f9},
+	{0x9c69a97284b578d7, 0xff2a760414536efb},
+	{0xc38413cf25e2d70d, 0xfef5138519684aba},
+	{0xf46518c2ef5b8cd1, 0x7eb258665fc25d69},
+	{0x98bf2f79d5993802, 0xef2f773ffbd97a61},
+	{0xbeeefb584aff8603, 0xaafb550ffacfd8fa},
+	{0xeeaaba2e5dbf6784, 0x95ba2a53f983cf38},
+	{0x952ab45cfa97a0b2, 0xdd945a747bf26183},
+	{0xba756174393d88df, 0x94f971119aeef9e4},
+	{0xe912b9d1478ceb17, 0x7a37cd5601aab85d},
+	{0x91abb422ccb812ee, 0xac62e055c10ab33a},
+	{0xb616a12b7fe617aa, 0x577b986b314d6009},
+	{0xe39c49765fdf9d94, 0xed5a7e85fda0b80b},
+	{0x8e41ade9fbebc27d, 0x14588f13be847307},
+	{0xb1d219647ae6b31c, 0x596eb2d8ae258fc8},
+	{0xde469fbd99a05fe3, 0x6fca5f8ed9aef3bb},
+	{0x8aec23d680043bee, 0x25de7bb9480d5854},
+	{0xada72ccc20054ae9, 0xaf561aa79a10ae6a},
+	{0xd910f7ff28069da4, 0x1b2ba1518094da04},
+	{0x87aa9aff79042286, 0x90fb44d2f05d0842},
+	{0xa99541bf57452b28, 0x353a1607ac744a53},
+	{0xd3fa922f2d1675f2, 0x42889b8997915ce8},
+	{0x847c9b5d7c2e09b7, 0x69956135febada11},
+	{0xa59bc234db398c25, 0x43fab9837e699095},
+	{0xcf02b2c21207ef2e, 0x94f967e45e03f4bb},
+	{0x8161afb94b44f57d, 0x1d1be0eebac278f5},
+	{0xa1ba1ba79e1632dc, 0x6462d92a69731732},
+	{0xca28a291859bbf93, 0x7d7b8f7503cfdcfe},
+	{0xfcb2cb35e702af78, 0x5cda735244c3d43e},
+	{0x9defbf01b061adab, 0x3a0888136afa64a7},
+	{0xc56baec21c7a1916, 0x088aaa1845b8fdd0},
+	{0xf6c69a72a3989f5b, 0x8aad549e57273d45},
+	{0x9a3c2087a63f6399, 0x36ac54e2f678864b},
+	{0xc0cb28a98fcf3c7f, 0x84576a1bb416a7dd},
+	{0xf0fdf2d3f3c30b9f, 0x656d44a2a11c51d5},
+	{0x969eb7c47859e743, 0x9f644ae5a4b1b325},
+	{0xbc4665b596706114, 0x873d5d9f0dde1fee},
+	{0xeb57ff22fc0c7959, 0xa90cb506d155a7ea},
+	{0x9316ff75dd87cbd8, 0x09a7f12442d588f2},
+	{0xb7dcbf5354e9bece, 0x0c11ed6d538aeb2f},
+	{0xe5d3ef282a242e81, 0x8f1668c8a86da5fa},
+	{0x8fa475791a569d10, 0xf96e017d694487bc},
+	{0xb38d92d760ec4455, 0x37c981dcc395a9ac},
+	{0xe070f78d3927556a, 0x85bbe253f47b1417},
+	{0x8c469ab843b89562, 0x93956d7478ccec8e},
+	{0xaf58416654a6babb, 0x387ac8d1970027b2},
+	{0xdb2e51bfe9d0696a, 0x06997b05fcc0319e},
+	{0x88fcf317f22241e2, 0x441fece3bdf81f03},
+	{0xab3c2fddeeaad25a, 0xd527e81cad7626c3},
+	{0xd60b3bd56a5586f1, 0x8a71e223d8d3b074},
+	{0x85c7056562757456, 0xf6872d5667844e49},
+	{0xa738c6bebb12d16c, 0xb428f8ac016561db},
+	{0xd106f86e69d785c7, 0xe13336d701beba52},
+	{0x82a45b450226b39c, 0xecc0024661173473},
+	{0xa34d721642b06084, 0x27f002d7f95d0190},
+	{0xcc20ce9bd35c78a5, 0x31ec038df7b441f4},
+	{0xff290242c83396ce, 0x7e67047175a15271},
+	{0x9f79a169bd203e41, 0x0f0062c6e984d386},
+	{0xc75809c42c684dd1, 0x52c07b78a3e60868},
+	{0xf92e0c3537826145, 0xa7709a56ccdf8a82},
+	{0x9bbcc7a142b17ccb, 0x88a66076400bb691},
+	{0xc2abf989935ddbfe, 0x6acff893d00ea435},
+	{0xf356f7ebf83552fe, 0x0583f6b8c4124d43},
+	{0x98165af37b2153de, 0xc3727a337a8b704a},
+	{0xbe1bf1b059e9a8d6, 0x744f18c0592e4c5c},
+	{0xeda2ee1c7064130c, 0x1162def06f79df73},
+	{0x9485d4d1c63e8be7, 0x8addcb5645ac2ba8},
+	{0xb9a74a0637ce2ee1, 0x6d953e2bd7173692},
+	{0xe8111c87c5c1ba99, 0xc8fa8db6ccdd0437},
+	{0x910ab1d4db9914a0, 0x1d9c9892400a22a2},
+	{0xb54d5e4a127f59c8, 0x2503beb6d00cab4b},
+	{0xe2a0b5dc971f303a, 0x2e44ae64840fd61d},
+	{0x8da471a9de737e24, 0x5ceaecfed289e5d2},
+	{0xb10d8e1456105dad, 0x7425a83e872c5f47},
+	{0xdd50f1996b947518, 0xd12f124e28f77719},
+	{0x8a5296ffe33cc92f, 0x82bd6b70d99aaa6f},
+	{0xace73cbfdc0bfb7b, 0x636cc64d1001550b},
+	{0xd8210befd30efa5a, 0x3c47f7e05401aa4e},
+	{0x8714a775e3e95c78, 0x65acfaec34810a71},
+	{0xa8d9d1535ce3b396, 0x7f1839a741a14d0d},
+	{0xd31045a8341ca07c, 0x1ede48111209a050},
+	{0x83ea2b892091e44d, 0x934aed0aab460432},
+	{0xa4e4b66b68b65d60, 0xf81da84d5617853f},
+	{0xce1de40642e3f4b9, 0x36251260ab9d668e},
+	{0x80d2ae83e9ce78f3, 0xc1d72b7c6b426019},
+	{0xa1075a24e4421730, 0xb24cf65b8612f81f},
+	{0xc94930ae1d529cfc, 0xdee033f26797b627},
+	{0xfb9b7cd9a4a7443c, 0x169840ef017da3b1},
+	{0x9d412e0806e88aa5, 0x8e1f289560ee864e},
+	{0xc491798a08a2ad4e, 0xf1a6f2bab92a27e2},
+	{0xf5b5d7ec8acb58a2, 0xae10af696774b1db},
+	{0x9991a6f3d6bf1765, 0xacca6da1e0a8ef29},
+	{0xbff610b0cc6edd3f, 0x17fd090a58d32af3},
+	{0xeff394dcff8a948e, 0xddfc4b4cef07f5b0},
+	{0x95f83d0a1fb69cd9, 0x4abdaf101564f98e},
+	{0xbb764c4ca7a4440f, 0x9d6d1ad41abe37f1},
+	{0xea53df5fd18d5513, 0x84c86189216dc5ed},
+	{0x92746b9be2f8552c, 0x32fd3cf5b4e49bb4},
+	{0xb7118682dbb66a77, 0x3fbc8c33221dc2a1},
+	{0xe4d5e82392a40515, 0x0fabaf3feaa5334a},
+	{0x8f05b1163ba6832d, 0x29cb4d87f2a7400e},
+	{0xb2c71d5bca9023f8, 0x743e20e9ef511012},
+	{0xdf78e4b2bd342cf6, 0x914da9246b255416},
+	{0x8bab8eefb6409c1a, 0x1ad089b6c2f7548e},
+	{0xae9672aba3d0c320, 0xa184ac2473b529b1},
+	{0xda3c0f568cc4f3e8, 0xc9e5d72d90a2741e},
+	{0x8865899617fb1871, 0x7e2fa67c7a658892},
+	{0xaa7eebfb9df9de8d, 0xddbb901b98feeab7},
+	{0xd51ea6fa85785631, 0x552a74227f3ea565},
+	{0x8533285c936b35de, 0xd53a88958f87275f},
+	{0xa67ff273b8460356, 0x8a892abaf368f137},
+	{0xd01fef10a657842c, 0x2d2b7569b0432d85},
+	{0x8213f56a67f6b29b, 0x9c3b29620e29fc73},
+	{0xa298f2c501f45f42, 0x8349f3ba91b47b8f},
+	{0xcb3f2f7642717713, 0x241c70a936219a73},
+	{0xfe0efb53d30dd4d7, 0xed238cd383aa0110},
+	{0x9ec95d1463e8a506, 0xf4363804324a40aa},
+	{0xc67bb4597ce2ce48, 0xb143c6053edcd0d5},
+	{0xf81aa16fdc1b81da, 0xdd94b7868e94050a},
+	{0x9b10a4e5e9913128, 0xca7cf2b4191c8326},
+	{0xc1d4ce1f63f57d72, 0xfd1c2f611f63a3f0},
+	{0xf24a01a73cf2dccf, 0xbc633b39673c8cec},
+	{0x976e41088617ca01, 0xd5be0503e085d813},
+	{0xbd49d14aa79dbc82, 0x4b2d8644d8a74e18},
+	{0xec9c459d51852ba2, 0xddf8e7d60ed1219e},
+	{0x93e1ab8252f33b45, 0xcabb90e5c942b503},
+	{0xb8da1662e7b00a17, 0x3d6a751f3b936243},
+	{0xe7109bfba19c0c9d, 0x0cc512670a783ad4},
+	{0x906a617d450187e2, 0x27fb2b80668b24c5},
+	{0xb484f9dc9641e9da, 0xb1f9f660802dedf6},
+	{0xe1a63853bbd26451, 0x5e7873f8a0396973},
+	{0x8d07e33455637eb2, 0xdb0b487b6423e1e8},
+	{0xb049dc016abc5e5f, 0x91ce1a9a3d2cda62},
+	{0xdc5c5301c56b75f7, 0x7641a140cc7810fb},
+	{0x89b9b3e11b6329ba, 0xa9e904c87fcb0a9d},
+	{0xac2820d9623bf429, 0x546345fa9fbdcd44},
+	{0xd732290fbacaf133, 0xa97c177947ad4095},
+	{0x867f59a9d4bed6c0, 0x49ed8eabcccc485d},
+	{0xa81f301449ee8c70, 0x5c68f256bfff5a74},
+	{0xd226fc195c6a2f8c, 0x73832eec6fff3111},
+	{0x83585d8fd9c25db7, 0xc831fd53c5ff7eab},
+	{0xa42e74f3d032f525, 0xba3e7ca8b77f5e55},
+	{0xcd3a1230c43fb26f, 0x28ce1bd2e55f35eb},
+	{0x80444b5e7aa7cf85, 0x7980d163cf5b81b3},
+	{0xa0555e361951c366, 0xd7e105bcc332621f},
+	{0xc86ab5c39fa63440, 0x8dd9472bf3fefaa7},
+	{0xfa856334878fc150, 0xb14f98f6f0feb951},
+	{0x9c935e00d4b9d8d2, 0x6ed1bf9a569f33d3},
+	{0xc3b8358109e84f07, 0x0a862f80ec4700c8},
+	{0xf4a642e14c6262c8, 0xcd27bb612758c0fa},
+	{0x98e7e9cccfbd7dbd, 0x8038d51cb897789c},
+	{0xbf21e44003acdd2c, 0xe0470a63e6bd56c3},
+	{0xeeea5d5004981478, 0x1858ccfce06cac74},
+	{0x95527a5202df0ccb, 0x0f37801e0c43ebc8},
+	{0xbaa718e68396cffd, 0xd30560258f54e6ba},
+	{0xe950df20247c83fd, 0x47c6b82ef32a2069},
+	{0x91d28b7416cdd27e, 0x4cdc331d57fa5441},
+	{0xb6472e511c81471d, 0xe0133fe4adf8e952},
+	{0xe3d8f9e563a198e5, 0x58180fddd97723a6},
+	{0x8e679c2f5e44ff8f, 0x570f09eaa7ea7648},
+};
+
+// Convert w * 10^q to the bits of a positive double, where w is not zero
+static uint64_t _vjson_lemire(uint64_t w, int64_t q) {
+	const uint64_t inf = 0x7ffull << 52;
+	if (q < -342) return 0;
+	if (q > 308) return inf;
+
+	// Multiply by the truncated power of five. Only the top 55 bits of the
+	// product are needed; if the ones below them are all set, the error in
+	// the truncated power could carry into them, so the next 64 bits of the
+	// power are included too
+	unsigned lz = _vjson_clz(w);
+	w <<= lz;
+	const uint64_t *pow5 = _vjson_pow5[q + 342];
+	uint64_t lo, hi = _vjson_mul128(w, pow5[0], &lo);
+	if ((hi & 0x1ff) == 0x1ff) {
+		uint64_t lo2, hi2 = _vjson_mul128(w, pow5[1], &lo2);
+		lo += hi2;
+		hi += lo < hi2;
+	}
+
+	unsigned upper = hi >> 63;
+	uint64_t mantissa = hi >> (upper + 9);
+	// floor(log2(10^q)) + 63, plus the normalization shifts and the exponent bias
+	int64_t exp2 = ((152170 + 65536) * q >> 16) + 63 + upper - lz + 1023;
+
+	if (exp2 <= 0) {
+		// Subnormal
+		if (1 - exp2 >= 64) return 0;
+		mantissa >>= 1 - exp2;
+		mantissa += mantissa & 1;
+		mantissa >>= 1;
+		return mantissa;
+	}
+
+	// If the product is exactly halfway between two doubles, round to even.
+	// This can only happen for small exponents
+	if (lo <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 && mantissa << (upper + 9) == hi) {
+		mantissa &= ~(uint64_t)1;
+	}
+
+	mantissa += mantissa & 1;
+	mantissa >>= 1;
+	if (mantissa >= 2ull << 52) {
+		mantissa = 1ull << 52;
+		exp2++;
+	}
+	if (exp2 >= 0x7ff) return inf;
+	return (uint64_t)exp2 << 52 | (mantissa & ~(1ull << 52));
+}
+
+// Convert a number the slow way. The decimal point is localized for strtod
+static double _vjson_strtod(const char *src, const char *end) {
+	char sbuf[128], *buf = sbuf;
+	size_t len = end - src;
+	if (len >= sizeof sbuf && !(buf = malloc(len + 1))) return 0;
+	memcpy(buf, src, len);
+	buf[len] = 0;
+
+	char *dot = memchr(buf, '.', len);
+	if (dot) *dot = *localeconv()->decimal_point;
+	double d = strtod(buf, NULL);
+
+	if (buf != sbuf) free(buf);
+	return d;
+}
+
+static double _vjson_to_double(const struct _vjson_number *n, const char *src, const char *end) {
+	double d;
+	if (!n->mantissa) {
+		d = 0;
+	} else if (!n->truncated && n->mantissa <= 1ull << 53 && n->exp10 >= -22 && n->exp10 <= 22 && FLT_EVAL_METHOD == 0) {
+		// Both the mantissa and the power of ten are exact doubles, so a
+		// single rounding gives the correct result
+		static const double pow10[] = {
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+			1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+		};
+		d = n->mantissa;
+		d = n->exp10 < 0 ? d / pow10[-n->exp10] : d * pow10[n->exp10];
+	} else {
+		uint64_t bits = _vjson_lemire(n->mantissa, n->exp10);
+		// If digits were dropped, the true value is between mantissa and mantissa + 1
+		if (n->truncated && bits != _vjson_lemire(n->mantissa + 1, n->exp10)) {
+			return _vjson_strtod(src, end);
+		}
+		memcpy(&d, &bits, sizeof d);
+	}
+	return n->negative ? -d : d;
+}
+// }}}
+
 static _Bool _vjson_keyword(const char **src, const char *end, const char *kw) {
 	size_t kwlen = strlen(kw);
-	if (*src + kwlen >= end) return 0;
+	if (*src + kwlen > end) return 0;
 	if (strncmp(*src, kw, kwlen)) return 0;
 
 	*src += kwlen;
@@ -95,28 +1573,117 @@ static int _vjson_utf8_len(unsigned long cp) {
 	return 1;
 }
 
+static size_t _vjson_utf8_encode(unsigned long cp, char *p) {
+	size_t cplen = _vjson_utf8_len(cp), n = cplen;
+	if (cplen == 1) {
+		*p = cp;
+	} else {
+		*p = (0xf0 << (4-cplen)) & 0xff;
+		*p++ |= cp >> (6*--cplen);
+		while (cplen) *p++ = 0x80 | ((cp >> (6*--cplen)) & 0x3f);
+	}
+	return n;
+}
+
+// Parse up to 4 hex digits
+static unsigned long _vjson_hex4(const char **src) {
+	unsigned long cp = 0;
+	for (int i = 0; i < 4; i++, ++*src) {
+		char c = **src;
+		if (c >= '0' && c <= '9') cp = cp << 4 | (c - '0');
+		else if ((c|0x20) >= 'a' && (c|0x20) <= 'f') cp = cp << 4 | ((c|0x20) - 'a' + 10);
+		else break;
+	}
+	return cp;
+}
+
+// Decode the escape sequence following a backslash, and return its length in UTF-8
+static size_t _vjson_escape(const char **src, char *out) {
+	switch (*(*src)++) {
+	case 'b':
+		*out = '\b';
+		return 1;
+	case 'f':
+		*out = '\f';
+		return 1;
+	case 'n':
+		*out = '\n';
+		return 1;
+	case 'r':
+		*out = '\r';
+		return 1;
+	case 't':
+		*out = '\t';
+		return 1;
+
+	case 'u':;
+		unsigned long cp = _vjson_hex4(src);
+
+		// Combine surrogate pairs
+		if (cp >= 0xd800 && cp < 0xdc00 && (*src)[0] == '\\' && (*src)[1] == 'u') {
+			const char *p = *src + 2;
+			unsigned long lo = _vjson_hex4(&p);
+			if (lo >= 0xdc00 && lo < 0xe000) {
+				cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+				*src = p;
+			}
+		}
+		return _vjson_utf8_encode(cp, out);
+
+	default:
+		*out = (*src)[-1];
+		return 1;
+	}
+}
+
+static size_t _vjson_unescape(const char *src, size_t len, char *out) {
+	const char *end = src + len;
+	char *p = out;
+	while (src < end) {
+		// Copy up to the next escape in bulk
+		const char *esc = memchr(src, '\\', end - src);
+		if (!esc) esc = end;
+		memcpy(p, src, esc - src);
+		p += esc - src;
+		src = esc;
+
+		if (src < end) {
+			src++;
+			p += _vjson_escape(&src, p);
+		}
+	}
+	return p - out;
+}
+
 static enum vjson_type _vjson_string(const char **src, const char *end, char **val) {
-	if (**src != '"') return VJSON_ERROR;
+	if ((end && *src >= end) || **src != '"') return VJSON_ERROR;
 	++*src;
 
 	size_t slen = 0;
 	const char *start = *src;
 
-	while (**src != '"') {
-		if (end && start >= end) return VJSON_ERROR;
+	for (;;) {
+		if (end && *src >= end) return VJSON_ERROR;
+		if (**src == '"') break;
 
 		if (**src == '\\') {
 			++*src;
+			if (end && *src >= end) return VJSON_ERROR;
 
 			if (**src == 'u') {
 				++*src;
 
-				char *cpend;
-				long cp = strtol(*src, &cpend, 16);
-				if (*src == cpend) return VJSON_ERROR;
-				size_t cp_strlen = cpend - *src - 1;
-
-				*src += cp_strlen;
+				// Read the digits as _vjson_escape will, without going past end
+				const char *hex = *src;
+				char buf[4] = {0};
+				if (end && end - hex < 4) {
+					memcpy(buf, hex, end - hex);
+					hex = buf;
+				}
+				const char *hex_end = hex;
+				unsigned long cp = _vjson_hex4(&hex_end);
+				if (hex_end == hex) return VJSON_ERROR;
+				*src += hex_end - hex - 1;
 
 				size_t cplen = _vjson_utf8_len(cp);
 				if (!cplen) return VJSON_ERROR;
@@ -134,89 +1701,21 @@ static enum vjson_type _vjson_string(const char **src, const char *end, char **v
 
 	if (val) {
 		char *p = malloc(slen + 1);
-		p[slen] = 0;
+		p[_vjson_unescape(start, *src - 1 - start, p)] = 0;
 		*val = p;
-
-		while (*start != '"') {
-			if (*start == '\\') {
-				++start;
-				switch (*start) {
-				case 'b':
-					*p++ = '\b';
-					break;
-
-				case 'f':
-					*p++ = '\f';
-					break;
-
-				case 'n':
-					*p++ = '\n';
-					break;
-
-				case 'r':
-					*p++ = '\r';
-					break;
-
-				case 't':
-					*p++ = '\t';
-					break;
-
-				case 'u':;
-					char *cpend;
-					long cp = strtol(start + 1, &cpend, 16);
-					start = cpend - 1;
-
-					// Encode codepoint as UTF-8
-					size_t cplen = _vjson_utf8_len(cp);
-					if (cplen == 1) {
-						*p++ = cp;
-					} else {
-						*p = (0xf0 << (4-cplen)) & 0xff;
-						*p++ |= cp >> (6*--cplen);
-						while (cplen) *p++ = 0x80 | ((cp >> (6*--cplen)) & 0x3f);
-					}
-					break;
-
-				default:
-					*p++ = *start;
-					break;
-				}
-			} else {
-				*p++ = *start;
-			}
-
-			++start;
-		}
 	}
 
 	return VJSON_STRING;
 }
 
-static _Bool _vjson_delimited(const char **src, const char *end, char sdelim, char edelim) {
+static _Bool _vjson_delimited(const char **src, const char *end, char sdelim) {
 	_vjson_whitespace(src, end);
 	if (*src >= end) return 0;
 	if (**src != sdelim) return 0;
 
-	// Skip starting delimiter
-	++*src;
-
-	unsigned level = 1;
-	while (level) {
-		if (*src >= end) return 0;
-
-		if (**src == '"') {
-			vjson_string(src, end);
-		} else {
-			if (**src == sdelim) {
-				level++;
-			} else if (**src == edelim) {
-				level--;
-			}
-
-			++*src;
-		}
-	}
-
+	const char *p = _vjson_skip_container(*src, end);
+	if (!p) return 0;
+	*src = p;
 	return 1;
 }
 
@@ -293,9 +1792,9 @@ enum vjson_type vjson_number(const char **src, const char *end) {
 	_vjson_whitespace(src, end);
 	if (*src >= end) return VJSON_ERROR;
 
-	char *nend;
-	strtold(*src, &nend);
-	if (nend == *src) return VJSON_ERROR;
+	struct _vjson_number n;
+	const char *nend = _vjson_scan_number(*src, end, &n);
+	if (!nend) return VJSON_ERROR;
 	*src = nend;
 
 	return VJSON_NUMBER;
@@ -323,44 +1822,104 @@ enum vjson_type vjson_string(const char **src, const char *end) {
 }
 
 enum vjson_type vjson_array(const char **src, const char *end) {
-	return _vjson_delimited(src, end, '[', ']') ? VJSON_ARRAY : VJSON_ERROR;
+	return _vjson_delimited(src, end, '[') ? VJSON_ARRAY : VJSON_ERROR;
 }
 
 enum vjson_type vjson_object(const char **src, const char *end) {
-	return _vjson_delimited(src, end, '{', '}') ? VJSON_OBJECT : VJSON_ERROR;
+	return _vjson_delimited(src, end, '{') ? VJSON_OBJECT : VJSON_ERROR;
 }
 
 const char *vjson_enter(const char *src) {
-	while (strchr(" \t\n", *src)) src++;
-	src++;
-	while (strchr(" \t\n", *src)) src++;
-	return src;
+	src = _vjson_skip_space(src);
+	return _vjson_skip_space(src + 1);
 }
 
 long double vjson_get_number(const char *src) {
-	while (strchr(" \t\n", *src)) src++;
-	return strtold(src, NULL);
+	double val;
+	vjson_get_double(src, &val);
+	return val;
+}
+
+_Bool vjson_get_i64(const char *src, int64_t *val) {
+	src = _vjson_skip_space(src);
+	struct _vjson_number n;
+	const char *end = _vjson_scan_number(src, NULL, &n);
+	if (!end) {
+		*val = 0;
+		return 0;
+	}
+
+	if (n.integral && !n.overflow) {
+		if (!n.negative && n.u <= INT64_MAX) {
+			*val = n.u;
+			return 1;
+		}
+		if (n.negative && n.u <= (uint64_t)INT64_MAX + 1) {
+			*val = n.u ? -(int64_t)(n.u - 1) - 1 : 0;
+			return 1;
+		}
+	}
+
+	double d = _vjson_to_double(&n, src, end);
+	if (d >= 0x1p63) *val = INT64_MAX;
+	else if (d <= -0x1p63) *val = INT64_MIN;
+	else *val = d;
+	return 0;
+}
+
+_Bool vjson_get_u64(const char *src, uint64_t *val) {
+	src = _vjson_skip_space(src);
+	struct _vjson_number n;
+	const char *end = _vjson_scan_number(src, NULL, &n);
+	if (!end) {
+		*val = 0;
+		return 0;
+	}
+
+	if (n.integral && !n.overflow && (!n.negative || !n.u)) {
+		*val = n.u;
+		return 1;
+	}
+
+	double d = _vjson_to_double(&n, src, end);
+	if (d >= 0x1p64) *val = UINT64_MAX;
+	else if (d <= 0) *val = 0;
+	else *val = d;
+	return 0;
+}
+
+_Bool vjson_get_double(const char *src, double *val) {
+	src = _vjson_skip_space(src);
+	struct _vjson_number n;
+	const char *end = _vjson_scan_number(src, NULL, &n);
+	if (!end) {
+		*val = 0;
+		return 0;
+	}
+
+	*val = _vjson_to_double(&n, src, end);
+	return n.integral;
 }
 
 _Bool vjson_get_bool(const char *src) {
-	while (strchr(" \t\n", *src)) src++;
+	src = _vjson_skip_space(src);
 	return *src == 't';
 }
 
 char *vjson_get_string(const char *src) {
-	while (strchr(" \t\n", *src)) src++;
+	src = _vjson_skip_space(src);
 	char *val;
 	_vjson_string(&src, NULL, &val);
 	return val;
 }
 
 size_t vjson_get_size(const char *src) {
-	while (strchr(" \t\n", *src)) src++;
+	src = _vjson_skip_space(src);
 
 	// Skip starting delimiter
 	src++;
 
-	while (strchr(" \t\n", *src)) src++;
+	src = _vjson_skip_space(src);
 	if (*src == ']' || *src == '}') return 0;
 
 	size_t count = 1;
@@ -384,4 +1943,1522 @@ size_t vjson_get_size(const char *src) {
 	return count;
 }
 
+// String views {{{
+struct vjson_view vjson_get_view(const char *src) {
+	src = _vjson_skip_space(src) + 1;
+	struct vjson_view view = {.s = src};
+
+	// strcspn is vectorized by most C libraries, and stops at the closing quote
+	for (;;) {
+		src += strcspn(src, "\"\\");
+		if (*src == '"') break;
+		if (*src == '\\') {
+			view.escaped = 1;
+			src++;
+		}
+		src++;
+	}
+
+	view.len = src - view.s;
+	return view;
+}
+
+size_t vjson_unescape(struct vjson_view view, char *buf) {
+	if (!view.escaped) {
+		memcpy(buf, view.s, view.len);
+		return view.len;
+	}
+	return _vjson_unescape(view.s, view.len, buf);
+}
+
+const char *vjson_get_astring(const char *src, struct varena **arena, size_t *len) {
+	struct vjson_view view = vjson_get_view(src);
+	*len = view.len;
+	if (!view.escaped) return view.s;
+
+	char *p = aalloc(arena, view.len);
+	if (!p) return NULL;
+	*len = _vjson_unescape(view.s, view.len, p);
+	return p;
+}
+
+_Bool vjson_key_eq(const char *src, const char *key) {
+	struct vjson_view view = vjson_get_view(src);
+	if (!view.escaped) return !strncmp(view.s, key, view.len) && !key[view.len];
+
+	const char *end = view.s + view.len;
+	for (src = view.s; src < end;) {
+		if (*src != '\\') {
+			if (!*key || *src++ != *key++) return 0;
+			continue;
+		}
+
+		src++;
+		char buf[4];
+		size_t n = _vjson_escape(&src, buf);
+		for (size_t i = 0; i < n; i++) {
+			if (!*key || buf[i] != *key++) return 0;
+		}
+	}
+	return !*key;
+}
+// }}}
+
+// Tape {{{
+enum {
+	_vjson_T_NEXT, // After a value, or at the top level
+	_vjson_T_VALUE, // After a colon or a comma in an array
+	_vjson_T_FIRST_VALUE, // After an opening square bracket
+	_vjson_T_KEY, // After a comma in an object
+	_vjson_T_FIRST_KEY, // After an opening curly bracket
+	_vjson_T_COLON, // After a key
+};
+
+struct _vjson_frame {
+	uint32_t node, last;
+};
+
+// Parse the scalar or string spanning from the structural at off to the next one
+static enum vjson_type _vjson_tape_scalar(const char *src, uint32_t off, uint32_t next, uint32_t *len) {
+	while (next > off && _vjson_is_space(src[next - 1])) next--;
+	*len = next - off;
+
+	if (src[off] == '"') {
+		// The structural index ensures strings are terminated, and nothing
+		// follows the closing quote before the next structural
+		return *len >= 2 && src[next - 1] == '"' ? VJSON_STRING : VJSON_ERROR;
+	}
+
+	const char *p = src + off;
+	enum vjson_type t = vjson_value(&p, src + next);
+	if (p != src + next) return VJSON_ERROR;
+	if (t != VJSON_NUMBER && t != VJSON_BOOL && t != VJSON_NULL) return VJSON_ERROR;
+	return t;
+}
+
+int vjson_tape_parse(struct vjson_tape *tape, struct varena **arena, const char *src, const char *end) {
+	*tape = (struct vjson_tape){.src = src};
+
+	struct vjson_index idx;
+	if (vjson_index_build(&idx, src, end)) return -1;
+	if (!idx.n) {
+		vjson_index_free(&idx);
+		return 0;
+	}
+
+	// Every value starts at a structural, so the index bounds the number of
+	// nodes and the depth of nesting
+	struct vjson_node *nodes = aalloc(arena, idx.n * sizeof *nodes);
+	struct _vjson_frame *stack = malloc(idx.n * sizeof *stack);
+	if (!nodes || !stack) goto error;
+
+	size_t n = 0, depth = 0;
+	uint32_t top_last = 0;
+	int state = _vjson_T_NEXT;
+	for (size_t k = 0; k < idx.n; k++) {
+		uint32_t off = idx.pos[k];
+		char c = src[off];
+		struct _vjson_frame *top = depth ? &stack[depth - 1] : NULL;
+		_Bool in_object = top && nodes[top->node].type == VJSON_OBJECT;
+
+		switch (c) {
+		case ',':
+			if (state != _vjson_T_NEXT || !top) goto error;
+			state = in_object ? _vjson_T_KEY : _vjson_T_VALUE;
+			continue;
+
+		case ':':
+			if (state != _vjson_T_COLON) goto error;
+			state = _vjson_T_VALUE;
+			continue;
+
+		case ']':
+		case '}':
+			if (!top) goto error;
+			if (in_object != (c == '}')) goto error;
+			if (state != _vjson_T_NEXT && state != _vjson_T_FIRST_VALUE && state != _vjson_T_FIRST_KEY) goto error;
+
+			struct vjson_node *node = &nodes[top->node];
+			node->len = off + 1 - node->off;
+			node->skip = n - top->node;
+			if (node->size) nodes[top->last].last = 1;
+			depth--;
+			state = _vjson_T_NEXT;
+			continue;
+		}
+
+		// Everything else starts a key or value
+		if (state == _vjson_T_KEY || state == _vjson_T_FIRST_KEY) {
+			uint32_t len;
+			if (c != '"') goto error;
+			if (_vjson_tape_scalar(src, off, idx.pos[k+1], &len) != VJSON_STRING) goto error;
+			nodes[n++] = (struct vjson_node){.type = VJSON_STRING, .off = off, .len = len, .skip = 1};
+			nodes[top->node].size++;
+			state = _vjson_T_COLON;
+			continue;
+		}
+
+		if (state == _vjson_T_COLON) goto error;
+		if (state == _vjson_T_NEXT && top) goto error;
+
+		if (top) {
+			top->last = n;
+			if (!in_object) nodes[top->node].size++;
+		} else {
+			top_last = n;
+		}
+
+		if (c == '[' || c == '{') {
+			nodes[n] = (struct vjson_node){.type = c == '[' ? VJSON_ARRAY : VJSON_OBJECT, .off = off};
+			stack[depth++] = (struct _vjson_frame){.node = n};
+			n++;
+			state = c == '[' ? _vjson_T_FIRST_VALUE : _vjson_T_FIRST_KEY;
+		} else {
+			uint32_t len;
+			enum vjson_type t = _vjson_tape_scalar(src, off, idx.pos[k+1], &len);
+			if (t == VJSON_ERROR) goto error;
+			nodes[n++] = (struct vjson_node){.type = t, .off = off, .len = len, .skip = 1};
+			state = _vjson_T_NEXT;
+		}
+	}
+	if (depth || state != _vjson_T_NEXT) goto error;
+
+	nodes[top_last].last = 1;
+	tape->n = n;
+	tape->nodes = nodes;
+	free(stack);
+	vjson_index_free(&idx);
+	return 0;
+
+error:
+	// The nodes stay in the arena until it is freed
+	free(stack);
+	vjson_index_free(&idx);
+	return -1;
+}
+
+const struct vjson_node *vjson_tape_root(const struct vjson_tape *tape) {
+	return tape->n ? tape->nodes : NULL;
+}
+
+const char *vjson_node_src(const struct vjson_tape *tape, const struct vjson_node *node) {
+	return tape->src + node->off;
+}
+
+struct vjson_view vjson_node_view(const struct vjson_tape *tape, const struct vjson_node *node) {
+	const char *s = tape->src + node->off + 1;
+	size_t len = node->len - 2;
+	return (struct vjson_view){s, len, memchr(s, '\\', len) != NULL};
+}
+
+const struct vjson_node *vjson_node_child(const struct vjson_node *node) {
+	return node->skip > 1 ? node + 1 : NULL;
+}
+
+const struct vjson_node *vjson_node_next(const struct vjson_node *node) {
+	return node->last ? NULL : node + node->skip;
+}
+
+size_t vjson_node_size(const struct vjson_node *node) {
+	return node->size;
+}
+
+const struct vjson_node *vjson_node_at(const struct vjson_node *node, size_t i) {
+	if (i >= node->size) return NULL;
+
+	// Objects take two nodes per member
+	size_t width = node->type == VJSON_OBJECT ? 2 : 1;
+	if (node->skip == width*node->size + 1) {
+		// No nested containers
+		return node + 1 + width*i;
+	}
+
+	const struct vjson_node *child = node + 1;
+	while (i--) {
+		if (width == 2) child += child->skip;
+		child += child->skip;
+	}
+	return child;
+}
+// }}}
+
+// Incremental parsing {{{
+enum {
+	_vjson_TOK_NONE,
+	_vjson_TOK_STRING,
+	_vjson_TOK_SCALAR,
+};
+
+static inline _Bool _vjson_delim(char c) {
+	return _vjson_class[(unsigned char)c] & ~_vjson_C_BACKSLASH;
+}
+
+// Find the end of a string, starting inside it. esc is set if the first byte
+// is escaped, and is updated if the string doesn't end before end
+static const char *_vjson_string_end(const char *src, const char *end, _Bool *esc) {
+	const char *seg = src;
+	for (;;) {
+		const char *quote = memchr(src, '"', end - src);
+		const char *stop = quote ? quote : end;
+
+		// The quote is escaped if an odd number of backslashes precede it
+		const char *bs = stop;
+		while (bs > seg && bs[-1] == '\\') bs--;
+		size_t run = stop - bs + (bs == seg && *esc);
+
+		if (!quote) {
+			*esc = run & 1;
+			return NULL;
+		}
+		if (!(run & 1)) return quote + 1;
+		src = quote + 1;
+	}
+}
+
+static const char *_vjson_scalar_end(const char *src, const char *end) {
+	while (src < end && !_vjson_delim(*src)) src++;
+	return src < end ? src : NULL;
+}
+
+static int _vjson_push_event(struct vjson_push *p, enum vjson_event ev, enum vjson_type type, const char *tok, size_t len) {
+	int ret = p->handler.event(p->handler.ctx, ev, type, tok, len);
+	if (ret) p->err = ret;
+	return ret;
+}
+
+static int _vjson_push_token(struct vjson_push *p, const char *tok, size_t len) {
+	if (p->state == _vjson_T_KEY || p->state == _vjson_T_FIRST_KEY) {
+		if (*tok != '"') return p->err = -1;
+		p->state = _vjson_T_COLON;
+		return _vjson_push_event(p, VJSON_EV_KEY, VJSON_STRING, tok, len);
+	}
+	if (p->state == _vjson_T_COLON || (p->state == _vjson_T_NEXT && p->depth)) {
+		return p->err = -1;
+	}
+
+	enum vjson_type type = VJSON_STRING;
+	if (*tok != '"') {
+		const char *src = tok;
+		type = vjson_value(&src, tok + len);
+		if (src != tok + len || (type != VJSON_NUMBER && type != VJSON_BOOL && type != VJSON_NULL)) {
+			return p->err = -1;
+		}
+	}
+
+	p->state = _vjson_T_NEXT;
+	return _vjson_push_event(p, VJSON_EV_SCALAR, type, tok, len);
+}
+
+// Handle a single-byte structural
+static int _vjson_push_structural(struct vjson_push *p, const char *src) {
+	size_t i = p->depth - 1;
+	_Bool in_object = p->depth && p->stack[i / 64] >> (i % 64) & 1;
+
+	switch (*src) {
+	case ',':
+		if (p->state != _vjson_T_NEXT || !p->depth) return p->err = -1;
+		p->state = in_object ? _vjson_T_KEY : _vjson_T_VALUE;
+		return 0;
+
+	case ':':
+		if (p->state != _vjson_T_COLON) return p->err = -1;
+		p->state = _vjson_T_VALUE;
+		return 0;
+
+	case ']':
+	case '}':
+		if (!p->depth || in_object != (*src == '}')) return p->err = -1;
+		if (p->state != _vjson_T_NEXT && p->state != _vjson_T_FIRST_VALUE && p->state != _vjson_T_FIRST_KEY) {
+			return p->err = -1;
+		}
+		p->depth--;
+		p->state = _vjson_T_NEXT;
+		return _vjson_push_event(p, VJSON_EV_END, in_object ? VJSON_OBJECT : VJSON_ARRAY, src, 1);
+
+	case '[':
+	case '{':
+		if (p->state != _vjson_T_VALUE && p->state != _vjson_T_FIRST_VALUE && (p->state != _vjson_T_NEXT || p->depth)) {
+			return p->err = -1;
+		}
+		if (p->depth == VJSON_MAX_DEPTH) return p->err = -1;
+
+		i = p->depth++;
+		_Bool object = *src == '{';
+		p->stack[i / 64] = (p->stack[i / 64] & ~(1ull << i % 64)) | (uint64_t)object << i % 64;
+		p->state = object ? _vjson_T_FIRST_KEY : _vjson_T_FIRST_VALUE;
+		return _vjson_push_event(p, VJSON_EV_START, object ? VJSON_OBJECT : VJSON_ARRAY, src, 1);
+	}
+
+	return p->err = -1;
+}
+
+// Append to the split token. It is kept nul-terminated, so a scalar at the
+// end of a document can be passed to the vjson_get_* functions
+static int _vjson_push_save(struct vjson_push *p, const char *src, size_t len) {
+	if (p->buf_len + len >= p->buf_cap) {
+		size_t cap = p->buf_cap ? p->buf_cap : 64;
+		while (p->buf_len + len >= cap) cap *= 2;
+		char *buf = realloc(p->buf, cap);
+		if (!buf) return p->err = -1;
+		p->buf = buf;
+		p->buf_cap = cap;
+	}
+	memcpy(p->buf + p->buf_len, src, len);
+	p->buf_len += len;
+	p->buf[p->buf_len] = 0;
+	return 0;
+}
+
+void vjson_push_init(struct vjson_push *p, struct vjson_handler handler) {
+	*p = (struct vjson_push){.handler = handler, .state = _vjson_T_NEXT};
+}
+
+int vjson_push(struct vjson_push *p, const char *data, size_t len) {
+	if (p->err) return p->err;
+
+	const char *src = data, *end = data + len;
+
+	// Finish a token left over from the last chunk
+	if (p->tok) {
+		const char *tend = p->tok == _vjson_TOK_STRING ? _vjson_string_end(src, end, &p->esc) : _vjson_scalar_end(src, end);
+		if (!tend) {
+			if (_vjson_push_save(p, src, len)) goto error;
+			p->offset += len;
+			return 0;
+		}
+
+		if (_vjson_push_save(p, src, tend - src)) goto error;
+		size_t tok_len = p->buf_len;
+		p->tok = _vjson_TOK_NONE;
+		p->buf_len = 0;
+		if (_vjson_push_token(p, p->buf, tok_len)) goto error;
+		src = tend;
+	}
+
+	while (src < end) {
+		if (_vjson_is_space(*src)) {
+			src++;
+			continue;
+		}
+
+		// Tokens contained in this chunk are passed on directly, and others
+		// saved until their end arrives
+		const char *tend;
+		if (*src == '"') {
+			p->esc = 0;
+			tend = _vjson_string_end(src + 1, end, &p->esc);
+			p->tok = _vjson_TOK_STRING;
+		} else if (_vjson_delim(*src)) {
+			if (_vjson_push_structural(p, src)) goto error;
+			src++;
+			continue;
+		} else {
+			tend = _vjson_scalar_end(src, end);
+			p->tok = _vjson_TOK_SCALAR;
+		}
+
+		if (!tend) {
+			if (_vjson_push_save(p, src, end - src)) goto error;
+			break;
+		}
+		p->tok = _vjson_TOK_NONE;
+		if (_vjson_push_token(p, src, tend - src)) goto error;
+		src = tend;
+	}
+
+	p->offset += len;
+	return 0;
+
+error:
+	p->offset += src - data;
+	return p->err;
+}
+
+int vjson_push_end(struct vjson_push *p) {
+	if (p->err) return p->err;
+	if (p->tok == _vjson_TOK_STRING) return p->err = -1;
+
+	// A scalar at the end of the document is ended by the end of the document
+	if (p->tok == _vjson_TOK_SCALAR) {
+		size_t len = p->buf_len;
+		p->tok = _vjson_TOK_NONE;
+		p->buf_len = 0;
+		if (_vjson_push_token(p, p->buf, len)) return p->err;
+	}
+
+	if (p->depth || p->state != _vjson_T_NEXT) return p->err = -1;
+	return 0;
+}
+
+void vjson_push_free(struct vjson_push *p) {
+	free(p->buf);
+	p->buf = NULL;
+	p->buf_len = p->buf_cap = 0;
+}
+// }}}
+
+// NDJSON {{{
+// Find the newlines in the block at src, which may be cut short by end
+static inline uint64_t _vjson_newlines(const char *src, const char *end) {
+	char buf[64];
+	if (end - src < 64) {
+		memset(buf, 0, sizeof buf);
+		memcpy(buf, src, end - src);
+		src = buf;
+	}
+
+#ifdef _VJSON_X86
+	uint64_t mask = 0;
+	__m128i nl = _mm_set1_epi8('\n');
+	for (unsigned i = 0; i < 64; i += 16) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+		mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, nl)) << i;
+	}
+	return mask;
+#else
+	uint64_t mask = 0;
+	for (unsigned i = 0; i < 64; i++) {
+		mask |= (uint64_t)(src[i] == '\n') << i;
+	}
+	return mask;
+#endif
+}
+
+// Chunks start after the first newline at or after their nominal start
+static const char *_vjson_chunk_start(const char *src, const char *end, size_t off) {
+	if (!off) return src;
+	if (off >= (size_t)(end - src)) return end;
+	const char *nl = memchr(src + off - 1, '\n', end - (src + off - 1));
+	return nl ? nl + 1 : end;
+}
+
+struct _vjson_results {
+	void **items;
+	size_t n, cap;
+	_Bool done;
+};
+
+struct _vjson_ndjson_job {
+	const char *src, *end;
+	const struct vjson_ndjson *opts;
+	size_t chunk_size, nchunks;
+	struct _vjson_results *results; // Per chunk, when ordered
+#ifdef _VJSON_THREADS
+	atomic_size_t next;
+	atomic_int ret;
+	atomic_uint nthreads;
+	mtx_t lock;
+	size_t next_send; // First chunk whose results haven't been sent
+#else
+	size_t next;
+	int ret;
+	unsigned nthreads;
+#endif
+};
+
+static int _vjson_ndjson_record(struct _vjson_ndjson_job *job, struct vjson_record *rec, struct _vjson_results *res, const char *src, const char *end) {
+	if (end > src && end[-1] == '\r') end--;
+	_vjson_whitespace(&src, end);
+	if (src == end) return 0;
+
+	rec->src = src;
+	rec->end = end;
+	rec->offset = src - job->src;
+	rec->result = NULL;
+	int ret = job->opts->record(job->opts->ctx, rec);
+	if (ret || !rec->result || !job->opts->results) return ret;
+
+#ifdef _VJSON_THREADS
+	if (!res) {
+		job->opts->send(job->opts->results, rec->result);
+		return 0;
+	}
+
+	if (res->n == res->cap) {
+		size_t cap = res->cap ? 2*res->cap : 64;
+		void **items = realloc(res->items, cap * sizeof *items);
+		if (!items) return -1;
+		res->items = items;
+		res->cap = cap;
+	}
+	res->items[res->n++] = rec->result;
+#else
+	(void)res;
+#endif
+	return 0;
+}
+
+// Send the results of every finished chunk that isn't waiting on an earlier one
+static void _vjson_ndjson_send(struct _vjson_ndjson_job *job, size_t chunk) {
+#ifdef _VJSON_THREADS
+	mtx_lock(&job->lock);
+	job->results[chunk].done = 1;
+	for (; job->next_send < job->nchunks && job->results[job->next_send].done; job->next_send++) {
+		struct _vjson_results *res = &job->results[job->next_send];
+		for (size_t i = 0; i < res->n; i++) {
+			job->opts->send(job->opts->results, res->items[i]);
+		}
+		free(res->items);
+		*res = (struct _vjson_results){.done = 1};
+	}
+	mtx_unlock(&job->lock);
+#else
+	(void)job, (void)chunk;
+#endif
+}
+
+static int _vjson_ndjson_worker(void *arg) {
+	struct _vjson_ndjson_job *job = arg;
+	struct vjson_record rec = {0};
+#ifdef _VJSON_THREADS
+	rec.thread = atomic_fetch_add(&job->nthreads, 1);
+#else
+	rec.thread = job->nthreads++;
+#endif
+
+	for (;;) {
+#ifdef _VJSON_THREADS
+		size_t chunk = atomic_fetch_add(&job->next, 1);
+#else
+		size_t chunk = job->next++;
+#endif
+		if (chunk >= job->nchunks || job->ret) return 0;
+
+		struct varena *arena = varena_new(64 << 10);
+		if (!arena) {
+			job->ret = -1;
+			return 0;
+		}
+		rec.arena = &arena;
+		struct _vjson_results *res = job->results ? &job->results[chunk] : NULL;
+
+		// Split the chunk into lines using a bitmask of newlines for each 64 bytes
+		const char *start = _vjson_chunk_start(job->src, job->end, chunk * job->chunk_size);
+		const char *end = _vjson_chunk_start(job->src, job->end, (chunk + 1) * job->chunk_size);
+		const char *line = start;
+		int ret = 0;
+		for (const char *p = start; p < end && !ret; p += 64) {
+			for (uint64_t nl = _vjson_newlines(p, end); nl && !ret; nl &= nl - 1) {
+				const char *e = p + _vjson_ctz(nl);
+				ret = _vjson_ndjson_record(job, &rec, res, line, e);
+				line = e + 1;
+			}
+		}
+		// Only the last chunk can end without a newline
+		if (!ret && line < end) ret = _vjson_ndjson_record(job, &rec, res, line, end);
+		varena_free(arena);
+
+		if (ret) {
+#ifdef _VJSON_THREADS
+			int zero = 0;
+			atomic_compare_exchange_strong(&job->ret, &zero, ret);
+#else
+			job->ret = ret;
+#endif
+			return 0;
+		}
+		if (res) _vjson_ndjson_send(job, chunk);
+	}
+}
+
+int vjson_ndjson(const char *src, const char *end, const struct vjson_ndjson *opts) {
+	struct _vjson_ndjson_job job = {
+		.src = src,
+		.end = end,
+		.opts = opts,
+		.chunk_size = opts->chunk_size ? opts->chunk_size : 1 << 20,
+	};
+	job.nchunks = ((size_t)(end - src) + job.chunk_size - 1) / job.chunk_size;
+
+#ifdef _VJSON_THREADS
+	if (opts->results && opts->ordered) {
+		if (mtx_init(&job.lock, mtx_plain) != thrd_success) return -1;
+		if (!(job.results = calloc(job.nchunks ? job.nchunks : 1, sizeof *job.results))) {
+			mtx_destroy(&job.lock);
+			return -1;
+		}
+	}
+
+	// The calling thread works too. If threads can't be created, carry on
+	// with fewer of them
+	size_t n = opts->nthreads < job.nchunks ? opts->nthreads : job.nchunks;
+	thrd_t *threads = n > 1 ? malloc((n - 1) * sizeof *threads) : NULL;
+	size_t started = 0;
+	if (threads) {
+		for (; started + 1 < n; started++) {
+			if (thrd_create(&threads[started], _vjson_ndjson_worker, &job) != thrd_success) break;
+		}
+	}
+	_vjson_ndjson_worker(&job);
+	for (size_t i = 0; i < started; i++) thrd_join(threads[i], NULL);
+	free(threads);
+
+	if (job.results) {
+		// Results left unsent after stopping are dropped
+		for (size_t i = 0; i < job.nchunks; i++) free(job.results[i].items);
+		free(job.results);
+		mtx_destroy(&job.lock);
+	}
+	if (opts->results) opts->send(opts->results, NULL);
+#else
+	_vjson_ndjson_worker(&job);
+#endif
+
+	return job.ret;
+}
+
+#if defined(_POSIX_C_SOURCE) && _POSIX_C_SOURCE >= 200112L
+int vjson_ndjson_file(const char *fn, const struct vjson_ndjson *opts) {
+	int fd = open(fn, O_RDONLY);
+	if (fd < 0) return -1;
+
+	struct stat st;
+	if (fstat(fd, &st)) {
+		close(fd);
+		return -1;
+	}
+
+	// Empty files can't be mapped
+	size_t len = st.st_size;
+	if (!len) {
+		close(fd);
+		return vjson_ndjson(NULL, NULL, opts);
+	}
+
+	char *src = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (src == MAP_FAILED) return -1;
+
+	int ret = vjson_ndjson(src, src + len, opts);
+	munmap(src, len);
+	return ret;
+}
+#endif
+// }}}
+
+// Path queries {{{
+enum {
+	_vjson_STEP_KEY,
+	_vjson_STEP_INDEX,
+	_vjson_STEP_MEMBERS,
+	_vjson_STEP_ITEMS,
+};
+
+struct _vjson_step {
+	int type;
+	size_t index; // Array index, or length of key
+	const char *key; // Nul-terminated, for vjson_key_eq
+};
+
+struct _vjson_path {
+	size_t nsteps;
+	struct _vjson_step *steps;
+	char *keys;
+};
+
+struct vjson_query {
+	size_t npaths, depth; // Depth is the greatest number of steps
+	struct _vjson_path paths[];
+};
+
+static int _vjson_compile_path(struct _vjson_path *path, const char *src) {
+	// Each step is at least two characters, and the keys fit in a copy of the path
+	size_t len = strlen(src);
+	path->nsteps = 0;
+	path->steps = malloc((len / 2 + 1) * sizeof *path->steps);
+	path->keys = malloc(len + 1);
+	if (!path->steps || !path->keys) return -1;
+
+	// Without the $, the first step can leave out the dot
+	char *keys = path->keys;
+	_Bool first = *src != '$';
+	if (!first) src++;
+	for (; *src; first = 0) {
+		struct _vjson_step *step = &path->steps[path->nsteps++];
+		if (*src == '[') {
+			src++;
+			if (*src == '*') {
+				step->type = _vjson_STEP_ITEMS;
+				src++;
+			} else {
+				if (*src < '0' || *src > '9') return -1;
+				step->type = _vjson_STEP_INDEX;
+				step->index = 0;
+				for (; *src >= '0' && *src <= '9'; src++) {
+					step->index = step->index * 10 + (*src - '0');
+				}
+			}
+			if (*src++ != ']') return -1;
+			continue;
+		}
+
+		if (*src == '.') {
+			src++;
+		} else if (!first) {
+			return -1;
+		}
+
+		size_t n = strcspn(src, ".[");
+		if (!n) return -1;
+		if (n == 1 && *src == '*') {
+			step->type = _vjson_STEP_MEMBERS;
+		} else {
+			step->type = _vjson_STEP_KEY;
+			step->index = n;
+			step->key = keys;
+			memcpy(keys, src, n);
+			keys[n] = 0;
+			keys += n + 1;
+		}
+		src += n;
+	}
+	return 0;
+}
+
+void vjson_query_free(struct vjson_query *q) {
+	if (!q) return;
+	for (size_t i = 0; i < q->npaths; i++) {
+		free(q->paths[i].steps);
+		free(q->paths[i].keys);
+	}
+	free(q);
+}
+
+struct vjson_query *vjson_query_new(const char *const *paths, size_t npaths) {
+	struct vjson_query *q = calloc(1, sizeof *q + npaths * sizeof *q->paths);
+	if (!q) return NULL;
+	q->npaths = npaths;
+	for (size_t i = 0; i < npaths; i++) {
+		if (_vjson_compile_path(&q->paths[i], paths[i])) {
+			vjson_query_free(q);
+			return NULL;
+		}
+		if (q->paths[i].nsteps > q->depth) q->depth = q->paths[i].nsteps;
+	}
+	return q;
+}
+
+struct _vjson_query_run {
+	const struct vjson_query *q;
+	const char *end;
+	vjson_match_fn match;
+	void *ctx;
+};
+
+// Skip a value without parsing it
+static int _vjson_skip_value(const char **src, const char *end) {
+	const char *p;
+	switch (**src) {
+	case '[':
+	case '{':
+		p = _vjson_skip_container(*src, end);
+		break;
+
+	case '"':;
+		_Bool esc = 0;
+		p = _vjson_string_end(*src + 1, end, &esc);
+		break;
+
+	default:
+		p = *src;
+		if (vjson_value(&p, end) == VJSON_ERROR) return -1;
+		break;
+	}
+
+	if (!p) return -1;
+	*src = p;
+	return 0;
+}
+
+static _Bool _vjson_step_key(const struct _vjson_step *step, const char *key, size_t len) {
+	if (!memchr(key, '\\', len)) return len == step->index && !memcmp(key, step->key, len);
+	return vjson_key_eq(key - 1, step->key);
+}
+
+// Match a value against the active paths, which have matched up to depth steps.
+// The paths active in each child are stored after them
+static int _vjson_query_value(const struct _vjson_query_run *r, const char **src, size_t *active, size_t nactive, size_t depth) {
+	_vjson_whitespace(src, r->end);
+	if (*src >= r->end) return -1;
+	const char *start = *src;
+
+	// Paths that end here match this value, and the others continue into it
+	size_t *cont = active + nactive, ncont = 0;
+	for (size_t i = 0; i < nactive; i++) {
+		if (r->q->paths[active[i]].nsteps > depth) cont[ncont++] = active[i];
+	}
+	size_t *child = cont + ncont;
+
+	char c = **src;
+	int ret;
+	if (!ncont || (c != '[' && c != '{')) {
+		if (_vjson_skip_value(src, r->end)) return -1;
+	} else if (c == '{') {
+		++*src;
+		_vjson_whitespace(src, r->end);
+		if (*src < r->end && **src == '}') {
+			++*src;
+		} else for (;;) {
+			_vjson_whitespace(src, r->end);
+			if (*src >= r->end || **src != '"') return -1;
+			_Bool esc = 0;
+			const char *key = *src + 1;
+			const char *kend = _vjson_string_end(key, r->end, &esc);
+			if (!kend) return -1;
+
+			size_t nchild = 0;
+			for (size_t i = 0; i < ncont; i++) {
+				const struct _vjson_step *step = &r->q->paths[cont[i]].steps[depth];
+				if (step->type == _vjson_STEP_MEMBERS || (step->type == _vjson_STEP_KEY && _vjson_step_key(step, key, kend - 1 - key))) {
+					child[nchild++] = cont[i];
+				}
+			}
+
+			*src = kend;
+			_vjson_whitespace(src, r->end);
+			if (*src >= r->end || **src != ':') return -1;
+			++*src;
+			if ((ret = _vjson_query_value(r, src, child, nchild, depth + 1))) return ret;
+
+			_vjson_whitespace(src, r->end);
+			if (*src >= r->end) return -1;
+			if (*(*src)++ == '}') break;
+			if ((*src)[-1] != ',') return -1;
+		}
+	} else {
+		++*src;
+		_vjson_whitespace(src, r->end);
+		if (*src < r->end && **src == ']') {
+			++*src;
+		} else for (size_t index = 0;; index++) {
+			size_t nchild = 0;
+			for (size_t i = 0; i < ncont; i++) {
+				const struct _vjson_step *step = &r->q->paths[cont[i]].steps[depth];
+				if (step->type == _vjson_STEP_ITEMS || (step->type == _vjson_STEP_INDEX && step->index == index)) {
+					child[nchild++] = cont[i];
+				}
+			}
+			if ((ret = _vjson_query_value(r, src, child, nchild, depth + 1))) return ret;
+
+			_vjson_whitespace(src, r->end);
+			if (*src >= r->end) return -1;
+			if (*(*src)++ == ']') break;
+			if ((*src)[-1] != ',') return -1;
+		}
+	}
+
+	for (size_t i = 0; i < nactive; i++) {
+		if (r->q->paths[active[i]].nsteps != depth) continue;
+		if ((ret = r->match(r->ctx, active[i], start, *src - start))) return ret;
+	}
+	return 0;
+}
+
+int vjson_query(const struct vjson_query *q, const char *src, const char *end, vjson_match_fn match, void *ctx) {
+	// Each level of nesting needs space for the active paths, split into
+	// those that end and those that continue
+	size_t *active = malloc((2 * q->depth + 2) * (q->npaths ? q->npaths : 1) * sizeof *active);
+	if (!active) return -1;
+
+	struct _vjson_query_run r = {q, end, match, ctx};
+	int ret = 0;
+	for (;;) {
+		_vjson_whitespace(&src, end);
+		if (src >= end) break;
+
+		for (size_t i = 0; i < q->npaths; i++) active[i] = i;
+		if ((ret = _vjson_query_value(&r, &src, active, q->npaths, 0))) break;
+	}
+
+	free(active);
+	return ret;
+}
+// }}}
+
+// Writer {{{
+static int _vjson_w_flush(struct vjson_writer *w, const char *buf, size_t len) {
+#if defined(__unix__) || defined(__APPLE__)
+	while (len) {
+		ssize_t n = write(w->fd, buf, len);
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			return w->err = -1;
+		}
+		buf += n;
+		len -= n;
+	}
+	return 0;
+#else
+	return w->err = -1;
+#endif
+}
+
+// Make space for n more bytes
+static int _vjson_w_reserve(struct vjson_writer *w, size_t n) {
+	if (w->err) return w->err;
+	if (w->cap - w->len >= n) return 0;
+
+	if (w->fd >= 0) {
+		if (_vjson_w_flush(w, w->buf, w->len)) return -1;
+		w->len = 0;
+		if (w->cap >= n) return 0;
+	}
+	if (!w->alloc || w->fd >= 0) return w->err = -1;
+
+	size_t cap = w->cap ? w->cap : 64;
+	while (cap - w->len < n) cap *= 2;
+	char *buf = realloc(w->buf, cap);
+	if (!buf) return w->err = -1;
+	w->buf = buf;
+	w->cap = cap;
+	return 0;
+}
+
+static int _vjson_w_put(struct vjson_writer *w, const char *s, size_t n) {
+	// Large writes go straight to the file
+	if (w->fd >= 0 && n > w->cap - w->len && n >= w->cap / 2) {
+		if (w->err || _vjson_w_flush(w, w->buf, w->len)) return -1;
+		w->len = 0;
+		return _vjson_w_flush(w, s, n);
+	}
+
+	if (_vjson_w_reserve(w, n)) return -1;
+	memcpy(w->buf + w->len, s, n);
+	w->len += n;
+	return 0;
+}
+
+static int _vjson_w_newline(struct vjson_writer *w, size_t depth) {
+	if (!w->indent) return 0;
+	if (_vjson_w_put(w, "\n", 1)) return -1;
+	size_t n = strlen(w->indent);
+	while (depth--) {
+		if (_vjson_w_put(w, w->indent, n)) return -1;
+	}
+	return 0;
+}
+
+static inline _Bool _vjson_w_object(const struct vjson_writer *w) {
+	size_t i = w->depth - 1;
+	return w->depth && w->stack[i / 64] >> (i % 64) & 1;
+}
+
+// Separate an item from the one before it
+static int _vjson_w_item(struct vjson_writer *w) {
+	if (w->err) return w->err;
+	_Bool first = w->first;
+	w->first = 0;
+	if (!w->depth) return first ? 0 : _vjson_w_put(w, "\n", 1);
+	if (!first && _vjson_w_put(w, ",", 1)) return -1;
+	return _vjson_w_newline(w, w->depth);
+}
+
+// Start a value, which must follow a key in objects
+static int _vjson_w_value(struct vjson_writer *w) {
+	if (w->err) return w->err;
+	if (w->key) {
+		w->key = 0;
+		return 0;
+	}
+	if (_vjson_w_object(w)) return w->err = -1;
+	return _vjson_w_item(w);
+}
+
+static const char _vjson_digits[] =
+	"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+	"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+// Format an integer backwards from end, two digits at a time
+static char *_vjson_utoa(char *end, uint64_t val) {
+	while (val >= 100) {
+		unsigned i = val % 100 * 2;
+		val /= 100;
+		*--end = _vjson_digits[i + 1];
+		*--end = _vjson_digits[i];
+	}
+	if (val >= 10) {
+		*--end = _vjson_digits[val * 2 + 1];
+		*--end = _vjson_digits[val * 2];
+	} else {
+		*--end = '0' + val;
+	}
+	return end;
+}
+
+// Grisu2 {{{
+// Floating point numbers with a 64-bit significand
+struct _vjson_fp {
+	uint64_t f;
+	int e;
+};
+
+static inline struct _vjson_fp _vjson_fp_mul(struct _vjson_fp a, struct _vjson_fp b) {
+	uint64_t lo, hi = _vjson_mul128(a.f, b.f, &lo);
+	hi += lo >> 63; // Round
+	return (struct _vjson_fp){hi, a.e + b.e + 64};
+}
+
+// Normalized 10^k for k from -348 to 340 in steps of 8
+static const struct _vjson_fp _vjson_cached_pow10[] = {
+	{0xfa8fd5a0081c0288, -1220}, {0xbaaee17fa23ebf76, -1193}, {0x8b16fb203055ac76, -1166},
+	{0xcf42894a5dce35ea, -1140}, {0x9a6bb0aa55653b2d, -1113}, {0xe61acf033d1a45df, -1087},
+	{0xab70fe17c79ac6ca, -1060}, {0xff77b1fcbebcdc4f, -1034}, {0xbe5691ef416bd60c, -1007},
+	{0x8dd01fad907ffc3c, -980}, {0xd3515c2831559a83, -954}, {0x9d71ac8fada6c9b5, -927},
+	{0xea9c227723ee8bcb, -901}, {0xaecc49914078536d, -874}, {0x823c12795db6ce57, -847},
+	{0xc21094364dfb5637, -821}, {0x9096ea6f3848984f, -794}, {0xd77485cb25823ac7, -768},
+	{0xa086cfcd97bf97f4, -741}, {0xef340a98172aace5, -715}, {0xb23867fb2a35b28e, -688},
+	{0x84c8d4dfd2c63f3b, -661}, {0xc5dd44271ad3cdba, -635}, {0x936b9fcebb25c996, -608},
+	{0xdbac6c247d62a584, -582}, {0xa3ab66580d5fdaf6, -555}, {0xf3e2f893dec3f126, -529},
+	{0xb5b5ada8aaff80b8, -502}, {0x87625f056c7c4a8b, -475}, {0xc9bcff6034c13053, -449},
+	{0x964e858c91ba2655, -422}, {0xdff9772470297ebd, -396}, {0xa6dfbd9fb8e5b88f, -369},
+	{0xf8a95fcf88747d94, -343}, {0xb94470938fa89bcf, -316}, {0x8a08f0f8bf0f156b, -289},
+	{0xcdb02555653131b6, -263}, {0x993fe2c6d07b7fac, -236}, {0xe45c10c42a2b3b06, -210},
+	{0xaa242499697392d3, -183}, {0xfd87b5f28300ca0e, -157}, {0xbce5086492111aeb, -130},
+	{0x8cbccc096f5088cc, -103}, {0xd1b71758e219652c, -77}, {0x9c40000000000000, -50},
+	{0xe8d4a51000000000, -24}, {0xad78ebc5ac620000, 3}, {0x813f3978f8940984, 30},
+	{0xc097ce7bc90715b3, 56}, {0x8f7e32ce7bea5c70, 83}, {0xd5d238a4abe98068, 109},
+	{0x9f4f2726179a2245, 136}, {0xed63a231d4c4fb27, 162}, {0xb0de65388cc8ada8, 189},
+	{0x83c7088e1aab65db, 216}, {0xc45d1df942711d9a, 242}, {0x924d692ca61be758, 269},
+	{0xda01ee641a708dea, 295}, {0xa26da3999aef774a, 322}, {0xf209787bb47d6b85, 348},
+	{0xb454e4a179dd1877, 375}, {0x865b86925b9bc5c2, 402}, {0xc83553c5c8965d3d, 428},
+	{0x952ab45cfa97a0b3, 455}, {0xde469fbd99a05fe3, 481}, {0xa59bc234db398c25, 508},
+	{0xf6c69a72a3989f5c, 534}, {0xb7dcbf5354e9bece, 561}, {0x88fcf317f22241e2, 588},
+	{0xcc20ce9bd35c78a5, 614}, {0x98165af37b2153df, 641}, {0xe2a0b5dc971f303a, 667},
+	{0xa8d9d1535ce3b396, 694}, {0xfb9b7cd9a4a7443c, 720}, {0xbb764c4ca7a44410, 747},
+	{0x8bab8eefb6409c1a, 774}, {0xd01fef10a657842c, 800}, {0x9b10a4e5e9913129, 827},
+	{0xe7109bfba19c0c9d, 853}, {0xac2820d9623bf429, 880}, {0x80444b5e7aa7cf85, 907},
+	{0xbf21e44003acdd2d, 933}, {0x8e679c2f5e44ff8f, 960}, {0xd433179d9c8cb841, 986},
+	{0x9e19db92b4e31ba9, 1013}, {0xeb96bf6ebadf77d9, 1039}, {0xaf87023b9bf0ee6b, 1066},
+};
+
+static const uint64_t _vjson_pow10_u64[] = {
+	1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull,
+	100000000ull, 1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull,
+	10000000000000ull, 100000000000000ull, 1000000000000000ull, 10000000000000000ull,
+	100000000000000000ull, 1000000000000000000ull, 10000000000000000000ull,
+};
+
+// Move the last digit towards the exact value while it stays within the bounds
+static void _vjson_grisu_round(char *buf, int len, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w) {
+	while (rest < wp_w && delta - rest >= ten_kappa && (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+		buf[len - 1]--;
+		rest += ten_kappa;
+	}
+}
+
+// Generate the digits of the shortest number between wp - delta and wp
+static int _vjson_grisu_digits(struct _vjson_fp w, struct _vjson_fp wp, uint64_t delta, char *buf, int *k) {
+	struct _vjson_fp one = {1ull << -wp.e, wp.e};
+	uint64_t wp_w = wp.f - w.f;
+	uint32_t p1 = wp.f >> -one.e;
+	uint64_t p2 = wp.f & (one.f - 1);
+
+	int len = 0, kappa = 1;
+	while (kappa < 10 && p1 >= _vjson_pow10_u64[kappa]) kappa++;
+
+	// Integer part
+	while (kappa > 0) {
+		uint32_t pow = _vjson_pow10_u64[kappa - 1];
+		uint32_t d = p1 / pow;
+		p1 %= pow;
+		if (d || len) buf[len++] = '0' + d;
+		kappa--;
+
+		uint64_t rest = ((uint64_t)p1 << -one.e) + p2;
+		if (rest <= delta) {
+			*k += kappa;
+			_vjson_grisu_round(buf, len, delta, rest, _vjson_pow10_u64[kappa] << -one.e, wp_w);
+			return len;
+		}
+	}
+
+	// Fractional part
+	for (;;) {
+		p2 *= 10;
+		delta *= 10;
+		char d = p2 >> -one.e;
+		if (d || len) buf[len++] = '0' + d;
+		p2 &= one.f - 1;
+		kappa--;
+		if (p2 < delta) {
+			*k += kappa;
+			_vjson_grisu_round(buf, len, delta, p2, one.f, -kappa < 20 ? wp_w * _vjson_pow10_u64[-kappa] : 0);
+			return len;
+		}
+	}
+}
+
+// Write the digits of a positive, finite double. Returns the number of digits,
+// which are multiplied by 10^k
+static int _vjson_grisu2(double val, char *buf, int *k) {
+	uint64_t bits;
+	memcpy(&bits, &val, sizeof bits);
+	int bexp = bits >> 52 & 0x7ff;
+	uint64_t mant = bits & ((1ull << 52) - 1);
+	struct _vjson_fp v = bexp ? (struct _vjson_fp){mant | 1ull << 52, bexp - 1075} : (struct _vjson_fp){mant, -1074};
+
+	// The boundaries halfway to the neighbouring doubles, normalized to the same exponent
+	struct _vjson_fp plus = {(v.f << 1) + 1, v.e - 1};
+	while (!(plus.f & (1ull << 53))) {
+		plus.f <<= 1;
+		plus.e--;
+	}
+	plus.f <<= 10;
+	plus.e -= 10;
+	struct _vjson_fp minus = v.f == 1ull << 52 ? (struct _vjson_fp){(v.f << 2) - 1, v.e - 2} : (struct _vjson_fp){(v.f << 1) - 1, v.e - 1};
+	minus.f <<= minus.e - plus.e;
+	minus.e = plus.e;
+
+	unsigned lz = _vjson_clz(v.f);
+	v.f <<= lz;
+	v.e -= lz;
+
+	// Choose a power of ten that brings the upper boundary's exponent into [-60, -32]
+	double dk = (-61 - plus.e) * 0.30102999566398114 + 347;
+	int ik = dk;
+	if (dk - ik > 0) ik++;
+	unsigned index = (ik >> 3) + 1;
+	*k = -(-348 + (int)index * 8);
+	struct _vjson_fp c = _vjson_cached_pow10[index];
+
+	struct _vjson_fp w = _vjson_fp_mul(v, c);
+	struct _vjson_fp wp = _vjson_fp_mul(plus, c);
+	struct _vjson_fp wm = _vjson_fp_mul(minus, c);
+	wm.f++;
+	wp.f--;
+	return _vjson_grisu_digits(w, wp, wp.f - wm.f, buf, k);
+}
+// }}}
+
+// Format a finite double into buf, which must hold 32 bytes
+static size_t _vjson_dtoa(double val, char *buf) {
+	char *p = buf;
+	if (signbit(val)) {
+		*p++ = '-';
+		val = -val;
+	}
+	if (val == 0) {
+		memcpy(p, "0.0", 3);
+		return p + 3 - buf;
+	}
+
+	int k;
+	int len = _vjson_grisu2(val, p, &k);
+	int kk = len + k; // 10^(kk-1) <= val < 10^kk
+
+	if (k >= 0 && kk <= 21) {
+		// 1234e7 -> 12340000000.0
+		memset(p + len, '0', kk - len);
+		memcpy(p + kk, ".0", 2);
+		return p + kk + 2 - buf;
+	} else if (kk > 0 && kk <= 21) {
+		// 1234e-2 -> 12.34
+		memmove(p + kk + 1, p + kk, len - kk);
+		p[kk] = '.';
+		return p + len + 1 - buf;
+	} else if (kk > -6 && kk <= 0) {
+		// 1234e-6 -> 0.001234
+		int off = 2 - kk;
+		memmove(p + off, p, len);
+		p[0] = '0';
+		p[1] = '.';
+		memset(p + 2, '0', off - 2);
+		return p + len + off - buf;
+	}
+
+	// 1234e30 -> 1.234e33
+	if (len > 1) {
+		memmove(p + 2, p + 1, len - 1);
+		p[1] = '.';
+		len++;
+	}
+	p += len;
+	*p++ = 'e';
+	int exp = kk - 1;
+	if (exp < 0) {
+		*p++ = '-';
+		exp = -exp;
+	}
+	char digits[4], *d = _vjson_utoa(digits + sizeof digits, exp);
+	memcpy(p, d, digits + sizeof digits - d);
+	return p + (digits + sizeof digits - d) - buf;
+}
+
+// Find the first byte that needs escaping
+static size_t _vjson_escape_span(const char *s, size_t len) {
+	size_t i = 0;
+#ifdef _VJSON_X86
+	const __m128i quote = _mm_set1_epi8('"'), bs = _mm_set1_epi8('\\'), ctl = _mm_set1_epi8(0x1f);
+	for (; i + 16 <= len; i += 16) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(s + i));
+		__m128i m = _mm_or_si128(_mm_cmpeq_epi8(x, quote), _mm_cmpeq_epi8(x, bs));
+		// Bytes up to 0x1f are unchanged by an unsigned max with 0x1f
+		m = _mm_or_si128(m, _mm_cmpeq_epi8(_mm_max_epu8(x, ctl), ctl));
+		unsigned mask = _mm_movemask_epi8(m);
+		if (mask) return i + _vjson_ctz(mask);
+	}
+#endif
+	for (; i < len; i++) {
+		unsigned char c = s[i];
+		if (c < 0x20 || c == '"' || c == '\\') break;
+	}
+	return i;
+}
+
+static int _vjson_w_string(struct vjson_writer *w, const char *s, size_t len) {
+	if (_vjson_w_put(w, "\"", 1)) return -1;
+	while (len) {
+		size_t n = _vjson_escape_span(s, len);
+		if (_vjson_w_put(w, s, n)) return -1;
+		s += n;
+		len -= n;
+		if (!len) break;
+
+		char esc[6] = {'\\'};
+		size_t esc_len = 2;
+		switch (*s) {
+		case '"': esc[1] = '"'; break;
+		case '\\': esc[1] = '\\'; break;
+		case '\b': esc[1] = 'b'; break;
+		case '\f': esc[1] = 'f'; break;
+		case '\n': esc[1] = 'n'; break;
+		case '\r': esc[1] = 'r'; break;
+		case '\t': esc[1] = 't'; break;
+		default:
+			memcpy(esc + 1, "u00", 3);
+			esc[4] = "0123456789abcdef"[*s >> 4];
+			esc[5] = "0123456789abcdef"[*s & 0xf];
+			esc_len = 6;
+			break;
+		}
+		if (_vjson_w_put(w, esc, esc_len)) return -1;
+		s++;
+		len--;
+	}
+	return _vjson_w_put(w, "\"", 1);
+}
+
+void vjson_writer_init(struct vjson_writer *w, char *buf, size_t cap, int fd) {
+	*w = (struct vjson_writer){.buf = buf, .cap = cap, .fd = fd, .first = 1};
+	if (!buf) {
+		w->alloc = 1;
+		if (fd >= 0 && !cap) w->cap = cap = 64 << 10;
+		if (cap && !(w->buf = malloc(cap))) {
+			w->cap = 0;
+			w->err = -1;
+		}
+	}
+}
+
+int vjson_writer_flush(struct vjson_writer *w) {
+	if (w->err) return w->err;
+	if (w->fd < 0) return 0;
+	if (_vjson_w_flush(w, w->buf, w->len)) return -1;
+	w->len = 0;
+	return 0;
+}
+
+void vjson_writer_free(struct vjson_writer *w) {
+	if (w->alloc) free(w->buf);
+	w->buf = NULL;
+	w->len = w->cap = 0;
+}
+
+int vjson_write_null(struct vjson_writer *w) {
+	if (_vjson_w_value(w)) return -1;
+	return _vjson_w_put(w, "null", 4);
+}
+
+int vjson_write_bool(struct vjson_writer *w, _Bool val) {
+	if (_vjson_w_value(w)) return -1;
+	return val ? _vjson_w_put(w, "true", 4) : _vjson_w_put(w, "false", 5);
+}
+
+int vjson_write_i64(struct vjson_writer *w, int64_t val) {
+	if (_vjson_w_value(w)) return -1;
+	char buf[20], *end = buf + sizeof buf;
+	char *p = _vjson_utoa(end, val < 0 ? -(uint64_t)val : (uint64_t)val);
+	if (val < 0) *--p = '-';
+	return _vjson_w_put(w, p, end - p);
+}
+
+int vjson_write_u64(struct vjson_writer *w, uint64_t val) {
+	if (_vjson_w_value(w)) return -1;
+	char buf[20], *end = buf + sizeof buf;
+	char *p = _vjson_utoa(end, val);
+	return _vjson_w_put(w, p, end - p);
+}
+
+int vjson_write_double(struct vjson_writer *w, double val) {
+	if (!isfinite(val)) return vjson_write_null(w);
+	if (_vjson_w_value(w)) return -1;
+	char buf[32];
+	return _vjson_w_put(w, buf, _vjson_dtoa(val, buf));
+}
+
+int vjson_write_string(struct vjson_writer *w, const char *s, size_t len) {
+	if (_vjson_w_value(w)) return -1;
+	return _vjson_w_string(w, s, len);
+}
+
+int vjson_write_key(struct vjson_writer *w, const char *s, size_t len) {
+	if (w->err) return w->err;
+	if (w->key || !_vjson_w_object(w)) return w->err = -1;
+	if (_vjson_w_item(w) || _vjson_w_string(w, s, len)) return -1;
+	w->key = 1;
+	return w->indent ? _vjson_w_put(w, ": ", 2) : _vjson_w_put(w, ":", 1);
+}
+
+static int _vjson_w_start(struct vjson_writer *w, _Bool object) {
+	if (w->depth == VJSON_MAX_DEPTH) return w->err = -1;
+	if (_vjson_w_value(w) || _vjson_w_put(w, object ? "{" : "[", 1)) return -1;
+
+	size_t i = w->depth++;
+	w->stack[i / 64] = (w->stack[i / 64] & ~(1ull << i % 64)) | (uint64_t)object << i % 64;
+	w->first = 1;
+	return 0;
+}
+
+int vjson_write_array(struct vjson_writer *w) {
+	return _vjson_w_start(w, 0);
+}
+
+int vjson_write_object(struct vjson_writer *w) {
+	return _vjson_w_start(w, 1);
+}
+
+int vjson_write_end(struct vjson_writer *w) {
+	if (w->err) return w->err;
+	if (!w->depth || w->key) return w->err = -1;
+
+	size_t i = --w->depth;
+	_Bool object = w->stack[i / 64] >> (i % 64) & 1;
+	if (!w->first && _vjson_w_newline(w, w->depth)) return -1;
+	w->first = 0;
+	return _vjson_w_put(w, object ? "}" : "]", 1);
+}
+// }}}
+
+// Struct binding {{{
+// Find the field for a key by its length and first byte, starting after the
+// last match, since keys usually come in the same order as the fields
+static const struct vjson_field *_vjson_field(const struct vjson_schema *schema, size_t *next, const char *key, size_t len) {
+	_Bool esc = memchr(key, '\\', len) != NULL;
+	size_t i = *next;
+	for (size_t n = 0; n < schema->nfields; n++, i++) {
+		if (i == schema->nfields) i = 0;
+		const struct vjson_field *f = &schema->fields[i];
+		if (esc ? vjson_key_eq(key - 1, f->name) : f->len == len && *f->name == *key && !memcmp(f->name, key, len)) {
+			*next = i + 1;
+			return f;
+		}
+	}
+	return NULL;
+}
+
+static int _vjson_bind_object(const struct vjson_schema *schema, char *out, const char **src, const char *end, struct varena **arena);
+
+static int _vjson_bind_number(const struct vjson_field *f, void *dst, const char **src, const char *end) {
+	struct _vjson_number n;
+	const char *p = _vjson_scan_number(*src, end, &n);
+	if (!p) return -1;
+
+	if (f->kind == VJSON_K_DOUBLE) {
+		*(double *)dst = _vjson_to_double(&n, *src, p);
+	} else if (!n.integral || n.overflow) {
+		return -1;
+	} else if (f->kind == VJSON_K_U64) {
+		if (n.negative && n.u) return -1;
+		*(uint64_t *)dst = n.u;
+	} else {
+		uint64_t max = f->kind == VJSON_K_INT ? INT_MAX : INT64_MAX;
+		if (n.u > max + n.negative) return -1;
+		int64_t val = n.negative && n.u ? -(int64_t)(n.u - 1) - 1 : (int64_t)n.u;
+		if (f->kind == VJSON_K_INT) *(int *)dst = val;
+		else *(int64_t *)dst = val;
+	}
+
+	*src = p;
+	return 0;
+}
+
+static int _vjson_bind_value(const struct vjson_field *f, char *out, const char **src, const char *end, struct varena **arena) {
+	void *dst = out + f->offset;
+	if (_vjson_keyword(src, end, "null")) return 0;
+
+	switch (f->kind) {
+	case VJSON_K_BOOL:
+		if (_vjson_keyword(src, end, "true")) *(_Bool *)dst = 1;
+		else if (_vjson_keyword(src, end, "false")) *(_Bool *)dst = 0;
+		else return -1;
+		return 0;
+
+	case VJSON_K_INT:
+	case VJSON_K_I64:
+	case VJSON_K_U64:
+	case VJSON_K_DOUBLE:
+		return _vjson_bind_number(f, dst, src, end);
+
+	case VJSON_K_STRING:;
+		if (**src != '"') return -1;
+		_Bool esc = 0;
+		const char *s = *src + 1, *p = _vjson_string_end(s, end, &esc);
+		if (!p) return -1;
+
+		size_t len = p - 1 - s;
+		char *str = aalloc(arena, len + 1);
+		if (!str) return -1;
+		len = _vjson_unescape(s, len, str);
+		str[len] = 0;
+		*(char **)dst = str;
+		*src = p;
+		return 0;
+
+	case VJSON_K_OBJECT:
+		return _vjson_bind_object(f->schema, dst, src, end, arena);
+	}
+	return -1;
+}
+
+static int _vjson_bind_object(const struct vjson_schema *schema, char *out, const char **src, const char *end, struct varena **arena) {
+	_vjson_whitespace(src, end);
+	if (*src >= end || **src != '{') return -1;
+	++*src;
+	_vjson_whitespace(src, end);
+	if (*src < end && **src == '}') {
+		++*src;
+		return 0;
+	}
+
+	size_t next = 0;
+	for (;;) {
+		_vjson_whitespace(src, end);
+		if (*src >= end || **src != '"') return -1;
+		_Bool esc = 0;
+		const char *key = *src + 1;
+		const char *kend = _vjson_string_end(key, end, &esc);
+		if (!kend) return -1;
+		const struct vjson_field *f = _vjson_field(schema, &next, key, kend - 1 - key);
+
+		*src = kend;
+		_vjson_whitespace(src, end);
+		if (*src >= end || **src != ':') return -1;
+		++*src;
+		_vjson_whitespace(src, end);
+		if (*src >= end) return -1;
+		if (f ? _vjson_bind_value(f, out, src, end, arena) : _vjson_skip_value(src, end)) return -1;
+
+		_vjson_whitespace(src, end);
+		if (*src >= end) return -1;
+		if (*(*src)++ == '}') return 0;
+		if ((*src)[-1] != ',') return -1;
+	}
+}
+
+int vjson_bind(const struct vjson_schema *schema, void *out, const char **src, const char *end, struct varena **arena) {
+	return _vjson_bind_object(schema, out, src, end, arena);
+}
+// }}}
+
 #endif
@@ -0,0 +1,454 @@
+/* vzip.h
+ *
+ * ZIP archive reader
+ * Define VZIP_IMPL in one translation unit
+ * Requires vinflate.h, and v.h in the implementation
+ *
+ * Limitations:
+ * - Only stored and deflated members can be extracted
+ * - Encrypted members and split archives are not supported
+ * - The whole archive is mapped into memory, so on 32-bit systems archives
+ *   larger than the address space cannot be opened
+ */
+
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+ * this software, either in source code form or as a compiled binary, for any
+ * purpose, commercial or non-commercial, and by any means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors of
+ * this software dedicate any and all copyright interest in the software to the
+ * public domain. We make this dedication for the benefit of the public at
+ * large and to the detriment of our heirs and successors. We intend this
+ * dedication to be an overt act of relinquishment in perpetuity of all present
+ * and future rights to this software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ */
+#ifndef VZIP_H
+#define VZIP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "vinflate.h"
+
+// Data types {{{
+enum {
+	VZIP_STORED = 0,
+	VZIP_DEFLATED = 8,
+};
+
+enum {
+	VZIP_FLAG_ENCRYPTED = 1<<0,
+	VZIP_FLAG_DESCRIPTOR = 1<<3, // Sizes and CRC follow the data instead of the local header
+	VZIP_FLAG_UTF8 = 1<<11,
+};
+
+// A member of the archive, read from the central directory. ZIP64 sizes and
+// offsets have already been substituted
+struct vzip_entry {
+	const char *name; // Points into the archive, and is not NUL-terminated
+	size_t name_len;
+
+	uint16_t method, flags;
+	uint32_t crc;
+	uint64_t comp_size, size;
+	uint64_t local_off; // Offset of the local header
+};
+
+struct vzip {
+	const unsigned char *data;
+	size_t len;
+	_Bool mapped; // data was mapped by vzip_open, and is unmapped by vzip_close
+
+	size_t nentries;
+	struct vzip_entry *entries;
+
+	const char *comment; // Archive comment, not NUL-terminated
+	size_t comment_len;
+};
+
+enum vzip_error {
+	VZIP_ERR_SUCCESS, // No error
+	VZIP_ERR_OPEN,
+	VZIP_ERR_FORMAT,
+	VZIP_ERR_UNSUPPORTED,
+	VZIP_ERR_NOMEM,
+	VZIP_ERR_SIZE,
+	VZIP_ERR_CRC,
+	VZIP_ERR_DATA,
+
+	VZIP_NERR,
+};
+extern const char *vzip_error_string[VZIP_NERR];
+// }}}
+
+// Map a file and read its central directory
+enum vzip_error vzip_open(struct vzip *z, const char *fn);
+// Read the central directory of an archive already in memory. The data must
+// stay alive until vzip_close
+enum vzip_error vzip_open_mem(struct vzip *z, const unsigned char *data, size_t len);
+void vzip_close(struct vzip *z);
+
+// Find an entry by name, returning NULL if there is none
+const struct vzip_entry *vzip_find(const struct vzip *z, const char *name);
+
+// Find an entry's compressed data, which points into the archive
+enum vzip_error vzip_data(const struct vzip *z, const struct vzip_entry *e, const unsigned char **data);
+// Decompress an entry into out, which must hold e->size bytes, and check its CRC
+enum vzip_error vzip_extract(const struct vzip *z, const struct vzip_entry *e, unsigned char *out);
+
+// Parallel extraction {{{
+// vzip_extract_all extracts each job's entry into its buffer, using up to
+// nthreads threads including the caller. Each job's error is set separately,
+// and the first is returned. Parallelism requires C11 threads, and is disabled
+// without them.
+struct vzip_job {
+	const struct vzip_entry *entry;
+	unsigned char *out; // Must hold entry->size bytes
+	enum vzip_error err;
+};
+
+enum vzip_error vzip_extract_all(const struct vzip *z, struct vzip_job *jobs, size_t njobs, unsigned nthreads);
+// }}}
+
+#endif
+
+#ifdef VZIP_IMPL
+#undef VZIP_IMPL
+
+#include <stdlib.h>
+#include <string.h>
+#include "v.h"
+
+#if __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_THREADS__) && !defined(__STDC_NO_ATOMICS__)
+#define _VZIP_THREADS
+#include <stdatomic.h>
+#include <threads.h>
+#endif
+
+const char *vzip_error_string[VZIP_NERR] = {
+	"Success",
+	"Could not open file",
+	"Malformed ZIP archive",
+	"Unsupported compression method or encryption",
+	"Out of memory",
+	"Size mismatch",
+	"CRC mismatch",
+	"Corrupt compressed data",
+};
+
+enum {
+	_vzip_SIG_LOCAL = 0x04034b50,
+	_vzip_SIG_CENTRAL = 0x02014b50,
+	_vzip_SIG_EOCD = 0x06054b50,
+	_vzip_SIG_EOCD64 = 0x06064b50,
+	_vzip_SIG_LOCATOR64 = 0x07064b50,
+
+	_vzip_LOCAL_LEN = 30,
+	_vzip_CENTRAL_LEN = 46,
+	_vzip_EOCD_LEN = 22,
+	_vzip_EOCD64_LEN = 56,
+	_vzip_LOCATOR64_LEN = 20,
+	_vzip_MAX_COMMENT = 0xffff,
+
+	_vzip_EXTRA_ZIP64 = 0x0001,
+};
+
+static inline uint16_t _vzip_le16(const unsigned char *p) {
+	return p[0] | p[1] << 8;
+}
+static inline uint32_t _vzip_le32(const unsigned char *p) {
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+static inline uint64_t _vzip_le64(const unsigned char *p) {
+	return _vzip_le32(p) | (uint64_t)_vzip_le32(p + 4) << 32;
+}
+
+// Central directory {{{
+// Replace 32-bit fields set to all ones with values from the ZIP64 extra
+// field, which stores only those fields, in order
+static enum vzip_error _vzip_zip64_extra(struct vzip_entry *e, const unsigned char *p, size_t len) {
+	while (len >= 4) {
+		uint16_t id = _vzip_le16(p), n = _vzip_le16(p + 2);
+		if (n > len - 4) return VZIP_ERR_FORMAT;
+		if (id == _vzip_EXTRA_ZIP64) {
+			const unsigned char *f = p + 4, *end = f + n;
+			uint64_t *fields[] = {&e->size, &e->comp_size, &e->local_off};
+			for (size_t i = 0; i < sizeof fields / sizeof *fields; i++) {
+				if (*fields[i] != 0xffffffff) continue;
+				if (end - f < 8) return VZIP_ERR_FORMAT;
+				*fields[i] = _vzip_le64(f);
+				f += 8;
+			}
+			return 0;
+		}
+		p += 4 + n;
+		len -= 4 + n;
+	}
+	return 0;
+}
+
+// Find the end of central directory record, which is followed only by the
+// archive comment. Searches backwards, so a comment containing the signature
+// isn't mistaken for it
+static const unsigned char *_vzip_find_eocd(const unsigned char *data, size_t len) {
+	if (len < _vzip_EOCD_LEN) return NULL;
+	size_t lim = len - _vzip_EOCD_LEN;
+	size_t start = lim > _vzip_MAX_COMMENT ? lim - _vzip_MAX_COMMENT : 0;
+	for (size_t off = lim + 1; off-- > start;) {
+		const unsigned char *p = data + off;
+		if (_vzip_le32(p) == _vzip_SIG_EOCD && _vzip_le16(p + 20) == lim - off) {
+			return p;
+		}
+	}
+	return NULL;
+}
+
+enum vzip_error vzip_open_mem(struct vzip *z, const unsigned char *data, size_t len) {
+	*z = (struct vzip){.data = data, .len = len};
+
+	const unsigned char *eocd = _vzip_find_eocd(data, len);
+	if (!eocd) return VZIP_ERR_FORMAT;
+	z->comment = (const char *)eocd + _vzip_EOCD_LEN;
+	z->comment_len = _vzip_le16(eocd + 20);
+
+	// Multi-disk archives are not supported
+	if (_vzip_le16(eocd + 4) || _vzip_le16(eocd + 6)) return VZIP_ERR_UNSUPPORTED;
+
+	uint64_t nentries = _vzip_le16(eocd + 10);
+	uint64_t cd_size = _vzip_le32(eocd + 12);
+	uint64_t cd_off = _vzip_le32(eocd + 16);
+
+	// A ZIP64 archive has a locator just before the EOCD record, pointing to
+	// the ZIP64 EOCD record
+	size_t eocd_off = eocd - data;
+	if (eocd_off >= _vzip_LOCATOR64_LEN) {
+		const unsigned char *loc = eocd - _vzip_LOCATOR64_LEN;
+		if (_vzip_le32(loc) == _vzip_SIG_LOCATOR64) {
+			uint64_t off = _vzip_le64(loc + 8);
+			if (off > eocd_off - _vzip_LOCATOR64_LEN || eocd_off - _vzip_LOCATOR64_LEN - off < _vzip_EOCD64_LEN) {
+				return VZIP_ERR_FORMAT;
+			}
+			const unsigned char *eocd64 = data + off;
+			if (_vzip_le32(eocd64) != _vzip_SIG_EOCD64) return VZIP_ERR_FORMAT;
+			if (_vzip_le32(eocd64 + 16) || _vzip_le32(eocd64 + 20)) return VZIP_ERR_UNSUPPORTED;
+			nentries = _vzip_le64(eocd64 + 32);
+			cd_size = _vzip_le64(eocd64 + 40);
+			cd_off = _vzip_le64(eocd64 + 48);
+		}
+	}
+
+	if (cd_off > len || cd_size > len - cd_off) return VZIP_ERR_FORMAT;
+	// Each entry takes at least a fixed-size header, which bounds the allocation
+	if (nentries > cd_size / _vzip_CENTRAL_LEN) return VZIP_ERR_FORMAT;
+
+	z->entries = malloc((nentries ? nentries : 1) * sizeof *z->entries);
+	if (!z->entries) return VZIP_ERR_NOMEM;
+
+	const unsigned char *p = data + cd_off, *end = p + cd_size;
+	for (uint64_t i = 0; i < nentries; i++) {
+		if (end - p < _vzip_CENTRAL_LEN || _vzip_le32(p) != _vzip_SIG_CENTRAL) goto malformed;
+
+		size_t name_len = _vzip_le16(p + 28);
+		size_t extra_len = _vzip_le16(p + 30);
+		size_t comment_len = _vzip_le16(p + 32);
+		if ((size_t)(end - p - _vzip_CENTRAL_LEN) < name_len + extra_len + comment_len) goto malformed;
+
+		struct vzip_entry *e = &z->entries[i];
+		*e = (struct vzip_entry){
+			.name = (const char *)p + _vzip_CENTRAL_LEN,
+			.name_len = name_len,
+			.flags = _vzip_le16(p + 8),
+			.method = _vzip_le16(p + 10),
+			.crc = _vzip_le32(p + 16),
+			.comp_size = _vzip_le32(p + 20),
+			.size = _vzip_le32(p + 24),
+			.local_off = _vzip_le32(p + 42),
+		};
+		if (_vzip_zip64_extra(e, p + _vzip_CENTRAL_LEN + name_len, extra_len)) goto malformed;
+
+		p += _vzip_CENTRAL_LEN + name_len + extra_len + comment_len;
+	}
+	z->nentries = nentries;
+	return 0;
+
+malformed:
+	free(z->entries);
+	z->entries = NULL;
+	return VZIP_ERR_FORMAT;
+}
+
+enum vzip_error vzip_open(struct vzip *z, const char *fn) {
+	size_t len;
+	const unsigned char *data = mapfile(fn, &len);
+	if (!data) {
+		*z = (struct vzip){0};
+		return VZIP_ERR_OPEN;
+	}
+
+	enum vzip_error err = vzip_open_mem(z, data, len);
+	if (err) {
+		munmap((void *)data, len);
+		*z = (struct vzip){0};
+		return err;
+	}
+	z->mapped = 1;
+	return 0;
+}
+
+void vzip_close(struct vzip *z) {
+	free(z->entries);
+	if (z->mapped) munmap((void *)z->data, z->len);
+	*z = (struct vzip){0};
+}
+
+const struct vzip_entry *vzip_find(const struct vzip *z, const char *name) {
+	size_t len = strlen(name);
+	for (size_t i = 0; i < z->nentries; i++) {
+		const struct vzip_entry *e = &z->entries[i];
+		if (e->name_len == len && !memcmp(e->name, name, len)) return e;
+	}
+	return NULL;
+}
+// }}}
+
+// Extraction {{{
+enum vzip_error vzip_data(const struct vzip *z, const struct vzip_entry *e, const unsigned char **data) {
+	// The local header repeats most of the central directory entry, but its
+	// name and extra field lengths may differ
+	if (e->local_off > z->len || z->len - e->local_off < _vzip_LOCAL_LEN) return VZIP_ERR_FORMAT;
+	const unsigned char *p = z->data + e->local_off;
+	if (_vzip_le32(p) != _vzip_SIG_LOCAL) return VZIP_ERR_FORMAT;
+
+	uint64_t off = e->local_off + _vzip_LOCAL_LEN + _vzip_le16(p + 26) + _vzip_le16(p + 28);
+	if (off > z->len || e->comp_size > z->len - off) return VZIP_ERR_FORMAT;
+
+	*data = z->data + off;
+	return 0;
+}
+
+// Decompress with the streaming decoder, for entries too large for vinflate
+static enum vzip_error _vzip_inflate_stream(const unsigned char *inp, uint64_t inp_len, unsigned char *out, uint64_t out_len, uint32_t *crc) {
+	struct vinf_stream *s = malloc(sizeof *s);
+	if (!s) return VZIP_ERR_NOMEM;
+
+	vinf_stream_init(s, VINF_STREAM_RAW);
+	s->inp = inp;
+	s->inp_len = inp_len;
+	s->out = out;
+	s->out_len = out_len;
+
+	enum vzip_error err = 0;
+	if (vinflate_stream(s)) err = VZIP_ERR_DATA;
+	else if (!s->done) err = s->out_len ? VZIP_ERR_DATA : VZIP_ERR_SIZE;
+	else if (s->total_out != out_len) err = VZIP_ERR_SIZE;
+	*crc = s->crc;
+
+	free(s);
+	return err;
+}
+
+enum vzip_error vzip_extract(const struct vzip *z, const struct vzip_entry *e, unsigned char *out) {
+	if (e->flags & VZIP_FLAG_ENCRYPTED) return VZIP_ERR_UNSUPPORTED;
+
+	const unsigned char *data;
+	enum vzip_error err = vzip_data(z, e, &data);
+	if (err) return err;
+
+	switch (e->method) {
+	case VZIP_STORED:
+		if (e->comp_size != e->size) return VZIP_ERR_SIZE;
+		memcpy(out, data, e->size);
+		if (vinf_crc32_buf(0, out, e->size) != e->crc) return VZIP_ERR_CRC;
+		return 0;
+
+	case VZIP_DEFLATED:
+		if (e->size > UINT32_MAX) {
+			uint32_t crc;
+			err = _vzip_inflate_stream(data, e->comp_size, out, e->size, &crc);
+			if (err) return err;
+			if (crc != e->crc) return VZIP_ERR_CRC;
+			return 0;
+		}
+
+		// vinflate checks the CRC as it goes, while the output is in cache
+		switch (vinflate((struct vinf_data){data, e->comp_size, out, e->crc, e->size})) {
+		case VENF_ERR_SUCCESS: return 0;
+		case VENF_ERR_CRC_MISMATCH: return VZIP_ERR_CRC;
+		case VENF_ERR_OVERFLOW: return VZIP_ERR_SIZE;
+		default: return VZIP_ERR_DATA;
+		}
+
+	default:
+		return VZIP_ERR_UNSUPPORTED;
+	}
+}
+// }}}
+
+// Parallel extraction {{{
+struct _vzip_extract_job {
+	const struct vzip *z;
+	struct vzip_job *jobs;
+	size_t njobs;
+#ifdef _VZIP_THREADS
+	atomic_size_t next;
+#else
+	size_t next;
+#endif
+};
+
+static int _vzip_extract_worker(void *arg) {
+	struct _vzip_extract_job *job = arg;
+	for (;;) {
+#ifdef _VZIP_THREADS
+		size_t i = atomic_fetch_add(&job->next, 1);
+#else
+		size_t i = job->next++;
+#endif
+		if (i >= job->njobs) return 0;
+
+		struct vzip_job *j = &job->jobs[i];
+		j->err = vzip_extract(job->z, j->entry, j->out);
+	}
+}
+
+enum vzip_error vzip_extract_all(const struct vzip *z, struct vzip_job *jobs, size_t njobs, unsigned nthreads) {
+	struct _vzip_extract_job job = {.z = z, .jobs = jobs, .njobs = njobs};
+
+#ifdef _VZIP_THREADS
+	// The calling thread works too. If threads can't be created, carry on
+	// with fewer of them
+	size_t n = nthreads < njobs ? nthreads : njobs;
+	thrd_t *threads = n > 1 ? malloc((n - 1) * sizeof *threads) : NULL;
+	size_t started = 0;
+	if (threads) {
+		for (; started + 1 < n; started++) {
+			if (thrd_create(&threads[started], _vzip_extract_worker, &job) != thrd_success) break;
+		}
+	}
+	_vzip_extract_worker(&job);
+	for (size_t i = 0; i < started; i++) thrd_join(threads[i], NULL);
+	free(threads);
+#else
+	(void)nthreads;
+	_vzip_extract_worker(&job);
+#endif
+
+	for (size_t i = 0; i < njobs; i++) {
+		if (jobs[i].err) return jobs[i].err;
+	}
+	return 0;
+}
+// }}}
+
+#endif